@@ -1,3 +1,5 @@
+require("rgbds.hardware").setup()
+require("rgbds.macros").setup()
 vim.treesitter.start()
 
 -- Set comment string for commenting/uncommenting
@@ -12,3 +14,46 @@ vim.bo.cindent = false
 
 vim.wo.foldexpr = "v:lua.vim.treesitter.foldexpr()"
 vim.wo.foldmethod = "expr"
+
+vim.bo.omnifunc = "v:lua.require'rgbds.complete'.omnifunc"
+-- the analyzers enabled in setup()
+require("rgbds").attach(0)
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsReferences", function(args)
+	require("rgbds.references").quickfix(args.args ~= "" and args.args or nil)
+end, { nargs = "?", desc = "References of a symbol in the project" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsSections", function()
+	require("rgbds").attach(0, "sizes")
+	require("rgbds.sizes").report(0)
+end, { desc = "Bytes used per bank by the sections of the buffer" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsCost", function(args)
+	require("rgbds").attach(0, "costs")
+	require("rgbds.costs").report(0, args.line1, args.line2)
+end, { range = true, desc = "Bytes and cycles of the instructions in the range" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsStack", function()
+	require("rgbds").attach(0, "stack")
+	require("rgbds.stack").report(0, vim.api.nvim_win_get_cursor(0)[1] - 1)
+end, { desc = "Maximum stack depth of the function at the cursor" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsLatency", function()
+	require("rgbds").attach(0, "latency")
+	require("rgbds.latency").quickfix(0)
+end, { desc = "Code running with interrupts disabled, longest first" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsPeephole", function()
+	require("rgbds").attach(0, "peephole")
+	require("rgbds.peephole").quickfix(0)
+end, { desc = "Cheaper equivalents of instructions in the buffer" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsRewrite", function()
+	require("rgbds").attach(0, "peephole")
+	require("rgbds.peephole").apply(0, vim.api.nvim_win_get_cursor(0)[1] - 1)
+end, { desc = "Replace the instructions at the cursor with their cheaper equivalent" })
+
+vim.api.nvim_buf_create_user_command(0, "RgbdsJumps", function()
+	require("rgbds").attach(0, "jumps")
+	require("rgbds.jumps").quickfix(0)
+end, { desc = "jp that could be jr and jr out of range" })
@@ -0,0 +1,221 @@
+-- What the analyzers of a buffer share: a cache of results by syntax node,
+-- the changed rows of the buffer and a timer running their update.
+--
+-- A reparse keeps the nodes an edit did not touch, with their ids, so a
+-- result cached by node id stays valid until its node changes. Every entry
+-- holds its node in `node`, which keeps its tree and thereby the id from
+-- being reused by another node. Entries marked `volatile` read constants or
+-- files and are computed again every time they are needed.
+
+local M = {}
+
+---Entries a cache keeps before it is dropped and built again.
+M.cache_limit = 100000
+
+---@class rgbds.NodeCache
+---@field entries table<integer, { node: TSNode, volatile: boolean|nil }> by node id
+---@field count integer
+local NodeCache = {}
+NodeCache.__index = NodeCache
+
+---@return rgbds.NodeCache
+function M.cache()
+	return setmetatable({ entries = {}, count = 0 }, NodeCache)
+end
+
+---The entry of `node`, volatile or not, nil if there is none.
+---@param node TSNode
+---@return table|nil
+function NodeCache:peek(node)
+	return self.entries[node:id()]
+end
+
+---The entry of `node` if it is still valid.
+---@param node TSNode
+---@return table|nil
+function NodeCache:get(node)
+	local entry = self.entries[node:id()]
+	if entry and not entry.volatile then
+		return entry
+	end
+	return nil
+end
+
+---Caches `entry` for `node` and returns it.
+---@generic T
+---@param node TSNode
+---@param entry T
+---@return T
+function NodeCache:put(node, entry)
+	local id = node:id()
+	if self.entries[id] == nil then
+		self.count = self.count + 1
+	end
+	self.entries[id] = entry
+	return entry
+end
+
+---Drops the entries once there are more than `cache_limit`. Called at the
+---start of an update, when no entry is in use.
+function NodeCache:trim()
+	if self.count > M.cache_limit then
+		self.entries, self.count = {}, 0
+	end
+end
+
+---@class rgbds.Analyzer
+---@field name string e.g. "stack", names the autocommand groups
+---@field buffers table<integer, table> the state of every attached buffer
+---@field update fun(buf: integer)
+---@field delay integer milliseconds from the last change to the update
+---@field namespaces integer[] cleared on detach
+---@field highlights? fun() defines the highlight groups, again on ColorScheme
+---@field dirty? integer if set, `state.dirty` collects the changed rows
+---and as many rows above them, see `M.take_dirty()`
+---@field depends? string[] modules attached to the buffer first, e.g.
+---"rgbds.values" for an analyzer reading constants
+---@field on_detach? fun(buf: integer, state: table) releases what the state
+---holds besides its timer and namespaces
+
+local highlighted = {}
+
+---Detaches `analyzer` from `buf` and clears what it shows.
+---@param buf integer
+---@param analyzer rgbds.Analyzer
+function M.detach(buf, analyzer)
+	local state = analyzer.buffers[buf]
+	if state == nil then
+		return
+	end
+	analyzer.buffers[buf] = nil
+	state.timer:close()
+	if vim.api.nvim_buf_is_valid(buf) then
+		for _, ns in ipairs(analyzer.namespaces) do
+			vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+		end
+	end
+	if analyzer.on_detach then
+		analyzer.on_detach(buf, state)
+	end
+end
+
+---Attaches `analyzer` to `buf` (0 or nil for the current buffer) with
+---`state`, or the state `state(buf)` returns, after the modules it depends
+---on. The state gets a `timer` (and `dirty`). The update runs `delay` after
+---the last change and once after attaching. Returns the function scheduling
+---an update, nil if `analyzer` was attached to `buf` already.
+---@param buf integer|nil
+---@param analyzer rgbds.Analyzer
+---@param state table|fun(buf: integer): table
+---@return fun()|nil
+function M.attach(buf, analyzer, state)
+	if buf == nil or buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	if analyzer.buffers[buf] then
+		return nil
+	end
+	for _, name in ipairs(analyzer.depends or {}) do
+		require(name).attach(buf)
+	end
+	if type(state) == "function" then
+		state = state(buf)
+	end
+	if analyzer.highlights and not highlighted[analyzer.name] then
+		highlighted[analyzer.name] = true
+		analyzer.highlights()
+		vim.api.nvim_create_autocmd("ColorScheme", {
+			group = vim.api.nvim_create_augroup("rgbds." .. analyzer.name, { clear = true }),
+			callback = analyzer.highlights,
+		})
+	end
+	state.timer = assert(vim.uv.new_timer())
+	analyzer.buffers[buf] = state
+	local function schedule()
+		state.timer:start(analyzer.delay, 0, vim.schedule_wrap(function()
+			analyzer.update(buf)
+		end))
+	end
+
+	local group = vim.api.nvim_create_augroup("rgbds." .. analyzer.name .. "." .. buf, { clear = true })
+	if analyzer.dirty then
+		local above = analyzer.dirty
+		state.dirty = { { 0, vim.api.nvim_buf_line_count(buf) } }
+		vim.api.nvim_buf_attach(buf, false, {
+			on_bytes = function(_, _, _, start_row, _, _, old_rows, _, _, new_rows)
+				if analyzer.buffers[buf] ~= state then
+					return true
+				end
+				local delta = new_rows - old_rows
+				for _, range in ipairs(state.dirty) do
+					if range[1] > start_row then
+						range[1] = math.max(start_row, range[1] + delta)
+					end
+					if range[2] > start_row then
+						range[2] = math.max(start_row + 1, range[2] + delta)
+					end
+				end
+				table.insert(state.dirty, { math.max(0, start_row - above), start_row + new_rows + 1 })
+				schedule()
+			end,
+			on_detach = function()
+				M.detach(buf, analyzer)
+			end,
+		})
+		local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+		if ok and parser then
+			parser:register_cbs({
+				on_changedtree = function(changes)
+					if analyzer.buffers[buf] ~= state then
+						return
+					end
+					for _, change in ipairs(changes) do
+						-- Range4 or Range6
+						local end_row = #change == 6 and change[4] or change[3]
+						table.insert(state.dirty, { change[1], end_row + 1 })
+					end
+				end,
+			})
+		end
+	else
+		vim.api.nvim_create_autocmd({ "TextChanged", "TextChangedI" }, {
+			group = group,
+			buffer = buf,
+			callback = schedule,
+		})
+	end
+	vim.api.nvim_create_autocmd({ "BufUnload", "BufWipeout" }, {
+		group = group,
+		buffer = buf,
+		callback = function()
+			vim.api.nvim_del_augroup_by_id(group)
+			M.detach(buf, analyzer)
+		end,
+	})
+	schedule()
+	return schedule
+end
+
+---The rows of `state` changed since the last call, merged and sorted, end
+---exclusive.
+---@param state { dirty: integer[][] }
+---@return integer[][]
+function M.take_dirty(state)
+	local ranges = state.dirty
+	state.dirty = {}
+	table.sort(ranges, function(a, b)
+		return a[1] < b[1]
+	end)
+	local merged = {}
+	for _, range in ipairs(ranges) do
+		local last = merged[#merged]
+		if last and range[1] <= last[2] then
+			last[2] = math.max(last[2], range[2])
+		else
+			merged[#merged + 1] = { range[1], range[2] }
+		end
+	end
+	return merged
+end
+
+return M
@@ -0,0 +1,329 @@
+-- Completion of symbols, instructions, registers, directives and hardware.inc
+-- names.
+--
+-- All candidates live in one radix trie (rgbds.trie) keyed by their lowercase
+-- name, so a lookup walks the typed prefix and then only as many nodes as
+-- candidates are returned. Buffers, the files they include and project
+-- indexes are sources of names; when one changes, the names it gained or lost
+-- are inserted or removed and the rest of the trie is left alone.
+
+local analyzer = require("rgbds.analyzer")
+local include_cache = require("rgbds.include_cache")
+local syntax = require("rgbds.syntax")
+local trie = require("rgbds.trie")
+
+local M = {}
+
+---Maximum number of candidates returned.
+M.limit = 50
+
+-- Keywords as in tree-sitter-rgbasm/grammar.js.
+local MNEMONICS = {
+	"ADC", "ADD", "AND", "BIT", "CALL", "CCF", "CP", "CPL", "DAA", "DEC", "DI", "EI", "HALT", "INC",
+	"JP", "JR", "LD", "LDD", "LDH", "LDI", "NOP", "OR", "POP", "PUSH", "RES", "RET", "RETI", "RL",
+	"RLA", "RLC", "RLCA", "RR", "RRA", "RRC", "RRCA", "RST", "SBC", "SCF", "SET", "SLA", "SRA", "SRL",
+	"STOP", "SUB", "SWAP", "XOR",
+}
+local REGISTERS = {
+	"A", "B", "C", "D", "E", "H", "L", "AF", "BC", "DE", "HL", "SP", "HLI", "HLD", "Z", "NZ", "NC",
+}
+local DIRECTIVES = {
+	"ALIGN", "ASSERT", "BREAK", "CHARMAP", "DB", "DEF", "DL", "DS", "DW", "ELIF", "ELSE", "ENDC",
+	"ENDL", "ENDM", "ENDR", "ENDSECTION", "ENDU", "EQU", "EQUS", "EXPORT", "FAIL", "FATAL", "FOR",
+	"FRAGMENT", "IF", "INCBIN", "INCLUDE", "LOAD", "MACRO", "NEWCHARMAP", "NEXTU", "OPT", "POPC",
+	"POPO", "POPS", "PRINT", "PRINTLN", "PURGE", "PUSHC", "PUSHO", "PUSHS", "RB", "READFILE",
+	"REDEF", "REPT", "RL", "RSRESET", "RSSET", "RW", "SECTION", "SETCHARMAP", "SHIFT",
+	"STATIC_ASSERT", "UNION", "WARN", "HRAM", "OAM", "ROM0", "ROMX", "SRAM", "VRAM", "WRAM0",
+	"WRAMX",
+}
+
+-- Sources, better first when names are equally long.
+local BUFFER, INCLUDE, PROJECT, HARDWARE, KEYWORD = 1, 2, 3, 4, 5
+
+-- |complete-items| kinds
+local KINDS = {
+	label = "f",
+	["local"] = "f",
+	constant = "d",
+	variable = "v",
+	string = "v",
+	macro = "m",
+	instruction = "i",
+	register = "r",
+	directive = "k",
+}
+
+---@class rgbds.CompletionItem
+---@field word string
+---@field kind string
+---@field source integer
+---@field project string|nil index path, for project names
+---@field header string|nil path of the included file, for its names
+---@field keyword boolean|nil shown in the case of the typed prefix
+
+local symbols = trie.new()
+local keywords_loaded = false
+
+---@class rgbds.CompletionSource
+---@field items table<string, rgbds.CompletionItem> by name
+---@field source integer
+---@field project string|nil
+---@field header string|nil
+
+---Replaces the names of `source` by `names`, touching only the difference.
+---@param source rgbds.CompletionSource
+---@param names table<string, string> kinds by name
+local function sync(source, names)
+	for name, item in pairs(source.items) do
+		if names[name] ~= item.kind then
+			symbols:remove(name:lower(), item)
+			source.items[name] = nil
+		end
+	end
+	for name, kind in pairs(names) do
+		if source.items[name] == nil then
+			local item = {
+				word = name,
+				kind = kind,
+				source = source.source,
+				project = source.project,
+				header = source.header,
+			}
+			symbols:insert(name:lower(), item, item)
+			source.items[name] = item
+		end
+	end
+end
+
+local function load_keywords()
+	if keywords_loaded then
+		return
+	end
+	keywords_loaded = true
+	local function add(words, kind)
+		for _, word in ipairs(words) do
+			local item = { word = word, kind = kind, source = KEYWORD, keyword = true }
+			symbols:insert(word:lower(), item, item)
+		end
+	end
+	add(MNEMONICS, "instruction")
+	add(REGISTERS, "register")
+	add(DIRECTIVES, "directive")
+	local hardware = {}
+	for _, name in ipairs(require("rgbds.hardware_inc")) do
+		hardware[name] = "constant"
+	end
+	sync({ items = {}, source = HARDWARE }, hardware)
+end
+
+-- Project names by index path, loaded once per project and synced again
+-- when the index changes.
+---@type table<string, rgbds.CompletionSource>
+local projects = {}
+
+---@param path string
+local function load_project(path)
+	local index = require("rgbds.index").open(path)
+	if index == nil then
+		return
+	end
+	local names = index:defined_names()
+	index:close()
+	projects[path] = projects[path] or { items = {}, source = PROJECT, project = path }
+	sync(projects[path], names)
+end
+
+vim.api.nvim_create_autocmd("User", {
+	pattern = "RgbdsIndexChanged",
+	group = vim.api.nvim_create_augroup("rgbds.complete", { clear = true }),
+	callback = function(args)
+		local path = vim.fs.joinpath(args.data.root, require("rgbds.index").file_name)
+		if projects[path] then
+			load_project(path)
+		end
+	end,
+})
+
+---@class rgbds.CompletionHeader: rgbds.CompletionSource
+---@field hash string
+---@field refs integer buffers including it
+
+-- Names of included files, shared by the buffers that include them. They
+-- come from include_cache, so a header is parsed once for all of them.
+---@type table<string, rgbds.CompletionHeader>
+local headers = {}
+
+---@param path string
+local function acquire_header(path)
+	local header = headers[path]
+	if header == nil then
+		header = { items = {}, source = INCLUDE, header = path, hash = "", refs = 0 }
+		headers[path] = header
+	end
+	header.refs = header.refs + 1
+end
+
+---@param path string
+local function release_header(path)
+	local header = headers[path]
+	header.refs = header.refs - 1
+	if header.refs == 0 then
+		sync(header, {})
+		headers[path] = nil
+	end
+end
+
+---@class rgbds.CompletionBuffer: rgbds.CompletionSource
+---@field timer uv.uv_timer_t
+---@field headers table<string, true> files the buffer includes, transitively
+
+---@type table<integer, rgbds.CompletionBuffer>
+local buffers = {}
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	local names, includes = syntax.definitions(buf, parser:parse()[1]:root())
+	sync(state, names)
+
+	local include_dirs = (require("rgbds").options.index or {}).include_dirs
+	local included = include_cache.closure(vim.api.nvim_buf_get_name(buf), includes, include_dirs)
+	for path, record in pairs(included) do
+		if not state.headers[path] then
+			acquire_header(path)
+		end
+		local header = headers[path]
+		if header.hash ~= record.hash then
+			header.hash = record.hash
+			sync(header, record.names)
+		end
+	end
+	for path in pairs(state.headers) do
+		if not included[path] then
+			release_header(path)
+		end
+	end
+	state.headers = vim.tbl_map(function()
+		return true
+	end, included)
+end
+
+---@type rgbds.Analyzer
+local completion = {
+	name = "complete",
+	buffers = buffers,
+	update = update,
+	delay = 100,
+	namespaces = {},
+	on_detach = function(_, state)
+		sync(state, {})
+		for path in pairs(state.headers) do
+			release_header(path)
+		end
+	end,
+}
+
+---Starts completing in `buf`: loads the keywords and the project index once
+---and keeps the names defined in the buffer up to date as it changes.
+---@param buf? integer
+function M.attach(buf)
+	analyzer.attach(buf, completion, function(attached)
+		local found = vim.fs.find(require("rgbds.index").file_name, {
+			path = vim.fs.dirname(vim.api.nvim_buf_get_name(attached)),
+			upward = true,
+			type = "file",
+		})[1]
+		-- as the root passed to `RgbdsIndexChanged`
+		found = found and (vim.uv.fs_realpath(found) or found)
+		vim.schedule(function()
+			load_keywords()
+			if found and projects[found] == nil then
+				load_project(found)
+			end
+		end)
+		return { items = {}, source = BUFFER, project = found, headers = {} }
+	end)
+end
+
+---The candidates completing `prefix` in row `row` (0-based) of `buf`:
+---shortest first, then names of the buffer, the files it includes, the
+---project, hardware.inc and keywords. A prefix starting with `.` completes the local labels of the
+---enclosing global label.
+---@param buf integer
+---@param row integer
+---@param prefix string
+---@return { word: string, kind: string, menu: string }[]
+function M.candidates(buf, row, prefix)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local state = buffers[buf]
+	local project = state and state.project
+	local scope = ""
+	if prefix:sub(1, 1) == "." then
+		scope = syntax.scope_at(buf, row) or ""
+	end
+
+	local found = symbols:collect((scope .. prefix):lower(), M.limit, function(item)
+		if item.header ~= nil then
+			return state ~= nil and state.headers[item.header] ~= nil
+		end
+		return item.project == nil or item.project == project
+	end)
+	table.sort(found, function(a, b)
+		if #a.word ~= #b.word then
+			return #a.word < #b.word
+		elseif a.source ~= b.source then
+			return a.source < b.source
+		end
+		return a.word < b.word
+	end)
+
+	local lower = prefix:match("^%l") ~= nil
+	local menus = {
+		[BUFFER] = "[buffer]",
+		[INCLUDE] = "[include]",
+		[PROJECT] = "[project]",
+		[HARDWARE] = "[hardware.inc]",
+		[KEYWORD] = "",
+	}
+	local result, seen = {}, {}
+	for _, item in ipairs(found) do
+		local word = item.word
+		if item.keyword and lower then
+			word = word:lower()
+		end
+		word = word:sub(#scope + 1)
+		if not seen[word] then
+			seen[word] = true
+			result[#result + 1] = { word = word, kind = KINDS[item.kind] or "", menu = menus[item.source] }
+			if #result == M.limit then
+				break
+			end
+		end
+	end
+	return result
+end
+
+---For 'omnifunc', set by the rgbasm ftplugin.
+---@param findstart integer
+---@param base string
+---@return integer|table
+function M.omnifunc(findstart, base)
+	local row, col = unpack(vim.api.nvim_win_get_cursor(0))
+	if findstart == 1 then
+		local line = vim.api.nvim_get_current_line():sub(1, col)
+		return col - #line:match("[%w_%.@#$]*$")
+	end
+	M.attach(0)
+	return M.candidates(0, row - 1, base)
+end
+
+return M
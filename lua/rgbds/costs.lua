@@ -0,0 +1,349 @@
+-- Bytes and cycles of instructions, and their totals per label.
+--
+-- Every instruction line shows its size, M-cycles and the flags it changes,
+-- e.g. `3b 3/4c` for a conditional jump (not taken/taken). Global and local
+-- labels show the total of the code below them: REPT bodies times their
+-- count, the cheapest and the most expensive branch of an IF.
+--
+-- Like rgbds.values, the buffer is tracked by changed ranges: after an edit
+-- only the instructions on the changed lines are annotated again, and only
+-- the labels containing them are summed again. Totals are cached per syntax
+-- node, so a label reuses the totals of its unchanged children.
+
+local analyzer = require("rgbds.analyzer")
+local instructions = require("rgbds.instructions")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.costs")
+local label_ns = vim.api.nvim_create_namespace("rgbds.costs.labels")
+
+---@class rgbds.Cost
+---@field bytes integer
+---@field min integer M-cycles with every condition false
+---@field max integer M-cycles with every condition true
+---@field exact boolean false if unknown instructions or counts are included
+---@field flags? string Z N H C of an instruction, see rgbds.sm83
+
+---@class rgbds.CostEntry: rgbds.Cost
+---@field node TSNode keeps the node id from being reused
+---@field volatile boolean read a constant
+
+---@class rgbds.CostBuffer
+---@field cache rgbds.NodeCache of rgbds.CostEntry
+---@field dirty integer[][] row ranges, end exclusive
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.CostBuffer>
+local buffers = {}
+
+local query
+
+local function get_query()
+	query = query
+		or vim.treesitter.query.parse(
+			"rgbasm",
+			[[
+				(instruction) @instruction
+				(global_label_block) @label
+				(local_label_block) @label
+			]]
+		)
+	return query
+end
+
+---The cost of a single instruction, nil for forms the CPU does not have.
+---@param node TSNode instruction
+---@param source integer|string
+---@return rgbds.Cost|nil
+function M.instruction(node, source)
+	local entry = instructions.lookup(node, source)
+	if entry == nil then
+		return nil
+	end
+	return {
+		bytes = entry.bytes,
+		min = entry.cycles,
+		max = entry.taken or entry.cycles,
+		exact = true,
+		flags = entry.flags,
+	}
+end
+
+---@param cost rgbds.Cost
+---@return string
+function M.format(cost)
+	local cycles = cost.min == cost.max and tostring(cost.min) or string.format("%d/%d", cost.min, cost.max)
+	local text = string.format("%s%db %sc", cost.exact and "" or ">=", cost.bytes, cycles)
+	if cost.flags and cost.flags ~= "----" then
+		text = text .. " " .. cost.flags
+	end
+	return text
+end
+
+---@param node TSNode
+---@return rgbds.CostEntry
+local function entry(node)
+	return { node = node, bytes = 0, min = 0, max = 0, exact = true, volatile = false }
+end
+
+---@param into rgbds.CostEntry
+---@param part rgbds.CostEntry
+---@param times? integer
+local function add(into, part, times)
+	times = times or 1
+	into.bytes = into.bytes + part.bytes * times
+	into.min = into.min + part.min * times
+	into.max = into.max + part.max * times
+	into.exact = into.exact and part.exact
+	into.volatile = into.volatile or part.volatile
+end
+
+local total
+
+---@param buf integer
+---@param state rgbds.CostBuffer
+---@param node TSNode
+---@param result rgbds.CostEntry
+---@param skip? table<string, true>
+local function add_children(buf, state, node, result, skip)
+	for i = 0, node:named_child_count() - 1 do
+		local child = node:named_child(i)
+		if not (skip and skip[child:type()]) then
+			add(result, total(buf, state, child))
+		end
+	end
+end
+
+local CLAUSES = { elif_clause = true, else_clause = true }
+
+-- Nodes that contain statements.
+local CONTAINERS = {
+	source_file = true,
+	directive = true,
+	instruction_list = true,
+	global_label_block = true,
+	local_label_block = true,
+	section_block = true,
+	load_block = true,
+	pushs_block = true,
+	union_block = true,
+	nextu_block = true,
+	elif_clause = true,
+	else_clause = true,
+}
+
+---@param buf integer
+---@param state rgbds.CostBuffer
+---@param node TSNode
+---@return rgbds.CostEntry
+local function compute(buf, state, node)
+	local kind = node:type()
+	local result = entry(node)
+	if kind == "instruction" then
+		local cost = M.instruction(node, buf)
+		if cost then
+			add(result, cost)
+		else
+			result.exact = false
+		end
+	elseif kind == "rept_block" then
+		local count_node = node:field("count")[1]
+		local count
+		if count_node then
+			local row = count_node:start()
+			count = require("rgbds.eval").evaluate(count_node, {
+				source = buf,
+				memo = {},
+				lookup = function(name)
+					result.volatile = true
+					return require("rgbds.values").lookup(buf, name, row)
+				end,
+			})
+		end
+		local body = entry(node)
+		add_children(buf, state, node, body)
+		if type(count) == "number" then
+			add(result, body, math.max(0, count))
+		else
+			add(result, body)
+			result.exact = false
+		end
+	elseif kind == "if_block" then
+		-- the cheapest and the most expensive branch, none without an ELSE
+		local branches = { entry(node) }
+		local has_else = false
+		add_children(buf, state, node, branches[1], CLAUSES)
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			if CLAUSES[child:type()] then
+				has_else = has_else or child:type() == "else_clause"
+				branches[#branches + 1] = entry(child)
+				add_children(buf, state, child, branches[#branches])
+			end
+		end
+		if not has_else then
+			branches[#branches + 1] = entry(node)
+		end
+		result.min, result.max = math.huge, 0
+		for _, branch in ipairs(branches) do
+			result.bytes = math.max(result.bytes, branch.bytes)
+			result.min = math.min(result.min, branch.min)
+			result.max = math.max(result.max, branch.max)
+			result.exact = result.exact and branch.exact
+			result.volatile = result.volatile or branch.volatile
+		end
+	elseif kind == "for_block" then
+		-- counted once
+		add_children(buf, state, node, result)
+		result.exact = false
+	elseif kind == "macro_invocation" then
+		result.exact = false
+	elseif CONTAINERS[kind] then
+		add_children(buf, state, node, result)
+	end
+	return result
+end
+
+---@param buf integer
+---@param state rgbds.CostBuffer
+---@param node TSNode
+---@return rgbds.CostEntry
+function total(buf, state, node)
+	return state.cache:get(node) or state.cache:put(node, compute(buf, state, node))
+end
+
+---The total of the instructions starting in rows `first` to `last`
+---(0-based, inclusive) of `buf`, each counted once.
+---@param buf integer
+---@param first integer
+---@param last integer
+---@return rgbds.Cost
+function M.range(buf, first, last)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local sum = { bytes = 0, min = 0, max = 0, exact = true }
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return sum
+	end
+	local root = parser:parse()[1]:root()
+	for id, node in get_query():iter_captures(root, buf, first, last + 1) do
+		local row = node:start()
+		if get_query().captures[id] == "instruction" and row >= first and row <= last then
+			local cost = M.instruction(node, buf)
+			if cost then
+				add(sum, cost)
+			else
+				sum.exact = false
+			end
+		end
+	end
+	return sum
+end
+
+---Echoes the total of the lines `first` to `last` (1-based, inclusive).
+---@param buf integer
+---@param first integer
+---@param last integer
+function M.report(buf, first, last)
+	local sum = M.range(buf, first - 1, last - 1)
+	vim.api.nvim_echo({
+		{
+			string.format(
+				"%s%d bytes, %s M-cycles",
+				sum.exact and "" or ">=",
+				sum.bytes,
+				sum.min == sum.max and tostring(sum.min) or string.format("%d-%d", sum.min, sum.max)
+			),
+		},
+	}, false, {})
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	local root = parser:parse()[1]:root()
+	local ranges = analyzer.take_dirty(state)
+	state.cache:trim()
+	local rgbds = require("rgbds")
+	local options = { instructions = rgbds.shows("costs", "instructions"), labels = rgbds.shows("costs", "labels") }
+	local line_count = vim.api.nvim_buf_line_count(buf)
+	local labels, seen = {}, {}
+	for _, range in ipairs(ranges) do
+		local first, last = range[1], math.min(range[2], line_count)
+		if first < last then
+			vim.api.nvim_buf_clear_namespace(buf, ns, first, last)
+			vim.api.nvim_buf_clear_namespace(buf, label_ns, first, last)
+			for id, node in get_query():iter_captures(root, buf, first, last) do
+				local row = node:start()
+				if get_query().captures[id] == "label" then
+					-- also the labels around the range
+					if not seen[node:id()] then
+						seen[node:id()] = true
+						labels[#labels + 1] = node
+					end
+				elseif row >= first and row < last and options.instructions ~= false then
+					local cost = M.instruction(node, buf)
+					if cost then
+						vim.api.nvim_buf_set_extmark(buf, ns, row, 0, {
+							virt_text = { { M.format(cost), "RgbdsCost" } },
+							virt_text_pos = "eol",
+						})
+					end
+				end
+			end
+		end
+	end
+	if options.labels == false then
+		return
+	end
+	for _, label in ipairs(labels) do
+		local row = label:start()
+		for _, mark in ipairs(vim.api.nvim_buf_get_extmarks(buf, label_ns, { row, 0 }, { row, -1 }, {})) do
+			vim.api.nvim_buf_del_extmark(buf, label_ns, mark[1])
+		end
+		local sum = total(buf, state, label)
+		if sum.max > 0 or not sum.exact then
+			vim.api.nvim_buf_set_extmark(buf, label_ns, row, 0, {
+				virt_text = { { "Σ " .. M.format(sum), "RgbdsCost" } },
+				virt_text_pos = "eol",
+			})
+		end
+	end
+end
+
+---@type rgbds.Analyzer
+local costs = {
+	name = "costs",
+	buffers = buffers,
+	update = update,
+	delay = 100,
+	namespaces = { ns, label_ns },
+	dirty = 0,
+	-- for the constants it reads
+	depends = { "rgbds.values" },
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsCost", { link = "LspInlayHint", default = true })
+	end,
+}
+
+---Shows the cost of every instruction of `buf` and the totals of its labels.
+---@param buf integer|nil
+function M.attach(buf)
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	analyzer.attach(buf, costs, { cache = analyzer.cache() })
+end
+
+return M
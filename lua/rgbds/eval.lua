@@ -0,0 +1,589 @@
+-- Evaluation of constant expressions like rgbasm does at assembly time.
+--
+-- Numbers are 32-bit two's complement integers, fixed-point values have 16
+-- fractional bits unless a literal or function says otherwise. Anything that
+-- depends on the link (labels, BANK, SIZEOF, STARTOF), on the charmap or on
+-- macro arguments evaluates to nil. Names are resolved by the caller, so the
+-- same evaluator serves buffers and included files.
+
+local bit = require("bit")
+
+local M = {}
+
+---Fractional bits of fixed-point values, as `rgbasm -Q`.
+M.precision = 16
+
+---@alias rgbds.Value integer|string
+
+---@class rgbds.EvalContext
+---@field source integer|string buffer or string the nodes belong to
+---@field lookup fun(name: string, node: TSNode): rgbds.Value|nil value of `name` where `node` uses it
+---@field defined? fun(name: string, node: TSNode): boolean|nil whether `name` is defined there, nil if unknown
+---@field memo table<integer|string, any> results by node id
+
+-- cached "no value", so unknown nodes are not evaluated twice
+local NONE = {}
+
+local tobit = bit.tobit
+
+---@param x number
+---@return integer
+local function round(x)
+	return x >= 0 and math.floor(x + 0.5) or math.ceil(x - 0.5)
+end
+
+-- 32-bit multiplication; products of two int32 do not fit in a double.
+---@param a integer
+---@param b integer
+---@return integer
+local function mul(a, b)
+	local high = tobit(a * bit.arshift(b, 16))
+	return tobit(high * 65536 + a * bit.band(b, 0xFFFF))
+end
+
+---@param a integer
+---@param b integer
+---@return integer
+local function shift_left(a, b)
+	if b < 0 then
+		return b <= -32 and (a < 0 and -1 or 0) or bit.arshift(a, -b)
+	end
+	return b >= 32 and 0 or bit.lshift(a, b)
+end
+
+---@param a integer
+---@param b integer
+---@return integer
+local function shift_right(a, b)
+	if b < 0 then
+		return b <= -32 and 0 or bit.lshift(a, -b)
+	end
+	return b >= 32 and (a < 0 and -1 or 0) or bit.arshift(a, b)
+end
+
+-- The conversions of rgbasm's fixpoint.cpp.
+---@param value integer
+---@param q integer
+---@return number
+local function fix2double(value, q)
+	return value / 2 ^ q
+end
+
+---@param value number
+---@param q integer
+---@return integer
+local function double2fix(value, q)
+	if value ~= value then
+		return 0
+	elseif value == math.huge then
+		return 0x7FFFFFFF
+	elseif value == -math.huge then
+		return -0x80000000
+	end
+	return tobit(round(value * 2 ^ q) % 2 ^ 32)
+end
+
+local TAU = 2 * math.pi
+
+local BINARY = {
+	["+"] = function(a, b)
+		return tobit(a + b)
+	end,
+	["-"] = function(a, b)
+		return tobit(a - b)
+	end,
+	["*"] = mul,
+	["/"] = function(a, b)
+		if b == 0 then
+			return nil
+		end
+		-- rounds towards negative infinity
+		return tobit(math.floor(a / b))
+	end,
+	["%"] = function(a, b)
+		if b == 0 then
+			return nil
+		end
+		-- takes the sign of the divisor
+		return tobit(a % b)
+	end,
+	["**"] = function(a, b)
+		if b < 0 then
+			return nil
+		end
+		local result = 1
+		while b > 0 do
+			if b % 2 == 1 then
+				result = mul(result, a)
+			end
+			a = mul(a, a)
+			b = math.floor(b / 2)
+		end
+		return result
+	end,
+	["&"] = bit.band,
+	["|"] = bit.bor,
+	["^"] = bit.bxor,
+	["<<"] = shift_left,
+	[">>"] = shift_right,
+	[">>>"] = function(a, b)
+		if b < 0 then
+			return shift_left(a, -b)
+		end
+		return b >= 32 and 0 or bit.rshift(a, b)
+	end,
+	["=="] = function(a, b)
+		return a == b and 1 or 0
+	end,
+	["!="] = function(a, b)
+		return a ~= b and 1 or 0
+	end,
+	["<"] = function(a, b)
+		return a < b and 1 or 0
+	end,
+	["<="] = function(a, b)
+		return a <= b and 1 or 0
+	end,
+	[">"] = function(a, b)
+		return a > b and 1 or 0
+	end,
+	[">="] = function(a, b)
+		return a >= b and 1 or 0
+	end,
+}
+
+local STRING_BINARY = {
+	["++"] = function(a, b)
+		return a .. b
+	end,
+	["==="] = function(a, b)
+		return a == b and 1 or 0
+	end,
+	["!=="] = function(a, b)
+		return a ~= b and 1 or 0
+	end,
+}
+
+---@param s string
+---@return integer
+local function utf8_length(s)
+	local _, continuations = s:gsub("[\128-\191]", "")
+	return #s - continuations
+end
+
+---@param value integer
+---@return integer
+local function bitwidth(value)
+	local width = 0
+	while value ~= 0 do
+		value = bit.rshift(value, 1)
+		width = width + 1
+	end
+	return width
+end
+
+---@param value integer
+---@return integer
+local function tzcount(value)
+	if value == 0 then
+		return 32
+	end
+	local count = 0
+	while bit.band(value, 1) == 0 do
+		value = bit.rshift(value, 1)
+		count = count + 1
+	end
+	return count
+end
+
+-- Fixed-point functions, `q` is the optional precision argument.
+---@param f fun(...: number): number
+---@param arity integer
+local function fixed(f, arity)
+	return function(args)
+		local q = args[arity + 1] or M.precision
+		if #args > arity + 1 or q < 1 or q > 31 then
+			return nil
+		end
+		local values = {}
+		for i = 1, arity do
+			values[i] = fix2double(args[i], q)
+		end
+		return double2fix(f(unpack(values, 1, arity)), q)
+	end
+end
+
+---@param s string
+---@param sub string
+---@param plain_last boolean
+---@return integer
+local function find(s, sub, plain_last)
+	local found
+	local start = 1
+	while true do
+		local at = s:find(sub, start, true)
+		if at == nil then
+			break
+		end
+		found = found or at
+		if not plain_last then
+			break
+		end
+		found = at
+		start = at + 1
+	end
+	return found and found - 1 or -1
+end
+
+-- Built-ins by name, taking numbers unless listed in STRING_ARGUMENTS.
+local FUNCTIONS = {
+	HIGH = function(args)
+		return #args == 1 and bit.band(bit.rshift(args[1], 8), 0xFF) or nil
+	end,
+	LOW = function(args)
+		return #args == 1 and bit.band(args[1], 0xFF) or nil
+	end,
+	BITWIDTH = function(args)
+		return #args == 1 and bitwidth(args[1]) or nil
+	end,
+	TZCOUNT = function(args)
+		return #args == 1 and tzcount(args[1]) or nil
+	end,
+	MUL = fixed(function(a, b)
+		return a * b
+	end, 2),
+	DIV = fixed(function(a, b)
+		return a / b
+	end, 2),
+	FMOD = fixed(math.fmod, 2),
+	POW = fixed(function(a, b)
+		return a ^ b
+	end, 2),
+	LOG = fixed(function(a, b)
+		return math.log(a) / math.log(b)
+	end, 2),
+	ROUND = fixed(round, 1),
+	CEIL = fixed(math.ceil, 1),
+	FLOOR = fixed(math.floor, 1),
+	-- angles are in turns
+	SIN = fixed(function(a)
+		return math.sin(a * TAU)
+	end, 1),
+	COS = fixed(function(a)
+		return math.cos(a * TAU)
+	end, 1),
+	TAN = fixed(function(a)
+		return math.tan(a * TAU)
+	end, 1),
+	ASIN = fixed(function(a)
+		return math.asin(a) / TAU
+	end, 1),
+	ACOS = fixed(function(a)
+		return math.acos(a) / TAU
+	end, 1),
+	ATAN = fixed(function(a)
+		return math.atan(a) / TAU
+	end, 1),
+	ATAN2 = fixed(function(a, b)
+		return math.atan2(a, b) / TAU
+	end, 2),
+	STRLEN = function(args)
+		return #args == 1 and utf8_length(args[1]) or nil
+	end,
+	BYTELEN = function(args)
+		return #args == 1 and #args[1] or nil
+	end,
+	STRCAT = function(args)
+		return table.concat(args)
+	end,
+	STRUPR = function(args)
+		return #args == 1 and args[1]:upper() or nil
+	end,
+	STRLWR = function(args)
+		return #args == 1 and args[1]:lower() or nil
+	end,
+	STRCMP = function(args)
+		if #args ~= 2 then
+			return nil
+		end
+		return args[1] < args[2] and -1 or args[1] > args[2] and 1 or 0
+	end,
+	STRFIND = function(args)
+		return #args == 2 and find(args[1], args[2], false) or nil
+	end,
+	STRRFIND = function(args)
+		return #args == 2 and find(args[1], args[2], true) or nil
+	end,
+}
+
+local STRING_ARGUMENTS = {
+	STRLEN = true,
+	BYTELEN = true,
+	STRCAT = true,
+	STRUPR = true,
+	STRLWR = true,
+	STRCMP = true,
+	STRFIND = true,
+	STRRFIND = true,
+}
+
+---The value of a number literal, nil if it is not one.
+---@param text string
+---@return integer|nil
+function M.number(text)
+	text = text:gsub("_", "")
+	local integer, fraction, q = text:match("^(%d+)%.(%d+)[qQ](%d+)$")
+	if integer == nil then
+		integer, fraction = text:match("^(%d+)%.(%d+)$")
+		q = M.precision
+	end
+	if integer ~= nil then
+		q = tonumber(q)
+		if q < 1 or q > 31 then
+			return nil
+		end
+		return double2fix(tonumber(integer .. "." .. fraction), q)
+	end
+	local prefix, digits = text:match("^([%$&%%]?)(.+)$")
+	local base = ({ ["$"] = 16, ["&"] = 8, ["%"] = 2 })[prefix]
+	if base == nil then
+		local letter
+		letter, digits = text:match("^0([xXoObB])(.+)$")
+		base = letter and ({ x = 16, o = 8, b = 2 })[letter:lower()] or 10
+		digits = digits or text
+	end
+	local value = tonumber(digits, base)
+	-- too large constants are truncated, with a warning
+	return value and tobit(value % 2 ^ 32) or nil
+end
+
+---The value of a graphics literal with the default digits `0123`: the low
+---bits of the pixels in the low byte, the high bits in the high byte.
+---@param text string
+---@return integer|nil
+function M.graphics(text)
+	local pixels = text:match("^`([0-3]+)$")
+	if pixels == nil or #pixels > 8 then
+		return nil
+	end
+	local low, high = 0, 0
+	for i = 1, #pixels do
+		local pixel = pixels:byte(i) - 48
+		low = low * 2 + pixel % 2
+		high = high * 2 + math.floor(pixel / 2)
+	end
+	return high * 256 + low
+end
+
+local ESCAPES = { n = "\n", r = "\r", t = "\t", ["0"] = "\0", ["\\"] = "\\", ['"'] = '"', ["'"] = "'", ["{"] = "{", ["}"] = "}" }
+
+---The contents of a string literal, nil if it interpolates or uses macro
+---arguments.
+---@param text string
+---@return string|nil
+function M.string(text)
+	local raw = text:match('^#"""(.*)"""$') or text:match('^#"(.*)"$')
+	if raw then
+		return raw
+	end
+	local body = text:match('^"""(.*)"""$') or text:match('^"(.*)"$')
+	if body == nil or body:find("{", 1, true) then
+		return nil
+	end
+	local ok = true
+	body = body:gsub("\\(.)", function(c)
+		if ESCAPES[c] == nil then
+			ok = false
+			return ""
+		end
+		return ESCAPES[c]
+	end)
+	return ok and body or nil
+end
+
+---@param value rgbds.Value|nil
+---@return integer|nil
+local function as_number(value)
+	if type(value) == "string" then
+		-- one-character strings are their character, others need the charmap
+		return #value == 1 and value:byte() or nil
+	end
+	return value
+end
+
+local evaluate
+
+---@param node TSNode
+---@param ctx rgbds.EvalContext
+---@return rgbds.Value|nil
+local function compute(node, ctx)
+	local kind = node:type()
+	if kind == "number_literal" then
+		return M.number(vim.treesitter.get_node_text(node, ctx.source))
+	elseif kind == "graphics_literal" then
+		return M.graphics(vim.treesitter.get_node_text(node, ctx.source))
+	elseif kind == "char_literal" then
+		local body = vim.treesitter.get_node_text(node, ctx.source):match("^'(.*)'$")
+		local char = body and M.string('"' .. body .. '"')
+		return char and #char == 1 and char:byte() or nil
+	elseif kind == "string_literal" or kind == "raw_string_literal" then
+		return M.string(vim.treesitter.get_node_text(node, ctx.source))
+	elseif kind == "paren" then
+		local inner = node:named_child(0)
+		return inner and evaluate(inner, ctx)
+	elseif kind == "variable" then
+		local name = vim.treesitter.get_node_text(node, ctx.source)
+		if name:find("[{\\]") then
+			return nil
+		end
+		return ctx.lookup(name, node)
+	elseif kind == "unary_expression" then
+		local operator = node:child(0):type()
+		local value = as_number(evaluate(node:named_child(0), ctx))
+		if value == nil then
+			return nil
+		elseif operator == "-" then
+			return tobit(-value)
+		elseif operator == "~" then
+			return bit.bnot(value)
+		elseif operator == "!" then
+			return value == 0 and 1 or 0
+		end
+		return value
+	elseif kind == "binary_expression" then
+		local operator = node:field("operator")[1]
+		local left, right = node:field("left")[1], node:field("right")[1]
+		if operator == nil or left == nil or right == nil or left:type() == "register" then
+			return nil
+		end
+		operator = operator:type()
+		local a = evaluate(left, ctx)
+		if STRING_BINARY[operator] then
+			local b = evaluate(right, ctx)
+			if type(a) ~= "string" or type(b) ~= "string" then
+				return nil
+			end
+			return STRING_BINARY[operator](a, b)
+		end
+		a = as_number(a)
+		if operator == "&&" or operator == "||" then
+			-- a side that decides the result is enough
+			local decided = operator == "&&" and 0 or 1
+			local function decides(value)
+				return value ~= nil and (value ~= 0) == (decided == 1)
+			end
+			if decides(a) then
+				return decided
+			end
+			local b = as_number(evaluate(right, ctx))
+			if decides(b) then
+				return decided
+			end
+			return a ~= nil and b ~= nil and 1 - decided or nil
+		end
+		local b = as_number(evaluate(right, ctx))
+		if a == nil or b == nil or BINARY[operator] == nil then
+			return nil
+		end
+		return BINARY[operator](a, b)
+	elseif kind == "function_call" then
+		local name_node = node:named_child(0)
+		if name_node == nil or name_node:type() ~= "function_name" then
+			-- STARTOF and SIZEOF are known after linking
+			return nil
+		end
+		local name = vim.treesitter.get_node_text(name_node, ctx.source):upper()
+		local args = {}
+		for i = 1, node:named_child_count() - 1 do
+			args[i] = node:named_child(i)
+		end
+		if name == "DEF" then
+			local arg = args[1]
+			if #args ~= 1 or ctx.defined == nil then
+				return nil
+			end
+			local found = ctx.defined(vim.treesitter.get_node_text(arg, ctx.source), arg)
+			if found == nil then
+				return nil
+			end
+			return found and 1 or 0
+		elseif name == "ISCONST" then
+			-- unknown values may still be constants defined elsewhere
+			return #args == 1 and evaluate(args[1], ctx) ~= nil and 1 or nil
+		end
+		local f = FUNCTIONS[name]
+		if f == nil then
+			return nil
+		end
+		for i, arg in ipairs(args) do
+			local value = evaluate(arg, ctx)
+			if STRING_ARGUMENTS[name] then
+				if type(value) ~= "string" then
+					return nil
+				end
+			else
+				value = as_number(value)
+				if value == nil then
+					return nil
+				end
+			end
+			args[i] = value
+		end
+		return f(args)
+	end
+	-- labels, @, _NARG, macro arguments, fragments and anonymous labels
+	return nil
+end
+
+---The value of the expression `node`, nil if it is not known before linking.
+---Results are kept in `ctx.memo` by node id.
+---@param node TSNode
+---@param ctx rgbds.EvalContext
+---@return rgbds.Value|nil
+function evaluate(node, ctx)
+	local id = node:id()
+	local cached = ctx.memo[id]
+	if cached == nil then
+		cached = compute(node, ctx)
+		if cached == nil then
+			cached = NONE
+		end
+		ctx.memo[id] = cached
+	end
+	if cached == NONE then
+		return nil
+	end
+	return cached
+end
+
+M.evaluate = evaluate
+
+---Applies the assignment of a def_directive, `=` or a compound operator
+---like `+=`, to the previous value of the name.
+---@param assign string
+---@param previous rgbds.Value|nil
+---@param value rgbds.Value|nil
+---@return rgbds.Value|nil
+function M.assign(assign, previous, value)
+	local operator = assign:match("^(.-)=$")
+	if operator == nil or operator == "" then
+		return value
+	end
+	previous, value = as_number(previous), as_number(value)
+	if previous == nil or value == nil or BINARY[operator] == nil then
+		return nil
+	end
+	return BINARY[operator](previous, value)
+end
+
+---Formats a value for display: numbers in decimal and hexadecimal.
+---@param value rgbds.Value
+---@return string
+function M.format(value)
+	if type(value) == "string" then
+		return (string.format("%q", value):gsub("\\\n", "\\n"))
+	end
+	return string.format("%d ($%X)", value, bit.band(value, 0xFFFFFFFF) % 2 ^ 32)
+end
+
+return M
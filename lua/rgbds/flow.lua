@@ -0,0 +1,149 @@
+-- The control flow of the functions of a buffer, for the analyses that walk
+-- it: rgbds.stack and rgbds.latency.
+--
+-- A function is a global label with its local labels. Its instructions are
+-- listed in document order with the labels between them, so a jump to one of
+-- its own labels is an index into the list and a jump anywhere else leaves
+-- the function. tree-sitter-rgbasm/tools/cfg.c builds the same graphs for a
+-- whole project.
+
+local M = {}
+
+---The flow of an SM83 form: jump, branch, call, return, return_cond or
+---indirect, nil for falling through.
+---@type table<string, string>
+M.FLOWS = {
+	["jp n"] = "jump",
+	["jr n"] = "jump",
+	["jp cc,n"] = "branch",
+	["jr cc,n"] = "branch",
+	["call n"] = "call",
+	["call cc,n"] = "call",
+	["rst n"] = "call",
+	["ret"] = "return",
+	["reti"] = "return",
+	["ret cc"] = "return_cond",
+	["jp hl"] = "indirect",
+}
+
+-- Nodes that contain the statements of a function.
+local CONTAINERS = {
+	directive = true,
+	instruction_list = true,
+	local_label_block = true,
+	if_block = true,
+	elif_clause = true,
+	else_clause = true,
+	rept_block = true,
+	for_block = true,
+	load_block = true,
+	pushs_block = true,
+	union_block = true,
+	nextu_block = true,
+}
+
+---The name a label or a jump target refers to, local ones with their global.
+---@param node TSNode
+---@param buf integer
+---@param global string
+---@return string|nil
+function M.symbol(node, buf, global)
+	local kind = node:type()
+	if kind == "local_symbol" then
+		return global .. vim.treesitter.get_node_text(node, buf)
+	elseif kind == "variable" or kind == "qualified_symbol" then
+		return vim.treesitter.get_node_text(node, buf)
+	end
+end
+
+---The symbol a jump or call of `flow` goes to, from its operand nodes.
+---@param flow string|nil
+---@param operands TSNode[]
+---@param buf integer
+---@param global string
+---@return string|nil
+function M.target(flow, operands, buf, global)
+	if flow and flow ~= "return" and flow ~= "return_cond" and flow ~= "indirect" then
+		local last = operands[#operands]
+		return last and M.symbol(last, buf, global)
+	end
+end
+
+---The instructions of the function `block` in document order, and the index
+---of the first one after each of its labels. `problem` is called for what
+---the list misses: macro invocations, and REPT and FOR bodies listed once.
+---@param buf integer
+---@param block TSNode global_label_block
+---@param global string
+---@param problem fun(reason: string, row: integer)
+---@return { list: TSNode[], labels: table<string, integer> }
+function M.collect(buf, block, global, problem)
+	local out = { list = {}, labels = { [global] = 1 } }
+	local function visit(node)
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			local kind = child:type()
+			if kind == "instruction" then
+				out.list[#out.list + 1] = child
+			elseif kind == "macro_invocation" then
+				problem("macro invocation", child:start())
+			elseif CONTAINERS[kind] then
+				if kind == "local_label_block" then
+					local name = child:field("name")[1]
+					local label = name and M.symbol(name, buf, global)
+					if label then
+						out.labels[label] = #out.list + 1
+					end
+				elseif kind == "rept_block" or kind == "for_block" then
+					problem("REPT or FOR block counted once", child:start())
+				end
+				visit(child)
+			end
+		end
+	end
+	visit(block)
+	return out
+end
+
+---The global_label_block nodes under `root`, in document order.
+---@param root TSNode
+---@return TSNode[]
+function M.functions(root)
+	local found = {}
+	local function visit(node)
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			local kind = child:type()
+			if kind == "global_label_block" then
+				found[#found + 1] = child
+			elseif kind == "section_block" or kind == "directive" or kind == "if_block" or kind == "else_clause" then
+				visit(child)
+			end
+		end
+	end
+	visit(root)
+	return found
+end
+
+---The successors of the instruction `i` of a function's list: indices, or
+---false for leaving the function. `item.flow` is its flow, `item.index` the
+---index its target label has in the function, if any.
+---@param items { flow: string|nil, index: integer|nil }[]
+---@param i integer
+---@return (integer|false)[]
+function M.successors(items, i)
+	local item = items[i]
+	local flow = item.flow
+	if flow == "jump" then
+		return { item.index or false }
+	elseif flow == "branch" then
+		return { i + 1, item.index or false }
+	elseif flow == "return" or flow == "indirect" then
+		return { false }
+	elseif flow == "return_cond" then
+		return { i + 1, false }
+	end
+	return { i + 1 }
+end
+
+return M
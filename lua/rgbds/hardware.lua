@@ -0,0 +1,269 @@
+-- hardware.inc constants are highlighted only in buffers that can see them.
+--
+-- The shipped rgbasm_identifier highlights test every global identifier
+-- against all hardware.inc names with `#any-of?`. In Neovim that predicate is
+-- replaced by `#rgbds-hardware?`, which first checks whether the buffer
+-- reaches hardware.inc through the include graph: its own INCLUDEs,
+-- transitively through include_cache, or a file of the project index that
+-- includes both hardware.inc and the buffer's file. The answer is cached per
+-- buffer and computed on BufEnter, and again when the buffer, a saved file or
+-- the index changes. Computing it may read and parse INCLUDEd files, so the
+-- predicate never does: it reads the cached answer, and a buffer without one
+-- is computed right after the redraw, which is repeated if the answer is
+-- yes. Buffers that do not reach it fail the predicate on one table lookup.
+
+local include_cache = require("rgbds.include_cache")
+local syntax = require("rgbds.syntax")
+
+local M = {}
+
+---@type table<string, true>
+local names = {}
+for _, name in ipairs(require("rgbds.hardware_inc")) do
+	names[name] = true
+end
+
+---@type table<integer, boolean>
+local reaches = {}
+
+---Buffers whose answer is computed after the current redraw.
+---@type table<integer, true>
+local pending = {}
+
+---@class rgbds.HardwareProject
+---@field mtime string
+---@field sees table<string, true> files that see hardware.inc
+
+---@type table<string, rgbds.HardwareProject>
+local projects = {}
+
+---@param path string as written or resolved
+---@return boolean
+local function is_hardware(path)
+	local base = path:match("[^/]*$"):lower()
+	return base == "hardware.inc" or base == "hardware_compat.inc"
+end
+
+---The files of the project of `index_path` that see hardware.inc: those
+---including it, directly or not, and everything they include.
+---@param index_path string
+---@return table<string, true>
+local function project_sees(index_path)
+	local stat = vim.uv.fs_stat(index_path)
+	local mtime = stat and (stat.mtime.sec .. "." .. stat.mtime.nsec) or ""
+	local project = projects[index_path]
+	if project and project.mtime == mtime then
+		return project.sees
+	end
+	local index = require("rgbds.index").open(index_path)
+	if index == nil then
+		return {}
+	end
+	local graph = index:include_graph()
+	index:close()
+
+	local includers = {}
+	local queue = {}
+	for path, includes in pairs(graph) do
+		for _, include in ipairs(includes) do
+			if include.path then
+				includers[include.path] = includers[include.path] or {}
+				table.insert(includers[include.path], path)
+			end
+			if is_hardware(include.path or include.name) then
+				queue[#queue + 1] = path
+			end
+		end
+	end
+	local including = {}
+	while #queue > 0 do
+		local path = table.remove(queue)
+		if not including[path] then
+			including[path] = true
+			vim.list_extend(queue, includers[path] or {})
+		end
+	end
+	local sees = {}
+	queue = vim.tbl_keys(including)
+	while #queue > 0 do
+		local path = table.remove(queue)
+		if not sees[path] then
+			sees[path] = true
+			for _, include in ipairs(graph[path] or {}) do
+				queue[#queue + 1] = include.path
+			end
+		end
+	end
+	projects[index_path] = { mtime = mtime, sees = sees }
+	return sees
+end
+
+---@param buf integer
+---@return boolean
+local function compute(buf)
+	local path = vim.api.nvim_buf_get_name(buf)
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	local tree = ok and parser and (parser:trees()[1] or parser:parse()[1])
+	if tree then
+		local _, includes = syntax.definitions(buf, tree:root())
+		local include_dirs = (require("rgbds").options.index or {}).include_dirs
+		for _, name in ipairs(includes) do
+			if is_hardware(name) then
+				return true
+			end
+		end
+		for included, record in pairs(include_cache.closure(path, includes, include_dirs)) do
+			if is_hardware(included) then
+				return true
+			end
+			for _, name in ipairs(record.includes) do
+				if is_hardware(name) then
+					return true
+				end
+			end
+		end
+	end
+	local index_path = path ~= ""
+		and vim.fs.find(require("rgbds.index").file_name, {
+			path = vim.fs.dirname(path),
+			upward = true,
+			type = "file",
+		})[1]
+	if index_path then
+		local real = vim.uv.fs_realpath(path) or path
+		return project_sees(index_path)[real] == true
+	end
+	return false
+end
+
+local function redraw(buf)
+	if vim.api.nvim__redraw then
+		vim.api.nvim__redraw({ buf = buf, valid = false })
+	else
+		vim.cmd("redraw!")
+	end
+end
+
+---Computes the answer for `buf` again and redraws it if it changed.
+---@param buf integer
+local function refresh(buf)
+	local old = reaches[buf] or false
+	reaches[buf] = compute(buf)
+	if reaches[buf] ~= old then
+		redraw(buf)
+	end
+end
+
+---Whether hardware.inc constants are highlighted in `buf`, as cached. Without
+---an answer yet it is computed after the redraw and false until then.
+---@param buf integer
+---@return boolean
+function M.reaches(buf)
+	local result = reaches[buf]
+	if result == nil and not pending[buf] then
+		pending[buf] = true
+		vim.schedule(function()
+			pending[buf] = nil
+			if reaches[buf] == nil and vim.api.nvim_buf_is_valid(buf) then
+				refresh(buf)
+			end
+		end)
+	end
+	return result == true
+end
+
+local function refresh_all()
+	for buf in pairs(reaches) do
+		if vim.api.nvim_buf_is_valid(buf) then
+			refresh(buf)
+		else
+			reaches[buf] = nil
+		end
+	end
+end
+
+-- Replaces `#any-of?` of the hardware.inc names by `#rgbds-hardware?`.
+local function install_query()
+	local text = syntax.query_text("rgbasm_identifier", "highlights")
+	local start = text:find("(#any-of? @constant", 1, true)
+	local _, finish = text:find("; END WARN%s*%)", start or 1)
+	if start == nil or finish == nil then
+		-- overridden by the user, leave it alone
+		return
+	end
+	text = text:sub(1, start - 1) .. "(#rgbds-hardware? @constant)" .. text:sub(finish + 1)
+	pcall(vim.treesitter.query.set, "rgbasm_identifier", "highlights", text)
+end
+
+local installed = false
+
+---Installs the predicate and the query. Called by the rgbasm ftplugin before
+---highlighting starts.
+function M.setup()
+	if installed then
+		return
+	end
+	installed = true
+
+	vim.treesitter.query.add_predicate("rgbds-hardware?", function(match, _, source, predicate)
+		if type(source) ~= "number" or not M.reaches(source) then
+			return false
+		end
+		local nodes = match[predicate[2]]
+		if type(nodes) ~= "table" then
+			nodes = { nodes }
+		end
+		for _, node in ipairs(nodes) do
+			if not names[vim.treesitter.get_node_text(node, source)] then
+				return false
+			end
+		end
+		return true
+	end, { force = true, all = true })
+	install_query()
+
+	local group = vim.api.nvim_create_augroup("rgbds.hardware", { clear = true })
+	local timers = {}
+	vim.api.nvim_create_autocmd({ "TextChanged", "TextChangedI" }, {
+		group = group,
+		callback = function(args)
+			if reaches[args.buf] == nil then
+				return
+			end
+			local timer = timers[args.buf] or assert(vim.uv.new_timer())
+			timers[args.buf] = timer
+			timer:start(200, 0, vim.schedule_wrap(function()
+				if vim.api.nvim_buf_is_valid(args.buf) then
+					refresh(args.buf)
+				end
+			end))
+		end,
+	})
+	vim.api.nvim_create_autocmd("BufEnter", {
+		group = group,
+		callback = function(args)
+			if reaches[args.buf] == nil and vim.bo[args.buf].filetype == "rgbasm" then
+				refresh(args.buf)
+			end
+		end,
+	})
+	-- a saved file may be a header of other buffers
+	vim.api.nvim_create_autocmd("BufWritePost", { group = group, callback = refresh_all })
+	vim.api.nvim_create_autocmd("User", {
+		group = group,
+		pattern = "RgbdsIndexChanged",
+		callback = refresh_all,
+	})
+	vim.api.nvim_create_autocmd("BufWipeout", {
+		group = group,
+		callback = function(args)
+			reaches[args.buf] = nil
+			if timers[args.buf] then
+				timers[args.buf]:close()
+				timers[args.buf] = nil
+			end
+		end,
+	})
+end
+
+return M
@@ -0,0 +1,266 @@
+-- A cache of parsed INCLUDE targets shared by all buffers.
+--
+-- Headers like hardware.inc, charmaps and macro libraries are included by
+-- many files. Their syntax tree and the names they define are kept once per
+-- content hash, least recently used first out when the estimated memory
+-- exceeds `max_bytes`. A file whose mtime and size did not change is not
+-- read again, and the names are also stored in the cache directory, so in
+-- the next session unchanged headers are not parsed until their tree is
+-- asked for.
+
+local syntax = require("rgbds.syntax")
+
+local M = {}
+
+---Estimated memory the cached trees and names may take, in bytes.
+M.max_bytes = 32 * 1024 * 1024
+
+-- bumped when the stored names change meaning
+local DISK_VERSION = 1
+
+---@class rgbds.ParsedFile
+---@field hash string sha256 of the contents
+---@field names table<string, string> kinds by name, local labels qualified
+---@field includes string[] as written
+---@field tree TSTree|nil nil until parsed in this session
+---@field source string|nil the contents `tree` was parsed from
+---@field bytes integer estimated memory
+---@field used integer
+
+---@class rgbds.CachedFile
+---@field hash string
+---@field mtime_ns integer
+---@field size integer
+
+---@type table<string, rgbds.CachedFile>
+local files = {}
+---@type table<string, rgbds.ParsedFile>
+local parsed = {}
+local total_bytes = 0
+local clock = 0
+
+---@return string
+local function disk_dir()
+	return vim.fs.joinpath(vim.fn.stdpath("cache"), "rgbds.nvim", "includes")
+end
+
+---@param hash string
+---@return { names: table<string, string>, includes: string[] }|nil
+local function disk_load(hash)
+	local file = io.open(vim.fs.joinpath(disk_dir(), hash .. ".json"), "rb")
+	if file == nil then
+		return nil
+	end
+	local contents = file:read("*a")
+	file:close()
+	local ok, stored = pcall(vim.json.decode, contents)
+	if not ok or type(stored) ~= "table" or stored.version ~= DISK_VERSION then
+		return nil
+	end
+	return stored
+end
+
+---@param record rgbds.ParsedFile
+local function disk_store(record)
+	local dir = disk_dir()
+	vim.fn.mkdir(dir, "p")
+	local path = vim.fs.joinpath(dir, record.hash .. ".json")
+	local file = io.open(path .. ".tmp", "wb")
+	if file == nil then
+		return
+	end
+	file:write(vim.json.encode({ version = DISK_VERSION, names = record.names, includes = record.includes }))
+	file:close()
+	os.rename(path .. ".tmp", path)
+end
+
+-- Trees take roughly ten bytes per byte of source, names their length and a
+-- table slot.
+---@param record rgbds.ParsedFile
+local function estimate(record)
+	local bytes = record.source and #record.source * 11 or 0
+	for name in pairs(record.names) do
+		bytes = bytes + #name + 40
+	end
+	for _, name in ipairs(record.includes) do
+		bytes = bytes + #name + 16
+	end
+	total_bytes = total_bytes - record.bytes + bytes
+	record.bytes = bytes
+end
+
+local function evict()
+	while total_bytes > M.max_bytes do
+		local oldest
+		for _, record in pairs(parsed) do
+			if oldest == nil or record.used < oldest.used then
+				oldest = record
+			end
+		end
+		if oldest == nil or oldest.used == clock then
+			-- never drop what was just asked for
+			return
+		end
+		parsed[oldest.hash] = nil
+		total_bytes = total_bytes - oldest.bytes
+	end
+end
+
+---@param record rgbds.ParsedFile
+---@return rgbds.ParsedFile
+local function touch(record)
+	clock = clock + 1
+	record.used = clock
+	return record
+end
+
+---@param source string
+---@return TSTree
+local function parse(source)
+	return vim.treesitter.get_string_parser(source, "rgbasm"):parse()[1]
+end
+
+---@param path string
+---@return string|nil
+local function read(path)
+	local file = io.open(path, "rb")
+	if file == nil then
+		return nil
+	end
+	local contents = file:read("*a")
+	file:close()
+	return contents
+end
+
+---The parsed contents of `path`, or nil if it cannot be read. Unchanged files
+---cost a stat; files with the contents of another cached file share its
+---record.
+---@param path string
+---@return rgbds.ParsedFile|nil
+function M.get(path)
+	local stat = vim.uv.fs_stat(path)
+	if stat == nil or stat.type ~= "file" then
+		files[path] = nil
+		return nil
+	end
+	local mtime_ns = stat.mtime.sec * 1000000000 + stat.mtime.nsec
+	local file = files[path]
+	local source
+	if file == nil or file.mtime_ns ~= mtime_ns or file.size ~= stat.size then
+		source = read(path)
+		if source == nil then
+			return nil
+		end
+		file = { hash = vim.fn.sha256(source), mtime_ns = mtime_ns, size = stat.size }
+		files[path] = file
+	end
+
+	local record = parsed[file.hash]
+	if record == nil then
+		local stored = disk_load(file.hash)
+		record = { hash = file.hash, names = {}, includes = {}, bytes = 0, used = 0 }
+		if stored ~= nil then
+			record.names, record.includes = stored.names, stored.includes
+		else
+			source = source or read(path)
+			if source == nil then
+				return nil
+			end
+			record.source = source
+			record.tree = parse(source)
+			record.names, record.includes = syntax.definitions(source, record.tree:root())
+			disk_store(record)
+		end
+		parsed[file.hash] = record
+		estimate(record)
+	end
+	touch(record)
+	evict()
+	return record
+end
+
+---The syntax tree of `path` and the contents it was parsed from, parsed
+---once per content.
+---@param path string
+---@return TSTree|nil, string|nil
+function M.tree(path)
+	local record = M.get(path)
+	if record == nil then
+		return nil
+	end
+	if record.tree == nil then
+		local source = read(path)
+		if source == nil or vim.fn.sha256(source) ~= record.hash then
+			-- changed since the stat, the next get() picks it up
+			return nil
+		end
+		record.source = source
+		record.tree = parse(source)
+		estimate(record)
+		evict()
+	end
+	return record.tree, record.source
+end
+
+---Resolves an INCLUDE of the file `includer` like rgbasm: relative to the
+---working directory, then to `include_dirs` and the includer's directory.
+---@param name string as written
+---@param includer string
+---@param include_dirs? string[]
+---@return string|nil
+function M.resolve(name, includer, include_dirs)
+	local candidates = { name }
+	if name:sub(1, 1) ~= "/" then
+		for _, dir in ipairs(include_dirs or {}) do
+			candidates[#candidates + 1] = vim.fs.joinpath(dir, name)
+		end
+		candidates[#candidates + 1] = vim.fs.joinpath(vim.fs.dirname(includer), name)
+	end
+	for _, candidate in ipairs(candidates) do
+		local stat = vim.uv.fs_stat(candidate)
+		if stat and stat.type == "file" then
+			return vim.fs.normalize(vim.uv.fs_realpath(candidate) or candidate)
+		end
+	end
+	return nil
+end
+
+---The files `includes` of `includer` resolve to and, transitively, the files
+---those include, each once.
+---@param includer string
+---@param includes string[] as written
+---@param include_dirs? string[]
+---@return table<string, rgbds.ParsedFile> by path
+function M.closure(includer, includes, include_dirs)
+	local found = {}
+	local function visit(from, names)
+		for _, name in ipairs(names) do
+			local path = M.resolve(name, from, include_dirs)
+			if path and found[path] == nil then
+				local record = M.get(path)
+				if record then
+					found[path] = record
+					visit(path, record.includes)
+				end
+			end
+		end
+	end
+	visit(includer, includes)
+	return found
+end
+
+---Memory use and contents, for checking the cap.
+---@return { bytes: integer, files: integer, parsed: integer, trees: integer }
+function M.stats()
+	local result = { bytes = total_bytes, files = 0, parsed = 0, trees = 0 }
+	for _ in pairs(files) do
+		result.files = result.files + 1
+	end
+	for _, record in pairs(parsed) do
+		result.parsed = result.parsed + 1
+		result.trees = result.trees + (record.tree and 1 or 0)
+	end
+	return result
+end
+
+return M
@@ -0,0 +1,918 @@
+-- Reader for the binary project index written by `rgbasm-index -o`.
+--
+-- The index is mapped read-only through the LuaJIT FFI, lookups hash the
+-- name and read only the records they return. The layout is documented in
+-- tree-sitter-rgbasm/tools/index_format.h.
+
+local ffi = require("ffi")
+local bit = require("bit")
+
+local M = {}
+
+---Name of the index in a project's root directory.
+M.file_name = ".rgbds-index"
+
+local VERSION = 2
+local BYTE_ORDER = 0x01020304
+
+local kinds = { "label", "local", "constant", "variable", "string", "macro", "section", "export" }
+
+ffi.cdef([[
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t size;
+	uint32_t strings_offset, strings_size;
+	uint32_t files_offset, file_count;
+	uint32_t includes_offset, include_count;
+	uint32_t symbols_offset, symbol_count;
+	uint32_t references_offset, reference_count;
+	uint32_t names_offset, name_count;
+	uint32_t postings_offset, posting_count;
+	uint32_t buckets_offset, bucket_count;
+	uint32_t search_names_offset, search_name_count;
+	uint32_t trigrams_offset, trigram_count;
+	uint32_t trigram_postings_offset, trigram_posting_count;
+} rgbds_index_header;
+
+typedef struct {
+	uint32_t path;
+	uint32_t flags;
+	uint64_t hash;
+	int64_t mtime_ns;
+	uint64_t size;
+	uint32_t first_include, include_count;
+	uint32_t first_symbol, symbol_count;
+	uint32_t first_reference, reference_count;
+} rgbds_index_file;
+
+typedef struct {
+	uint32_t name;
+	uint32_t path;
+	uint32_t row, column;
+} rgbds_index_include;
+
+typedef struct {
+	uint32_t name;
+	uint32_t scope;
+	uint32_t file;
+	uint8_t kind;
+	uint8_t flags;
+	uint16_t reserved;
+	uint32_t row, column;
+	uint32_t start_byte, end_byte;
+} rgbds_index_symbol;
+
+typedef struct {
+	uint32_t name;
+	uint32_t file;
+	uint8_t flags;
+	uint8_t reserved[3];
+	uint32_t row, column;
+	uint32_t start_byte, end_byte;
+} rgbds_index_reference;
+
+typedef struct {
+	uint32_t name;
+	uint32_t hash;
+	uint32_t first_symbol, symbol_count;
+	uint32_t first_reference, reference_count;
+} rgbds_index_name;
+
+typedef struct {
+	uint32_t key;
+	uint32_t first, count;
+} rgbds_index_trigram;
+
+int strcmp(const char *a, const char *b);
+size_t strlen(const char *s);
+]])
+
+local mmap
+if ffi.os ~= "Windows" then
+	ffi.cdef([[
+	int open(const char *path, int flags, ...);
+	int close(int fd);
+	int64_t lseek(int fd, int64_t offset, int whence);
+	void *mmap(void *address, size_t length, int protection, int flags, int fd, int64_t offset);
+	int munmap(void *address, size_t length);
+	]])
+	local PROT_READ = 1
+	local MAP_SHARED = 1
+	local SEEK_END = 2
+	local MAP_FAILED = ffi.cast("void *", -1)
+
+	---@return ffi.cdata*|nil, integer|nil, function|nil
+	mmap = function(path)
+		local fd = ffi.C.open(path, 0)
+		if fd < 0 then
+			return nil
+		end
+		local size = tonumber(ffi.C.lseek(fd, 0, SEEK_END))
+		local data = size > 0 and ffi.C.mmap(nil, size, PROT_READ, MAP_SHARED, fd, 0) or MAP_FAILED
+		ffi.C.close(fd)
+		if data == MAP_FAILED then
+			return nil
+		end
+		return ffi.cast("const uint8_t *", data), size, function()
+			ffi.C.munmap(data, size)
+		end
+	end
+else
+	-- no mmap, keep the whole file as a Lua string instead
+	mmap = function(path)
+		local file = io.open(path, "rb")
+		if file == nil then
+			return nil
+		end
+		local contents = file:read("*a")
+		file:close()
+		local data = ffi.cast("const uint8_t *", contents)
+		return data, #contents, function()
+			contents = nil
+		end
+	end
+end
+
+---32-bit FNV-1a, as rgbasm_index_name_hash. The multiplication by 16777619 is
+---split into a shift and a small product, so it stays exact in a double.
+---@param name string
+---@return integer
+local function hash(name)
+	local h = bit.tobit(0x811c9dc5)
+	for i = 1, #name do
+		h = bit.bxor(h, name:byte(i))
+		h = bit.tobit(bit.lshift(h, 24) + h * 403)
+	end
+	return h
+end
+
+---@class rgbds.IndexSymbol
+---@field name string
+---@field kind string
+---@field scope string|nil parent label of a local label
+---@field path string
+---@field row integer 0-based
+---@field column integer 0-based, in bytes
+---@field exported boolean
+---@field in_macro boolean
+
+---@class rgbds.IndexReference
+---@field name string
+---@field path string
+---@field row integer 0-based
+---@field column integer 0-based, in bytes
+---@field end_column integer
+---@field macro_call boolean
+
+---@class rgbds.Index
+---@field path string
+---@field private data ffi.cdata*
+---@field private size integer
+---@field private unmap function
+local Index = {}
+Index.__index = Index
+
+---@private
+function Index:table(offset, type)
+	return ffi.cast(type, self.data + offset)
+end
+
+---@private
+function Index:string(offset)
+	return ffi.string(self.strings + offset)
+end
+
+---@private
+---@return ffi.cdata*|nil
+function Index:find_name(name)
+	local header = self.header
+	local h = hash(name)
+	local mask = header.bucket_count - 1
+	local i = bit.band(h, mask)
+	for _ = 1, header.bucket_count do
+		if self.buckets[i] == 0 then
+			break
+		end
+		local entry = self.names[self.buckets[i] - 1]
+		if bit.tobit(entry.hash) == h and ffi.C.strcmp(self.strings + entry.name, name) == 0 then
+			return entry
+		end
+		i = bit.band(i + 1, mask)
+	end
+	return nil
+end
+
+---@private
+---@return rgbds.IndexSymbol
+function Index:symbol(name, symbol)
+	return {
+		name = name,
+		kind = kinds[symbol.kind + 1] or "unknown",
+		scope = symbol.scope ~= 0 and self:string(symbol.scope) or nil,
+		path = self:string(self.files[symbol.file].path),
+		row = symbol.row,
+		column = symbol.column,
+		exported = bit.band(symbol.flags, 1) ~= 0,
+		in_macro = bit.band(symbol.flags, 2) ~= 0,
+	}
+end
+
+---The definitions of `name`, local labels qualified as `Parent.local`.
+---@param name string
+---@return rgbds.IndexSymbol[]
+function Index:definitions(name)
+	local result = {}
+	local entry = self:find_name(name)
+	if entry == nil then
+		return result
+	end
+	for i = 0, entry.symbol_count - 1 do
+		result[#result + 1] = self:symbol(name, self.symbols[self.postings[entry.first_symbol + i]])
+	end
+	return result
+end
+
+---The uses of `name`, in file and source order.
+---@param name string
+---@return rgbds.IndexReference[]
+function Index:references(name)
+	local result = {}
+	local entry = self:find_name(name)
+	if entry == nil then
+		return result
+	end
+	for i = 0, entry.reference_count - 1 do
+		local reference = self.references_[self.postings[entry.first_reference + i]]
+		result[#result + 1] = {
+			name = name,
+			path = self:string(self.files[reference.file].path),
+			row = reference.row,
+			column = reference.column,
+			end_column = reference.column + reference.end_byte - reference.start_byte,
+			macro_call = bit.band(reference.flags, 1) ~= 0,
+		}
+	end
+	return result
+end
+
+-- Search, as rgbasm_index_view_search. Match kinds, better first.
+local EXACT, PREFIX, SUBSTRING, FUZZY = 0, 1, 2, 3
+local match_names = { [EXACT] = "exact", [PREFIX] = "prefix", [SUBSTRING] = "substring", [FUZZY] = "fuzzy" }
+local SECTION, EXPORT = 6, 7
+
+---@param byte integer
+---@return integer
+local function fold(byte)
+	if byte >= 65 and byte <= 90 then
+		return byte + 32
+	end
+	return byte
+end
+
+---The distinct trigram keys of the lowercased bytes `query`, sorted.
+---@param query integer[]
+---@return integer[]
+local function trigrams_of(query)
+	local keys, seen = {}, {}
+	for i = 1, #query - 2 do
+		local key = query[i] * 65536 + query[i + 1] * 256 + query[i + 2]
+		if not seen[key] then
+			seen[key] = true
+			keys[#keys + 1] = key
+		end
+	end
+	table.sort(keys)
+	return keys
+end
+
+---@private
+---Compares the name at string `offset` with the lowercased `query` like
+---strcmp, ignoring ASCII case, over the length of the query.
+function Index:compare_folded(offset, query)
+	local s = self.bytes + offset
+	for i = 1, #query do
+		local x = fold(s[i - 1])
+		if x ~= query[i] or x == 0 then
+			return x - query[i]
+		end
+	end
+	return 0
+end
+
+---@private
+function Index:match_kind(offset, length, query)
+	local s = self.bytes + offset
+	local n = #query
+	for start = 0, length - n do
+		local i = 0
+		while i < n and fold(s[start + i]) == query[i + 1] do
+			i = i + 1
+		end
+		if i == n then
+			if start > 0 then
+				return SUBSTRING
+			end
+			return n == length and EXACT or PREFIX
+		end
+	end
+	return FUZZY
+end
+
+---@private
+function Index:ranks_before(a, b)
+	if a.kind ~= b.kind then
+		return a.kind < b.kind
+	elseif a.similarity ~= b.similarity then
+		return a.similarity > b.similarity
+	elseif a.length ~= b.length then
+		return a.length < b.length
+	end
+	return ffi.C.strcmp(self.strings + self.names[a.name].name, self.strings + self.names[b.name].name) < 0
+end
+
+---@private
+---Offers the search name `search_name` sharing `shared` of the query's
+---`trigram_count` trigrams to the ranked `matches`.
+function Index:offer(matches, limit, query, search_name, shared, trigram_count)
+	-- at least half the trigrams, as offer_name in index_format.c explains;
+	-- only a name with all of them can contain the query
+	if shared * 2 < trigram_count then
+		return
+	end
+	local name = self.search_names[search_name]
+	local offset = self.names[name].name
+	local length = tonumber(ffi.C.strlen(self.strings + offset))
+	local match = { name = name, length = length, similarity = 1 }
+	match.kind = shared < trigram_count and FUZZY or self:match_kind(offset, length, query)
+	if match.kind == FUZZY then
+		-- the name's trigrams are counted with repeats, close enough
+		local name_trigrams = length > 2 and length - 2 or 1
+		match.similarity = shared / (trigram_count + name_trigrams - shared)
+	end
+	if #matches == limit and (limit == 0 or not self:ranks_before(match, matches[limit])) then
+		return
+	end
+	local i = #matches < limit and #matches + 1 or limit
+	while i > 1 and self:ranks_before(match, matches[i - 1]) do
+		matches[i] = matches[i - 1]
+		i = i - 1
+	end
+	matches[i] = match
+end
+
+---@private
+---@return ffi.cdata*|nil
+function Index:find_trigram(key)
+	local low, high = 0, self.header.trigram_count
+	while low < high do
+		local middle = math.floor((low + high) / 2)
+		local trigram = self.trigrams[middle]
+		if trigram.key == key then
+			return trigram
+		elseif trigram.key < key then
+			low = middle + 1
+		else
+			high = middle
+		end
+	end
+	return nil
+end
+
+---@private
+function Index:posting_contains(trigram, search_name)
+	local low, high = trigram.first, trigram.first + trigram.count
+	while low < high do
+		local middle = math.floor((low + high) / 2)
+		local posting = self.trigram_postings[middle]
+		if posting == search_name then
+			return true
+		elseif posting < search_name then
+			low = middle + 1
+		else
+			high = middle
+		end
+	end
+	return false
+end
+
+---@class rgbds.IndexSearchOptions
+---@field limit? integer names to return at most, default 20
+---@field fuzzy? boolean also names sharing most of the query's trigrams
+
+---The definitions of the defined names containing `query`, ignoring ASCII
+---case, best first: exact matches, then prefixes, then other substrings and
+---with `fuzzy` similar names. Queries of one or two bytes only find names
+---starting with them. Each result has a `match` field with its kind.
+---@param query string
+---@param opts? rgbds.IndexSearchOptions
+---@return (rgbds.IndexSymbol|{ match: string })[]
+function Index:search(query, opts)
+	opts = opts or {}
+	local limit = opts.limit or 20
+	local folded = {}
+	for i = 1, #query do
+		folded[i] = fold(query:byte(i))
+	end
+	local keys = trigrams_of(folded)
+	local matches = {}
+	local count = self.header.search_name_count
+
+	if #keys == 0 then
+		-- too short for a trigram: the names starting with it are a range
+		local low, high = 0, count
+		while low < high do
+			local middle = math.floor((low + high) / 2)
+			if self:compare_folded(self.names[self.search_names[middle]].name, folded) < 0 then
+				low = middle + 1
+			else
+				high = middle
+			end
+		end
+		for i = low, count - 1 do
+			if self:compare_folded(self.names[self.search_names[i]].name, folded) ~= 0 then
+				break
+			end
+			self:offer(matches, limit, folded, i, 0, 0)
+		end
+	elseif not opts.fuzzy then
+		-- every trigram must occur: walk the rarest one, probe the others
+		local lists = {}
+		for i, key in ipairs(keys) do
+			lists[i] = self:find_trigram(key)
+			if lists[i] == nil then
+				return {}
+			end
+		end
+		table.sort(lists, function(a, b)
+			return a.count < b.count
+		end)
+		local rarest = lists[1]
+		for i = rarest.first, rarest.first + rarest.count - 1 do
+			local search_name = self.trigram_postings[i]
+			local j = 2
+			while j <= #lists and self:posting_contains(lists[j], search_name) do
+				j = j + 1
+			end
+			if j > #lists then
+				self:offer(matches, limit, folded, search_name, #keys, #keys)
+			end
+		end
+	else
+		-- count the query trigrams of every name that has one
+		local shared, touched = {}, {}
+		local counted = math.min(#keys, 255)
+		for i = 1, counted do
+			local trigram = self:find_trigram(keys[i])
+			if trigram ~= nil then
+				for j = trigram.first, trigram.first + trigram.count - 1 do
+					local search_name = self.trigram_postings[j]
+					local n = shared[search_name]
+					if n == nil then
+						touched[#touched + 1] = search_name
+					end
+					shared[search_name] = (n or 0) + 1
+				end
+			end
+		end
+		for _, search_name in ipairs(touched) do
+			self:offer(matches, limit, folded, search_name, shared[search_name], counted)
+		end
+	end
+
+	local result = {}
+	for _, match in ipairs(matches) do
+		local entry = self.names[match.name]
+		local name = self:string(entry.name)
+		for i = 0, entry.symbol_count - 1 do
+			local symbol = self.symbols[self.postings[entry.first_symbol + i]]
+			if symbol.kind ~= SECTION and symbol.kind ~= EXPORT then
+				local record = self:symbol(name, symbol)
+				record.match = match_names[match.kind]
+				result[#result + 1] = record
+			end
+		end
+	end
+	return result
+end
+
+---Every name searched by `search()`, with the kind of its first definition.
+---@return table<string, string>
+function Index:defined_names()
+	local result = {}
+	for i = 0, self.header.search_name_count - 1 do
+		local entry = self.names[self.search_names[i]]
+		for j = 0, entry.symbol_count - 1 do
+			local symbol = self.symbols[self.postings[entry.first_symbol + j]]
+			if symbol.kind ~= SECTION and symbol.kind ~= EXPORT then
+				result[self:string(entry.name)] = kinds[symbol.kind + 1]
+				break
+			end
+		end
+	end
+	return result
+end
+
+---The INCLUDEs of every indexed file, as written and as resolved (nil if
+---not found).
+---@return table<string, { name: string, path: string|nil }[]>
+function Index:include_graph()
+	local result = {}
+	for i = 0, self.header.file_count - 1 do
+		local file = self.files[i]
+		local includes = {}
+		for j = file.first_include, file.first_include + file.include_count - 1 do
+			local include = self.includes[j]
+			includes[#includes + 1] = {
+				name = self:string(include.name),
+				path = include.path ~= 0 and self:string(include.path) or nil,
+			}
+		end
+		result[self:string(file.path)] = includes
+	end
+	return result
+end
+
+---Whether the index has a record of the file and its mtime (ns) and size.
+---@param path string canonical
+---@return { mtime_ns: integer, size: integer, has_errors: boolean }|nil
+function Index:file(path)
+	local low, high = 0, self.header.file_count
+	while low < high do
+		local middle = math.floor((low + high) / 2)
+		local file = self.files[middle]
+		local order = ffi.C.strcmp(self.strings + file.path, path)
+		if order == 0 then
+			return {
+				mtime_ns = tonumber(file.mtime_ns),
+				size = tonumber(file.size),
+				has_errors = bit.band(file.flags, 1) ~= 0,
+			}
+		elseif order < 0 then
+			low = middle + 1
+		else
+			high = middle
+		end
+	end
+	return nil
+end
+
+function Index:close()
+	if self.unmap then
+		self.unmap()
+		self.unmap = nil
+	end
+end
+
+-- The tables of the index, their offset and count fields and record types.
+local TABLES = {
+	{ "files_offset", "file_count", "rgbds_index_file" },
+	{ "includes_offset", "include_count", "rgbds_index_include" },
+	{ "symbols_offset", "symbol_count", "rgbds_index_symbol" },
+	{ "references_offset", "reference_count", "rgbds_index_reference" },
+	{ "names_offset", "name_count", "rgbds_index_name" },
+	{ "postings_offset", "posting_count", "uint32_t" },
+	{ "buckets_offset", "bucket_count", "uint32_t" },
+	{ "search_names_offset", "search_name_count", "uint32_t" },
+	{ "trigrams_offset", "trigram_count", "rgbds_index_trigram" },
+	{ "trigram_postings_offset", "trigram_posting_count", "uint32_t" },
+}
+
+---Whether `count` records of `record_size` bytes at `offset` lie inside the
+---index, as table_fits in index_format.c checks them.
+---@param size integer of the index
+---@param offset integer
+---@param count integer
+---@param record_size integer
+---@return boolean
+local function fits(size, offset, count, record_size)
+	return offset % 8 == 0
+		and offset >= ffi.sizeof("rgbds_index_header")
+		and offset <= size
+		and count * record_size <= size - offset
+end
+
+---Whether the header of an index of `size` bytes describes tables inside
+---it, so reading them cannot leave the mapping.
+---@param header ffi.cdata*
+---@param data ffi.cdata*
+---@param size integer
+---@return boolean
+local function valid(header, data, size)
+	local strings_offset, strings_size = tonumber(header.strings_offset), tonumber(header.strings_size)
+	if
+		not fits(size, strings_offset, strings_size, 1)
+		or strings_size == 0
+		or data[strings_offset + strings_size - 1] ~= 0
+	then
+		return false
+	end
+	for _, entry in ipairs(TABLES) do
+		local offset, count = tonumber(header[entry[1]]), tonumber(header[entry[2]])
+		if not fits(size, offset, count, ffi.sizeof(entry[3])) then
+			return false
+		end
+	end
+	local buckets = tonumber(header.bucket_count)
+	return buckets > 0 and bit.band(buckets, buckets - 1) == 0
+end
+
+---Whether `first + count` entries fit in a table of `size` entries.
+---@param first integer
+---@param count integer
+---@param size integer
+---@return boolean
+local function range_fits(first, count, size)
+	return first + count <= size
+end
+
+---Whether every entry of `values[first, first + count)` is below `bound`.
+---@param values ffi.cdata*
+---@param first integer
+---@param count integer
+---@param bound integer
+---@return boolean
+local function all_below(values, first, count, bound)
+	for i = first, first + count - 1 do
+		if values[i] >= bound then
+			return false
+		end
+	end
+	return true
+end
+
+---Whether the records of `self` only refer to strings, records and postings
+---that exist, as records_valid in index_format.c checks them.
+---@param self rgbds.Index
+---@return boolean
+local function records_valid(self)
+	local header = self.header
+	local strings = header.strings_size
+	local include_count, symbol_count, reference_count = header.include_count, header.symbol_count, header.reference_count
+	local file_count, name_count, posting_count = header.file_count, header.name_count, header.posting_count
+	for i = 0, file_count - 1 do
+		local file = self.files[i]
+		if
+			file.path >= strings
+			or not range_fits(file.first_include, file.include_count, include_count)
+			or not range_fits(file.first_symbol, file.symbol_count, symbol_count)
+			or not range_fits(file.first_reference, file.reference_count, reference_count)
+		then
+			return false
+		end
+	end
+	for i = 0, include_count - 1 do
+		local include = self.includes[i]
+		if include.name >= strings or include.path >= strings then
+			return false
+		end
+	end
+	for i = 0, symbol_count - 1 do
+		local symbol = self.symbols[i]
+		if symbol.name >= strings or symbol.scope >= strings or symbol.file >= file_count then
+			return false
+		end
+	end
+	for i = 0, reference_count - 1 do
+		local reference = self.references_[i]
+		if reference.name >= strings or reference.file >= file_count then
+			return false
+		end
+	end
+	for i = 0, name_count - 1 do
+		local name = self.names[i]
+		if
+			name.name >= strings
+			or not range_fits(name.first_symbol, name.symbol_count, posting_count)
+			or not range_fits(name.first_reference, name.reference_count, posting_count)
+			or not all_below(self.postings, name.first_symbol, name.symbol_count, symbol_count)
+			or not all_below(self.postings, name.first_reference, name.reference_count, reference_count)
+		then
+			return false
+		end
+	end
+	-- a probe ends at an empty bucket, so there must be one
+	local empty = false
+	for i = 0, header.bucket_count - 1 do
+		local bucket = self.buckets[i]
+		if bucket > name_count then
+			return false
+		end
+		empty = empty or bucket == 0
+	end
+	if not empty then
+		return false
+	end
+	for i = 0, header.trigram_count - 1 do
+		local trigram = self.trigrams[i]
+		if not range_fits(trigram.first, trigram.count, header.trigram_posting_count) then
+			return false
+		end
+	end
+	return all_below(self.search_names, 0, header.search_name_count, name_count)
+		and all_below(self.trigram_postings, 0, header.trigram_posting_count, header.search_name_count)
+end
+
+---Maps an index. Returns nil if it is missing, of another version or
+---damaged; run `rgbasm-index -o` to write it.
+---@param path string
+---@return rgbds.Index|nil
+function M.open(path)
+	local data, size, unmap = mmap(path)
+	if data == nil then
+		return nil
+	end
+	local header = ffi.cast("const rgbds_index_header *", data)
+	if
+		size < ffi.sizeof("rgbds_index_header")
+		or ffi.string(header.magic, 8) ~= "RGBDSIDX"
+		or header.version ~= VERSION
+		or header.byte_order ~= BYTE_ORDER
+		or tonumber(header.size) ~= size
+		or not valid(header, data, size)
+	then
+		unmap()
+		return nil
+	end
+	local self = setmetatable({ path = path, data = data, size = size, unmap = unmap, header = header }, Index)
+	self.strings = ffi.cast("const char *", data + header.strings_offset)
+	self.files = self:table(header.files_offset, "const rgbds_index_file *")
+	self.includes = self:table(header.includes_offset, "const rgbds_index_include *")
+	self.symbols = self:table(header.symbols_offset, "const rgbds_index_symbol *")
+	self.references_ = self:table(header.references_offset, "const rgbds_index_reference *")
+	self.names = self:table(header.names_offset, "const rgbds_index_name *")
+	self.postings = self:table(header.postings_offset, "const uint32_t *")
+	self.buckets = self:table(header.buckets_offset, "const uint32_t *")
+	self.bytes = ffi.cast("const uint8_t *", self.strings)
+	self.search_names = self:table(header.search_names_offset, "const uint32_t *")
+	self.trigrams = self:table(header.trigrams_offset, "const rgbds_index_trigram *")
+	self.trigram_postings = self:table(header.trigram_postings_offset, "const uint32_t *")
+	if not records_valid(self) then
+		unmap()
+		return nil
+	end
+	return self
+end
+
+---The index of the project containing `path`: the nearest `.rgbds-index` in
+---it or one of its parents.
+---@param path string
+---@return rgbds.Index|nil
+function M.find(path)
+	local found = vim.fs.find(M.file_name, { path = vim.fs.dirname(path), upward = true, type = "file" })
+	if found[1] == nil then
+		return nil
+	end
+	return M.open(found[1])
+end
+
+---@param name string relative path
+---@return boolean
+local function visible(name)
+	return not (name:match("^%.") or name:match("/%."))
+end
+
+---@class rgbds.IndexWatchOptions
+---@field cmd? string the `rgbasm-index` executable
+---@field include_dirs? string[] passed as `-I`
+---@field debounce? integer milliseconds to collect events before updating
+
+---@class rgbds.IndexWatch
+---@field root string
+---@field stop fun()
+
+---Keeps the index of the project in `root` up to date. Changes reported by
+---`vim.uv` fs events are collected and passed to `rgbasm-index -c`, which
+---parses only the files whose content hash changed. After each update the
+---`User RgbdsIndexChanged` autocmd runs with `data = { root, files }`, where
+---`files` are the changed files and every file that includes them.
+---@param root string
+---@param opts? rgbds.IndexWatchOptions
+---@return rgbds.IndexWatch
+function M.watch(root, opts)
+	opts = vim.tbl_extend("keep", opts or {}, { cmd = "rgbasm-index", include_dirs = {}, debounce = 50 })
+	root = vim.fs.normalize(vim.uv.fs_realpath(root) or root)
+	local index_path = vim.fs.joinpath(root, M.file_name)
+	local handles = {}
+	local pending = {}
+	local running = false
+	local stopped = false
+	local timer = assert(vim.uv.new_timer())
+
+	local function command(changed)
+		local cmd = { opts.cmd, "-o", index_path }
+		for _, dir in ipairs(opts.include_dirs) do
+			vim.list_extend(cmd, { "-I", dir })
+		end
+		for _, path in ipairs(changed) do
+			vim.list_extend(cmd, { "-c", path })
+		end
+		cmd[#cmd + 1] = root
+		return cmd
+	end
+
+	local flush
+	local function run(changed)
+		running = true
+		vim.system(command(changed), { text = true }, function(result)
+			running = false
+			if stopped then
+				return
+			end
+			if result.code ~= 0 and result.stderr ~= "" then
+				vim.schedule(function()
+					vim.notify("rgbds.nvim: " .. vim.trim(result.stderr), vim.log.levels.WARN)
+				end)
+			end
+			local files = vim.split(result.stdout or "", "\n", { trimempty = true })
+			vim.schedule(function()
+				vim.api.nvim_exec_autocmds("User", {
+					pattern = "RgbdsIndexChanged",
+					data = { root = root, files = files },
+				})
+			end)
+			if next(pending) ~= nil then
+				flush()
+			end
+		end)
+	end
+
+	flush = function()
+		if running then
+			-- picked up when the running update is done
+			return
+		end
+		local changed = vim.tbl_keys(pending)
+		pending = {}
+		if #changed > 0 then
+			table.sort(changed)
+			run(changed)
+		end
+	end
+
+	local watch_dir
+	local function on_event(dir, filename)
+		-- hidden files are the index itself and editor swap files
+		if filename == nil or filename:sub(1, 1) == "." then
+			return
+		end
+		local path = vim.fs.joinpath(dir, filename)
+		local stat = vim.uv.fs_stat(path)
+		if stat and stat.type == "directory" then
+			watch_dir(path)
+			for name, type in vim.fs.dir(path, { depth = math.huge, skip = visible }) do
+				if type == "file" and visible(name) then
+					pending[vim.fs.joinpath(path, name)] = true
+				end
+			end
+		else
+			pending[path] = true
+		end
+		timer:start(opts.debounce, 0, flush)
+	end
+
+	-- fs events are not recursive on every platform, so every directory is
+	-- watched on its own
+	watch_dir = function(dir)
+		if handles[dir] or stopped then
+			return
+		end
+		local handle = vim.uv.new_fs_event()
+		if handle == nil then
+			return
+		end
+		handles[dir] = handle
+		handle:start(dir, {}, function(err, filename)
+			if not err then
+				on_event(dir, filename)
+			end
+		end)
+	end
+
+	watch_dir(root)
+	for name, type in vim.fs.dir(root, { depth = math.huge, skip = visible }) do
+		if type == "directory" and visible(name) then
+			watch_dir(vim.fs.joinpath(root, name))
+		end
+	end
+	if vim.uv.fs_stat(index_path) == nil then
+		run({})
+	end
+
+	return {
+		root = root,
+		stop = function()
+			stopped = true
+			timer:stop()
+			timer:close()
+			for _, handle in pairs(handles) do
+				handle:stop()
+				handle:close()
+			end
+			handles = {}
+		end,
+	}
+end
+
+return M
@@ -1,5 +1,13 @@
 local M = {}
 
+---The options passed to `setup()`.
+---@type rgbds.Options
+M.options = {}
+
+---The directory of the plugin, as given to or found by `init()`.
+---@type string|nil
+M.dir = nil
+
 local init = false
 
 local function get_plugin_dir()
@@ -66,15 +74,109 @@ function M.init(dir)
 			return
 		end
 	end
+	M.dir = dir
 	register(dir)
 	init = true
 end
 
----@param spec LazyPluginSpec
+-- Keeps the project index of every rgbasm buffer's project up to date.
+---@param opts rgbds.IndexWatchOptions
+local function watch_indexes(opts)
+	local watches = {}
+	vim.api.nvim_create_autocmd("FileType", {
+		pattern = "rgbasm",
+		callback = function(args)
+			local index = require("rgbds.index")
+			local found = vim.fs.find(index.file_name, {
+				path = vim.fs.dirname(vim.api.nvim_buf_get_name(args.buf)),
+				upward = true,
+				type = "file",
+			})
+			local root = found[1] and vim.fs.dirname(found[1])
+			if root and not watches[root] then
+				watches[root] = index.watch(root, opts)
+			end
+		end,
+	})
+end
+
+-- The analyzers of rgbasm buffers. Each runs only in buffers it is enabled
+-- for, by `true` or a table as its option, or after one of its commands.
+M.analyzers = { "complete", "values", "sizes", "costs", "stack", "latency", "peephole", "jumps" }
+
+---@class rgbds.Options
+---@field index? rgbds.IndexWatchOptions|{ watch?: boolean }
+---@field include_cache? { max_bytes?: integer }
+---@field complete? boolean
+---@field values? boolean|{ hints?: boolean, dim?: boolean }
+---@field sizes? boolean|{ hints?: boolean }
+---@field costs? boolean|{ instructions?: boolean, labels?: boolean }
+---@field stack? boolean|{ hints?: boolean }
+---@field latency? boolean|{ hints?: boolean }
+---@field peephole? boolean|{ hints?: boolean }
+---@field jumps? boolean|{ hints?: boolean }
+
+---Whether the analyzer `name` is enabled in `setup()`.
+---@param name string
+---@return boolean
+function M.enabled(name)
+	return type(M.options[name]) == "table"
+end
+
+---Whether the analyzer `name` is enabled and its option `key` is not false,
+---e.g. whether it shows hints. Analyzers attached only because another one
+---or a command needs them show nothing.
+---@param name string
+---@param key string
+---@return boolean
+function M.shows(name, key)
+	return M.enabled(name) and M.options[name][key] ~= false
+end
+
+---Attaches the enabled analyzers to `buf`, or the one named `name`.
+---@param buf integer
+---@param name? string
+function M.attach(buf, name)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	for _, analyzer in ipairs(name and { name } or M.analyzers) do
+		if name or M.enabled(analyzer) then
+			require("rgbds." .. analyzer).attach(buf)
+		end
+	end
+	if name then
+		-- the command runs right away
+		require("rgbds.values").update(buf)
+	end
+end
+
+---@param opts rgbds.Options|nil
 function M.setup(opts)
 	if not init then
 		M.init()
 	end
+	opts = vim.deepcopy(opts or {})
+	for _, name in ipairs(M.analyzers) do
+		if opts[name] == true then
+			opts[name] = {}
+		elseif opts[name] == false then
+			opts[name] = nil
+		end
+	end
+	M.options = opts
+	-- buffers opened before
+	for _, buf in ipairs(vim.api.nvim_list_bufs()) do
+		if vim.api.nvim_buf_is_loaded(buf) and vim.bo[buf].filetype == "rgbasm" then
+			M.attach(buf)
+		end
+	end
+	if opts.include_cache and opts.include_cache.max_bytes then
+		require("rgbds.include_cache").max_bytes = opts.include_cache.max_bytes
+	end
+	if opts.index and opts.index.watch then
+		watch_indexes(opts.index)
+	end
 end
 
 return M
@@ -0,0 +1,150 @@
+-- SM83 encodings of instruction nodes.
+--
+-- An instruction is looked up in rgbds.sm83 by its form: the lowercase
+-- mnemonic and operands as spelled in scripts/update-sm83.py. Every operand
+-- is tried as written first and then by its class, so `ld a, [bc]` finds its
+-- own form and `ld a, b` the one of `ld r,r`. tree-sitter-rgbasm/tools/sm83.c
+-- does the same for the command line tools.
+
+local eval = require("rgbds.eval")
+local sm83 = require("rgbds.sm83")
+
+local M = {}
+
+local R8 = { a = true, b = true, c = true, d = true, e = true, h = true, l = true }
+local R16 = { bc = true, de = true, hl = true, sp = true }
+local ALU = { add = true, adc = true, sub = true, sbc = true, ["and"] = true, xor = true, ["or"] = true, cp = true }
+local SPELLINGS = { ["hl+"] = "hli", ["hl-"] = "hld" }
+
+---@param node TSNode
+---@param source integer|string
+---@return string
+local function register(node, source)
+	local name = vim.treesitter.get_node_text(node, source):lower()
+	return SPELLINGS[name] or name
+end
+
+---Whether an address is `[$ff00 + c]` or `[c + $ff00]`, which rgbasm
+---assembles like `[c]`.
+---@param node TSNode
+---@param source integer|string
+---@return boolean
+local function is_high_c(node, source)
+	local text = vim.treesitter.get_node_text(node, source):lower():gsub("[%s%[%]]", "")
+	local number = text:match("^(.+)%+c$") or text:match("^c%+(.+)$")
+	return number ~= nil and eval.number(number) == 0xff00
+end
+
+---An operand as written and by its class.
+---@param node TSNode
+---@param source integer|string
+---@return string exact, string class
+local function operand(node, source)
+	local kind = node:type()
+	if kind == "register" then
+		local name = register(node, source)
+		return name, R8[name] and "r" or R16[name] and "rr" or name
+	elseif kind == "address" then
+		local inner = node:named_child(0)
+		if inner and inner:type() == "register" then
+			local name = "[" .. register(inner, source) .. "]"
+			return name, name
+		elseif is_high_c(node, source) then
+			return "[c]", "[c]"
+		end
+		return "[n]", "[n]"
+	elseif kind == "condition_code" then
+		return "cc", "cc"
+	elseif kind == "binary_expression" then
+		local left = node:field("left")[1]
+		if left and left:type() == "register" then
+			-- ld hl, sp + e8
+			return "sp+n", "sp+n"
+		end
+	end
+	return "n", "n"
+end
+
+---The instruction node of `node`, which may be an `instruction` wrapping it.
+---@param node TSNode
+---@return TSNode
+local function unwrap(node)
+	if node:type() == "instruction" then
+		return node:named_child(0) or node
+	end
+	return node
+end
+
+---The mnemonic and operands of an instruction, operands as written and by
+---class.
+---@param node TSNode
+---@param source integer|string
+---@return string|nil mnemonic, string[] exact, string[] classes, TSNode[] operands
+function M.operands(node, source)
+	node = unwrap(node)
+	local mnemonic = node:field("mnemonic")[1]
+	if mnemonic == nil then
+		return nil, {}, {}, {}
+	end
+	local exact, classes, nodes = {}, {}, {}
+	local function add(child)
+		nodes[#nodes + 1] = child
+		exact[#exact + 1], classes[#classes + 1] = operand(child, source)
+	end
+	for i = 0, node:named_child_count() - 1 do
+		local child = node:named_child(i)
+		if child:type() == "operand_list" then
+			for j = 0, child:named_child_count() - 1 do
+				add(child:named_child(j))
+			end
+		elseif child ~= mnemonic and child:type() ~= "instruction_name" then
+			add(child)
+		end
+	end
+	return vim.treesitter.get_node_text(mnemonic, source):lower(), exact, classes, nodes
+end
+
+---The SM83 table entry of the instruction `node` and its form, nil for
+---forms the CPU does not have.
+---@param node TSNode
+---@param source integer|string
+---@return table|nil entry, string|nil form
+function M.lookup(node, source)
+	local mnemonic, exact, classes = M.operands(node, source)
+	if mnemonic == nil then
+		return nil
+	end
+	-- push and pop take af where the other rr forms take sp
+	if (mnemonic == "push" or mnemonic == "pop") and exact[1] == "sp" then
+		return nil
+	end
+	if ALU[mnemonic] and #exact == 2 and exact[1] == "a" then
+		table.remove(exact, 1)
+		table.remove(classes, 1)
+	end
+	local candidates
+	if #exact == 0 then
+		candidates = { mnemonic }
+	elseif #exact == 1 then
+		candidates = { mnemonic .. " " .. exact[1], mnemonic .. " " .. classes[1] }
+	elseif #exact == 2 then
+		local prefix = mnemonic .. " "
+		candidates = {
+			prefix .. exact[1] .. "," .. exact[2],
+			prefix .. exact[1] .. "," .. classes[2],
+			prefix .. classes[1] .. "," .. exact[2],
+			prefix .. classes[1] .. "," .. classes[2],
+		}
+	else
+		return nil
+	end
+	for _, form in ipairs(candidates) do
+		local entry = sm83[form]
+		if entry then
+			return entry, form
+		end
+	end
+	return nil
+end
+
+return M
@@ -0,0 +1,310 @@
+-- `jp` instructions that could be `jr`, and `jr` instructions out of range.
+--
+-- A `jr` reaches -128 to +127 bytes from its end and is a byte and an
+-- M-cycle cheaper than a `jp`. Distances come from the section layouts of
+-- rgbds.sizes: the offset of a statement of a SECTION is the sum of the
+-- cached sizes before it, and the offsets of the labels and jumps inside a
+-- statement are relative to it and cached per syntax node (rgbds.analyzer),
+-- rows too. After an edit only the changed statements are walked again, the
+-- ones after them keep their entries and are shifted to their new offset
+-- and row.
+--
+-- Offsets after a size that is not exact, like a macro invocation or ALIGN,
+-- start a new epoch and are only compared with each other. Jumps into or out
+-- of IF blocks, REPT and FOR bodies and LOAD blocks are not checked.
+-- tree-sitter-rgbasm/tools/jumps.c does the same for a whole project.
+
+local analyzer = require("rgbds.analyzer")
+local flow = require("rgbds.flow")
+local instructions = require("rgbds.instructions")
+local sizes = require("rgbds.sizes")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.jumps")
+
+-- The jumps checked, by SM83 form.
+local JUMPS = {
+	["jp n"] = "jp",
+	["jp cc,n"] = "jp",
+	["jr n"] = "jr",
+	["jr cc,n"] = "jr",
+}
+
+---A label or jump, placed relative to the statement containing it.
+---@class rgbds.JumpItem
+---@field label? string the name of a label, `Parent.local` for local ones
+---@field node? TSNode the instruction of a jump
+---@field row? integer of a jump, relative to the statement
+---@field jr? boolean whether the jump is a jr
+---@field target? string the label a jump goes to
+---@field offset integer bytes before it
+---@field epoch integer sizes before it that are not exact
+---@field scope integer|nil id of the IF branch containing it
+
+---@class rgbds.Jump
+---@field row integer 0-based
+---@field jr boolean
+---@field distance integer of the jr, from its end
+---@field fits boolean
+
+---@class rgbds.JumpBuffer
+---@field cache rgbds.NodeCache of { node: TSNode, items: rgbds.JumpItem[], volatile: boolean|nil } by statement
+---@field jumps rgbds.Jump[]
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.JumpBuffer>
+local buffers = {}
+
+-- Nodes walked for the labels and jumps they contain.
+local CONTAINERS = {
+	directive = true,
+	instruction_list = true,
+	global_label_block = true,
+	local_label_block = true,
+	if_block = true,
+}
+
+local walk
+
+---Adds the labels and jumps of `node`, placed at `at`, and moves `at` past
+---it. `start` is where the IF block `node` is a clause of starts.
+---@param buf integer
+---@param node TSNode
+---@param global string
+---@param at { offset: integer, epoch: integer }
+---@param scope integer|nil
+---@param items rgbds.JumpItem[]
+---@param start { offset: integer, epoch: integer }
+local function visit(buf, node, global, at, scope, items, start)
+	local kind = node:type()
+	if kind == "elif_clause" or kind == "else_clause" then
+		-- each branch is placed where the IF starts
+		walk(buf, node, global, { offset = start.offset, epoch = start.epoch }, node:id(), items)
+		return
+	end
+	local size = sizes.size(buf, node)
+	if size == nil then
+		return
+	end
+	if kind == "instruction" then
+		local _, form = instructions.lookup(node, buf)
+		if JUMPS[form] then
+			local _, _, _, operands = instructions.operands(node, buf)
+			items[#items + 1] = {
+				node = node,
+				jr = JUMPS[form] == "jr",
+				target = flow.target("jump", operands, buf, global),
+				offset = at.offset,
+				epoch = at.epoch,
+				scope = scope,
+			}
+		end
+	elseif CONTAINERS[kind] then
+		local inner, label = global, nil
+		local name = node:field("name")[1]
+		if kind == "global_label_block" then
+			inner = name and vim.treesitter.get_node_text(name, buf) or ""
+			label = inner
+		elseif kind == "local_label_block" then
+			label = name and flow.symbol(name, buf, global)
+		end
+		if label then
+			items[#items + 1] = { label = label, offset = at.offset, epoch = at.epoch, scope = scope }
+		end
+		walk(buf, node, inner, { offset = at.offset, epoch = at.epoch }, kind == "if_block" and node:id() or scope, items)
+	end
+	at.offset = at.offset + size.bytes
+	if size.align or not size.exact then
+		at.epoch = at.epoch + 1
+	end
+end
+
+---@param buf integer
+---@param node TSNode
+---@param global string
+---@param at { offset: integer, epoch: integer }
+---@param scope integer|nil
+---@param items rgbds.JumpItem[]
+function walk(buf, node, global, at, scope, items)
+	local start = { offset = at.offset, epoch = at.epoch }
+	for i = 0, node:named_child_count() - 1 do
+		visit(buf, node:named_child(i), global, at, scope, items, start)
+	end
+end
+
+---The labels and jumps of a statement of a section, relative to it.
+---@param buf integer
+---@param state rgbds.JumpBuffer
+---@param statement TSNode
+---@return rgbds.JumpItem[]
+local function items_of(buf, state, statement)
+	local cached = state.cache:get(statement)
+	if cached then
+		return cached.items
+	end
+	local items = {}
+	local at = { offset = 0, epoch = 0 }
+	visit(buf, statement, "", at, nil, items, at)
+	local base = statement:start()
+	for _, item in ipairs(items) do
+		if item.node then
+			item.row = item.node:start() - base
+		end
+	end
+	local size = sizes.size(buf, statement)
+	return state.cache:put(statement, { node = statement, items = items, volatile = size and size.volatile }).items
+end
+
+---The distance of a jr replacing the jump at `offset` to `target`.
+---@param jr boolean
+---@param offset integer
+---@param target integer
+---@return integer
+local function distance(jr, offset, target)
+	-- from the end of a 2-byte jr; a jp shrinking by a byte moves a target
+	-- after it along
+	local result = target - offset - 2
+	if not jr and target > offset then
+		result = result - 1
+	end
+	return result
+end
+
+---@param buf integer
+---@param state rgbds.JumpBuffer
+---@param layout rgbds.SectionLayout
+---@param jumps rgbds.Jump[]
+local function check(buf, state, layout, jumps)
+	local labels, placed = {}, {}
+	for n, statement in ipairs(layout.nodes) do
+		for _, item in ipairs(items_of(buf, state, statement)) do
+			local at = {
+				item = item,
+				statement = statement,
+				offset = layout.offsets[n] + item.offset,
+				epoch = layout.epochs[n] + item.epoch,
+			}
+			if item.label then
+				labels[item.label] = at
+			else
+				placed[#placed + 1] = at
+			end
+		end
+	end
+	for _, jump in ipairs(placed) do
+		local item = jump.item
+		local target = item.target and labels[item.target]
+		if target and target.epoch == jump.epoch and target.item.scope == item.scope then
+			local result = distance(item.jr, jump.offset, target.offset)
+			local fits = result >= -128 and result <= 127
+			if fits ~= item.jr then
+				local row = jump.statement:start() + item.row
+				jumps[#jumps + 1] = { row = row, jr = item.jr, distance = result, fits = fits }
+			end
+		end
+	end
+end
+
+---@param jump rgbds.Jump
+---@return string
+local function format(jump)
+	if jump.jr then
+		return string.format("jr out of range: %+d", jump.distance)
+	end
+	return "→ jr -1b -1c"
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	state.cache:trim()
+	local jumps = {}
+	for _, section in ipairs(sizes.sections(buf)) do
+		if section.layout then
+			check(buf, state, section.layout, jumps)
+		end
+	end
+	state.jumps = jumps
+	vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+	if not require("rgbds").shows("jumps", "hints") then
+		return
+	end
+	for _, jump in ipairs(jumps) do
+		vim.api.nvim_buf_set_extmark(buf, ns, jump.row, 0, {
+			virt_text = { { format(jump), jump.jr and "RgbdsJumpRange" or "RgbdsJump" } },
+			virt_text_pos = "eol",
+		})
+	end
+end
+
+---The jp instructions of `buf` that could be jr and the jr instructions out
+---of range, as of the last update.
+---@param buf integer
+---@return rgbds.Jump[]
+function M.jumps(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local state = buffers[buf]
+	return state and state.jumps or {}
+end
+
+---Fills the quickfix list with the jumps of `buf`, the jr out of range
+---first.
+---@param buf integer
+function M.quickfix(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	sizes.update(buf)
+	update(buf)
+	local jumps = vim.list_extend({}, M.jumps(buf))
+	table.sort(jumps, function(a, b)
+		if a.jr ~= b.jr then
+			return a.jr
+		end
+		return a.row < b.row
+	end)
+	local items = {}
+	for _, jump in ipairs(jumps) do
+		local text = string.format("jp can be jr (%+d)", jump.distance)
+		if jump.jr then
+			local over = jump.distance > 0 and jump.distance - 127 or -128 - jump.distance
+			text = string.format("jr out of range by %d bytes (%+d)", over, jump.distance)
+		end
+		items[#items + 1] = { bufnr = buf, lnum = jump.row + 1, text = text, type = jump.jr and "E" or nil }
+	end
+	if #items == 0 then
+		vim.notify("rgbds.nvim: no jumps to change in this buffer")
+		return
+	end
+	vim.fn.setqflist({}, " ", { title = "Jumps", items = items })
+	vim.cmd("botright copen")
+end
+
+---@type rgbds.Analyzer
+local jumps = {
+	name = "jumps",
+	buffers = buffers,
+	update = update,
+	-- after rgbds.sizes laid out the sections
+	delay = 300,
+	namespaces = { ns },
+	depends = { "rgbds.sizes" },
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsJump", { link = "LspInlayHint", default = true })
+		vim.api.nvim_set_hl(0, "RgbdsJumpRange", { link = "DiagnosticVirtualTextError", default = true })
+	end,
+}
+
+---Shows the jumps of `buf` to change as it changes.
+---@param buf integer|nil
+function M.attach(buf)
+	analyzer.attach(buf, jumps, { cache = analyzer.cache(), jumps = {} })
+end
+
+return M
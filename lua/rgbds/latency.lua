@@ -0,0 +1,565 @@
+-- Code that runs with interrupts disabled in the functions of a buffer.
+--
+-- Every `di` starts a region that lasts until an `ei` or a `reti` ends it.
+-- An `ei` enables interrupts after the instruction that follows it, so both
+-- count; a `halt` right after an `ei` waits with interrupts enabled. Its worst case is the longest path through the jumps and
+-- branches of its function, loops bounded by a `; @loop N` comment on their
+-- jump back, plus the worst case of every function it calls up to that
+-- function's own `ei`, `reti` or return. A region that returns with
+-- interrupts disabled goes on in a caller and is a lower bound.
+-- tree-sitter-rgbasm/tools/latency.c does the same for a whole project,
+-- including the interrupt handlers.
+--
+-- Functions are compiled once per syntax node like in rgbds.stack, with rows
+-- relative to their label. The cost of a function and of each of its regions
+-- is kept with the costs of the functions they called; after an edit only
+-- the regions of changed functions, or of functions whose callees now cost
+-- something else, are walked again.
+
+local analyzer = require("rgbds.analyzer")
+local flow = require("rgbds.flow")
+local instructions = require("rgbds.instructions")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.latency")
+
+---@class rgbds.LatencyItem
+---@field cycles integer M-cycles, with the condition false
+---@field taken integer|nil M-cycles with the condition true
+---@field flow string|nil see rgbds.flow
+---@field target string|nil
+---@field index integer|nil of the target in the function
+---@field ime "di"|"ei"|"reti"|nil
+---@field halt boolean
+---@field bound integer|nil of the loop it jumps back to
+---@field known boolean
+---@field row integer relative to the label of the function
+
+---@alias rgbds.LatencyAt { [1]: string, [2]: integer } a function and a row relative to its label
+
+---@class rgbds.LatencyCost
+---@field cycles integer
+---@field exact boolean
+---@field reason string|nil why it is not exact
+---@field reason_at rgbds.LatencyAt|nil
+---@field returns integer|nil the relative row of a return with interrupts disabled
+---@field halts integer[] the halts it reaches, by index in the function
+---@field deps { name: string|false, cycles: integer|nil, exact: boolean|nil, at: rgbds.LatencyAt|nil }[] the costs of callees it used
+
+---@class rgbds.LatencySummary
+---@field node TSNode keeps the node id from being reused
+---@field global string the name of the function
+---@field items rgbds.LatencyItem[]
+---@field exact boolean
+---@field reason string|nil
+---@field row integer|nil relative to the label
+---@field volatile boolean read a constant
+---@field routine rgbds.LatencyCost|nil
+---@field regions table<integer, rgbds.LatencyCost> by the index of the di
+
+---@class rgbds.LatencyRegion
+---@field name string the function
+---@field row integer 0-based row of the di
+---@field cycles integer
+---@field exact boolean
+---@field reason string|nil
+---@field reason_row integer|nil
+
+---@class rgbds.LatencyHalt
+---@field name string the function
+---@field row integer
+---@field disabled boolean reached with interrupts disabled
+
+---@class rgbds.LatencyBuffer
+---@field cache rgbds.NodeCache of rgbds.LatencySummary
+---@field regions rgbds.LatencyRegion[]
+---@field halts rgbds.LatencyHalt[]
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.LatencyBuffer>
+local buffers = {}
+
+local IME = { di = "di", ei = "ei", reti = "reti" }
+
+---@param result { exact: boolean, reason: string|nil, row: integer|nil, reason_at: rgbds.LatencyAt|nil }
+---@param reason string
+---@param at integer|rgbds.LatencyAt
+---@param key? string the field `at` goes to, `row` by default
+local function problem(result, reason, at, key)
+	if result.exact then
+		result.exact, result.reason = false, reason
+		result[key or "row"] = at
+	end
+end
+
+---The `N` of a `; @loop N` comment on the line of `node`.
+---@param buf integer
+---@param node TSNode instruction
+---@param summary rgbds.LatencySummary
+---@return integer|nil
+local function loop_bound(buf, node, summary)
+	local list = node:parent()
+	local comment = list and list:next_named_sibling()
+	if comment == nil or comment:type() ~= "inline_comment" or comment:start() ~= node:start() then
+		return nil
+	end
+	local text = vim.treesitter.get_node_text(comment, buf):match("@loop%s+([%w_%$%%%.]+)")
+	if text == nil then
+		return nil
+	end
+	local value = require("rgbds.eval").number(text)
+	if value == nil then
+		summary.volatile = true
+		value = require("rgbds.values").lookup(buf, text, node:start())
+	end
+	return type(value) == "number" and value >= 0 and value or nil
+end
+
+---@param buf integer
+---@param block TSNode global_label_block
+---@return rgbds.LatencySummary
+local function summarize(buf, block)
+	local name = block:field("name")[1]
+	local global = name and vim.treesitter.get_node_text(name, buf) or ""
+	local base = block:start()
+	local summary = { node = block, global = global, items = {}, exact = true, volatile = false, regions = {} }
+	local out = flow.collect(buf, block, global, function(reason, row)
+		problem(summary, reason, row - base)
+	end)
+	for i, node in ipairs(out.list) do
+		local entry, form = instructions.lookup(node, buf)
+		local item = { cycles = 0, halt = false, known = entry ~= nil, row = node:start() - base }
+		if entry then
+			local _, _, _, operands = instructions.operands(node, buf)
+			item.cycles, item.taken = entry.cycles, entry.taken
+			item.flow = flow.FLOWS[form]
+			item.target = flow.target(item.flow, operands, buf, global)
+			item.index = item.target and out.labels[item.target]
+			item.ime = IME[form]
+			item.halt = form == "halt"
+			if item.flow == "branch" or item.flow == "jump" then
+				item.bound = loop_bound(buf, node, summary)
+			end
+		end
+		summary.items[i] = item
+	end
+	return summary
+end
+
+---The worst case of `summary` from its instruction `start` until interrupts
+---are enabled or it returns.
+---@param summary rgbds.LatencySummary
+---@param start integer
+---@param cost_of fun(name: string|false): rgbds.LatencyCost|nil the function called, false for the next one
+---@return rgbds.LatencyCost
+local function walk(summary, start, cost_of)
+	local items = summary.items
+	local result = {
+		cycles = 0,
+		exact = summary.exact,
+		reason = summary.reason,
+		reason_at = summary.row and { summary.global, summary.row },
+		halts = {},
+		deps = {},
+	}
+	local function fail(reason, row)
+		problem(result, reason, { summary.global, row }, "reason_at")
+	end
+	local function callee(name, row)
+		local cost = cost_of(name)
+		result.deps[#result.deps + 1] =
+			{ name = name, cycles = cost and cost.cycles, exact = cost and cost.exact, at = cost and cost.reason_at }
+		if cost == nil then
+			if name == false then
+				fail("code running past the end of the buffer", row)
+			else
+				fail(name and (name .. " is not in this buffer") or "call to an unknown address", row)
+			end
+			return 0
+		end
+		if not cost.exact then
+			problem(result, cost.reason, cost.reason_at, "reason_at")
+		end
+		return cost.cycles
+	end
+
+	---@param i integer
+	---@return { to: integer|false, cost: integer }[]
+	local function edges(i)
+		local item = items[i]
+		local base, taken = item.cycles, item.taken or item.cycles
+		local kind = item.flow
+		local list
+		if not item.known then
+			fail("unknown instruction", item.row)
+		end
+		if item.ime == "ei" then
+			-- the next instruction still runs with interrupts disabled, what
+			-- it calls does not
+			local delayed = items[i + 1]
+			return { { to = false, cost = base + (delayed and (delayed.taken or delayed.cycles) or 0) } }
+		elseif kind == "jump" then
+			list = { { to = item.index or false, cost = base } }
+			if item.index == nil then
+				-- a tail call
+				list[1].cost = base + callee(item.target, item.row)
+			end
+		elseif kind == "branch" then
+			list = { { to = i + 1, cost = base }, { to = item.index or false, cost = taken } }
+			if item.index == nil then
+				list[2].cost = taken + callee(item.target, item.row)
+			end
+		elseif kind == "call" and item.taken then
+			list = { { to = i + 1, cost = base }, { to = i + 1, cost = taken + callee(item.target, item.row) } }
+		elseif kind == "call" then
+			list = { { to = i + 1, cost = base + callee(item.target, item.row) } }
+		elseif kind == "return" or kind == "return_cond" then
+			if item.ime ~= "reti" and result.returns == nil then
+				result.returns = item.row
+			end
+			list = kind == "return" and { { to = false, cost = base } }
+				or { { to = i + 1, cost = base }, { to = false, cost = taken } }
+		elseif kind == "indirect" then
+			fail("indirect jump", item.row)
+			list = { { to = false, cost = base } }
+		else
+			list = { { to = i + 1, cost = base } }
+		end
+		for _, edge in ipairs(list) do
+			if edge.to and edge.to > #items then
+				-- falls into the next function
+				edge.to = false
+				edge.cost = edge.cost + callee(false, item.row)
+			end
+		end
+		return list
+	end
+
+	if items[start] == nil then
+		-- a label without code falls into the next function
+		result.cycles = callee(false, 0)
+		return result
+	end
+
+	-- depth-first from `start`: the postorder, and the back edges that close
+	-- a loop
+	local out, post, order, on_path = {}, {}, {}, {}
+	local stack = { start }
+	local next_edge = { [start] = 1 }
+	out[start] = edges(start)
+	on_path[start] = true
+	while #stack > 0 do
+		local v = stack[#stack]
+		local edge = out[v][next_edge[v]]
+		if edge == nil then
+			on_path[v] = nil
+			order[#order + 1] = v
+			post[v] = #order
+			stack[#stack] = nil
+		else
+			next_edge[v] = next_edge[v] + 1
+			local to = edge.to
+			if to and out[to] then
+				edge.back = on_path[to] == true
+			elseif to then
+				out[to] = edges(to)
+				next_edge[to] = 1
+				on_path[to] = true
+				stack[#stack + 1] = to
+			end
+		end
+	end
+
+	-- bounded loops add their repetitions to their first instruction, inner
+	-- ones first
+	local loops = {}
+	for _, v in ipairs(order) do
+		if items[v].halt then
+			result.halts[#result.halts + 1] = v
+		end
+		for _, edge in ipairs(out[v]) do
+			if edge.back then
+				loops[#loops + 1] = { header = edge.to, tail = v, edge = edge }
+			end
+		end
+	end
+	table.sort(loops, function(a, b)
+		return post[a.header] < post[b.header]
+	end)
+	local extra = {}
+	for _, loop in ipairs(loops) do
+		local bound = items[loop.tail].bound
+		if bound == nil then
+			fail("loop without a `; @loop N` bound", items[loop.tail].row)
+		elseif bound > 0 then
+			local longest = {}
+			for _, v in ipairs(order) do
+				local own = v == loop.header and 0 or (extra[v] or 0)
+				if v == loop.tail then
+					longest[v] = own
+				else
+					for _, edge in ipairs(out[v]) do
+						if not edge.back and edge.to and longest[edge.to] then
+							longest[v] = math.max(longest[v] or 0, own + edge.cost + longest[edge.to])
+						end
+					end
+				end
+			end
+			if longest[loop.header] then
+				local repeated = (longest[loop.header] + loop.edge.cost) * (bound - 1)
+				extra[loop.header] = math.max(extra[loop.header] or 0, repeated)
+			end
+		end
+	end
+
+	local longest = {}
+	for _, v in ipairs(order) do
+		local best = 0
+		for _, edge in ipairs(out[v]) do
+			if not edge.back then
+				best = math.max(best, edge.cost + (edge.to and longest[edge.to] or 0))
+			end
+		end
+		longest[v] = (extra[v] or 0) + best
+	end
+	result.cycles = longest[start]
+	return result
+end
+
+---@param a rgbds.LatencyAt|nil
+---@param b rgbds.LatencyAt|nil
+---@return boolean
+local function same_at(a, b)
+	return a == b or (a ~= nil and b ~= nil and a[1] == b[1] and a[2] == b[2])
+end
+
+---Whether `cost` was computed with the costs its callees have now.
+---@param cost rgbds.LatencyCost|nil
+---@param cost_of fun(name: string|false): rgbds.LatencyCost|nil
+---@return boolean
+local function valid(cost, cost_of)
+	if cost == nil then
+		return false
+	end
+	for _, dep in ipairs(cost.deps) do
+		local now = cost_of(dep.name)
+		if
+			(now and now.cycles) ~= dep.cycles
+			or (now and now.exact) ~= dep.exact
+			or not same_at(now and now.reason_at, dep.at)
+		then
+			return false
+		end
+	end
+	return true
+end
+
+---The regions and halts of the functions of a buffer. Costs kept in the
+---summaries are reused while their callees cost the same. `row` is where the
+---label of a function is now, its summary's rows are relative to it.
+---@param functions { name: string, row: integer, summary: rgbds.LatencySummary }[]
+---@return rgbds.LatencyRegion[], rgbds.LatencyHalt[]
+function M.combine(functions)
+	local by_name = {}
+	for i, f in ipairs(functions) do
+		by_name[f.name] = i
+	end
+	local costs, running = {}, {}
+	local routine
+
+	---The costs of what the function `i` calls, false for the next one.
+	local function callees(i)
+		return function(name)
+			local callee
+			if name == false then
+				callee = functions[i + 1] and i + 1
+			else
+				callee = name and by_name[name]
+			end
+			return callee and routine(callee)
+		end
+	end
+
+	function routine(i)
+		if costs[i] then
+			return costs[i]
+		end
+		if running[i] then
+			local at = { functions[i].name, 0 }
+			return { cycles = 0, exact = false, reason = "recursion", reason_at = at, halts = {}, deps = {} }
+		end
+		running[i] = true
+		local summary = functions[i].summary
+		local cost_of = callees(i)
+		if summary.next ~= (functions[i + 1] and functions[i + 1].name) or not valid(summary.routine, cost_of) then
+			summary.next = functions[i + 1] and functions[i + 1].name
+			summary.regions = {}
+			summary.routine = walk(summary, 1, cost_of)
+		end
+		running[i] = nil
+		costs[i] = summary.routine
+		return summary.routine
+	end
+
+	---The buffer row of `at`.
+	---@param at rgbds.LatencyAt
+	---@param f { row: integer } the function it is in if there is none of its name
+	local function row_of(at, f)
+		local found = by_name[at[1]]
+		return (found and functions[found].row or f.row) + at[2]
+	end
+
+	local regions, halts = {}, {}
+	for i, f in ipairs(functions) do
+		routine(i)
+		local summary = f.summary
+		local cost_of = callees(i)
+		local disabled = {}
+		for j, item in ipairs(summary.items) do
+			if item.ime == "di" then
+				local cost = summary.regions[j]
+				if not valid(cost, cost_of) then
+					cost = walk(summary, j, cost_of)
+					summary.regions[j] = cost
+				end
+				for _, k in ipairs(cost.halts) do
+					disabled[k] = true
+				end
+				local region = {
+					name = f.name,
+					row = f.row + item.row,
+					cycles = cost.cycles,
+					exact = cost.exact,
+					reason = cost.reason,
+					reason_row = cost.reason_at and row_of(cost.reason_at, f),
+				}
+				if cost.returns then
+					-- it goes on in a caller
+					problem(region, "return with interrupts disabled", f.row + cost.returns, "reason_row")
+				end
+				regions[#regions + 1] = region
+			end
+		end
+		for j, item in ipairs(summary.items) do
+			if item.halt then
+				halts[#halts + 1] = { name = f.name, row = f.row + item.row, disabled = disabled[j] == true }
+			end
+		end
+	end
+	return regions, halts
+end
+
+---@param region rgbds.LatencyRegion
+---@return string
+local function format(region)
+	return string.format("interrupts off %s%dc", region.exact and "" or ">=", region.cycles)
+end
+
+---@param buf integer
+---@param state rgbds.LatencyBuffer
+---@param root TSNode
+---@return { name: string, row: integer, summary: rgbds.LatencySummary }[]
+local function functions(buf, state, root)
+	state.cache:trim()
+	local found = {}
+	for _, block in ipairs(flow.functions(root)) do
+		local summary = state.cache:get(block) or state.cache:put(block, summarize(buf, block))
+		found[#found + 1] = { name = summary.global, row = block:start(), summary = summary }
+	end
+	return found
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	state.regions, state.halts = M.combine(functions(buf, state, parser:parse()[1]:root()))
+	vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+	if not require("rgbds").shows("latency", "hints") then
+		return
+	end
+	for _, region in ipairs(state.regions) do
+		vim.api.nvim_buf_set_extmark(buf, ns, region.row, 0, {
+			virt_text = { { format(region), "RgbdsLatency" } },
+			virt_text_pos = "eol",
+		})
+	end
+end
+
+---The regions with interrupts disabled of `buf` and its halts, as of the
+---last update.
+---@param buf integer
+---@return rgbds.LatencyRegion[], rgbds.LatencyHalt[]
+function M.regions(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local state = buffers[buf]
+	return state and state.regions or {}, state and state.halts or {}
+end
+
+---Fills the quickfix list with the regions of `buf`, longest first, and
+---its halts.
+---@param buf integer
+function M.quickfix(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	update(buf)
+	local regions, halts = M.regions(buf)
+	regions = vim.list_extend({}, regions)
+	table.sort(regions, function(a, b)
+		return a.cycles > b.cycles
+	end)
+	local items = {}
+	for _, region in ipairs(regions) do
+		local text = string.format("%s: %s%d M-cycles", region.name, region.exact and "" or ">=", region.cycles)
+		if not region.exact then
+			text = string.format("%s (%s, line %d)", text, region.reason, region.reason_row + 1)
+		end
+		items[#items + 1] = { bufnr = buf, lnum = region.row + 1, text = text }
+	end
+	for _, halt in ipairs(halts) do
+		items[#items + 1] = {
+			bufnr = buf,
+			lnum = halt.row + 1,
+			text = string.format("%s: halt with interrupts %s", halt.name, halt.disabled and "disabled" or "enabled"),
+		}
+	end
+	if #items == 0 then
+		vim.notify("rgbds.nvim: no di or halt in this buffer")
+		return
+	end
+	vim.fn.setqflist({}, " ", { title = "Interrupts disabled", items = items })
+	vim.cmd("botright copen")
+end
+
+---@type rgbds.Analyzer
+local latency = {
+	name = "latency",
+	buffers = buffers,
+	update = update,
+	delay = 200,
+	namespaces = { ns },
+	-- for the constants it reads
+	depends = { "rgbds.values" },
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsLatency", { link = "LspInlayHint", default = true })
+	end,
+}
+
+---Shows the worst case of every region with interrupts disabled of `buf` at
+---its di.
+---@param buf integer|nil
+function M.attach(buf)
+	analyzer.attach(buf, latency, { cache = analyzer.cache(), regions = {}, halts = {} })
+end
+
+return M
@@ -0,0 +1,233 @@
+-- Highlighting of macro invocations by what the project defines.
+--
+-- A mistyped instruction parses as a macro invocation, so syntax alone
+-- highlights it like a macro. `#rgbds-macro?` checks the name against hash
+-- sets of the macros defined in the project index, in the buffer and in the
+-- files it includes. The rgbasm highlights get a pattern capturing unknown
+-- invocations as `@function.macro.unknown`, undercurled by default. Without
+-- a project index every invocation counts as known, since macros may come
+-- from a file including the buffer.
+--
+-- The sets are rebuilt when the index or the buffer changes, and windows
+-- are redrawn only if a set actually changed. No reparse is needed.
+
+local include_cache = require("rgbds.include_cache")
+local syntax = require("rgbds.syntax")
+
+local M = {}
+
+---@class rgbds.MacroProject
+---@field macros table<string, true>
+
+---@type table<string, rgbds.MacroProject>
+local projects = {}
+
+---@class rgbds.MacroBuffer
+---@field project string|nil index path
+---@field macros table<string, true> defined in the buffer and its includes
+
+---@type table<integer, rgbds.MacroBuffer>
+local buffers = {}
+
+---@param a table<string, true>
+---@param b table<string, true>
+---@return boolean
+local function same_set(a, b)
+	for name in pairs(a) do
+		if not b[name] then
+			return false
+		end
+	end
+	for name in pairs(b) do
+		if not a[name] then
+			return false
+		end
+	end
+	return true
+end
+
+---Loads the macros of the index at `path` again. Returns whether they
+---changed.
+---@param path string
+---@return boolean
+local function load_project(path)
+	local macros = {}
+	local index = require("rgbds.index").open(path)
+	if index ~= nil then
+		for name, kind in pairs(index:defined_names()) do
+			if kind == "macro" then
+				macros[name] = true
+			end
+		end
+		index:close()
+	end
+	local project = projects[path]
+	if project and same_set(project.macros, macros) then
+		return false
+	end
+	projects[path] = { macros = macros }
+	return true
+end
+
+---The macros defined in `buf` and, transitively, the files it includes.
+---@param buf integer
+---@return table<string, true>
+local function buffer_macros(buf)
+	local macros = {}
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	-- the tree the highlighter parsed, predicates must not parse
+	local tree = ok and parser and parser:trees()[1]
+	if not tree then
+		return macros
+	end
+	local names, includes = syntax.definitions(buf, tree:root())
+	for name, kind in pairs(names) do
+		if kind == "macro" then
+			macros[name] = true
+		end
+	end
+	local include_dirs = (require("rgbds").options.index or {}).include_dirs
+	for _, record in pairs(include_cache.closure(vim.api.nvim_buf_get_name(buf), includes, include_dirs)) do
+		for name, kind in pairs(record.names) do
+			if kind == "macro" then
+				macros[name] = true
+			end
+		end
+	end
+	return macros
+end
+
+---@param buf integer
+---@return rgbds.MacroBuffer
+local function buffer_state(buf)
+	local state = buffers[buf]
+	if state == nil then
+		local path = vim.api.nvim_buf_get_name(buf)
+		local index_path = path ~= ""
+			and vim.fs.find(require("rgbds.index").file_name, {
+				path = vim.fs.dirname(path),
+				upward = true,
+				type = "file",
+			})[1]
+		index_path = index_path and (vim.uv.fs_realpath(index_path) or index_path) or nil
+		if index_path and projects[index_path] == nil then
+			load_project(index_path)
+		end
+		state = { project = index_path, macros = buffer_macros(buf) }
+		buffers[buf] = state
+	end
+	return state
+end
+
+---Whether `name` is a macro known in `buf`, or nothing is known there.
+---@param buf integer
+---@param name string
+---@return boolean
+function M.is_macro(buf, name)
+	local state = buffer_state(buf)
+	if state.project == nil then
+		return true
+	end
+	return state.macros[name] ~= nil or projects[state.project].macros[name] ~= nil
+end
+
+local function redraw(buf)
+	if vim.api.nvim__redraw then
+		vim.api.nvim__redraw({ buf = buf, valid = false })
+	else
+		vim.cmd("redraw!")
+	end
+end
+
+local function define_highlight()
+	vim.api.nvim_set_hl(0, "@function.macro.unknown", { link = "DiagnosticUnderlineWarn", default = true })
+end
+
+-- invocations of names that are not known macros
+local PATTERN = [[
+
+((macro_invocation
+  (variable) @function.macro.unknown)
+  (#not-rgbds-macro? @function.macro.unknown)
+  (#set! priority 121))
+]]
+
+local installed = false
+
+---Installs the predicate and the pattern. Called by the rgbasm ftplugin
+---before highlighting starts.
+function M.setup()
+	if installed then
+		return
+	end
+	installed = true
+
+	vim.treesitter.query.add_predicate("rgbds-macro?", function(match, _, source, predicate)
+		if type(source) ~= "number" then
+			return true
+		end
+		local nodes = match[predicate[2]]
+		if type(nodes) ~= "table" then
+			nodes = { nodes }
+		end
+		for _, node in ipairs(nodes) do
+			if not M.is_macro(source, vim.treesitter.get_node_text(node, source)) then
+				return false
+			end
+		end
+		return true
+	end, { force = true, all = true })
+	pcall(vim.treesitter.query.set, "rgbasm", "highlights", syntax.query_text("rgbasm", "highlights") .. PATTERN)
+	define_highlight()
+
+	local group = vim.api.nvim_create_augroup("rgbds.macros", { clear = true })
+	vim.api.nvim_create_autocmd("ColorScheme", { group = group, callback = define_highlight })
+	local timers = {}
+	vim.api.nvim_create_autocmd({ "TextChanged", "TextChangedI" }, {
+		group = group,
+		callback = function(args)
+			local state = buffers[args.buf]
+			if state == nil then
+				return
+			end
+			local timer = timers[args.buf] or assert(vim.uv.new_timer())
+			timers[args.buf] = timer
+			timer:start(200, 0, vim.schedule_wrap(function()
+				if buffers[args.buf] ~= state or not vim.api.nvim_buf_is_valid(args.buf) then
+					return
+				end
+				local macros = buffer_macros(args.buf)
+				if not same_set(state.macros, macros) then
+					state.macros = macros
+					redraw(args.buf)
+				end
+			end))
+		end,
+	})
+	vim.api.nvim_create_autocmd("User", {
+		group = group,
+		pattern = "RgbdsIndexChanged",
+		callback = function(args)
+			local path = vim.fs.joinpath(args.data.root, require("rgbds.index").file_name)
+			if projects[path] and load_project(path) then
+				for buf, state in pairs(buffers) do
+					if state.project == path and vim.api.nvim_buf_is_valid(buf) then
+						redraw(buf)
+					end
+				end
+			end
+		end,
+	})
+	vim.api.nvim_create_autocmd("BufWipeout", {
+		group = group,
+		callback = function(args)
+			buffers[args.buf] = nil
+			if timers[args.buf] then
+				timers[args.buf]:close()
+				timers[args.buf] = nil
+			end
+		end,
+	})
+end
+
+return M
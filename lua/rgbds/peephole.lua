@@ -0,0 +1,350 @@
+-- Cheaper equivalents of instructions, like `xor a` for `ld a, 0`.
+--
+-- The rules are the patterns of queries/peephole.scm, which
+-- tree-sitter-rgbasm/tools/peephole.c runs over a whole project. :TSUpdate
+-- installs it with the other queries of the grammar; until then it is read
+-- from the plugin directory. A match
+-- shows the replacement and what it saves at the end of its first line,
+-- e.g. `→ xor a -1b -1c`, and `:RgbdsRewrite` applies it.
+--
+-- Like rgbds.costs, only the changed lines are matched again after an edit.
+-- Rules that check the value of a constant also match the lines reading one
+-- again when a DEF changes.
+
+local analyzer = require("rgbds.analyzer")
+local costs = require("rgbds.costs")
+local eval = require("rgbds.eval")
+local sm83 = require("rgbds.sm83")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.peephole")
+local reader_ns = vim.api.nvim_create_namespace("rgbds.peephole.readers")
+
+---@class rgbds.Suggestion
+---@field rule string
+---@field row integer of the first instruction replaced, 0-based
+---@field range integer[] start row, start col, end row, end col of the text replaced
+---@field text string the replacement
+---@field bytes integer saved
+---@field cycles integer M-cycles saved
+---@field note string|nil what else changes, e.g. flags
+
+---@class rgbds.PeepholeBuffer
+---@field dirty integer[][] row ranges, end exclusive
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.PeepholeBuffer>
+local buffers = {}
+
+-- rows whose values a rule looked up while matching, if recorded
+---@type table<integer, true>|nil
+local reads
+
+local installed = false
+
+local function install_predicates()
+	if installed then
+		return
+	end
+	installed = true
+	local function nodes_of(match, predicate)
+		local nodes = match[predicate[2]]
+		return type(nodes) == "table" and nodes or { nodes }
+	end
+	vim.treesitter.query.add_predicate("rgbds-keyword?", function(match, _, source, predicate)
+		for _, node in ipairs(nodes_of(match, predicate)) do
+			local text = vim.treesitter.get_node_text(node, source):lower()
+			local found = false
+			for i = 3, #predicate do
+				found = found or text == predicate[i]
+			end
+			if not found then
+				return false
+			end
+		end
+		return true
+	end, { force = true, all = true })
+	vim.treesitter.query.add_predicate("rgbds-value?", function(match, _, source, predicate)
+		local min, max = eval.number(predicate[3]), eval.number(predicate[4])
+		for _, node in ipairs(nodes_of(match, predicate)) do
+			local row = node:start()
+			local value = eval.evaluate(node, {
+				source = source,
+				memo = {},
+				lookup = function(name)
+					if type(source) ~= "number" then
+						return nil
+					end
+					if reads then
+						reads[row] = true
+					end
+					return require("rgbds.values").lookup(source, name, row)
+				end,
+			})
+			if type(value) ~= "number" or not min or not max or value < min or value > max then
+				return false
+			end
+		end
+		return true
+	end, { force = true, all = true })
+end
+
+local query
+
+local function get_query()
+	if query == nil then
+		install_predicates()
+		query = vim.treesitter.query.get("rgbasm", "peephole")
+		local dir = require("rgbds").dir
+		if query == nil and dir then
+			local file = io.open(vim.fs.joinpath(dir, "tree-sitter-rgbasm", "queries", "peephole.scm"), "r")
+			if file then
+				query = vim.treesitter.query.parse("rgbasm", file:read("*a"))
+				file:close()
+			end
+		end
+	end
+	return query
+end
+
+-- Lines whose edit changes values.
+local defs_query
+
+local function get_defs_query()
+	defs_query = defs_query or vim.treesitter.query.parse("rgbasm", "(def_directive) @def")
+	return defs_query
+end
+
+---@param text string
+---@param captures table<string, TSNode>
+---@param buf integer
+---@return string
+local function expand(text, captures, buf)
+	return (
+		text:gsub("{(%w+)}", function(name)
+			local node = captures[name]
+			return node and vim.treesitter.get_node_text(node, buf)
+		end)
+	)
+end
+
+---The suggestion of a match, nil if the CPU lacks one of its forms.
+---@param buf integer
+---@param match table<integer, TSNode[]>
+---@param metadata table
+---@return rgbds.Suggestion|nil
+local function suggestion(buf, match, metadata)
+	local form = sm83[metadata.form or ""]
+	if form == nil or metadata.rule == nil or metadata.replace == nil then
+		return nil
+	end
+	local captures, first, last = {}, nil, nil
+	local bytes, cycles = 0, 0
+	for id, nodes in pairs(match) do
+		local name = get_query().captures[id]
+		for _, node in ipairs(type(nodes) == "table" and nodes or { nodes }) do
+			captures[name] = node
+			if name == "rewrite" then
+				local cost = costs.instruction(node, buf)
+				if cost == nil then
+					return nil
+				end
+				bytes, cycles = bytes + cost.bytes, cycles + cost.min
+				if first == nil or node:start_byte() < first:start_byte() then
+					first = node
+				end
+				if last == nil or node:end_byte() > last:end_byte() then
+					last = node
+				end
+			end
+		end
+	end
+	if first == nil or last == nil then
+		return nil
+	end
+	local start_row, start_col = first:start()
+	local end_row, end_col = last:end_()
+	return {
+		rule = metadata.rule,
+		row = start_row,
+		range = { start_row, start_col, end_row, end_col },
+		text = expand(metadata.replace, captures, buf),
+		bytes = bytes - form.bytes,
+		cycles = cycles - form.cycles,
+		note = metadata.note,
+	}
+end
+
+---The suggestions whose first instruction starts in rows `first` to `last`
+---(0-based, end exclusive) of `buf`.
+---@param buf integer
+---@param root TSNode
+---@param first integer
+---@param last integer
+---@return rgbds.Suggestion[]
+local function match(buf, root, first, last)
+	local found = {}
+	local q = get_query()
+	if q == nil then
+		return found
+	end
+	for _, captures, metadata in q:iter_matches(root, buf, first, last, { all = true }) do
+		local item = suggestion(buf, captures, metadata)
+		if item and item.row >= first and item.row < last then
+			found[#found + 1] = item
+		end
+	end
+	table.sort(found, function(a, b)
+		return a.row < b.row
+	end)
+	return found
+end
+
+---@param item rgbds.Suggestion
+---@return string
+local function format(item)
+	return string.format("→ %s -%db -%dc", item.text, item.bytes, item.cycles)
+end
+
+---@param buf integer
+---@return TSNode|nil
+local function root_of(buf)
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return nil
+	end
+	return parser:parse()[1]:root()
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local root = root_of(buf)
+	if root == nil then
+		return
+	end
+	local line_count = vim.api.nvim_buf_line_count(buf)
+	local dirty = state.dirty
+	for _, range in ipairs(dirty) do
+		local first, last = range[1], math.min(range[2], line_count)
+		if first < last and get_defs_query():iter_captures(root, buf, first, last)() then
+			-- a DEF changed: the lines reading constants too
+			for _, mark in ipairs(vim.api.nvim_buf_get_extmarks(buf, reader_ns, 0, -1, {})) do
+				dirty[#dirty + 1] = { mark[2], mark[2] + 1 }
+			end
+			break
+		end
+	end
+	local hints = require("rgbds").shows("peephole", "hints")
+	for _, range in ipairs(analyzer.take_dirty(state)) do
+		local first, last = range[1], math.min(range[2], line_count)
+		if first < last then
+			vim.api.nvim_buf_clear_namespace(buf, ns, first, last)
+			vim.api.nvim_buf_clear_namespace(buf, reader_ns, first, last)
+			reads = {}
+			local found = match(buf, root, first, last)
+			for row in pairs(reads) do
+				if row >= first and row < last then
+					vim.api.nvim_buf_set_extmark(buf, reader_ns, row, 0, {})
+				end
+			end
+			reads = nil
+			for _, item in ipairs(hints and found or {}) do
+				vim.api.nvim_buf_set_extmark(buf, ns, item.row, 0, {
+					virt_text = { { format(item), "RgbdsPeephole" } },
+					virt_text_pos = "eol",
+				})
+			end
+		end
+	end
+end
+
+---Every suggestion for `buf`, in document order.
+---@param buf integer
+---@return rgbds.Suggestion[]
+function M.suggestions(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local root = root_of(buf)
+	if root == nil then
+		return {}
+	end
+	return match(buf, root, 0, vim.api.nvim_buf_line_count(buf))
+end
+
+---Replaces the instructions of the first suggestion on row `row` (0-based).
+---@param buf integer
+---@param row integer
+---@return boolean applied
+function M.apply(buf, row)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local root = root_of(buf)
+	local item = root and match(buf, root, row, row + 1)[1]
+	if item == nil then
+		vim.notify("rgbds.nvim: no rewrite on this line")
+		return false
+	end
+	local range = item.range
+	vim.api.nvim_buf_set_text(buf, range[1], range[2], range[3], range[4], { item.text })
+	if item.note then
+		vim.notify(string.format("rgbds.nvim: %s: %s", item.rule, item.note))
+	end
+	return true
+end
+
+---Fills the quickfix list with the suggestions for `buf`.
+---@param buf integer
+function M.quickfix(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local items = {}
+	for _, item in ipairs(M.suggestions(buf)) do
+		local text = string.format("%s: %s, %d bytes, %d M-cycles less", item.rule, item.text, item.bytes, item.cycles)
+		if item.note then
+			text = text .. " (" .. item.note .. ")"
+		end
+		items[#items + 1] = { bufnr = buf, lnum = item.row + 1, col = item.range[2] + 1, text = text }
+	end
+	if #items == 0 then
+		vim.notify("rgbds.nvim: no rewrites for this buffer")
+		return
+	end
+	vim.fn.setqflist({}, " ", { title = "Peephole rewrites", items = items })
+	vim.cmd("botright copen")
+end
+
+---@type rgbds.Analyzer
+local peephole = {
+	name = "peephole",
+	buffers = buffers,
+	update = update,
+	delay = 100,
+	namespaces = { ns, reader_ns },
+	-- the line above too, a rule may span both
+	dirty = 1,
+	-- for the constants it reads
+	depends = { "rgbds.values" },
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsPeephole", { link = "LspInlayHint", default = true })
+	end,
+}
+
+---Shows the rewrites for `buf` as it changes.
+---@param buf integer|nil
+function M.attach(buf)
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil or get_query() == nil then
+		return
+	end
+	analyzer.attach(buf, peephole, {})
+end
+
+return M
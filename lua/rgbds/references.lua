@@ -0,0 +1,156 @@
+-- Project-wide references of labels, constants and macros.
+--
+-- With a project index the reference postings are read directly. Otherwise
+-- `rgbasm-index --references` parses the project on all cores and prints the
+-- references of every file as soon as it is parsed, which are passed on as
+-- they arrive.
+
+local M = {}
+
+---@class rgbds.ReferencesOptions
+---@field cmd? string the `rgbasm-index` executable
+---@field include_dirs? string[] passed as `-I`
+---@field root? string the directory to search without an index
+
+---@class rgbds.ReferenceSearch
+---@field cancel fun()
+
+---@class rgbds.Reference
+---@field name string
+---@field path string
+---@field row integer 0-based
+---@field column integer 0-based, in bytes
+
+---@param line string `reference\tname\tpath:row:column`, 1-based
+---@return rgbds.Reference|nil
+local function parse(line)
+	local name, path, row, column = line:match("^reference\t([^\t]+)\t(.+):(%d+):(%d+)$")
+	if name == nil then
+		return nil
+	end
+	return { name = name, path = path, row = tonumber(row) - 1, column = tonumber(column) - 1 }
+end
+
+---Finds the references of `name` in the project of `path`. `on_references`
+---is called on the main loop with every batch as it is found, `on_done` once
+---at the end.
+---@param path string a file of the project
+---@param name string local labels qualified as `Parent.local`
+---@param on_references fun(references: rgbds.Reference[])
+---@param on_done? fun()
+---@param opts? rgbds.ReferencesOptions
+---@return rgbds.ReferenceSearch
+function M.find(path, name, on_references, on_done, opts)
+	opts = vim.tbl_extend("keep", opts or {}, require("rgbds").options.index or {})
+	opts = vim.tbl_extend("keep", opts, { cmd = "rgbasm-index", include_dirs = {} })
+	on_done = on_done or function() end
+
+	local index = require("rgbds.index").find(path)
+	if index ~= nil then
+		local references = index:references(name)
+		index:close()
+		vim.schedule(function()
+			on_references(references)
+			on_done()
+		end)
+		return { cancel = function() end }
+	end
+
+	local root = opts.root or vim.fs.root(path, { "Makefile", ".git" }) or vim.fs.dirname(path)
+	local cmd = { opts.cmd, "--references", name }
+	for _, dir in ipairs(opts.include_dirs) do
+		vim.list_extend(cmd, { "-I", dir })
+	end
+	cmd[#cmd + 1] = root
+
+	local partial = ""
+	local cancelled = false
+	local ok, process = pcall(vim.system, cmd, {
+		text = true,
+		cwd = root,
+		stdout = function(_, data)
+			if data == nil or cancelled then
+				return
+			end
+			local lines = vim.split(partial .. data, "\n")
+			partial = table.remove(lines)
+			local batch = {}
+			for _, line in ipairs(lines) do
+				batch[#batch + 1] = parse(line)
+			end
+			if #batch > 0 then
+				vim.schedule(function()
+					if not cancelled then
+						on_references(batch)
+					end
+				end)
+			end
+		end,
+	}, function()
+		vim.schedule(function()
+			if not cancelled then
+				on_done()
+			end
+		end)
+	end)
+	if not ok then
+		vim.notify("rgbds.nvim: could not run " .. opts.cmd, vim.log.levels.WARN)
+		vim.schedule(on_done)
+		return { cancel = function() end }
+	end
+	return {
+		cancel = function()
+			cancelled = true
+			process:kill("sigterm")
+		end,
+	}
+end
+
+local running
+
+---Fills the quickfix list with the references of `name`, or of the symbol
+---under the cursor, opening it as soon as the first one is found.
+---@param name? string
+---@param opts? rgbds.ReferencesOptions
+function M.quickfix(name, opts)
+	local buf = vim.api.nvim_get_current_buf()
+	if name == nil then
+		local row, col = unpack(vim.api.nvim_win_get_cursor(0))
+		name = require("rgbds.syntax").name_at(buf, row - 1, col)
+		if name == nil then
+			vim.notify("rgbds.nvim: no symbol under the cursor", vim.log.levels.WARN)
+			return
+		end
+	end
+	if running then
+		running.cancel()
+	end
+
+	local title = "References of " .. name
+	vim.fn.setqflist({}, " ", { title = title, items = {} })
+	local id = vim.fn.getqflist({ id = 0 }).id
+	local count = 0
+	running = M.find(vim.api.nvim_buf_get_name(buf), name, function(references)
+		local items = {}
+		for _, reference in ipairs(references) do
+			items[#items + 1] = {
+				filename = reference.path,
+				lnum = reference.row + 1,
+				col = reference.column + 1,
+				text = name,
+			}
+		end
+		vim.fn.setqflist({}, "a", { id = id, items = items })
+		if count == 0 and #items > 0 then
+			vim.cmd("botright copen")
+		end
+		count = count + #items
+	end, function()
+		running = nil
+		if count == 0 then
+			vim.notify("rgbds.nvim: no references of " .. name)
+		end
+	end, opts)
+end
+
+return M
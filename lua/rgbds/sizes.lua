@@ -0,0 +1,702 @@
+-- Byte sizes of the SECTIONs of a buffer and how full their banks are.
+--
+-- Sizes are computed bottom-up and cached per syntax node (rgbds.analyzer),
+-- so after an edit only the ancestors of the changed nodes are computed
+-- again. Sizes read from constants (DS, REPT and FOR counts, IF conditions)
+-- or files (INCBIN) are computed again on every update, from the cached
+-- sizes of their children.
+--
+-- ALIGN padding is exact where the section's address or alignment says
+-- enough about the offset, otherwise the size is a lower bound. So are sizes
+-- containing macro invocations or anything else that cannot be known from
+-- the buffer.
+--
+-- Every SECTION also keeps the offset of each of its statements, the sum of
+-- the cached sizes before it. rgbds.jumps places instructions from there.
+
+local analyzer = require("rgbds.analyzer")
+local eval = require("rgbds.eval")
+local instructions = require("rgbds.instructions")
+
+local M = {}
+
+---Bytes per bank of each section type.
+M.capacities = {
+	ROM0 = 0x4000,
+	ROMX = 0x4000,
+	VRAM = 0x2000,
+	SRAM = 0x2000,
+	WRAM0 = 0x1000,
+	WRAMX = 0x1000,
+	OAM = 0xA0,
+	HRAM = 0x7F,
+}
+
+local ns = vim.api.nvim_create_namespace("rgbds.sizes")
+
+---@class rgbds.Size
+---@field node TSNode
+---@field bytes integer
+---@field exact boolean
+---@field volatile boolean read constants or files
+---@field align boolean contains ALIGN
+
+---@class rgbds.Section
+---@field name string
+---@field type string|nil ROM0, ROMX, ...
+---@field bank integer|nil
+---@field address integer|nil
+---@field union boolean
+---@field bytes integer
+---@field exact boolean
+---@field row integer 0-based
+---@field layout? rgbds.SectionLayout of SECTION blocks
+
+---@class rgbds.SectionLayout
+---@field nodes TSNode[] the statements of the section
+---@field offsets integer[] bytes before each statement
+---@field epochs integer[] sizes before each statement that are not exact:
+---only offsets of the same epoch can be subtracted
+
+---@class rgbds.SizeBuffer
+---@field cache rgbds.NodeCache of rgbds.Size
+---@field sections rgbds.Section[]
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.SizeBuffer>
+local buffers = {}
+
+local DATA_WIDTHS = { DB = 1, DW = 2, DL = 4 }
+
+-- Children that are not emitted, by the node containing them.
+local SKIP = {
+	section_block = { section_directive = true },
+}
+
+---@class rgbds.SizeContext
+---@field buf integer
+---@field state rgbds.SizeBuffer
+---@field volatile boolean whether the entry being computed read a constant
+
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@return rgbds.Value|nil
+local function evaluate(ctx, node)
+	local row = node:start()
+	return eval.evaluate(node, {
+		source = ctx.buf,
+		memo = {},
+		lookup = function(name)
+			ctx.volatile = true
+			return require("rgbds.values").lookup(ctx.buf, name, row)
+		end,
+	})
+end
+
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@return integer|nil
+local function evaluate_number(ctx, node)
+	local value = evaluate(ctx, node)
+	return type(value) == "number" and value or nil
+end
+
+local size
+
+---@param node TSNode
+---@return rgbds.Size
+local function entry(node)
+	return { node = node, bytes = 0, exact = true, volatile = false, align = false }
+end
+
+---@param into rgbds.Size
+---@param part rgbds.Size
+---@param times? integer
+local function add(into, part, times)
+	into.bytes = into.bytes + part.bytes * (times or 1)
+	into.exact = into.exact and part.exact
+	into.volatile = into.volatile or part.volatile
+	into.align = into.align or part.align
+end
+
+---The sum of the sizes of the named children of `node`, except `skip`.
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@param result rgbds.Size
+---@param skip? table<string, true>
+local function add_children(ctx, node, result, skip)
+	for i = 0, node:named_child_count() - 1 do
+		local child = node:named_child(i)
+		if not (skip and skip[child:type()]) then
+			add(result, size(ctx, child))
+		end
+	end
+end
+
+---@param ctx rgbds.SizeContext
+---@param node TSNode simple_directive
+---@param result rgbds.Size
+local function directive_size(ctx, node, result)
+	local keyword = node:field("keyword")[1]
+	keyword = keyword and vim.treesitter.get_node_text(keyword, ctx.buf):upper()
+	local args = {}
+	local list = node:named_child(1)
+	if list and list:type() == "argument_list" then
+		for i = 0, list:named_child_count() - 1 do
+			args[#args + 1] = list:named_child(i)
+		end
+	end
+	local width = DATA_WIDTHS[keyword]
+	if width then
+		if #args == 0 then
+			-- like DS 1
+			result.bytes = width
+		end
+		for _, arg in ipairs(args) do
+			local kind = arg:type()
+			if kind == "string_literal" or kind == "raw_string_literal" then
+				-- one unit per character without a charmap
+				local text = eval.string(vim.treesitter.get_node_text(arg, ctx.buf))
+				result.bytes = result.bytes + width * (text and #text or 1)
+				result.exact = result.exact and text ~= nil
+			else
+				result.bytes = result.bytes + width
+			end
+		end
+	elseif keyword == "ALIGN" then
+		result.align = true
+	elseif keyword == "INCBIN" and args[1] then
+		result.volatile = true
+		local name = eval.string(vim.treesitter.get_node_text(args[1], ctx.buf))
+		local path = name and require("rgbds.include_cache").resolve(
+			name,
+			vim.api.nvim_buf_get_name(ctx.buf),
+			(require("rgbds").options.index or {}).include_dirs
+		)
+		local stat = path and vim.uv.fs_stat(path)
+		local start = args[2] and evaluate_number(ctx, args[2]) or 0
+		local length = args[3] and evaluate_number(ctx, args[3])
+		if length then
+			result.bytes = length
+		elseif stat and start then
+			result.bytes = math.max(0, stat.size - start)
+		else
+			result.exact = false
+		end
+	end
+end
+
+---The number of iterations of a FOR block, nil if unknown.
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@return integer|nil
+local function iterations(ctx, node)
+	-- the variable and the bounds, on the line of the FOR
+	local row = node:start()
+	local args = {}
+	for i = 0, node:named_child_count() - 1 do
+		local child = node:named_child(i)
+		local kind = child:type()
+		if child:start() ~= row then
+			break
+		elseif kind ~= "for_keyword" and kind ~= "quiet" and kind ~= "inline_comment" then
+			args[#args + 1] = child
+		end
+	end
+	-- FOR name, stop / FOR name, start, stop / FOR name, start, stop, step
+	local start, stop, step = 0, nil, 1
+	if #args == 2 then
+		stop = evaluate_number(ctx, args[2])
+	elseif #args >= 3 then
+		start = evaluate_number(ctx, args[2])
+		stop = evaluate_number(ctx, args[3])
+		step = args[4] and evaluate_number(ctx, args[4]) or (args[4] == nil and 1 or nil)
+	end
+	if start == nil or stop == nil or step == nil or step == 0 then
+		return nil
+	end
+	return math.max(0, math.ceil((stop - start) / step))
+end
+
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@return rgbds.Size
+local function compute(ctx, node)
+	local kind = node:type()
+	local result = entry(node)
+	if kind == "instruction" then
+		local found = instructions.lookup(node, ctx.buf)
+		result.bytes = found and found.bytes or 0
+		result.exact = found ~= nil
+	elseif kind == "simple_directive" then
+		directive_size(ctx, node, result)
+	elseif kind == "ds_directive" then
+		local count = node:field("size")[1]
+		if count then
+			local bytes = evaluate_number(ctx, count)
+			result.bytes = bytes and math.max(0, bytes) or 0
+			result.exact = bytes ~= nil
+		else
+			-- DS ALIGN[...]
+			result.align = true
+		end
+	elseif kind == "rept_block" or kind == "for_block" then
+		local count
+		if kind == "rept_block" then
+			local expression = node:field("count")[1]
+			count = expression and evaluate_number(ctx, expression)
+		else
+			count = iterations(ctx, node)
+		end
+		local body = entry(node)
+		add_children(ctx, node, body)
+		add(result, body, math.max(0, count or 1))
+		result.exact = result.exact and count ~= nil
+		-- offsets inside repeated blocks are not tracked
+		if body.align then
+			result.align, result.exact = false, false
+		end
+	elseif kind == "union_block" then
+		local part = entry(node)
+		local parts = { part }
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			if child:type() == "nextu_block" then
+				part = entry(child)
+				parts[#parts + 1] = part
+				add_children(ctx, child, part)
+			else
+				add(part, size(ctx, child))
+			end
+		end
+		for _, each in ipairs(parts) do
+			result.bytes = math.max(result.bytes, each.bytes)
+			result.exact = result.exact and each.exact and not each.align
+			result.volatile = result.volatile or each.volatile
+		end
+	elseif kind == "if_block" then
+		local condition = node:field("condition")[1]
+		local branches = { entry(node) }
+		local conditions = { condition and evaluate_number(ctx, condition) }
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			local child_kind = child:type()
+			if child_kind == "elif_clause" then
+				branches[#branches + 1] = entry(child)
+				local expression = child:named_child(1)
+				conditions[#branches] = expression and evaluate_number(ctx, expression)
+				add_children(ctx, child, branches[#branches])
+			elseif child_kind == "else_clause" then
+				branches[#branches + 1] = entry(child)
+				conditions[#branches] = 1
+				add_children(ctx, child, branches[#branches])
+			elseif child ~= condition then
+				add(branches[1], size(ctx, child))
+			end
+		end
+		-- the first true branch, or the largest one if that depends on unknowns
+		local chosen
+		for i, branch in ipairs(branches) do
+			if conditions[i] == nil then
+				break
+			elseif conditions[i] ~= 0 then
+				chosen = branch
+				break
+			end
+			if i == #branches then
+				chosen = entry(node)
+			end
+		end
+		if chosen then
+			add(result, chosen)
+		else
+			for _, branch in ipairs(branches) do
+				result.bytes = math.max(result.bytes, branch.bytes)
+				result.volatile = result.volatile or branch.volatile
+			end
+			result.exact = false
+		end
+		result.volatile = true
+		if result.align then
+			result.align, result.exact = false, false
+		end
+	elseif kind == "macro_invocation" then
+		result.exact = false
+	elseif kind == "pushs_block" or kind == "macro_definition" or kind == "fragment_literal" then
+		-- emitted elsewhere, or not at all
+	elseif
+		kind == "section_block"
+		or kind == "load_block"
+		or kind == "global_label_block"
+		or kind == "local_label_block"
+		or kind == "instruction_list"
+		or kind == "directive"
+		or kind == "nextu_block"
+	then
+		add_children(ctx, node, result, SKIP[kind])
+	end
+	return result
+end
+
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@return rgbds.Size
+function size(ctx, node)
+	local cached = ctx.state.cache:get(node)
+	if cached then
+		return cached
+	end
+	local outer = ctx.volatile
+	ctx.volatile = false
+	local result = compute(ctx, node)
+	result.volatile = result.volatile or ctx.volatile
+	ctx.volatile = outer
+	return ctx.state.cache:put(node, result)
+end
+
+---Adds ALIGN padding to the size of `node`, starting at `offset`, known in
+---its low `known` bits.
+---@param ctx rgbds.SizeContext
+---@param node TSNode
+---@param layout { offset: integer, known: integer, bytes: integer, exact: boolean }
+local function pad(ctx, node, layout)
+	for i = 0, node:named_child_count() - 1 do
+		local child = node:named_child(i)
+		local child_size = size(ctx, child)
+		local kind = child:type()
+		if kind == "load_block" and child_size.align then
+			-- aligned to the LOAD address, not this section's
+			layout.offset = layout.offset + child_size.bytes
+			layout.bytes = layout.bytes + child_size.bytes
+			layout.exact, layout.known = false, 0
+		elseif not child_size.align then
+			layout.offset = layout.offset + child_size.bytes
+			layout.bytes = layout.bytes + child_size.bytes
+			layout.exact = layout.exact and child_size.exact
+		elseif kind == "simple_directive" or kind == "ds_directive" then
+			local option = kind == "ds_directive" and child:named_child(1) or nil
+			local align, offset
+			if option and option:type() == "align_option" then
+				align = option:field("align")[1]
+				offset = option:field("offset")[1]
+			else
+				local list = child:named_child(1)
+				align = list and list:named_child(0)
+				offset = list and list:named_child(1)
+			end
+			local bits = align and evaluate_number(ctx, align)
+			local target = offset and evaluate_number(ctx, offset) or 0
+			if bits == nil or bits < 0 or bits > 16 or target == nil then
+				layout.exact = false
+				layout.known = 0
+			else
+				local modulus = 2 ^ bits
+				if bits <= layout.known then
+					local padding = (target - layout.offset) % modulus
+					layout.offset = layout.offset + padding
+					layout.bytes = layout.bytes + padding
+				else
+					-- at most modulus - 1 bytes
+					layout.exact = false
+					layout.offset = target
+				end
+				layout.known = bits
+			end
+		else
+			pad(ctx, child, layout)
+		end
+	end
+end
+
+---The offsets of the statements of the section `block`, measured.
+---@param state rgbds.SizeBuffer
+---@param block TSNode section_block
+---@return rgbds.SectionLayout
+local function place(state, block)
+	local layout = { nodes = {}, offsets = {}, epochs = {} }
+	local offset, epoch = 0, 0
+	for i = 0, block:named_child_count() - 1 do
+		local child = block:named_child(i)
+		local child_size = state.cache:peek(child)
+		if child_size then
+			local n = #layout.nodes + 1
+			layout.nodes[n], layout.offsets[n], layout.epochs[n] = child, offset, epoch
+			offset = offset + child_size.bytes
+			if child_size.align or not child_size.exact then
+				epoch = epoch + 1
+			end
+		end
+	end
+	return layout
+end
+
+---The type, bank, address and alignment of a section directive.
+---@param ctx rgbds.SizeContext
+---@param directive TSNode
+---@return rgbds.Section, integer known offset bits, integer offset
+local function section_info(ctx, directive)
+	local name = directive:field("name")[1]
+	local text = name and vim.treesitter.get_node_text(name, ctx.buf) or ""
+	local section = {
+		name = eval.string(text) or text,
+		union = directive:field("union")[1] ~= nil,
+		bytes = 0,
+		exact = true,
+		row = directive:start(),
+	}
+	local known, offset = 0, 0
+	for i = 0, directive:named_child_count() - 1 do
+		local child = directive:named_child(i)
+		local kind = child:type()
+		if kind == "section_type" then
+			section.type = vim.treesitter.get_node_text(child, ctx.buf):upper()
+		elseif kind == "section_address" then
+			local address = child:field("address")[1]
+			section.address = address and evaluate_number(ctx, address)
+			if section.address then
+				known, offset = 16, section.address
+			end
+		elseif kind == "section_options" then
+			for j = 0, child:named_child_count() - 1 do
+				local option = child:named_child(j):named_child(0)
+				if option and option:type() == "bank_option" then
+					local bank = option:field("bank")[1]
+					section.bank = bank and evaluate_number(ctx, bank)
+				elseif option and option:type() == "align_option" and known < 16 then
+					local align = option:field("align")[1]
+					local align_offset = option:field("offset")[1]
+					local bits = align and evaluate_number(ctx, align)
+					if bits then
+						known = bits
+						offset = align_offset and evaluate_number(ctx, align_offset) or 0
+					end
+				end
+			end
+		end
+	end
+	return section, known, offset
+end
+
+local SECTIONS = { section_block = true, load_block = true, pushs_block = true }
+
+-- Nodes sections and LOAD blocks can be nested in.
+local DESCEND = {
+	directive = true,
+	if_block = true,
+	elif_clause = true,
+	else_clause = true,
+	global_label_block = true,
+	local_label_block = true,
+}
+
+---@param buf integer
+---@param state rgbds.SizeBuffer
+---@param root TSNode
+---@return rgbds.Section[]
+local function measure(buf, state, root)
+	state.cache:trim()
+	local ctx = { buf = buf, state = state, volatile = false }
+	local sections = {}
+	local function visit(node)
+		for i = 0, node:named_child_count() - 1 do
+			local child = node:named_child(i)
+			local kind = child:type()
+			if SECTIONS[kind] then
+				-- LOAD and PUSHS take their section arguments inline
+				local directive = kind == "section_block" and child:named_child(0) or child
+				local section, known, offset = section_info(ctx, directive)
+				local child_size = size(ctx, child)
+				if child_size.align then
+					local layout = { offset = offset, known = known, bytes = 0, exact = true }
+					pad(ctx, child, layout)
+					section.bytes, section.exact = layout.bytes, layout.exact
+				else
+					section.bytes, section.exact = child_size.bytes, child_size.exact
+				end
+				if kind == "pushs_block" then
+					section.bytes = 0
+					for j = 0, child:named_child_count() - 1 do
+						local grandchild = child:named_child(j)
+						if grandchild:type() ~= "section_block" then
+							section.bytes = section.bytes + size(ctx, grandchild).bytes
+						end
+					end
+				end
+				if kind == "section_block" then
+					section.layout = place(state, child)
+				end
+				sections[#sections + 1] = section
+				-- LOAD blocks nest in sections, PUSHS blocks hold sections
+				visit(child)
+			elseif DESCEND[kind] then
+				visit(child)
+			end
+		end
+	end
+	visit(root)
+	return sections
+end
+
+---The bank a section fills, e.g. `ROMX[2]`, or its type for floating ones.
+---@param section rgbds.Section
+---@return string
+local function bank_key(section)
+	local kind = section.type or "?"
+	if section.bank and (kind == "ROMX" or kind == "VRAM" or kind == "SRAM" or kind == "WRAMX") then
+		return string.format("%s[%d]", kind, section.bank)
+	end
+	return kind
+end
+
+---The bytes used per bank by `sections`. UNION sections of the same name
+---overlap.
+---@param sections rgbds.Section[]
+---@return table<string, { bytes: integer, exact: boolean, capacity: integer|nil }>
+function M.fill(sections)
+	local banks = {}
+	local unions = {}
+	for _, section in ipairs(sections) do
+		local key = bank_key(section)
+		local bank = banks[key]
+		if bank == nil then
+			bank = { bytes = 0, exact = true, capacity = M.capacities[section.type] }
+			banks[key] = bank
+		end
+		local bytes = section.bytes
+		if section.union then
+			local union_key = key .. "\0" .. section.name
+			local previous = unions[union_key] or 0
+			bytes = math.max(0, bytes - previous)
+			unions[union_key] = math.max(previous, section.bytes)
+		end
+		bank.bytes = bank.bytes + bytes
+		bank.exact = bank.exact and section.exact
+	end
+	return banks
+end
+
+---@param bytes integer
+---@param exact boolean
+---@return string
+local function format_bytes(bytes, exact)
+	return string.format("%s%d bytes", exact and "" or ">=", bytes)
+end
+
+---@param bank { bytes: integer, capacity: integer|nil }
+---@return string
+local function percent(bank)
+	if bank.capacity == nil then
+		return ""
+	end
+	return string.format("%.1f%%", 100 * bank.bytes / bank.capacity)
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	local sections = measure(buf, state, parser:parse()[1]:root())
+	state.sections = sections
+	local banks = M.fill(sections)
+	vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+	if not require("rgbds").shows("sizes", "hints") then
+		return
+	end
+	for _, section in ipairs(sections) do
+		local key = bank_key(section)
+		local text = format_bytes(section.bytes, section.exact)
+		local bank = banks[key]
+		if bank.capacity then
+			text = string.format("%s, %s %s full", text, key, percent(bank))
+		end
+		vim.api.nvim_buf_set_extmark(buf, ns, section.row, 0, {
+			virt_text = { { text, "RgbdsValue" } },
+			virt_text_pos = "eol",
+		})
+	end
+end
+
+---Measures `buf` now instead of after the timer.
+---@param buf integer
+function M.update(buf)
+	update(buf)
+end
+
+---The sections of `buf` with their sizes, as of the last update.
+---@param buf integer
+---@return rgbds.Section[]
+function M.sections(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local state = buffers[buf]
+	return state and state.sections or {}
+end
+
+---The size of `node` as of the last update, nil if it was not measured.
+---@param buf integer
+---@param node TSNode
+---@return rgbds.Size|nil
+function M.size(buf, node)
+	local state = buffers[buf]
+	return state and state.cache:peek(node)
+end
+
+---Echoes the fill of every bank the sections of `buf` use, and its sections.
+---@param buf integer
+function M.report(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	update(buf)
+	local sections = M.sections(buf)
+	local banks = M.fill(sections)
+	local keys = vim.tbl_keys(banks)
+	table.sort(keys)
+	local chunks = {}
+	for _, key in ipairs(keys) do
+		local bank = banks[key]
+		chunks[#chunks + 1] = {
+			string.format(
+				"%-10s %s%s\n",
+				key,
+				format_bytes(bank.bytes, bank.exact),
+				bank.capacity and string.format(" of %d, %s", bank.capacity, percent(bank)) or ""
+			),
+			"Title",
+		}
+		for _, section in ipairs(sections) do
+			if bank_key(section) == key then
+				chunks[#chunks + 1] = {
+					string.format("  %-30s %s\n", section.name, format_bytes(section.bytes, section.exact)),
+				}
+			end
+		end
+	end
+	vim.api.nvim_echo(chunks, false, {})
+end
+
+---@type rgbds.Analyzer
+local sizes = {
+	name = "sizes",
+	buffers = buffers,
+	update = update,
+	-- after rgbds.values settled the constants
+	delay = 200,
+	namespaces = { ns },
+	depends = { "rgbds.values" },
+}
+
+---Shows the size of every section of `buf` and how full its bank is.
+---@param buf integer|nil
+function M.attach(buf)
+	analyzer.attach(buf, sizes, { cache = analyzer.cache(), sections = {} })
+end
+
+return M
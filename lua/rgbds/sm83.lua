@@ -0,0 +1,118 @@
+-- WARN: script-generated by scripts/update-sm83.py. Do not edit directly.
+-- SM83 instruction forms as keyed by rgbds.instructions.
+-- Cycles are M-cycles, `taken` those of a conditional jump, call or
+-- return whose condition is true. Flags are Z N H C.
+return {
+	["adc [hl]"] = { bytes = 1, cycles = 2, flags = "Z0HC" },
+	["adc n"] = { bytes = 2, cycles = 2, flags = "Z0HC" },
+	["adc r"] = { bytes = 1, cycles = 1, flags = "Z0HC" },
+	["add [hl]"] = { bytes = 1, cycles = 2, flags = "Z0HC" },
+	["add hl,rr"] = { bytes = 1, cycles = 2, flags = "-0HC" },
+	["add n"] = { bytes = 2, cycles = 2, flags = "Z0HC" },
+	["add r"] = { bytes = 1, cycles = 1, flags = "Z0HC" },
+	["add sp,n"] = { bytes = 2, cycles = 4, flags = "00HC" },
+	["and [hl]"] = { bytes = 1, cycles = 2, flags = "Z010" },
+	["and n"] = { bytes = 2, cycles = 2, flags = "Z010" },
+	["and r"] = { bytes = 1, cycles = 1, flags = "Z010" },
+	["bit n,[hl]"] = { bytes = 2, cycles = 3, flags = "Z01-" },
+	["bit n,r"] = { bytes = 2, cycles = 2, flags = "Z01-" },
+	["call cc,n"] = { bytes = 3, cycles = 3, taken = 6, flags = "----" },
+	["call n"] = { bytes = 3, cycles = 6, flags = "----" },
+	["ccf"] = { bytes = 1, cycles = 1, flags = "-00C" },
+	["cp [hl]"] = { bytes = 1, cycles = 2, flags = "Z1HC" },
+	["cp n"] = { bytes = 2, cycles = 2, flags = "Z1HC" },
+	["cp r"] = { bytes = 1, cycles = 1, flags = "Z1HC" },
+	["cpl"] = { bytes = 1, cycles = 1, flags = "-11-" },
+	["daa"] = { bytes = 1, cycles = 1, flags = "Z-0C" },
+	["dec [hl]"] = { bytes = 1, cycles = 3, flags = "Z1H-" },
+	["dec r"] = { bytes = 1, cycles = 1, flags = "Z1H-" },
+	["dec rr"] = { bytes = 1, cycles = 2, flags = "----" },
+	["di"] = { bytes = 1, cycles = 1, flags = "----" },
+	["ei"] = { bytes = 1, cycles = 1, flags = "----" },
+	["halt"] = { bytes = 1, cycles = 1, flags = "----" },
+	["inc [hl]"] = { bytes = 1, cycles = 3, flags = "Z0H-" },
+	["inc r"] = { bytes = 1, cycles = 1, flags = "Z0H-" },
+	["inc rr"] = { bytes = 1, cycles = 2, flags = "----" },
+	["jp cc,n"] = { bytes = 3, cycles = 3, taken = 4, flags = "----" },
+	["jp hl"] = { bytes = 1, cycles = 1, flags = "----" },
+	["jp n"] = { bytes = 3, cycles = 4, flags = "----" },
+	["jr cc,n"] = { bytes = 2, cycles = 2, taken = 3, flags = "----" },
+	["jr n"] = { bytes = 2, cycles = 3, flags = "----" },
+	["ld [bc],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [c],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [de],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [hl],n"] = { bytes = 2, cycles = 3, flags = "----" },
+	["ld [hl],r"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [hld],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [hli],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld [n],a"] = { bytes = 3, cycles = 4, flags = "----" },
+	["ld [n],sp"] = { bytes = 3, cycles = 5, flags = "----" },
+	["ld a,[bc]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld a,[c]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld a,[de]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld a,[hld]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld a,[hli]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld a,[n]"] = { bytes = 3, cycles = 4, flags = "----" },
+	["ld hl,sp+n"] = { bytes = 2, cycles = 3, flags = "00HC" },
+	["ld r,[hl]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ld r,n"] = { bytes = 2, cycles = 2, flags = "----" },
+	["ld r,r"] = { bytes = 1, cycles = 1, flags = "----" },
+	["ld rr,n"] = { bytes = 3, cycles = 3, flags = "----" },
+	["ld sp,hl"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldd [hl],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldd a,[hl]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldh [c],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldh [n],a"] = { bytes = 2, cycles = 3, flags = "----" },
+	["ldh a,[c]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldh a,[n]"] = { bytes = 2, cycles = 3, flags = "----" },
+	["ldi [hl],a"] = { bytes = 1, cycles = 2, flags = "----" },
+	["ldi a,[hl]"] = { bytes = 1, cycles = 2, flags = "----" },
+	["nop"] = { bytes = 1, cycles = 1, flags = "----" },
+	["or [hl]"] = { bytes = 1, cycles = 2, flags = "Z000" },
+	["or n"] = { bytes = 2, cycles = 2, flags = "Z000" },
+	["or r"] = { bytes = 1, cycles = 1, flags = "Z000" },
+	["pop af"] = { bytes = 1, cycles = 3, flags = "ZNHC" },
+	["pop rr"] = { bytes = 1, cycles = 3, flags = "----" },
+	["push af"] = { bytes = 1, cycles = 4, flags = "----" },
+	["push rr"] = { bytes = 1, cycles = 4, flags = "----" },
+	["res n,[hl]"] = { bytes = 2, cycles = 4, flags = "----" },
+	["res n,r"] = { bytes = 2, cycles = 2, flags = "----" },
+	["ret"] = { bytes = 1, cycles = 4, flags = "----" },
+	["ret cc"] = { bytes = 1, cycles = 2, taken = 5, flags = "----" },
+	["reti"] = { bytes = 1, cycles = 4, flags = "----" },
+	["rl [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["rl r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["rla"] = { bytes = 1, cycles = 1, flags = "000C" },
+	["rlc [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["rlc r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["rlca"] = { bytes = 1, cycles = 1, flags = "000C" },
+	["rr [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["rr r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["rra"] = { bytes = 1, cycles = 1, flags = "000C" },
+	["rrc [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["rrc r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["rrca"] = { bytes = 1, cycles = 1, flags = "000C" },
+	["rst n"] = { bytes = 1, cycles = 4, flags = "----" },
+	["sbc [hl]"] = { bytes = 1, cycles = 2, flags = "Z1HC" },
+	["sbc n"] = { bytes = 2, cycles = 2, flags = "Z1HC" },
+	["sbc r"] = { bytes = 1, cycles = 1, flags = "Z1HC" },
+	["scf"] = { bytes = 1, cycles = 1, flags = "-001" },
+	["set n,[hl]"] = { bytes = 2, cycles = 4, flags = "----" },
+	["set n,r"] = { bytes = 2, cycles = 2, flags = "----" },
+	["sla [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["sla r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["sra [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["sra r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["srl [hl]"] = { bytes = 2, cycles = 4, flags = "Z00C" },
+	["srl r"] = { bytes = 2, cycles = 2, flags = "Z00C" },
+	["stop"] = { bytes = 2, cycles = 1, flags = "----" },
+	["stop n"] = { bytes = 2, cycles = 1, flags = "----" },
+	["sub [hl]"] = { bytes = 1, cycles = 2, flags = "Z1HC" },
+	["sub n"] = { bytes = 2, cycles = 2, flags = "Z1HC" },
+	["sub r"] = { bytes = 1, cycles = 1, flags = "Z1HC" },
+	["swap [hl]"] = { bytes = 2, cycles = 4, flags = "Z000" },
+	["swap r"] = { bytes = 2, cycles = 2, flags = "Z000" },
+	["xor [hl]"] = { bytes = 1, cycles = 2, flags = "Z000" },
+	["xor n"] = { bytes = 2, cycles = 2, flags = "Z000" },
+	["xor r"] = { bytes = 1, cycles = 1, flags = "Z000" },
+}
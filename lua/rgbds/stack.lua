@@ -0,0 +1,377 @@
+-- Maximum stack depth of the functions of a buffer.
+--
+-- A function is a global label with its local labels. Its depth is the most
+-- it pushes below the stack pointer it was called with: push and pop, add sp
+-- and inc/dec sp along its jumps and branches, and for every call the return
+-- address and the depth of the function called. Functions of other files are
+-- not known here, calls to them make the depth a lower bound;
+-- tree-sitter-rgbasm/tools/stack.c computes it across a whole project.
+--
+-- Every function is summarized on its own: its deepest push, the depth at
+-- each call or jump to another function and whether it falls through into
+-- the next one. Summaries are cached per syntax node (rgbds.analyzer), so
+-- after an edit only the changed function is walked again; combining them
+-- along the calls is cheap and done for the whole buffer. A node keeps its
+-- id when lines above it are inserted or deleted, so summaries hold rows
+-- relative to the label of their function.
+
+local analyzer = require("rgbds.analyzer")
+local flow = require("rgbds.flow")
+local instructions = require("rgbds.instructions")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.stack")
+
+---@class rgbds.StackCall
+---@field name string|nil the function called or jumped to, nil if unknown
+---@field at integer the depth it starts at
+---@field row integer relative to the label of the function
+
+---@class rgbds.StackSummary
+---@field node TSNode keeps the node id from being reused
+---@field global string the name of the function
+---@field own integer the deepest push of the function itself
+---@field calls rgbds.StackCall[]
+---@field falls integer|nil the depth it falls into the next function with
+---@field exact boolean
+---@field reason string|nil why it is not exact
+---@field row integer|nil where, relative to the label of the function
+---@field volatile boolean read a constant
+
+---@class rgbds.StackDepth
+---@field name string
+---@field row integer 0-based row of the label
+---@field bytes integer
+---@field exact boolean
+---@field reason string|nil why it is not exact
+---@field reason_row integer|nil
+---@field chain string[] the calls down to the deepest point
+
+---@class rgbds.StackBuffer
+---@field cache rgbds.NodeCache of rgbds.StackSummary
+---@field depths rgbds.StackDepth[]
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.StackBuffer>
+local buffers = {}
+
+---@param summary rgbds.StackSummary
+---@param reason string
+---@param row integer
+local function problem(summary, reason, row)
+	if summary.exact then
+		summary.exact, summary.reason, summary.row = false, reason, row
+	end
+end
+
+---What an instruction does to the stack and where it goes next.
+---@param buf integer
+---@param node TSNode
+---@param summary rgbds.StackSummary
+---@return { delta: integer, set: boolean, flow: string|nil, target: string|nil, known: boolean }
+local function effect(buf, node, summary)
+	local result = { delta = 0, set = false, known = true }
+	local entry, form = instructions.lookup(node, buf)
+	if entry == nil then
+		result.known = false
+		return result
+	end
+	local mnemonic, exact, _, operands = instructions.operands(node, buf)
+	result.flow = flow.FLOWS[form]
+	if mnemonic == "push" then
+		result.delta = 2
+	elseif mnemonic == "pop" then
+		result.delta = -2
+	elseif exact[1] == "sp" then
+		if form == "inc rr" then
+			result.delta = -1
+		elseif form == "dec rr" then
+			result.delta = 1
+		elseif form == "ld rr,n" then
+			result.set = true
+		elseif form == "add sp,n" then
+			local row = node:start()
+			local offset = require("rgbds.eval").evaluate(operands[2], {
+				source = buf,
+				memo = {},
+				lookup = function(name)
+					summary.volatile = true
+					return require("rgbds.values").lookup(buf, name, row)
+				end,
+			})
+			if type(offset) == "number" then
+				result.delta = -offset
+			else
+				result.known = false
+			end
+		else
+			-- ld sp, hl
+			result.known = false
+		end
+	end
+	result.target = flow.target(result.flow, operands, buf, summary.global)
+	return result
+end
+
+---@param buf integer
+---@param block TSNode global_label_block
+---@return rgbds.StackSummary
+local function summarize(buf, block)
+	local name = block:field("name")[1]
+	local global = name and vim.treesitter.get_node_text(name, buf) or ""
+	local base = block:start()
+	local summary = { node = block, global = global, own = 0, calls = {}, exact = true, volatile = false }
+	local out = flow.collect(buf, block, global, function(reason, row)
+		problem(summary, reason, row - base)
+	end)
+	local list = out.list
+	local items = {}
+	for i, node in ipairs(list) do
+		local item = effect(buf, node, summary)
+		item.row = node:start() - base
+		item.index = item.target and out.labels[item.target]
+		items[i] = item
+	end
+
+	local function successors(i)
+		return flow.successors(items, i)
+	end
+
+	-- the depth on entering every instruction, forward edges first; a loop
+	-- entered only from below needs another pass
+	local depth = { 0 }
+	local changed = true
+	while changed do
+		changed = false
+		for i, item in ipairs(items) do
+			if depth[i] then
+				local after = item.set and 0 or depth[i] + item.delta
+				for _, j in ipairs(successors(i)) do
+					if j and j <= #items then
+						if j > i then
+							depth[j] = math.max(depth[j] or after, after)
+						elseif depth[j] == nil then
+							depth[j] = after
+							changed = true
+						end
+					end
+				end
+			end
+		end
+	end
+
+	for i, item in ipairs(items) do
+		local d = depth[i]
+		if d then
+			local after = item.set and 0 or d + item.delta
+			summary.own = math.max(summary.own, d, after)
+			if not item.known then
+				problem(summary, "unknown instruction or stack pointer change", item.row)
+			end
+			if item.flow == "call" then
+				summary.calls[#summary.calls + 1] = { name = item.target, at = d + 2, row = item.row }
+			elseif item.flow == "indirect" then
+				problem(summary, "indirect jump", item.row)
+			elseif (item.flow == "return" or item.flow == "return_cond") and after ~= 0 then
+				problem(summary, "return with a different stack depth than on entry", item.row)
+			end
+			if (item.flow == "jump" or item.flow == "branch") and item.index == nil then
+				-- a tail call
+				summary.calls[#summary.calls + 1] = { name = item.target, at = after, row = item.row }
+			end
+			for _, j in ipairs(successors(i)) do
+				if j and j > #items then
+					summary.falls = math.max(summary.falls or after, after)
+				elseif j and j > i and depth[j] ~= after then
+					problem(summary, "paths joining with different stack depths", items[j].row)
+				elseif j and j <= i and after > depth[j] and not items[j].set then
+					problem(summary, "stack growing in a loop", item.row)
+				end
+			end
+		end
+	end
+	return summary
+end
+
+---Combines the summaries of the functions of a buffer along their calls.
+---`row` is where the label of a function is now, its summary's rows are
+---relative to it.
+---@param functions { name: string, row: integer, summary: rgbds.StackSummary }[]
+---@return rgbds.StackDepth[]
+function M.combine(functions)
+	local by_name = {}
+	for i, f in ipairs(functions) do
+		by_name[f.name] = i
+	end
+	local results, running = {}, {}
+	local function depth(i)
+		if results[i] then
+			return results[i]
+		end
+		local f = functions[i]
+		if running[i] then
+			return { bytes = 0, exact = false, reason = "recursion", reason_row = f.row, chain = {} }
+		end
+		running[i] = true
+		local summary = f.summary
+		local result = {
+			name = f.name,
+			row = f.row,
+			bytes = summary.own,
+			exact = summary.exact,
+			reason = summary.reason,
+			reason_row = summary.row and f.row + summary.row,
+			chain = {},
+		}
+		local function fail(reason, row)
+			if result.exact then
+				result.exact, result.reason, result.reason_row = false, reason, row
+			end
+		end
+		local function through(callee, at)
+			local inner = depth(callee)
+			if at + inner.bytes > result.bytes then
+				result.bytes = at + inner.bytes
+				result.chain = vim.list_extend({ functions[callee].name }, inner.chain)
+			end
+			if not inner.exact then
+				fail(inner.reason, inner.reason_row)
+			end
+		end
+		for _, call in ipairs(summary.calls) do
+			local callee = call.name and by_name[call.name]
+			if callee then
+				through(callee, call.at)
+			else
+				result.bytes = math.max(result.bytes, call.at)
+				fail(
+					call.name and (call.name .. " is not in this buffer") or "call to an unknown address",
+					f.row + call.row
+				)
+			end
+		end
+		if summary.falls then
+			if functions[i + 1] then
+				through(i + 1, summary.falls)
+			else
+				fail("code running past the end of the buffer", f.row)
+			end
+		end
+		running[i] = nil
+		results[i] = result
+		return result
+	end
+	local depths = {}
+	for i = 1, #functions do
+		depths[i] = depth(i)
+	end
+	return depths
+end
+
+---@param depth rgbds.StackDepth
+---@return string
+local function format(depth)
+	return string.format("stack %s%d bytes", depth.exact and "" or ">=", depth.bytes)
+end
+
+---@param buf integer
+---@param state rgbds.StackBuffer
+---@param root TSNode
+---@return { name: string, row: integer, summary: rgbds.StackSummary }[]
+local function functions(buf, state, root)
+	state.cache:trim()
+	local found = {}
+	for _, block in ipairs(flow.functions(root)) do
+		local summary = state.cache:get(block) or state.cache:put(block, summarize(buf, block))
+		found[#found + 1] = { name = summary.global, row = block:start(), summary = summary }
+	end
+	return found
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	state.depths = M.combine(functions(buf, state, parser:parse()[1]:root()))
+	vim.api.nvim_buf_clear_namespace(buf, ns, 0, -1)
+	if not require("rgbds").shows("stack", "hints") then
+		return
+	end
+	for _, depth in ipairs(state.depths) do
+		if depth.bytes > 0 or not depth.exact then
+			vim.api.nvim_buf_set_extmark(buf, ns, depth.row, 0, {
+				virt_text = { { format(depth), "RgbdsStack" } },
+				virt_text_pos = "eol",
+			})
+		end
+	end
+end
+
+---The stack depth of every function of `buf`, as of the last update.
+---@param buf integer
+---@return rgbds.StackDepth[]
+function M.depths(buf)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	local state = buffers[buf]
+	return state and state.depths or {}
+end
+
+---Echoes the depth of the function at `row` (0-based) with the calls down to
+---its deepest point.
+---@param buf integer
+---@param row integer
+function M.report(buf, row)
+	if buf == 0 then
+		buf = vim.api.nvim_get_current_buf()
+	end
+	update(buf)
+	local found
+	for _, depth in ipairs(M.depths(buf)) do
+		if depth.row <= row then
+			found = depth
+		end
+	end
+	if found == nil then
+		vim.api.nvim_echo({ { "No function here" } }, false, {})
+		return
+	end
+	local text = string.format("%s: %s", found.name, format(found))
+	if #found.chain > 0 then
+		text = text .. ", via " .. table.concat(found.chain, " → ")
+	end
+	if not found.exact then
+		text = string.format("%s (%s, line %d)", text, found.reason, found.reason_row + 1)
+	end
+	vim.api.nvim_echo({ { text } }, false, {})
+end
+
+---@type rgbds.Analyzer
+local stack = {
+	name = "stack",
+	buffers = buffers,
+	update = update,
+	delay = 200,
+	namespaces = { ns },
+	-- for the constants it reads
+	depends = { "rgbds.values" },
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsStack", { link = "LspInlayHint", default = true })
+	end,
+}
+
+---Shows the maximum stack depth of every function of `buf` at its label.
+---@param buf integer|nil
+function M.attach(buf)
+	analyzer.attach(buf, stack, { cache = analyzer.cache(), depths = {} })
+end
+
+return M
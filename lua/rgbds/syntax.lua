@@ -0,0 +1,144 @@
+-- Names in the syntax tree of an rgbasm buffer, resolved like the indexer
+-- does: local labels are qualified with their enclosing global label.
+
+local M = {}
+
+local NAMES = { variable = true, global_symbol = true, local_symbol = true, qualified_symbol = true }
+
+---The name of the global label whose block contains `node`.
+---@param node TSNode|nil
+---@param buf integer|string a buffer or the source string
+---@return string|nil
+function M.scope_of(node, buf)
+	while node do
+		if node:type() == "global_label_block" then
+			local name = node:field("name")[1]
+			return name and vim.treesitter.get_node_text(name, buf)
+		end
+		node = node:parent()
+	end
+	return nil
+end
+
+---@param buf integer
+---@param row integer 0-based
+---@param col integer 0-based, in bytes
+---@return TSNode|nil
+local function node_at(buf, row, col)
+	local ok, node = pcall(vim.treesitter.get_node, { bufnr = buf, pos = { row, col }, ignore_injections = true })
+	return ok and node or nil
+end
+
+---The global label whose block contains row `row` of `buf`.
+---@param buf integer
+---@param row integer 0-based
+---@return string|nil
+function M.scope_at(buf, row)
+	local scope = M.scope_of(node_at(buf, row, 0), buf)
+	if scope then
+		return scope
+	end
+	-- the line is not parsed as part of a block yet, e.g. a new one
+	local lines = vim.api.nvim_buf_get_lines(buf, math.max(0, row - 1000), row + 1, false)
+	for i = #lines, 1, -1 do
+		local name = lines[i]:match("^([%a_][%w_#@$]*)::?")
+		if name then
+			return name
+		end
+	end
+	return nil
+end
+
+---The symbol at a position of `buf`, local labels qualified as
+---`Parent.local`.
+---@param buf integer
+---@param row integer 0-based
+---@param col integer 0-based, in bytes
+---@return string|nil
+function M.name_at(buf, row, col)
+	local node = node_at(buf, row, col)
+	-- the cursor is on the identifier or affix inside the name
+	for _ = 1, 2 do
+		if node == nil or NAMES[node:type()] then
+			break
+		end
+		node = node:parent()
+	end
+	local name
+	if node ~= nil and NAMES[node:type()] then
+		name = vim.treesitter.get_node_text(node, buf)
+	else
+		local line = vim.api.nvim_buf_get_lines(buf, row, row + 1, false)[1] or ""
+		local before = line:sub(1, col + 1):match("[%w_%.@#$]*$")
+		local after = line:sub(col + 2):match("^[%w_%.@#$]*")
+		name = before .. after
+		if name == "" then
+			return nil
+		end
+	end
+	if name:sub(1, 1) == "." then
+		local scope = node and M.scope_of(node, buf) or M.scope_at(buf, row)
+		if scope then
+			name = scope .. name
+		end
+	end
+	return name
+end
+
+---The text of the `name` query of `lang` as Neovim would load it, to be
+---changed and set again with |vim.treesitter.query.set()|.
+---@param lang string
+---@param name string
+---@return string
+function M.query_text(lang, name)
+	local parts = {}
+	for _, file in ipairs(vim.treesitter.query.get_files(lang, name)) do
+		local handle = io.open(file, "rb")
+		if handle then
+			parts[#parts + 1] = handle:read("*a")
+			handle:close()
+		end
+	end
+	return table.concat(parts, "\n")
+end
+
+local query
+
+---The names defined in `source`, a buffer or the string `root` was parsed
+---from, with their kinds, and the files it INCLUDEs as written.
+---@param source integer|string
+---@param root TSNode
+---@return table<string, string> names local labels qualified as `Parent.local`
+---@return string[] includes
+function M.definitions(source, root)
+	query = query
+		or vim.treesitter.query.parse(
+			"rgbasm",
+			[[
+			(global_label_block name: (global_symbol) @label)
+			(local_label_block name: [(local_symbol) (qualified_symbol)] @local)
+			(def_directive name: (variable) @constant)
+			(macro_definition name: (variable) @macro)
+			(include_directive (argument_list . [(string_literal) (raw_string_literal)] @include))
+			]]
+		)
+	local names, includes = {}, {}
+	for id, node in query:iter_captures(root, source) do
+		local kind = query.captures[id]
+		local text = vim.treesitter.get_node_text(node, source)
+		if kind == "include" then
+			includes[#includes + 1] = text:match('^#?"(.*)"$') or text
+		else
+			if kind == "local" and text:sub(1, 1) == "." then
+				local scope = M.scope_of(node:parent(), source)
+				if scope then
+					text = scope .. text
+				end
+			end
+			names[text] = kind
+		end
+	end
+	return names, includes
+end
+
+return M
@@ -0,0 +1,234 @@
+-- A radix trie: keys that share a prefix share its nodes and every edge holds
+-- a whole run of bytes, so the trie has about as many nodes as its keys have
+-- branch points. A key maps to a set of items, each under its own id.
+
+local M = {}
+
+---@class rgbds.TrieNode
+---@field label string the bytes of the edge from the parent
+---@field depth integer length of the key ending at this node
+---@field shortest integer length of the shortest key in the subtree
+---@field children table<integer, rgbds.TrieNode> by the first byte of their label
+---@field items table<any, any>|nil items by id
+
+---@param label string
+---@param depth integer
+---@return rgbds.TrieNode
+local function new_node(label, depth)
+	return { label = label, depth = depth, shortest = math.huge, children = {} }
+end
+
+---@param node rgbds.TrieNode
+local function update_shortest(node)
+	local shortest = node.items ~= nil and node.depth or math.huge
+	for _, child in pairs(node.children) do
+		if child.shortest < shortest then
+			shortest = child.shortest
+		end
+	end
+	node.shortest = shortest
+end
+
+---The length of the common prefix of `a` from `start` and `b`.
+---@param a string
+---@param start integer
+---@param b string
+---@return integer
+local function common_length(a, start, b)
+	local limit = math.min(#a - start + 1, #b)
+	local n = 0
+	while n < limit and a:byte(start + n) == b:byte(n + 1) do
+		n = n + 1
+	end
+	return n
+end
+
+---@class rgbds.Trie
+---@field root rgbds.TrieNode
+---@field count integer number of items
+local Trie = {}
+Trie.__index = Trie
+
+---@return rgbds.Trie
+function M.new()
+	return setmetatable({ root = new_node("", 0), count = 0 }, Trie)
+end
+
+---Adds `item` under `key`, replacing the item with the same `id`.
+---@param key string
+---@param id any
+---@param item any
+function Trie:insert(key, id, item)
+	local node = self.root
+	local pos = 1
+	while pos <= #key do
+		node.shortest = math.min(node.shortest, #key)
+		local byte = key:byte(pos)
+		local child = node.children[byte]
+		if child == nil then
+			child = new_node(key:sub(pos), #key)
+			node.children[byte] = child
+			pos = #key + 1
+		else
+			local n = common_length(key, pos, child.label)
+			if n < #child.label then
+				-- split the edge where the key leaves it
+				local middle = new_node(child.label:sub(1, n), node.depth + n)
+				middle.shortest = child.shortest
+				child.label = child.label:sub(n + 1)
+				middle.children[child.label:byte(1)] = child
+				node.children[byte] = middle
+				child = middle
+			end
+			pos = pos + n
+		end
+		node = child
+	end
+	node.shortest = #key
+	node.items = node.items or {}
+	if node.items[id] == nil then
+		self.count = self.count + 1
+	end
+	node.items[id] = item
+end
+
+---Removes the item `id` of `key`. Nodes left without items are dropped or
+---merged into their only child, so the trie stays compact.
+---@param key string
+---@param id any
+---@return boolean removed
+function Trie:remove(key, id)
+	local path = {}
+	local node = self.root
+	local pos = 1
+	while pos <= #key do
+		local child = node.children[key:byte(pos)]
+		if child == nil or key:sub(pos, pos + #child.label - 1) ~= child.label then
+			return false
+		end
+		path[#path + 1] = node
+		node = child
+		pos = pos + #child.label
+	end
+	if node.items == nil or node.items[id] == nil then
+		return false
+	end
+	node.items[id] = nil
+	self.count = self.count - 1
+	if next(node.items) ~= nil then
+		return true
+	end
+	node.items = nil
+	update_shortest(node)
+
+	local i = #path
+	while node ~= self.root and node.items == nil do
+		local parent = path[i]
+		local byte, child = next(node.children)
+		if byte == nil then
+			parent.children[node.label:byte(1)] = nil
+		elseif next(node.children, byte) == nil then
+			child.label = node.label .. child.label
+			parent.children[node.label:byte(1)] = child
+			break
+		else
+			break
+		end
+		node = parent
+		i = i - 1
+	end
+	for j = #path, 1, -1 do
+		update_shortest(path[j])
+	end
+	return true
+end
+
+-- A binary min-heap of nodes by the shortest key below them.
+
+local function heap_push(heap, node)
+	local i = #heap + 1
+	heap[i] = node
+	while i > 1 do
+		local parent = math.floor(i / 2)
+		if heap[parent].shortest <= node.shortest then
+			break
+		end
+		heap[i], heap[parent] = heap[parent], node
+		i = parent
+	end
+end
+
+local function heap_pop(heap)
+	local top = heap[1]
+	local last = heap[#heap]
+	heap[#heap] = nil
+	local n = #heap
+	if n > 0 then
+		local i = 1
+		while true do
+			local child = 2 * i
+			if child > n then
+				break
+			end
+			if child < n and heap[child + 1].shortest < heap[child].shortest then
+				child = child + 1
+			end
+			if heap[child].shortest >= last.shortest then
+				break
+			end
+			heap[i] = heap[child]
+			i = child
+		end
+		heap[i] = last
+	end
+	return top
+end
+
+---The items of the keys starting with `prefix`, shortest keys first. Nodes
+---are visited by the shortest key below them until `limit` items are
+---accepted and no keys of the same length remain, so the cost depends on
+---`limit`, not on the size of the trie.
+---@param prefix string
+---@param limit integer
+---@param accept? fun(item: any): boolean
+---@return any[]
+function Trie:collect(prefix, limit, accept)
+	local node = self.root
+	local pos = 1
+	while pos <= #prefix do
+		local child = node.children[prefix:byte(pos)]
+		if child == nil then
+			return {}
+		end
+		local n = common_length(prefix, pos, child.label)
+		if n < #child.label and pos + n <= #prefix then
+			return {}
+		end
+		node = child
+		pos = pos + n
+	end
+
+	local found = {}
+	local heap = { node }
+	local last_depth = 0
+	while #heap > 0 do
+		local top = heap_pop(heap)
+		if #found >= limit and top.shortest > last_depth then
+			break
+		end
+		if top.items ~= nil then
+			for _, item in pairs(top.items) do
+				if accept == nil or accept(item) then
+					found[#found + 1] = item
+					last_depth = top.depth
+				end
+			end
+		end
+		for _, child in pairs(top.children) do
+			heap_push(heap, child)
+		end
+	end
+	return found
+end
+
+return M
@@ -0,0 +1,676 @@
+-- Values of constants as inlay hints, and dimming of IF branches that are
+-- statically false.
+--
+-- Every DEF and every IF, ELIF and ELSE header of a buffer is a target,
+-- anchored by an extmark so it keeps its place while lines around it change.
+-- A target caches its value and the names it read. After an edit, only the
+-- targets on changed lines are evaluated again, then the targets that read a
+-- name whose definitions changed, in buffer order so that every name is
+-- settled before it is read. Expressions are evaluated by rgbds.eval; within
+-- one update each node is evaluated once.
+--
+-- A name is resolved to its last definition above the use, skipping
+-- definitions in inactive branches, then to the files the buffer INCLUDEs.
+-- Definitions in branches that may or may not be assembled are unknown when
+-- the name has another one, e.g. in the ELSE branch.
+
+local analyzer = require("rgbds.analyzer")
+local eval = require("rgbds.eval")
+local include_cache = require("rgbds.include_cache")
+local syntax = require("rgbds.syntax")
+
+local M = {}
+
+local ns = vim.api.nvim_create_namespace("rgbds.values")
+local dim_ns = vim.api.nvim_create_namespace("rgbds.values.inactive")
+
+---@class rgbds.ValueTarget
+---@field kind "def"|"if"|"elif"|"else"
+---@field name string|nil for "def"
+---@field value rgbds.Value|nil
+---@field reads table<string, true> names the value depends on
+---@field headers boolean whether a name was resolved in an included file
+---@field active boolean|nil for headers, whether their branch is assembled
+---@field dims integer[]|nil for "if", the dimming extmarks of the block
+
+---@class rgbds.ValueBuffer
+---@field targets table<integer, rgbds.ValueTarget> by extmark id
+---@field defs table<string, table<integer, true>> def targets by name
+---@field readers table<string, table<integer, true>> targets by name read
+---@field dirty integer[][] row ranges to evaluate again, end exclusive
+---@field includes string[]|nil INCLUDEs of the buffer as written
+---@field stale_headers boolean whether an included file may have changed
+---@field timer uv.uv_timer_t
+
+---@type table<integer, rgbds.ValueBuffer>
+local buffers = {}
+
+-- Values of the constants of included files by content hash. The files do
+-- not change for a hash, so nothing is invalidated.
+---@type table<string, { defs: table<string, TSNode>, source: string, memo: table, values: table }>
+local files = {}
+
+local NONE = {}
+
+local TARGETS = {
+	def = "def_directive",
+	["if"] = "if_block",
+	elif = "elif_clause",
+	["else"] = "else_clause",
+}
+
+local query
+
+local function get_query()
+	query = query
+		or vim.treesitter.query.parse(
+			"rgbasm",
+			[[
+			(def_directive) @def
+			(if_block condition: (_) @if)
+			(elif_clause (elif_keyword) . (_) @elif)
+			(else_clause (else_keyword) @else)
+			(if_block) @block
+			]]
+		)
+	return query
+end
+
+---@param buf integer
+---@param mark integer
+---@return integer|nil row, integer|nil col
+local function position(buf, mark)
+	local pos = vim.api.nvim_buf_get_extmark_by_id(buf, ns, mark, {})
+	return pos[1], pos[2]
+end
+
+---@param state rgbds.ValueBuffer
+---@param buf integer
+---@param row integer
+---@param col integer
+---@return integer|nil mark
+local function target_at(state, buf, row, col)
+	for _, mark in ipairs(vim.api.nvim_buf_get_extmarks(buf, ns, { row, col }, { row, col }, {})) do
+		if state.targets[mark[1]] then
+			return mark[1]
+		end
+	end
+	return nil
+end
+
+---The syntax node of a target and the expression that is its value.
+---@param root TSNode
+---@param kind string
+---@param row integer
+---@param col integer
+---@return TSNode|nil node, TSNode|nil expression
+local function target_node(root, kind, row, col)
+	local node = root:named_descendant_for_range(row, col, row, col)
+	while node and node:type() ~= TARGETS[kind] do
+		node = node:parent()
+	end
+	if node == nil then
+		return nil
+	elseif kind == "def" then
+		return node, node:field("value")[1]
+	elseif kind == "if" then
+		return node, node:field("condition")[1]
+	elseif kind == "elif" then
+		return node, node:named_child(1)
+	end
+	return node, nil
+end
+
+---Where the header of the branch `node` is in starts, if it is in one.
+---@param node TSNode
+---@return integer|nil row, integer|nil col
+local function branch_header(node)
+	local child = node
+	node = node:parent()
+	while node do
+		local kind = node:type()
+		if kind == "if_block" then
+			local condition = node:field("condition")[1]
+			-- the ELIF and ELSE clauses are children of the block
+			if condition and child:type() ~= "elif_clause" and child:type() ~= "else_clause" then
+				local row, col = condition:start()
+				return row, col
+			end
+		elseif kind == "elif_clause" then
+			local condition = node:named_child(1)
+			if condition then
+				local row, col = condition:start()
+				return row, col
+			end
+		elseif kind == "else_clause" then
+			local row, col = node:named_child(0):start()
+			return row, col
+		end
+		child = node
+		node = node:parent()
+	end
+	return nil
+end
+
+---@param state rgbds.ValueBuffer
+---@param buf integer
+---@param mark integer
+---@param changed table<string, true>
+local function remove_target(state, buf, mark, changed)
+	local target = state.targets[mark]
+	state.targets[mark] = nil
+	vim.api.nvim_buf_del_extmark(buf, ns, mark)
+	if target == nil then
+		return
+	end
+	for name in pairs(target.reads) do
+		if state.readers[name] then
+			state.readers[name][mark] = nil
+		end
+	end
+	if target.name then
+		state.defs[target.name][mark] = nil
+		changed[target.name] = true
+	end
+	for _, dim in ipairs(target.dims or {}) do
+		vim.api.nvim_buf_del_extmark(buf, dim_ns, dim)
+	end
+end
+
+---The value of the constant `name` in the included file `path`.
+---@param path string
+---@param record rgbds.ParsedFile
+---@param name string
+---@param resolve fun(name: string): rgbds.Value|nil for names of other files
+---@return rgbds.Value|nil
+local function file_value(path, record, name, resolve)
+	local file = files[record.hash]
+	if file == nil then
+		local tree, source = include_cache.tree(path)
+		if tree == nil then
+			return nil
+		end
+		file = { defs = {}, source = source, memo = {}, values = {} }
+		for id, node in get_query():iter_captures(tree:root(), source) do
+			if get_query().captures[id] == "def" then
+				local def_name = node:field("name")[1]
+				if def_name then
+					file.defs[vim.treesitter.get_node_text(def_name, source)] = node
+				end
+			end
+		end
+		files[record.hash] = file
+	end
+	local value = file.values[name]
+	if value == nil then
+		-- guards against cycles
+		file.values[name] = NONE
+		local node = file.defs[name]
+		local assign = node and node:field("assign_type")[1]
+		local expression = node and node:field("value")[1]
+		value = NONE
+		if expression and assign and (assign:type() == "equ_keyword" or assign:type() == "=") then
+			value = eval.evaluate(expression, {
+				source = file.source,
+				memo = file.memo,
+				lookup = function(other)
+					if file.defs[other] then
+						return file_value(path, record, other, resolve)
+					end
+					return resolve(other)
+				end,
+			})
+			if value == nil then
+				value = NONE
+			end
+		end
+		file.values[name] = value
+	end
+	if value == NONE then
+		return nil
+	end
+	return value
+end
+
+---@param buf integer
+---@param root TSNode
+---@param state rgbds.ValueBuffer
+---@return fun(name: string): rgbds.Value|nil, boolean found
+local function header_resolver(buf, root, state)
+	local closure
+	local function resolve(name)
+		if closure == nil then
+			if state.includes == nil then
+				local _, includes = syntax.definitions(buf, root)
+				state.includes = includes
+			end
+			local include_dirs = (require("rgbds").options.index or {}).include_dirs
+			closure = include_cache.closure(vim.api.nvim_buf_get_name(buf), state.includes, include_dirs)
+		end
+		for path, record in pairs(closure) do
+			local kind = record.names[name]
+			if kind == "constant" then
+				return file_value(path, record, name, resolve), true
+			elseif kind ~= nil then
+				return nil, true
+			end
+		end
+		return nil, false
+	end
+	return resolve
+end
+
+---The definition of `name` that is in effect in row `row`.
+---@param buf integer
+---@param state rgbds.ValueBuffer
+---@param root TSNode
+---@param name string
+---@param row integer
+---@return rgbds.ValueTarget|nil target, boolean found
+local function definition(buf, state, root, name, row)
+	local candidates = {}
+	for mark in pairs(state.defs[name] or {}) do
+		local def_row, def_col = position(buf, mark)
+		if def_row and def_row < row then
+			local node = target_node(root, "def", def_row, def_col)
+			local header_row, header_col
+			if node then
+				header_row, header_col = branch_header(node)
+			end
+			local header = header_row and target_at(state, buf, header_row, header_col)
+			local active = header == nil or state.targets[header].active
+			if active ~= false then
+				candidates[#candidates + 1] = { row = def_row, active = active, target = state.targets[mark] }
+			end
+		end
+	end
+	if #candidates == 0 then
+		return nil, false
+	end
+	table.sort(candidates, function(a, b)
+		return a.row > b.row
+	end)
+	if candidates[1].active == nil and #candidates > 1 then
+		-- which one depends on an unknown condition
+		return nil, true
+	end
+	return candidates[1].target, true
+end
+
+---Evaluates the targets in `queue` and those reading names that change, in
+---buffer order.
+---@param buf integer
+---@param state rgbds.ValueBuffer
+---@param root TSNode
+---@param pending table<integer, true> marks
+---@param changed table<string, true> names
+---@param blocks TSNode[] if_blocks to dim again
+local function settle(buf, state, root, pending, changed, blocks)
+	local rgbds = require("rgbds")
+	local options = { hints = rgbds.shows("values", "hints"), dim = rgbds.shows("values", "dim") }
+	local memo = {}
+	local resolve_header = header_resolver(buf, root, state)
+
+	local positions = {}
+	local queue = {}
+	local function before(a, b)
+		local pa, pb = positions[a], positions[b]
+		return pa[1] < pb[1] or (pa[1] == pb[1] and pa[2] < pb[2])
+	end
+	local function enqueue(mark, from)
+		if pending[mark] or state.targets[mark] == nil then
+			return
+		end
+		local row, col = position(buf, mark)
+		if row == nil then
+			return
+		end
+		pending[mark] = true
+		positions[mark] = { row, col }
+		-- readers come after what they read
+		local i = #queue + 1
+		while i > from + 1 and before(mark, queue[i - 1]) do
+			i = i - 1
+		end
+		table.insert(queue, i, mark)
+	end
+	local function enqueue_readers(name, from)
+		for mark in pairs(state.readers[name] or {}) do
+			enqueue(mark, from)
+		end
+	end
+
+	for mark in pairs(pending) do
+		local row, col = position(buf, mark)
+		if row ~= nil then
+			positions[mark] = { row, col }
+			queue[#queue + 1] = mark
+		end
+	end
+	table.sort(queue, before)
+	for name in pairs(changed) do
+		enqueue_readers(name, 0)
+	end
+	for _, block in ipairs(blocks) do
+		local condition = block:field("condition")[1]
+		local mark = condition and target_at(state, buf, condition:start())
+		if mark then
+			enqueue(mark, 0)
+		end
+	end
+
+	local function update_block(block, from)
+		local if_mark
+		local branches = {}
+		for i = 0, block:named_child_count() - 1 do
+			local child = block:named_child(i)
+			local kind = child:type()
+			local header, first
+			if i == 1 and child == block:field("condition")[1] then
+				header, first = child, child:end_()
+				if_mark = target_at(state, buf, child:start())
+			elseif kind == "elif_clause" then
+				header, first = child:named_child(1), child:start()
+			elseif kind == "else_clause" then
+				header, first = child:named_child(0), child:start()
+			end
+			if header then
+				if #branches > 0 then
+					branches[#branches].last = child:start()
+				end
+				branches[#branches + 1] = {
+					mark = target_at(state, buf, header:start()),
+					kind = kind,
+					first = first + 1,
+				}
+			end
+		end
+		if #branches == 0 or if_mark == nil then
+			return
+		end
+		branches[#branches].last = block:end_()
+
+		local decided, unknown = false, false
+		local dims = {}
+		for _, branch in ipairs(branches) do
+			local target = branch.mark and state.targets[branch.mark]
+			local active
+			if decided then
+				active = false
+			elseif branch.kind == "else_clause" then
+				active = not unknown or nil
+			else
+				local value = target and target.value
+				if type(value) ~= "number" then
+					unknown = true
+				elseif value ~= 0 then
+					active = not unknown or nil
+					decided = true
+				else
+					active = false
+				end
+			end
+			if target and target.active ~= active then
+				target.active = active
+				-- definitions in the branch are now in effect or not
+				if branch.last > branch.first then
+					local marks = vim.api.nvim_buf_get_extmarks(buf, ns, { branch.first, 0 }, { branch.last - 1, -1 }, {})
+					for _, mark in ipairs(marks) do
+						local def = state.targets[mark[1]]
+						if def and def.name then
+							enqueue_readers(def.name, from)
+						end
+					end
+				end
+			end
+			if active == false and branch.last > branch.first and options.dim ~= false then
+				dims[#dims + 1] = vim.api.nvim_buf_set_extmark(buf, dim_ns, branch.first, 0, {
+					end_row = branch.last,
+					end_col = 0,
+					hl_group = "RgbdsInactive",
+					hl_eol = true,
+					priority = 150,
+				})
+			end
+		end
+		local if_target = state.targets[if_mark]
+		for _, dim in ipairs(if_target.dims or {}) do
+			vim.api.nvim_buf_del_extmark(buf, dim_ns, dim)
+		end
+		if_target.dims = dims
+	end
+
+	local i = 1
+	while i <= #queue do
+		local mark = queue[i]
+		pending[mark] = nil
+		local target = state.targets[mark]
+		local row, col = positions[mark][1], positions[mark][2]
+		local node, expression
+		if target then
+			node, expression = target_node(root, target.kind, row, col)
+		end
+		if target and node == nil then
+			remove_target(state, buf, mark, changed)
+			if target.name then
+				enqueue_readers(target.name, i)
+			end
+		elseif target then
+			for name in pairs(target.reads) do
+				state.readers[name][mark] = nil
+			end
+			target.reads = {}
+			target.headers = false
+			local function read(name)
+				target.reads[name] = true
+				state.readers[name] = state.readers[name] or {}
+				state.readers[name][mark] = true
+			end
+			local function lookup(name)
+				read(name)
+				local def, found = definition(buf, state, root, name, row)
+				if def then
+					return def.value
+				elseif found then
+					return nil
+				end
+				target.headers = true
+				return (resolve_header(name))
+			end
+
+			local value, hint
+			if target.kind == "else" then
+				value = 1
+			elseif expression then
+				value = eval.evaluate(expression, {
+					source = buf,
+					memo = memo,
+					lookup = lookup,
+					defined = function(name)
+						read(name)
+						if select(2, definition(buf, state, root, name, row)) then
+							return true
+						end
+						target.headers = true
+						return select(2, resolve_header(name)) or nil
+					end,
+				})
+				-- a literal needs no hint
+				hint = value ~= nil and expression:named_child_count() > 0
+			end
+			if target.kind == "def" then
+				local assign = node:field("assign_type")[1]
+				assign = assign and assign:type()
+				if assign == "equs_keyword" or assign == "r_keyword" or assign == nil then
+					-- EQUS is expanded as text, RB/RW/RL depend on _RS
+					value, hint = nil, false
+				elseif assign ~= "=" and assign ~= "equ_keyword" then
+					local previous = lookup(target.name)
+					value = eval.assign(assign, previous, value)
+					hint = value ~= nil
+				end
+			end
+
+			local old = target.value
+			target.value = value
+			vim.api.nvim_buf_set_extmark(buf, ns, row, col, {
+				id = mark,
+				virt_text = hint and options.hints ~= false and { { "= " .. eval.format(value), "RgbdsValue" } }
+					or nil,
+				virt_text_pos = "eol",
+			})
+			if old ~= value then
+				if target.name then
+					enqueue_readers(target.name, i)
+				end
+			end
+			if target.kind ~= "def" then
+				local block = target.kind == "if" and node or node:parent()
+				if block then
+					update_block(block, i)
+				end
+			end
+		end
+		i = i + 1
+	end
+end
+
+---@param buf integer
+local function update(buf)
+	local state = buffers[buf]
+	if state == nil or not vim.api.nvim_buf_is_valid(buf) then
+		return
+	end
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	-- reports the ranges whose structure changed
+	local root = parser:parse()[1]:root()
+	local ranges = analyzer.take_dirty(state)
+
+	local pending, changed, blocks = {}, {}, {}
+	local seen_blocks = {}
+	local line_count = vim.api.nvim_buf_line_count(buf)
+	for _, range in ipairs(ranges) do
+		local first, last = range[1], math.min(range[2], line_count)
+		if first < last then
+			for _, mark in ipairs(vim.api.nvim_buf_get_extmarks(buf, ns, { first, 0 }, { last - 1, -1 }, {})) do
+				remove_target(state, buf, mark[1], changed)
+			end
+			for _, line in ipairs(vim.api.nvim_buf_get_lines(buf, first, last, false)) do
+				if line:lower():find("include", 1, true) then
+					state.stale_headers = true
+				end
+			end
+			for id, node in get_query():iter_captures(root, buf, first, last) do
+				local kind = get_query().captures[id]
+				local row, col = node:start()
+				if kind == "block" then
+					if not seen_blocks[node:id()] then
+						seen_blocks[node:id()] = true
+						blocks[#blocks + 1] = node
+					end
+				elseif row >= first and row < last and target_at(state, buf, row, col) == nil then
+					local mark = vim.api.nvim_buf_set_extmark(buf, ns, row, col, {})
+					local target = { kind = kind, reads = {}, headers = false }
+					if kind == "def" then
+						local name = node:field("name")[1]
+						target.name = name and vim.treesitter.get_node_text(name, buf) or ""
+						state.defs[target.name] = state.defs[target.name] or {}
+						state.defs[target.name][mark] = true
+						changed[target.name] = true
+					end
+					state.targets[mark] = target
+					pending[mark] = true
+				end
+			end
+		end
+	end
+	if state.stale_headers then
+		state.stale_headers = false
+		state.includes = nil
+		for mark, target in pairs(state.targets) do
+			if target.headers then
+				pending[mark] = true
+			end
+		end
+	end
+	settle(buf, state, root, pending, changed, blocks)
+end
+
+---@type rgbds.Analyzer
+local values = {
+	name = "values",
+	buffers = buffers,
+	update = update,
+	delay = 100,
+	namespaces = { ns, dim_ns },
+	dirty = 0,
+	highlights = function()
+		vim.api.nvim_set_hl(0, "RgbdsValue", { link = "LspInlayHint", default = true })
+		vim.api.nvim_set_hl(0, "RgbdsInactive", { link = "Comment", default = true })
+	end,
+}
+
+-- a saved file may be included by other buffers
+vim.api.nvim_create_autocmd("BufWritePost", {
+	group = vim.api.nvim_create_augroup("rgbds.values.includes", { clear = true }),
+	callback = function(args)
+		for buf, state in pairs(buffers) do
+			if buf ~= args.buf then
+				state.stale_headers = true
+				state.timer:start(values.delay, 0, vim.schedule_wrap(function()
+					update(buf)
+				end))
+			end
+		end
+	end,
+})
+
+---The value of `name` where row `row` (0-based) of `buf` uses it, as the
+---hints resolve it. Nil if unknown or `buf` is not attached.
+---@param buf integer
+---@param name string
+---@param row integer
+---@return rgbds.Value|nil
+function M.lookup(buf, name, row)
+	local state = buffers[buf]
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	local tree = state and ok and parser and parser:trees()[1]
+	if not tree then
+		return nil
+	end
+	local root = tree:root()
+	local def, found = definition(buf, state, root, name, row)
+	if def then
+		return def.value
+	elseif found then
+		return nil
+	end
+	return (header_resolver(buf, root, state)(name))
+end
+
+---Evaluates the changes to `buf` now instead of after the timer, e.g. before
+---a command reads values right after attaching.
+---@param buf integer
+function M.update(buf)
+	update(buf)
+end
+
+---Shows the values of constants and dims inactive IF branches in `buf`.
+---@param buf integer|nil
+function M.attach(buf)
+	local ok, parser = pcall(vim.treesitter.get_parser, buf, "rgbasm")
+	if not ok or parser == nil then
+		return
+	end
+	analyzer.attach(buf, values, {
+		targets = {},
+		defs = {},
+		readers = {},
+		stale_headers = false,
+	})
+end
+
+return M
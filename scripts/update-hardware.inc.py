@@ -52,6 +52,23 @@ def inject_vars(hardware_inc: str, vars: list[str]) -> str:
     return RE_BOUNDARY.sub(repl, hardware_inc)
 
 
+def format_lua(vars: list[str]) -> str:
+    out = "-- WARN: script-generated by scripts/update-hardware.inc.py. Do not edit directly.\n"
+    out += "-- The names defined by hardware.inc, for completion.\n"
+    out += "return {\n"
+    line = ""
+    for var in vars:
+        item = f'"{var}",'
+        if line and len(line) + 1 + len(item) > 100:
+            out += "\t" + line + "\n"
+            line = item
+        else:
+            line = f"{line} {item}" if line else item
+    if line:
+        out += "\t" + line + "\n"
+    return out + "}\n"
+
+
 if __name__ == "__main__":
     path = Path(__file__).parent.parent / "tree-sitter-rgbasm" / "identifier" / "queries" / "highlights.scm"
     assert path.exists(), "path does not exist"
@@ -68,3 +85,6 @@ if __name__ == "__main__":
     content = inject_vars(path.read_text(encoding="utf-8"), vars)
     assert all(v in content for v in vars), "not all vars were injected"
     path.write_text(content, encoding="utf-8")
+
+    lua_path = Path(__file__).parent.parent / "lua" / "rgbds" / "hardware_inc.lua"
+    lua_path.write_text(format_lua(vars), encoding="utf-8")
@@ -0,0 +1,142 @@
+"""Generates the SM83 instruction tables of the plugin and the C tools.
+
+Every instruction form is keyed like lua/rgbds/instructions.lua and
+tree-sitter-rgbasm/tools/sm83.c spell it: the lowercase mnemonic and its
+operands, `r` for 8-bit and `rr` for 16-bit registers, `n` for any
+expression, `[n]` for an address expression and `cc` for a condition. The
+`a` of `add a, b` and the other 8-bit arithmetic is left out.
+"""
+
+from pathlib import Path
+
+ROOT = Path(__file__).parent.parent
+
+ALU = [
+    ("add", "Z0HC"),
+    ("adc", "Z0HC"),
+    ("sub", "Z1HC"),
+    ("sbc", "Z1HC"),
+    ("and", "Z010"),
+    ("xor", "Z000"),
+    ("or", "Z000"),
+    ("cp", "Z1HC"),
+]
+SHIFTS = [(op, "Z00C") for op in ["rlc", "rrc", "rl", "rr", "sla", "sra", "srl"]] + [("swap", "Z000")]
+
+# (form, bytes, M-cycles, M-cycles if the condition is true, flags), the
+# flags as Z N H C: the flag if it is set by the result, 0 or 1 if it is
+# reset or set, - if it is kept.
+FORMS = [
+    ("nop", 1, 1, None, "----"),
+    ("halt", 1, 1, None, "----"),
+    ("stop", 2, 1, None, "----"),
+    ("stop n", 2, 1, None, "----"),
+    ("di", 1, 1, None, "----"),
+    ("ei", 1, 1, None, "----"),
+    ("daa", 1, 1, None, "Z-0C"),
+    ("cpl", 1, 1, None, "-11-"),
+    ("scf", 1, 1, None, "-001"),
+    ("ccf", 1, 1, None, "-00C"),
+    ("rlca", 1, 1, None, "000C"),
+    ("rrca", 1, 1, None, "000C"),
+    ("rla", 1, 1, None, "000C"),
+    ("rra", 1, 1, None, "000C"),
+    # 8-bit loads
+    ("ld r,r", 1, 1, None, "----"),
+    ("ld r,n", 2, 2, None, "----"),
+    ("ld r,[hl]", 1, 2, None, "----"),
+    ("ld [hl],r", 1, 2, None, "----"),
+    ("ld [hl],n", 2, 3, None, "----"),
+    ("ld a,[bc]", 1, 2, None, "----"),
+    ("ld a,[de]", 1, 2, None, "----"),
+    ("ld [bc],a", 1, 2, None, "----"),
+    ("ld [de],a", 1, 2, None, "----"),
+    ("ld a,[n]", 3, 4, None, "----"),
+    ("ld [n],a", 3, 4, None, "----"),
+    ("ld a,[hli]", 1, 2, None, "----"),
+    ("ld a,[hld]", 1, 2, None, "----"),
+    ("ld [hli],a", 1, 2, None, "----"),
+    ("ld [hld],a", 1, 2, None, "----"),
+    ("ldi a,[hl]", 1, 2, None, "----"),
+    ("ldi [hl],a", 1, 2, None, "----"),
+    ("ldd a,[hl]", 1, 2, None, "----"),
+    ("ldd [hl],a", 1, 2, None, "----"),
+    ("ld a,[c]", 1, 2, None, "----"),
+    ("ld [c],a", 1, 2, None, "----"),
+    ("ldh a,[c]", 1, 2, None, "----"),
+    ("ldh [c],a", 1, 2, None, "----"),
+    ("ldh a,[n]", 2, 3, None, "----"),
+    ("ldh [n],a", 2, 3, None, "----"),
+    # 16-bit loads
+    ("ld rr,n", 3, 3, None, "----"),
+    ("ld [n],sp", 3, 5, None, "----"),
+    ("ld sp,hl", 1, 2, None, "----"),
+    ("ld hl,sp+n", 2, 3, None, "00HC"),
+    ("push rr", 1, 4, None, "----"),
+    ("push af", 1, 4, None, "----"),
+    ("pop rr", 1, 3, None, "----"),
+    ("pop af", 1, 3, None, "ZNHC"),
+    # arithmetic
+    *[(f"{op} r", 1, 1, None, flags) for op, flags in ALU],
+    *[(f"{op} [hl]", 1, 2, None, flags) for op, flags in ALU],
+    *[(f"{op} n", 2, 2, None, flags) for op, flags in ALU],
+    ("inc r", 1, 1, None, "Z0H-"),
+    ("dec r", 1, 1, None, "Z1H-"),
+    ("inc [hl]", 1, 3, None, "Z0H-"),
+    ("dec [hl]", 1, 3, None, "Z1H-"),
+    ("inc rr", 1, 2, None, "----"),
+    ("dec rr", 1, 2, None, "----"),
+    ("add hl,rr", 1, 2, None, "-0HC"),
+    ("add sp,n", 2, 4, None, "00HC"),
+    # prefixed
+    *[(f"{op} r", 2, 2, None, flags) for op, flags in SHIFTS],
+    *[(f"{op} [hl]", 2, 4, None, flags) for op, flags in SHIFTS],
+    ("bit n,r", 2, 2, None, "Z01-"),
+    ("bit n,[hl]", 2, 3, None, "Z01-"),
+    *[(f"{op} n,r", 2, 2, None, "----") for op in ["res", "set"]],
+    *[(f"{op} n,[hl]", 2, 4, None, "----") for op in ["res", "set"]],
+    # control flow
+    ("jp n", 3, 4, None, "----"),
+    ("jp cc,n", 3, 3, 4, "----"),
+    ("jp hl", 1, 1, None, "----"),
+    ("jr n", 2, 3, None, "----"),
+    ("jr cc,n", 2, 2, 3, "----"),
+    ("call n", 3, 6, None, "----"),
+    ("call cc,n", 3, 3, 6, "----"),
+    ("ret", 1, 4, None, "----"),
+    ("ret cc", 1, 2, 5, "----"),
+    ("reti", 1, 4, None, "----"),
+    ("rst n", 1, 4, None, "----"),
+]
+
+WARNING = "script-generated by scripts/update-sm83.py. Do not edit directly."
+
+
+def format_lua(forms: list[tuple]) -> str:
+    out = f"-- WARN: {WARNING}\n"
+    out += "-- SM83 instruction forms as keyed by rgbds.instructions.\n"
+    out += "-- Cycles are M-cycles, `taken` those of a conditional jump, call or\n"
+    out += "-- return whose condition is true. Flags are Z N H C.\n"
+    out += "return {\n"
+    for form, size, cycles, taken, flags in forms:
+        taken = f", taken = {taken}" if taken else ""
+        out += f'\t["{form}"] = {{ bytes = {size}, cycles = {cycles}{taken}, flags = "{flags}" }},\n'
+    return out + "}\n"
+
+
+def format_c(forms: list[tuple]) -> str:
+    out = f"// WARN: {WARNING}\n"
+    out += "// SM83 instruction forms as keyed by sm83.c, sorted for bsearch.\n\n"
+    out += "static const RgbasmSm83Form rgbasm_sm83_forms[] = {\n"
+    for form, size, cycles, taken, flags in forms:
+        out += f'  {{"{form}", {size}, {cycles}, {taken or cycles}, "{flags}"}},\n'
+    return out + "};\n"
+
+
+if __name__ == "__main__":
+    forms = sorted(FORMS)
+    keys = [form for form, *_ in forms]
+    assert len(keys) == len(set(keys)), "duplicate form"
+    print(f"{len(forms)} forms.")
+    (ROOT / "lua" / "rgbds" / "sm83.lua").write_text(format_lua(forms), encoding="utf-8")
+    (ROOT / "tree-sitter-rgbasm" / "tools" / "sm83_table.h").write_text(format_c(forms), encoding="utf-8")
@@ -0,0 +1,204 @@
+/**
+ * @file Throughput of the WASM builds of both grammars
+ *
+ * Parses the benchmark corpus (or the given files and directories) with the
+ * web-tree-sitter builds of rgbasm and rgbasm_identifier and compares them
+ * with the native parser, `rgbasm-bench --identifier --json`, on the same
+ * files. The identifier workload is the text of every `identifier` node, the
+ * injection done by queries/injections.scm.
+ *
+ * The sizes of the `.wasm` files are reported raw and gzipped.
+ *
+ * Build the inputs with `make wasm rgbasm-bench` first.
+ */
+
+import { execFileSync } from "node:child_process";
+import { existsSync, readdirSync, readFileSync, statSync } from "node:fs";
+import { extname, join, resolve } from "node:path";
+import { fileURLToPath } from "node:url";
+import { gzipSync } from "node:zlib";
+import { Language, Parser } from "web-tree-sitter";
+
+const root = fileURLToPath(new URL("..", import.meta.url));
+
+const grammars = {
+  rgbasm: join(root, "tree-sitter-rgbasm.wasm"),
+  rgbasm_identifier: join(root, "identifier", "tree-sitter-rgbasm_identifier.wasm"),
+};
+
+// the extensions the Neovim plugin treats as rgbasm, see tools/util.c
+const extensions = new Set([".asm", ".s", ".inc", ".rgbasm", ".rgbinc", ".gbz80"]);
+
+function usage() {
+  console.error(
+    "usage: node bench/wasm.mjs [-n iterations] [--native rgbasm-bench] [--json] [path...]",
+  );
+  process.exit(2);
+}
+
+function parseArgs(argv) {
+  const options = {
+    iterations: 5,
+    native: process.env.RGBASM_BENCH,
+    json: false,
+    paths: [],
+  };
+  for (let i = 0; i < argv.length; i++) {
+    const arg = argv[i];
+    if (arg === "-n" && i + 1 < argv.length) {
+      options.iterations = Number(argv[++i]);
+    } else if (arg === "--native" && i + 1 < argv.length) {
+      options.native = argv[++i];
+    } else if (arg === "--json") {
+      options.json = true;
+    } else if (arg.startsWith("-")) {
+      usage();
+    } else {
+      options.paths.push(resolve(arg));
+    }
+  }
+  if (!(options.iterations >= 1)) {
+    usage();
+  }
+  if (options.paths.length === 0) {
+    options.paths.push(join(root, "bench", "corpus"));
+  }
+  options.native ??= [
+    join(root, "rgbasm-bench"),
+    join(root, "build", "rgbasm-bench"),
+    join(root, "build-pgo", "rgbasm-bench"),
+  ].find(existsSync);
+  return options;
+}
+
+// Same order as path_list_collect: sorted, hidden entries skipped.
+function collect(path, files) {
+  if (statSync(path).isDirectory()) {
+    for (const entry of readdirSync(path).sort()) {
+      if (!entry.startsWith(".")) {
+        const child = join(path, entry);
+        if (statSync(child).isDirectory() || extensions.has(extname(entry))) {
+          collect(child, files);
+        }
+      }
+    }
+  } else {
+    files.push(path);
+  }
+  return files;
+}
+
+function measure(parser, inputs, iterations) {
+  let best = Infinity;
+  let total = 0;
+  let errors = 0;
+  for (let iteration = 0; iteration < iterations; iteration++) {
+    const start = performance.now();
+    for (const input of inputs) {
+      const tree = parser.parse(input);
+      if (iteration === 0 && tree.rootNode.hasError) {
+        errors += 1;
+      }
+      tree.delete();
+    }
+    const elapsed = performance.now() - start;
+    total += elapsed;
+    best = Math.min(best, elapsed);
+  }
+  return { best_ms: best, mean_ms: total / iterations, errors };
+}
+
+function sizes() {
+  const result = {};
+  for (const [name, path] of Object.entries(grammars)) {
+    const data = readFileSync(path);
+    result[name] = { bytes: data.length, gzip_bytes: gzipSync(data, { level: 9 }).length };
+  }
+  return result;
+}
+
+function native(options) {
+  if (!options.native) {
+    return undefined;
+  }
+  const output = execFileSync(
+    options.native,
+    ["--identifier", "--json", "-n", String(options.iterations), ...options.paths],
+    { encoding: "utf8" },
+  );
+  return JSON.parse(output);
+}
+
+const options = parseArgs(process.argv.slice(2));
+for (const path of Object.values(grammars)) {
+  if (!existsSync(path)) {
+    console.error(`${path} is missing, run \`make wasm\` first`);
+    process.exit(1);
+  }
+}
+
+await Parser.init();
+const parser = new Parser();
+const rgbasm = await Language.load(grammars.rgbasm);
+const identifier = await Language.load(grammars.rgbasm_identifier);
+
+const sources = options.paths.flatMap(path => collect(path, [])).map(path => readFileSync(path, "utf8"));
+const bytes = sources.reduce((sum, source) => sum + Buffer.byteLength(source), 0);
+
+parser.setLanguage(rgbasm);
+const identifiers = [];
+for (const source of sources) {
+  const tree = parser.parse(source);
+  for (const node of tree.rootNode.descendantsOfType("identifier")) {
+    identifiers.push(node.text);
+  }
+  tree.delete();
+}
+
+const wasm = { rgbasm: measure(parser, sources, options.iterations) };
+parser.setLanguage(identifier);
+wasm.rgbasm_identifier = measure(parser, identifiers, options.iterations);
+parser.delete();
+
+const nativeResult = native(options);
+const result = {
+  files: sources.length,
+  bytes,
+  identifiers: identifiers.length,
+  iterations: options.iterations,
+  wasm,
+  native: nativeResult && {
+    rgbasm: { best_ms: nativeResult.best_ms, mean_ms: nativeResult.mean_ms },
+    rgbasm_identifier: {
+      best_ms: nativeResult.identifier.best_ms,
+      mean_ms: nativeResult.identifier.mean_ms,
+    },
+  },
+  sizes: sizes(),
+};
+
+if (options.json) {
+  console.log(JSON.stringify(result));
+} else {
+  const mib = bytes / (1024 * 1024);
+  console.log(`files:        ${result.files} (${(bytes / 1024).toFixed(1)} KiB)`);
+  console.log(`identifiers:  ${result.identifiers}`);
+  console.log(`iterations:   ${result.iterations}`);
+  for (const name of Object.keys(grammars)) {
+    const w = wasm[name];
+    const n = result.native?.[name];
+    const throughput = name === "rgbasm" ? `  ${(mib / (w.best_ms / 1e3)).toFixed(2)} MiB/s` : "";
+    console.log(`\n${name}`);
+    console.log(`  wasm:       ${w.best_ms.toFixed(3)} ms best, ${w.mean_ms.toFixed(3)} ms mean${throughput}`);
+    if (n) {
+      console.log(`  native:     ${n.best_ms.toFixed(3)} ms best, ${n.mean_ms.toFixed(3)} ms mean`);
+      console.log(`  slowdown:   ${(w.best_ms / n.best_ms).toFixed(2)}x`);
+    }
+    const size = result.sizes[name];
+    console.log(`  size:       ${size.bytes} bytes, ${size.gzip_bytes} gzipped`);
+  }
+  if (!result.native) {
+    console.log("\nno native rgbasm-bench found, pass --native or set RGBASM_BENCH");
+  }
+}
+
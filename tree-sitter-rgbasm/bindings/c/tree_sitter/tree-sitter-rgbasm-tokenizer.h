@@ -0,0 +1,85 @@
+#ifndef TREE_SITTER_RGBASM_TOKENIZER_H_
+#define TREE_SITTER_RGBASM_TOKENIZER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lexer-only access to rgbasm sources.
+//
+// The tokenizer classifies a buffer in a single linear pass without building
+// a syntax tree. It shares the identifier rules with the external scanner of
+// the grammar, but has no parser state: classes are lexical approximations,
+// good enough for highlighting large generated files.
+//
+// Blanks are not reported; every other byte belongs to exactly one token.
+
+typedef enum RgbasmTokenClass {
+  RGBASM_TOKEN_NEWLINE,     // a run of line breaks and blank lines
+  RGBASM_TOKEN_COMMENT,     // `; ...` and `/* ... */`
+  RGBASM_TOKEN_STRING,      // regular, triple-quoted and raw strings
+  RGBASM_TOKEN_CHAR,        // 'A'
+  RGBASM_TOKEN_NUMBER,      // all number and graphics literals
+  RGBASM_TOKEN_MNEMONIC,    // ld, jp, call, ...
+  RGBASM_TOKEN_REGISTER,    // a, hl, sp, hli, ...
+  RGBASM_TOKEN_CONDITION,   // z, nz, nc (`c` is reported as a register)
+  RGBASM_TOKEN_KEYWORD,     // directives and other reserved words
+  RGBASM_TOKEN_FUNCTION,    // built-in functions, e.g. HIGH(...)
+  RGBASM_TOKEN_CONSTANT,    // @, ., .., _NARG, __RGBDS_MAJOR__, ...
+  RGBASM_TOKEN_LABEL,       // label definitions and anonymous labels
+  RGBASM_TOKEN_MACRO,       // a non reserved identifier starting a line
+  RGBASM_TOKEN_IDENTIFIER,  // global symbols
+  RGBASM_TOKEN_LOCAL,       // .local and Parent.local symbols
+  RGBASM_TOKEN_MACRO_ARG,   // \1, \<name>, \@, \#, \,
+  RGBASM_TOKEN_OPERATOR,
+  RGBASM_TOKEN_PUNCTUATION, // brackets, commas, colons, line continuations
+  RGBASM_TOKEN_ERROR,
+  RGBASM_TOKEN_CLASS_COUNT,
+} RgbasmTokenClass;
+
+typedef struct RgbasmToken {
+  uint32_t offset;
+  uint32_t length;
+  RgbasmTokenClass token_class;
+} RgbasmToken;
+
+typedef struct RgbasmTokenizer {
+  const char *data;
+  uint32_t length;
+  uint32_t offset;
+  bool line_start;
+  bool after_operand;
+} RgbasmTokenizer;
+
+typedef struct RgbasmMappedFile {
+  const char *data;
+  size_t length;
+} RgbasmMappedFile;
+
+void rgbasm_tokenizer_init(RgbasmTokenizer *self, const char *data,
+                           uint32_t length);
+
+// Scans the next token. Returns false at the end of the buffer.
+bool rgbasm_tokenizer_next(RgbasmTokenizer *self, RgbasmToken *token);
+
+// Scans up to `capacity` tokens into `tokens` and returns their number, 0 at
+// the end of the buffer. Preferable over single tokens across FFI boundaries.
+uint32_t rgbasm_tokenizer_fill(RgbasmTokenizer *self, RgbasmToken *tokens,
+                               uint32_t capacity);
+
+const char *rgbasm_token_class_name(RgbasmTokenClass token_class);
+
+// Maps a file read-only into memory. Returns false on error, or on platforms
+// without mmap.
+bool rgbasm_map_file(const char *path, RgbasmMappedFile *file);
+void rgbasm_unmap_file(RgbasmMappedFile *file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TREE_SITTER_RGBASM_TOKENIZER_H_
@@ -0,0 +1,60 @@
+# Profile-guided, link-time optimized build of libtree-sitter-rgbasm.
+#
+#   cmake -D TREE_SITTER_RUNTIME_DIR=/path/to/tree-sitter/lib -P cmake/pgo.cmake
+#
+# Builds the library, the tree-sitter runtime and the parse benchmark with
+# instrumentation, trains them on bench/corpus and rebuilds with the profiles
+# and LTO. Both phases use the same build directory, since GCC keys the
+# profiles by object file path.
+#
+# Variables:
+#   BUILD_DIR                build directory (default: build-pgo)
+#   TREE_SITTER_RUNTIME_DIR  tree-sitter lib/ directory, pkg-config otherwise
+#   LLVM_PROFDATA            llvm-profdata binary, needed for Clang
+
+get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+if(NOT BUILD_DIR)
+    set(BUILD_DIR "${SOURCE_DIR}/build-pgo")
+endif()
+get_filename_component(BUILD_DIR "${BUILD_DIR}" ABSOLUTE)
+set(PROFILE_DIR "${BUILD_DIR}/pgo-profiles")
+if(NOT LLVM_PROFDATA)
+    set(LLVM_PROFDATA llvm-profdata)
+endif()
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "Command failed: ${ARGN}")
+    endif()
+endfunction()
+
+function(configure phase)
+    run("${CMAKE_COMMAND}" -S "${SOURCE_DIR}" -B "${BUILD_DIR}"
+        -DCMAKE_BUILD_TYPE=Release
+        -DRGBASM_BUILD_TOOLS=ON
+        -DRGBASM_PGO=${phase}
+        "-DRGBASM_PGO_DIR=${PROFILE_DIR}"
+        "-DTREE_SITTER_RUNTIME_DIR=${TREE_SITTER_RUNTIME_DIR}")
+endfunction()
+
+file(REMOVE_RECURSE "${PROFILE_DIR}")
+
+message(STATUS "PGO: instrumented build")
+configure(GENERATE)
+run("${CMAKE_COMMAND}" --build "${BUILD_DIR}" --clean-first)
+
+message(STATUS "PGO: training")
+run("${CMAKE_COMMAND}" --build "${BUILD_DIR}" --target pgo-train)
+
+file(GLOB RAW_PROFILES "${PROFILE_DIR}/*.profraw")
+if(RAW_PROFILES)
+    # Clang writes raw profiles, which need to be merged first
+    run("${LLVM_PROFDATA}" merge -o "${PROFILE_DIR}/rgbasm.profdata" ${RAW_PROFILES})
+endif()
+
+message(STATUS "PGO: optimized build")
+configure(USE)
+run("${CMAKE_COMMAND}" --build "${BUILD_DIR}" --clean-first)
+
+message(STATUS "PGO: done, libraries are in ${BUILD_DIR}")
@@ -0,0 +1,106 @@
+# Known-output tests of the analysis tools.
+#
+#   cmake -D TOOLS_DIR=build -P cmake/test-tools.cmake
+#
+# Runs rgbasm-<tool> on every test/tools/<tool>/<case>.asm, from that
+# directory, and compares what it prints with <case>.out. A first line like
+# `; ARGS: -v` gives arguments to pass before the file name. Several such
+# lines at the top run the tool once each, in order, and their output is
+# compared as a whole. In the arguments, `{}` is the case file and `{tmp}` a
+# scratch file removed after the case, e.g. an index written by one run and
+# read by the next; a line using either is not given the file name at the
+# end. The directory is cut from the output, so tools printing absolute paths
+# print relative ones.
+#
+# Variables:
+#   TOOLS_DIR  directory of the rgbasm-* binaries (default: the grammar directory)
+#   TOOLS      tools to test, separated by `;` (default: all of test/tools)
+#   UPDATE     write the output to the .out files instead of comparing
+
+get_filename_component(SOURCE_DIR "${CMAKE_CURRENT_LIST_DIR}/.." ABSOLUTE)
+if(NOT TOOLS_DIR)
+    set(TOOLS_DIR "${SOURCE_DIR}")
+endif()
+get_filename_component(TOOLS_DIR "${TOOLS_DIR}" ABSOLUTE)
+set(CASES_DIR "${SOURCE_DIR}/test/tools")
+
+if(NOT TOOLS)
+    file(GLOB entries RELATIVE "${CASES_DIR}" "${CASES_DIR}/*")
+    list(SORT entries)
+    foreach(entry IN LISTS entries)
+        if(IS_DIRECTORY "${CASES_DIR}/${entry}")
+            list(APPEND TOOLS "${entry}")
+        endif()
+    endforeach()
+endif()
+
+set(passed 0)
+set(failed "")
+foreach(tool IN LISTS TOOLS)
+    get_filename_component(dir "${CASES_DIR}/${tool}" REALPATH)
+    file(GLOB cases "${dir}/*.asm")
+    list(SORT cases)
+    foreach(input IN LISTS cases)
+        get_filename_component(name "${input}" NAME_WE)
+        file(READ "${input}" head LIMIT 1024)
+        set(runs 0)
+        while(head MATCHES "^; ARGS: ([^\n]*)\n(.*)$")
+            math(EXPR runs "${runs} + 1")
+            set(run_${runs} "${CMAKE_MATCH_1}")
+            set(head "${CMAKE_MATCH_2}")
+        endwhile()
+        if(runs EQUAL 0)
+            set(runs 1)
+            set(run_1 "")
+        endif()
+        set(scratch "${TOOLS_DIR}/test-tools-${tool}-${name}.tmp")
+        file(REMOVE "${scratch}")
+        set(output "")
+        set(result 0)
+        foreach(run RANGE 1 ${runs})
+            set(line "${run_${run}}")
+            if(NOT line MATCHES "{(tmp)?}")
+                string(APPEND line " {}")
+            endif()
+            string(REPLACE "{tmp}" "${scratch}" line "${line}")
+            string(REPLACE "{}" "${name}.asm" line "${line}")
+            separate_arguments(args UNIX_COMMAND "${line}")
+            execute_process(COMMAND "${TOOLS_DIR}/rgbasm-${tool}" ${args}
+                            WORKING_DIRECTORY "${dir}"
+                            OUTPUT_VARIABLE run_output
+                            RESULT_VARIABLE run_result)
+            string(APPEND output "${run_output}")
+            if(NOT run_result MATCHES "^[0-9]+$")
+                set(result "${run_result}")
+            endif()
+        endforeach()
+        file(REMOVE "${scratch}")
+        string(REPLACE "${dir}/" "" output "${output}")
+        set(expected_file "${dir}/${name}.out")
+        if(NOT result MATCHES "^[0-9]+$")
+            message(STATUS "${tool}/${name}: ${result}")
+            list(APPEND failed "${tool}/${name}")
+        elseif(UPDATE)
+            file(WRITE "${expected_file}" "${output}")
+            math(EXPR passed "${passed} + 1")
+        else()
+            set(expected "")
+            if(EXISTS "${expected_file}")
+                file(READ "${expected_file}" expected)
+            endif()
+            if(output STREQUAL expected)
+                math(EXPR passed "${passed} + 1")
+            else()
+                message(STATUS "${tool}/${name}: unexpected output\n"
+                               "--- expected\n${expected}--- actual\n${output}")
+                list(APPEND failed "${tool}/${name}")
+            endif()
+        endif()
+    endforeach()
+endforeach()
+
+list(LENGTH failed failed_count)
+message(STATUS "${passed} passed, ${failed_count} failed")
+if(failed_count GREATER 0)
+    message(FATAL_ERROR "Failed: ${failed}")
+endif()
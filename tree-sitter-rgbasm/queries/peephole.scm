@@ -0,0 +1,176 @@
+; Peephole rewrites: instructions with a cheaper equivalent.
+;
+; Every pattern captures the instructions it replaces as @rewrite and sets
+;   rule     its name
+;   replace  the text that replaces them, {name} is the text of @name
+;   form     the SM83 form of the replacement, for its bytes and cycles
+;   note     what else changes, if anything
+; `#rgbds-keyword? @capture word...` compares the text case-insensitively,
+; `#rgbds-value? @capture min max` evaluates a constant expression. Used by
+; lua/rgbds/peephole.lua and tools/peephole.c.
+
+; ld a, 0 -> xor a
+((instruction
+  (generic_instruction
+    mnemonic: (instruction_name) @_ld
+    (operand_list . (register) @_a . (_) @_value .))) @rewrite
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-value? @_value 0 0)
+  (#set! rule "ld-a-0")
+  (#set! replace "xor a")
+  (#set! form "xor r")
+  (#set! note "sets the flags, ld keeps them"))
+
+; cp 0 -> and a
+((instruction
+  (generic_instruction
+    mnemonic: (instruction_name) @_cp
+    (operand_list (_) @_value .))) @rewrite
+  (#rgbds-keyword? @_cp "cp")
+  (#rgbds-value? @_value 0 0)
+  (#set! rule "cp-0")
+  (#set! replace "and a")
+  (#set! form "and r")
+  (#set! note "N and H differ, Z and C do not"))
+
+; call X / ret -> jp X
+((instruction_list
+  .
+  (instruction
+    (call_instruction . (instruction_name) . (_) @target .)) @rewrite
+  .)
+  .
+  (instruction_list
+    .
+    (instruction
+      (ret_instruction . (instruction_name) .)) @rewrite
+    .)
+  (#set! rule "call-ret")
+  (#set! replace "jp {target}")
+  (#set! form "jp n")
+  (#set! note "the callee returns to the caller"))
+
+; ld a, [hl] / inc hl -> ld a, [hli]
+((instruction_list
+  .
+  (instruction
+    (generic_instruction
+      mnemonic: (instruction_name) @_ld
+      (operand_list . (register) @_a . (address . (register) @_hl .) .))) @rewrite
+  .)
+  .
+  (instruction_list
+    .
+    (instruction
+      (generic_instruction
+        mnemonic: (instruction_name) @_inc
+        (operand_list . (register) @_hl2 .))) @rewrite
+    .)
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-keyword? @_hl "hl")
+  (#rgbds-keyword? @_inc "inc")
+  (#rgbds-keyword? @_hl2 "hl")
+  (#set! rule "ld-a-hli")
+  (#set! replace "ld a, [hli]")
+  (#set! form "ld a,[hli]"))
+
+; ld [hl], a / inc hl -> ld [hli], a
+((instruction_list
+  .
+  (instruction
+    (generic_instruction
+      mnemonic: (instruction_name) @_ld
+      (operand_list . (address . (register) @_hl .) . (register) @_a .))) @rewrite
+  .)
+  .
+  (instruction_list
+    .
+    (instruction
+      (generic_instruction
+        mnemonic: (instruction_name) @_inc
+        (operand_list . (register) @_hl2 .))) @rewrite
+    .)
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-keyword? @_hl "hl")
+  (#rgbds-keyword? @_inc "inc")
+  (#rgbds-keyword? @_hl2 "hl")
+  (#set! rule "ld-hli-a")
+  (#set! replace "ld [hli], a")
+  (#set! form "ld [hli],a"))
+
+; ld a, [hl] / dec hl -> ld a, [hld]
+((instruction_list
+  .
+  (instruction
+    (generic_instruction
+      mnemonic: (instruction_name) @_ld
+      (operand_list . (register) @_a . (address . (register) @_hl .) .))) @rewrite
+  .)
+  .
+  (instruction_list
+    .
+    (instruction
+      (generic_instruction
+        mnemonic: (instruction_name) @_dec
+        (operand_list . (register) @_hl2 .))) @rewrite
+    .)
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-keyword? @_hl "hl")
+  (#rgbds-keyword? @_dec "dec")
+  (#rgbds-keyword? @_hl2 "hl")
+  (#set! rule "ld-a-hld")
+  (#set! replace "ld a, [hld]")
+  (#set! form "ld a,[hld]"))
+
+; ld [hl], a / dec hl -> ld [hld], a
+((instruction_list
+  .
+  (instruction
+    (generic_instruction
+      mnemonic: (instruction_name) @_ld
+      (operand_list . (address . (register) @_hl .) . (register) @_a .))) @rewrite
+  .)
+  .
+  (instruction_list
+    .
+    (instruction
+      (generic_instruction
+        mnemonic: (instruction_name) @_dec
+        (operand_list . (register) @_hl2 .))) @rewrite
+    .)
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-keyword? @_hl "hl")
+  (#rgbds-keyword? @_dec "dec")
+  (#rgbds-keyword? @_hl2 "hl")
+  (#set! rule "ld-hld-a")
+  (#set! replace "ld [hld], a")
+  (#set! form "ld [hld],a"))
+
+; ld [$FFxx], a -> ldh [$FFxx], a
+((instruction
+  (generic_instruction
+    mnemonic: (instruction_name) @_ld
+    (operand_list . (address . (_) @address .) . (register) @_a .))) @rewrite
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-value? @address "$FF00" "$FFFF")
+  (#set! rule "ldh-store")
+  (#set! replace "ldh [{address}], a")
+  (#set! form "ldh [n],a"))
+
+; ld a, [$FFxx] -> ldh a, [$FFxx]
+((instruction
+  (generic_instruction
+    mnemonic: (instruction_name) @_ld
+    (operand_list . (register) @_a . (address . (_) @address .) .))) @rewrite
+  (#rgbds-keyword? @_ld "ld")
+  (#rgbds-keyword? @_a "a")
+  (#rgbds-value? @address "$FF00" "$FFFF")
+  (#set! rule "ldh-load")
+  (#set! replace "ldh a, [{address}]")
+  (#set! form "ldh a,[n]"))
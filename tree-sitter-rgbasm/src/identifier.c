@@ -54,7 +54,9 @@ static bool is_reserved_word(const char *name, size_t len) {
       "__ISO_8601_LOCAL__",
   };
 
-  static const char *const reserved[] = {
+  // Fixed width rows instead of pointers: no relocations for the table in
+  // position independent builds, e.g. WASM side modules.
+  static const char reserved[][sizeof("STATIC_ASSERT")] = {
       // 1
       "A", "B", "C", "D", "E", "H", "L", "Z",
       // 2
@@ -89,7 +91,8 @@ static bool is_reserved_word(const char *name, size_t len) {
       "STRSLICE", "INCHARMAP", "ENDSECTION", "NEWCHARMAP", "SETCHARMAP",
       "STATIC_ASSERT"};
 
-  if (matches_any(name, len, constants,
+  if (len > 0 && (name[0] == '@' || name[0] == '.' || name[0] == '_') &&
+      matches_any(name, len, constants,
                   sizeof(constants) / sizeof(constants[0])) != -1) {
     return true;
   }
@@ -111,5 +114,22 @@ static bool is_reserved_word(const char *name, size_t len) {
   }
   upper[len] = '\0';
 
-  return matches_any(upper, len, reserved, count) != -1;
+  // `reserved` is ordered by length first, then alphabetically
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    const size_t kw_len = strlen(reserved[mid]);
+    const int cmp = kw_len != len ? (len < kw_len ? -1 : 1)
+                                  : memcmp(upper, reserved[mid], len);
+    if (cmp == 0) {
+      return true;
+    }
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return false;
 }
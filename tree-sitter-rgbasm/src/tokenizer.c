@@ -0,0 +1,683 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../bindings/c/tree_sitter/tree-sitter-rgbasm-tokenizer.h"
+#include "identifier.c"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TOKENIZER_SSE2 1
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ----- Character runs -----
+//
+// Blanks, comments and line breaks make up most of the bytes of generated
+// data files, so these runs are scanned 16 bytes at a time where possible.
+
+static inline bool is_blank_char(char c) { return c == ' ' || c == '\t'; }
+
+static inline bool is_space_char(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool is_line_break(char c) { return c == '\r' || c == '\n'; }
+
+#if TOKENIZER_SSE2
+static inline unsigned mask_of(const char *data, char a, char b) {
+  const __m128i chunk = _mm_loadu_si128((const __m128i *)data);
+  const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(a)),
+                                     _mm_cmpeq_epi8(chunk, _mm_set1_epi8(b)));
+  return (unsigned)_mm_movemask_epi8(match);
+}
+#endif
+
+// First position at or after `pos` which is not a blank.
+static uint32_t skip_blanks(const char *data, uint32_t pos, uint32_t end) {
+#if TOKENIZER_SSE2
+  while (pos + 16 <= end) {
+    const unsigned mask = ~mask_of(data + pos, ' ', '\t') & 0xFFFF;
+    if (mask != 0) {
+      return pos + (uint32_t)__builtin_ctz(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < end && is_blank_char(data[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// First position at or after `pos` which is not a blank or line break.
+static uint32_t skip_spaces(const char *data, uint32_t pos, uint32_t end) {
+#if TOKENIZER_SSE2
+  while (pos + 16 <= end) {
+    const unsigned mask =
+        ~(mask_of(data + pos, ' ', '\t') | mask_of(data + pos, '\r', '\n')) &
+        0xFFFF;
+    if (mask != 0) {
+      return pos + (uint32_t)__builtin_ctz(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < end && is_space_char(data[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// Position of the next line break at or after `pos`, or `end`.
+static uint32_t find_line_end(const char *data, uint32_t pos, uint32_t end) {
+#if TOKENIZER_SSE2
+  while (pos + 16 <= end) {
+    const unsigned mask = mask_of(data + pos, '\r', '\n');
+    if (mask != 0) {
+      return pos + (uint32_t)__builtin_ctz(mask);
+    }
+    pos += 16;
+  }
+#endif
+  while (pos < end && !is_line_break(data[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// Position after the `*/` closing a block comment, or `end`.
+static uint32_t find_block_comment_end(const char *data, uint32_t pos,
+                                       uint32_t end) {
+  while (pos < end) {
+    const char *star = memchr(data + pos, '*', end - pos);
+    if (star == NULL) {
+      return end;
+    }
+    pos = (uint32_t)(star - data) + 1;
+    if (pos < end && data[pos] == '/') {
+      return pos + 1;
+    }
+  }
+  return end;
+}
+
+// ----- Reserved words -----
+
+static const char *const MNEMONICS[] = {
+    "CP",  "DI",  "EI",  "JP",  "JR",  "LD",  "OR",  "RL",  "RR",   "ADC",
+    "ADD", "AND", "BIT", "CCF", "CPL", "DAA", "DEC", "INC", "LDD",  "LDH",
+    "LDI", "NOP", "POP", "RES", "RET", "RLA", "RLC", "RRA", "RRC",  "RST",
+    "SBC", "SCF", "SET", "SLA", "SRA", "SRL", "SUB", "XOR", "CALL", "HALT",
+    "PUSH", "RETI", "RLCA", "RRCA", "STOP", "SWAP",
+};
+
+static const char *const REGISTERS[] = {
+    "A", "B", "C", "D", "E", "H", "L", "AF", "BC", "DE", "HL", "SP", "HLD",
+    "HLI",
+};
+
+static const char *const CONDITIONS[] = {"Z", "NC", "NZ"};
+
+static const char *const FUNCTIONS[] = {
+    "COS",      "DEF",      "DIV",      "LOG",       "LOW",     "MUL",
+    "POW",      "SIN",      "TAN",      "ACOS",      "ASIN",    "ATAN",
+    "BANK",     "CEIL",     "FMOD",     "HIGH",      "ATAN2",   "FLOOR",
+    "ROUND",    "STRIN",    "SIZEOF",   "STRCAT",    "STRCMP",  "STRFMT",
+    "STRLEN",   "STRLWR",   "STRRIN",   "STRRPL",    "STRSUB",  "STRUPR",
+    "BYTELEN",  "CHARCMP",  "CHARLEN",  "CHARSUB",   "CHARVAL", "ISCONST",
+    "REVCHAR",  "SECTION",  "STARTOF",  "STRBYTE",   "STRCHAR", "STRFIND",
+    "TZCOUNT",  "BITWIDTH", "CHARSIZE", "READFILE",  "STRRFIND", "STRSLICE",
+    "INCHARMAP",
+};
+
+#define COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+static bool is_builtin_constant(const char *upper, size_t len) {
+  if (len >= 4 && upper[0] == '_' && upper[1] == '_') {
+    return upper[len - 1] == '_' && upper[len - 2] == '_';
+  }
+  return matches_any(upper, len, (const char *const[]){"_RS", "_NARG"}, 2) !=
+         -1;
+}
+
+// ----- Scanning -----
+
+// Length of a macro escape (\1, \@, \<name>, \<-1>) at `pos`, 0 if none.
+static uint32_t scan_macro_escape(const char *data, uint32_t pos,
+                                  uint32_t end) {
+  if (pos + 1 >= end || data[pos] != '\\') {
+    return 0;
+  }
+  const char c = data[pos + 1];
+  if ((c >= '1' && c <= '9') || c == '@') {
+    return 2;
+  }
+  if (c != '<') {
+    return 0;
+  }
+  uint32_t p = pos + 2;
+  if (p < end && data[p] == '-') {
+    p++;
+  }
+  const uint32_t inner = p;
+  while (p < end && (is_identifier_char(data[p]) || data[p] == '.')) {
+    p++;
+  }
+  if (p == inner || p >= end || data[p] != '>') {
+    return 0;
+  }
+  return p + 1 - pos;
+}
+
+// Scans an identifier like the external scanner does: an optional raw marker,
+// identifier characters, at most one dot, {interpolations} and macro escapes.
+// Returns the length, 0 if there is no identifier at `pos`.
+static uint32_t scan_identifier(const char *data, uint32_t pos, uint32_t end,
+                                int *dot, bool *interpolated) {
+  const uint32_t start = pos;
+  if (data[pos] == '#') {
+    pos++;
+  }
+  const uint32_t name_start = pos;
+  uint32_t interpolation = 0;
+  *dot = -1;
+  *interpolated = false;
+
+  while (pos < end) {
+    const char c = data[pos];
+    if (c == '\\') {
+      const uint32_t escape = scan_macro_escape(data, pos, end);
+      if (escape == 0) {
+        break;
+      }
+      *interpolated = true;
+      pos += escape;
+      continue;
+    }
+    if (c == '{') {
+      *interpolated = true;
+      interpolation += 1;
+    } else if (interpolation > 0) {
+      if (c == '}') {
+        interpolation -= 1;
+      } else if (is_line_break(c)) {
+        return 0;
+      }
+    } else if (c == '.') {
+      if (*dot != -1) {
+        break;
+      }
+      *dot = (int)(pos - start);
+    } else if (!is_identifier_char(c)) {
+      break;
+    } else if (pos == name_start && !is_identifier_start(c)) {
+      return 0;
+    }
+    pos++;
+  }
+  if (interpolation > 0 || pos == name_start) {
+    return 0;
+  }
+  if (*dot == (int)(pos - start) - 1 && pos - start == 1) {
+    // a lonely dot is a constant
+    return 0;
+  }
+  return pos - start;
+}
+
+static RgbasmTokenClass classify_word(const RgbasmTokenizer *self,
+                                      uint32_t start, uint32_t len,
+                                      uint32_t next) {
+  const char *data = self->data;
+  if (len > MAX_IDENTIFIER_LENGTH) {
+    return RGBASM_TOKEN_IDENTIFIER;
+  }
+  char upper[MAX_IDENTIFIER_LENGTH + 1];
+  for (uint32_t i = 0; i < len; i++) {
+    const char c = data[start + i];
+    upper[i] = (c >= 'a' && c <= 'z') ? (char)(c - 32) : c;
+  }
+  upper[len] = '\0';
+  if (!is_reserved_word(upper, len)) {
+    return RGBASM_TOKEN_IDENTIFIER;
+  }
+  if (is_builtin_constant(upper, len)) {
+    return RGBASM_TOKEN_CONSTANT;
+  }
+  if (next < self->length && data[next] == '(' &&
+      matches_any(upper, len, FUNCTIONS, COUNT(FUNCTIONS)) != -1) {
+    return RGBASM_TOKEN_FUNCTION;
+  }
+  if (matches_any(upper, len, MNEMONICS, COUNT(MNEMONICS)) != -1) {
+    return RGBASM_TOKEN_MNEMONIC;
+  }
+  if (matches_any(upper, len, REGISTERS, COUNT(REGISTERS)) != -1) {
+    return RGBASM_TOKEN_REGISTER;
+  }
+  if (matches_any(upper, len, CONDITIONS, COUNT(CONDITIONS)) != -1) {
+    return RGBASM_TOKEN_CONDITION;
+  }
+  return RGBASM_TOKEN_KEYWORD;
+}
+
+// Regular and triple-quoted strings, with escapes. Unterminated regular
+// strings end at the line break.
+static uint32_t scan_string(const char *data, uint32_t pos, uint32_t end,
+                            bool raw) {
+  const uint32_t start = pos;
+  if (raw) {
+    pos++;
+  }
+  const bool triple =
+      pos + 2 < end && data[pos + 1] == '"' && data[pos + 2] == '"';
+  pos += triple ? 3 : 1;
+  while (pos < end) {
+    const char c = data[pos];
+    if (c == '\\' && !raw) {
+      pos += 2;
+      continue;
+    }
+    if (c == '"') {
+      if (!triple) {
+        return pos + 1 - start;
+      }
+      if (pos + 2 < end && data[pos + 1] == '"' && data[pos + 2] == '"') {
+        return pos + 3 - start;
+      }
+    } else if (!triple && is_line_break(c)) {
+      break;
+    }
+    pos++;
+  }
+  return (pos < end ? pos : end) - start;
+}
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool is_hex_digit(char c) {
+  return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static uint32_t scan_digits(const char *data, uint32_t pos, uint32_t end,
+                            bool (*digit)(char)) {
+  while (pos < end && (digit(data[pos]) || data[pos] == '_')) {
+    pos++;
+  }
+  return pos;
+}
+
+static bool is_binary_digit(char c) { return c == '0' || c == '1'; }
+static bool is_octal_digit(char c) { return c >= '0' && c <= '7'; }
+static bool is_decimal_digit(char c) { return is_digit(c); }
+static bool is_hex(char c) { return is_hex_digit(c); }
+
+static bool is_graphics_char(char c) {
+  return (c >= '0' && c <= '3') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') || c == '.' || c == '#' || c == '@';
+}
+
+// Number literals, see number_literal in grammar.js. `pos` is on the first
+// character, prefixes have already been checked by the caller.
+static uint32_t scan_number(const char *data, uint32_t pos, uint32_t end) {
+  const uint32_t start = pos;
+  const char c = data[pos];
+  if (c == '$') {
+    return scan_digits(data, pos + 1, end, is_hex) - start;
+  }
+  if (c == '%') {
+    return scan_digits(data, pos + 1, end, is_binary_digit) - start;
+  }
+  if (c == '&') {
+    return scan_digits(data, pos + 1, end, is_octal_digit) - start;
+  }
+  if (c == '`') {
+    pos++;
+    while (pos < end && is_graphics_char(data[pos])) {
+      pos++;
+    }
+    return pos - start;
+  }
+  if (c == '0' && pos + 2 < end) {
+    const char prefix = data[pos + 1] | 0x20;
+    bool (*digit)(char) = prefix == 'x'   ? is_hex
+                          : prefix == 'b' ? is_binary_digit
+                          : prefix == 'o' ? is_octal_digit
+                                          : NULL;
+    if (digit != NULL && digit(data[pos + 2])) {
+      return scan_digits(data, pos + 2, end, digit) - start;
+    }
+  }
+  pos = scan_digits(data, pos, end, is_decimal_digit);
+  if (pos + 1 < end && data[pos] == '.' && is_digit(data[pos + 1])) {
+    pos = scan_digits(data, pos + 1, end, is_decimal_digit);
+    if (pos + 1 < end && (data[pos] | 0x20) == 'q' && is_digit(data[pos + 1])) {
+      pos = scan_digits(data, pos + 1, end, is_decimal_digit);
+    }
+  }
+  return pos - start;
+}
+
+static uint32_t scan_char(const char *data, uint32_t pos, uint32_t end) {
+  const uint32_t start = pos++;
+  while (pos < end && data[pos] != '\'' && !is_line_break(data[pos])) {
+    pos += data[pos] == '\\' ? 2 : 1;
+  }
+  if (pos < end && data[pos] == '\'') {
+    pos++;
+  }
+  return (pos < end ? pos : end) - start;
+}
+
+static uint32_t scan_operator(const char *data, uint32_t pos, uint32_t end) {
+  static const char *const operators[] = {
+      "===", "!==", ">>>", "<<=", ">>=", "**", "<<", ">>", "<=", "==",
+      ">=",  "!=",  "&&",  "||",  "++",  "+=", "-=", "*=", "/=", "%=",
+      "&=",  "|=",  "^=",
+  };
+  for (size_t i = 0; i < COUNT(operators); i++) {
+    const size_t len = strlen(operators[i]);
+    if (pos + len <= end && memcmp(data + pos, operators[i], len) == 0) {
+      return (uint32_t)len;
+    }
+  }
+  return strchr("+-*/%&|^~!<>=?", data[pos]) != NULL ? 1 : 0;
+}
+
+static inline bool ends_operand(RgbasmTokenClass token_class) {
+  switch (token_class) {
+  case RGBASM_TOKEN_STRING:
+  case RGBASM_TOKEN_CHAR:
+  case RGBASM_TOKEN_NUMBER:
+  case RGBASM_TOKEN_REGISTER:
+  case RGBASM_TOKEN_CONSTANT:
+  case RGBASM_TOKEN_IDENTIFIER:
+  case RGBASM_TOKEN_LOCAL:
+  case RGBASM_TOKEN_MACRO_ARG:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static RgbasmTokenClass scan_token(RgbasmTokenizer *self, uint32_t pos,
+                                   uint32_t *length) {
+  const char *data = self->data;
+  const uint32_t end = self->length;
+  const char c = data[pos];
+  const char next = pos + 1 < end ? data[pos + 1] : '\0';
+
+  switch (c) {
+  case '\r':
+  case '\n':
+    *length = skip_spaces(data, pos, end) - pos;
+    return RGBASM_TOKEN_NEWLINE;
+  case ';':
+    *length = find_line_end(data, pos, end) - pos;
+    return RGBASM_TOKEN_COMMENT;
+  case '"':
+    *length = scan_string(data, pos, end, false);
+    return RGBASM_TOKEN_STRING;
+  case '\'':
+    *length = scan_char(data, pos, end);
+    return RGBASM_TOKEN_CHAR;
+  case '`':
+    *length = scan_number(data, pos, end);
+    return *length > 1 ? RGBASM_TOKEN_NUMBER : RGBASM_TOKEN_ERROR;
+  case '$':
+    *length = scan_number(data, pos, end);
+    return is_hex_digit(next) ? RGBASM_TOKEN_NUMBER : RGBASM_TOKEN_ERROR;
+  case '%':
+    if (!self->after_operand && is_binary_digit(next)) {
+      *length = scan_number(data, pos, end);
+      return RGBASM_TOKEN_NUMBER;
+    }
+    break;
+  case '&':
+    if (!self->after_operand && is_octal_digit(next)) {
+      *length = scan_number(data, pos, end);
+      return RGBASM_TOKEN_NUMBER;
+    }
+    break;
+  case '/':
+    if (next == '*') {
+      *length = find_block_comment_end(data, pos + 2, end) - pos;
+      return RGBASM_TOKEN_COMMENT;
+    }
+    break;
+  case '#':
+    if (next == '"') {
+      *length = scan_string(data, pos, end, true);
+      return RGBASM_TOKEN_STRING;
+    }
+    break;
+  case '\\': {
+    if (next == '#' || next == ',') {
+      *length = 2;
+      return RGBASM_TOKEN_MACRO_ARG;
+    }
+    const uint32_t escape = scan_macro_escape(data, pos, end);
+    if (escape > 0) {
+      const char after = pos + escape < end ? data[pos + escape] : '\0';
+      if (is_identifier_char(after) || after == '{' || after == '.' ||
+          after == '\\') {
+        break; // part of an identifier, e.g. label\@
+      }
+      *length = escape;
+      return RGBASM_TOKEN_MACRO_ARG;
+    }
+    const uint32_t after = skip_blanks(data, pos + 1, end);
+    *length = 1;
+    if (after >= end || data[after] == ';' || is_line_break(data[after])) {
+      return RGBASM_TOKEN_PUNCTUATION; // line continuation
+    }
+    return RGBASM_TOKEN_ERROR;
+  }
+  case ':':
+    if (next == ':') {
+      *length = 2;
+      return RGBASM_TOKEN_PUNCTUATION;
+    }
+    if (next == '+' || next == '-') {
+      uint32_t p = pos + 1;
+      while (p < end && data[p] == next) {
+        p++;
+      }
+      *length = p - pos;
+      return RGBASM_TOKEN_LABEL;
+    }
+    *length = 1;
+    return self->line_start ? RGBASM_TOKEN_LABEL : RGBASM_TOKEN_PUNCTUATION;
+  case '[':
+  case ']':
+    *length = next == c ? 2 : 1;
+    return RGBASM_TOKEN_PUNCTUATION;
+  case '(':
+  case ')':
+  case ',':
+    *length = 1;
+    return RGBASM_TOKEN_PUNCTUATION;
+  case '@':
+    if (!is_identifier_char(next)) {
+      *length = 1;
+      return RGBASM_TOKEN_CONSTANT;
+    }
+    break;
+  default:
+    if (is_digit(c)) {
+      *length = scan_number(data, pos, end);
+      return RGBASM_TOKEN_NUMBER;
+    }
+    break;
+  }
+
+  // identifiers and keywords
+  int dot;
+  bool interpolated;
+  const uint32_t len = scan_identifier(data, pos, end, &dot, &interpolated);
+  if (len > 0) {
+    *length = len;
+    const uint32_t after = pos + len;
+    const bool label = after < end && data[after] == ':' &&
+                       !(after + 1 < end && (data[after + 1] == '+' ||
+                                             data[after + 1] == '-'));
+    if (dot >= 0) {
+      return label || (dot == 0 && self->line_start) ? RGBASM_TOKEN_LABEL
+                                                      : RGBASM_TOKEN_LOCAL;
+    }
+    if (label) {
+      return RGBASM_TOKEN_LABEL;
+    }
+    const RgbasmTokenClass token_class =
+        c == '#' || interpolated
+            ? RGBASM_TOKEN_IDENTIFIER
+            : classify_word(self, pos, len, skip_blanks(data, after, end));
+    if (token_class == RGBASM_TOKEN_IDENTIFIER && self->line_start) {
+      // `name = value` is a deprecated assignment, everything else a macro
+      const uint32_t op = skip_blanks(data, after, end);
+      const bool assignment = op < end && scan_operator(data, op, end) > 0 &&
+                              data[op] != '?' && data[op] != '!' &&
+                              data[op] != '~';
+      return assignment ? RGBASM_TOKEN_IDENTIFIER : RGBASM_TOKEN_MACRO;
+    }
+    return token_class;
+  }
+
+  if (c == '.') {
+    *length = next == '.' ? 2 : 1;
+    return RGBASM_TOKEN_CONSTANT;
+  }
+  const uint32_t op = scan_operator(data, pos, end);
+  if (op > 0) {
+    *length = op;
+    return RGBASM_TOKEN_OPERATOR;
+  }
+  *length = 1;
+  return RGBASM_TOKEN_ERROR;
+}
+
+// ----- API -----
+
+void rgbasm_tokenizer_init(RgbasmTokenizer *self, const char *data,
+                           uint32_t length) {
+  self->data = data;
+  self->length = length;
+  self->offset = 0;
+  self->line_start = true;
+  self->after_operand = false;
+}
+
+bool rgbasm_tokenizer_next(RgbasmTokenizer *self, RgbasmToken *token) {
+  const uint32_t pos = skip_blanks(self->data, self->offset, self->length);
+  if (pos >= self->length) {
+    self->offset = self->length;
+    return false;
+  }
+  uint32_t length = 0;
+  const RgbasmTokenClass token_class = scan_token(self, pos, &length);
+  if (length == 0) {
+    length = 1;
+  }
+  token->offset = pos;
+  token->length = length;
+  token->token_class = token_class;
+  self->offset = pos + length;
+  if (token_class == RGBASM_TOKEN_NEWLINE) {
+    self->line_start = true;
+    self->after_operand = false;
+  } else if (token_class != RGBASM_TOKEN_COMMENT) {
+    self->line_start = false;
+    self->after_operand = ends_operand(token_class) ||
+                          self->data[pos] == ')' || self->data[pos] == ']';
+  }
+  return true;
+}
+
+uint32_t rgbasm_tokenizer_fill(RgbasmTokenizer *self, RgbasmToken *tokens,
+                               uint32_t capacity) {
+  uint32_t count = 0;
+  while (count < capacity && rgbasm_tokenizer_next(self, &tokens[count])) {
+    count++;
+  }
+  return count;
+}
+
+const char *rgbasm_token_class_name(RgbasmTokenClass token_class) {
+  static const char *const names[RGBASM_TOKEN_CLASS_COUNT] = {
+      [RGBASM_TOKEN_NEWLINE] = "newline",
+      [RGBASM_TOKEN_COMMENT] = "comment",
+      [RGBASM_TOKEN_STRING] = "string",
+      [RGBASM_TOKEN_CHAR] = "char",
+      [RGBASM_TOKEN_NUMBER] = "number",
+      [RGBASM_TOKEN_MNEMONIC] = "mnemonic",
+      [RGBASM_TOKEN_REGISTER] = "register",
+      [RGBASM_TOKEN_CONDITION] = "condition",
+      [RGBASM_TOKEN_KEYWORD] = "keyword",
+      [RGBASM_TOKEN_FUNCTION] = "function",
+      [RGBASM_TOKEN_CONSTANT] = "constant",
+      [RGBASM_TOKEN_LABEL] = "label",
+      [RGBASM_TOKEN_MACRO] = "macro",
+      [RGBASM_TOKEN_IDENTIFIER] = "identifier",
+      [RGBASM_TOKEN_LOCAL] = "local",
+      [RGBASM_TOKEN_MACRO_ARG] = "macro_arg",
+      [RGBASM_TOKEN_OPERATOR] = "operator",
+      [RGBASM_TOKEN_PUNCTUATION] = "punctuation",
+      [RGBASM_TOKEN_ERROR] = "error",
+  };
+  if ((unsigned)token_class >= RGBASM_TOKEN_CLASS_COUNT) {
+    return "unknown";
+  }
+  return names[token_class];
+}
+
+bool rgbasm_map_file(const char *path, RgbasmMappedFile *file) {
+  file->data = NULL;
+  file->length = 0;
+#if defined(_WIN32)
+  (void)path;
+  return false;
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size > UINT32_MAX) {
+    close(fd);
+    return false;
+  }
+  if (info.st_size == 0) {
+    close(fd);
+    file->data = "";
+    return true;
+  }
+  void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+  file->data = data;
+  file->length = (size_t)info.st_size;
+  return true;
+#endif
+}
+
+void rgbasm_unmap_file(RgbasmMappedFile *file) {
+#if !defined(_WIN32)
+  if (file->length > 0) {
+    munmap((void *)file->data, file->length);
+  }
+#endif
+  file->data = NULL;
+  file->length = 0;
+}
@@ -0,0 +1,23 @@
+; ARGS: -v
+SECTION "Game", ROMX, BANK[1]
+Game:
+	ld b, 8
+.loop:
+	call Draw
+	dec b
+	jr nz, .loop ; @loop 4
+	call Sound
+	jp Sound
+
+SECTION "Gfx", ROMX, BANK[2]
+Draw:
+	ret
+
+SECTION "Audio", ROMX
+Sound:
+	ret
+
+SECTION "Near", ROMX, BANK[1]
+Near:
+	call Game
+	ret
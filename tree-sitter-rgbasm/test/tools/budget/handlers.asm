@@ -0,0 +1,31 @@
+; ARGS: -v -l 24
+SECTION "VBlank", ROM0[$40]
+IntVBlank:
+	jp VBlank
+
+SECTION "STAT", ROM0[$48]
+IntStat:
+	ld b, 4
+.wait:
+	dec b
+	jr nz, .wait ; @loop 4
+	reti
+
+SECTION "Timer", ROM0[$50]
+IntTimer:
+	ld b, 4
+.wait:
+	dec b
+	jr nz, .wait
+	reti
+
+SECTION "Handlers", ROM0
+VBlank:
+	push af
+	call Update
+	pop af
+	reti
+
+Update:
+	ld a, [hl]
+	ret
@@ -0,0 +1,33 @@
+SECTION "Entry", ROM0[$100]
+Entry:
+	nop
+	jp Main
+
+MACRO far_call
+	call Helper
+ENDM
+
+MACRO unused_call
+	call Lost
+ENDM
+
+SECTION "Main", ROM0
+Main:
+	far_call
+	jr Main
+	ld a, 1
+	ret
+
+Helper:
+	ret
+
+SECTION "Extra", ROM0
+Unused:
+	call Other
+	ret
+
+Other:
+	ret
+
+Lost:
+	ret
@@ -0,0 +1,15 @@
+; ARGS: -o {tmp} {}
+; ARGS: --lookup {tmp} Main Main.loop COUNT Helper Missing
+DEF COUNT EQU 3
+
+SECTION "Main", ROM0
+Main::
+	ld b, COUNT
+.loop:
+	call Helper
+	dec b
+	jr nz, .loop
+	ret
+
+Helper:
+	ret
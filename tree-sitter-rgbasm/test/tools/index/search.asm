@@ -0,0 +1,17 @@
+; ARGS: -o {tmp} {}
+; ARGS: --search {tmp} player
+; ARGS: --search {tmp} pl
+; ARGS: --search {tmp} --fuzzy -n 3 playerinti
+SECTION "Code", ROM0
+Player:
+	ret
+PlayerInit:
+	ret
+UpdatePlayer:
+	ret
+Enemy:
+	ret
+
+SECTION "State", WRAM0
+wPlayerX:
+	ds 1
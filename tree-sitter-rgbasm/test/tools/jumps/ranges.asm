@@ -0,0 +1,10 @@
+SECTION "Code", ROM0
+Main:
+	jp .skip
+	nop
+.skip:
+	jp nz, Main
+	jr Far
+	ds 200
+Far:
+	ret
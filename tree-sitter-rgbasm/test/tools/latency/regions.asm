@@ -0,0 +1,28 @@
+; ARGS: -l 40
+SECTION "VBlank", ROM0[$40]
+IntVBlank:
+	push af
+	ld a, [hl]
+	pop af
+	reti
+
+SECTION "Code", ROM0
+Main:
+	di
+	call Copy
+	ei
+	halt
+	di
+	ld a, 1
+	halt
+	ret
+
+Copy:
+	ld b, 8
+.loop:
+	ld a, [hl+]
+	ld [de], a
+	inc de
+	dec b
+	jr nz, .loop ; @loop 8
+	ret
@@ -0,0 +1,15 @@
+DEF rLCDC EQU $FF40
+
+SECTION "Code", ROM0
+Main:
+	ld a, 0
+	cp 0
+	ld [rLCDC], a
+	ld a, [hl]
+	inc hl
+	call Wait
+	ret
+
+Wait:
+	ld a, [$C000]
+	ret
@@ -0,0 +1,20 @@
+; ARGS: -v
+DEF COUNT EQU 4
+
+SECTION "Main", ROM0[$150]
+Main:
+	ld a, 0
+	ld [hl], a
+	jp Main
+
+SECTION "Table", ROMX, BANK[2]
+Table:
+	REPT COUNT
+	db 1, 2
+	ENDR
+	dw Main
+	ds 3
+
+SECTION "Buffer", WRAM0
+wBuffer:
+	ds 16
@@ -0,0 +1,5 @@
+; ARGS: --json
+SECTION "Code", ROMX
+	ds UNKNOWN_SIZE
+	ld b, 1
+	call Elsewhere
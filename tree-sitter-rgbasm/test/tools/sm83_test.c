@@ -0,0 +1,116 @@
+// Unit checks of the SM83 forms tools/sm83.c looks instructions up by.
+//
+// Every case is parsed on its own in a ROM0 section; the form, bytes and
+// M-cycles of its instruction must be the expected ones, or it must have no
+// form at all.
+
+#include "sm83.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+typedef struct Case {
+  const char *line;
+  const char *form; // NULL if the CPU does not have it
+  uint8_t bytes;
+  uint8_t cycles;
+  uint8_t taken_cycles;
+} Case;
+
+static const Case cases[] = {
+    {"nop", "nop", 1, 1, 1},
+    {"ld a, b", "ld r,r", 1, 1, 1},
+    {"ld b, [hl]", "ld r,[hl]", 1, 2, 2},
+    {"ld [hl+], a", "ld [hli],a", 1, 2, 2},
+    {"ld a, [hld]", "ld a,[hld]", 1, 2, 2},
+    {"ld hl, $c000", "ld rr,n", 3, 3, 3},
+    {"ld [wValue], a", "ld [n],a", 3, 4, 4},
+    {"ld hl, sp + 2", "ld hl,sp+n", 2, 3, 3},
+    {"ldh [$ff80], a", "ldh [n],a", 2, 3, 3},
+    {"ldh a, [c]", "ldh a,[c]", 1, 2, 2},
+    {"ld [$ff00+c], a", "ld [c],a", 1, 2, 2},
+    {"ld a, [$FF00 + c]", "ld a,[c]", 1, 2, 2},
+    {"ldh [c + $ff00], a", "ldh [c],a", 1, 2, 2},
+    {"ld [$ff01+c], a", "ld [n],a", 3, 4, 4},
+    {"add a, 1", "add n", 2, 2, 2},
+    {"xor a", "xor r", 1, 1, 1},
+    {"add hl, de", "add hl,rr", 1, 2, 2},
+    {"inc [hl]", "inc [hl]", 1, 3, 3},
+    {"bit 7, h", "bit n,r", 2, 2, 2},
+    {"jr nz, Label", "jr cc,n", 2, 2, 3},
+    {"call nc, Label", "call cc,n", 3, 3, 6},
+    {"ret z", "ret cc", 1, 2, 5},
+    {"push af", "push af", 1, 4, 4},
+    {"pop bc", "pop rr", 1, 3, 3},
+    {"push sp", NULL, 0, 0, 0},
+    {"pop sp", NULL, 0, 0, 0},
+    {"ld [hl], [hl]", NULL, 0, 0, 0},
+};
+
+// The first `instruction` node under `node`.
+static bool find_instruction(TSNode node, TSNode *out) {
+  if (strcmp(ts_node_type(node), "instruction") == 0) {
+    *out = node;
+    return true;
+  }
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    if (find_instruction(ts_node_named_child(node, i), out)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool check(TSParser *parser, const Case *test) {
+  char source[128];
+  snprintf(source, sizeof(source), "SECTION \"Test\", ROM0\n  %s\n",
+           test->line);
+  TSTree *tree =
+      ts_parser_parse_string(parser, NULL, source, (uint32_t)strlen(source));
+  TSNode instruction;
+  bool ok = find_instruction(ts_tree_root_node(tree), &instruction);
+  if (!ok) {
+    fprintf(stderr, "%s: no instruction\n", test->line);
+  } else {
+    const RgbasmSm83Form *form = rgbasm_sm83_lookup(instruction, source);
+    if (test->form == NULL) {
+      ok = form == NULL;
+      if (!ok) {
+        fprintf(stderr, "%s: expected no form, got %s\n", test->line,
+                form->form);
+      }
+    } else if (form == NULL) {
+      ok = false;
+      fprintf(stderr, "%s: expected %s, got no form\n", test->line,
+              test->form);
+    } else {
+      ok = strcmp(form->form, test->form) == 0 &&
+           form->bytes == test->bytes && form->cycles == test->cycles &&
+           form->taken_cycles == test->taken_cycles;
+      if (!ok) {
+        fprintf(stderr, "%s: expected %s %u/%u/%u, got %s %u/%u/%u\n",
+                test->line, test->form, test->bytes, test->cycles,
+                test->taken_cycles, form->form, form->bytes, form->cycles,
+                form->taken_cycles);
+      }
+    }
+  }
+  ts_tree_delete(tree);
+  return ok;
+}
+
+int main(void) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_rgbasm());
+  const size_t count = sizeof(cases) / sizeof(*cases);
+  size_t failed = 0;
+  for (size_t i = 0; i < count; i++) {
+    failed += check(parser, &cases[i]) ? 0 : 1;
+  }
+  ts_parser_delete(parser);
+  printf("sm83: %zu passed, %zu failed\n", count - failed, failed);
+  return failed == 0 ? 0 : 1;
+}
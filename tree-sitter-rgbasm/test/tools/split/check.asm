@@ -0,0 +1,36 @@
+; ARGS: --check -j 4 --min-chunk 1
+INCLUDE "hardware.inc"
+
+SECTION "Entry", ROM0[$100]
+Entry::
+	jp Main
+
+SECTION "Main", ROM0
+Main:
+	ld hl, Table
+.loop:
+	ld a, [hli]
+	and a
+	jr nz, .loop
+	ret
+
+MACRO far_call
+	ld a, BANK(\1)
+	ld [$2000], a
+	call \1
+ENDM
+
+IF DEF(DEBUG)
+SECTION "Debug", ROM0
+Debug:
+	ret
+ENDC
+
+SECTION "Table", ROMX, BANK[1]
+Table:
+	db 1, 2, 3, 0
+
+SECTION FRAGMENT "Code", ROM0
+Fragment:
+	ld a, [Table]
+	ret
@@ -0,0 +1,16 @@
+; ARGS: -j 4 --min-chunk 1
+DEF COUNT EQU 4
+
+SECTION "Main", ROM0
+Main:
+	ld a, COUNT
+	ret
+
+MACRO twice
+	nop
+	nop
+ENDM
+
+SECTION "Data", ROMX
+Table:
+	db 1, 2
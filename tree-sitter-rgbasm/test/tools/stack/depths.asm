@@ -0,0 +1,27 @@
+; ARGS: -v -l 8
+SECTION "Start", ROM0[$100]
+Start:
+	di
+	jp Main
+
+SECTION "VBlank", ROM0[$40]
+IntVBlank:
+	push af
+	call Update
+	pop af
+	reti
+
+SECTION "Code", ROM0
+Main:
+	ld sp, $e000
+	call Update
+.loop:
+	push bc
+	jr .loop
+
+Update:
+	push hl
+	push de
+	pop de
+	pop hl
+	ret
@@ -0,0 +1,393 @@
+// Ranks the calls and jumps from code in one ROMX bank to code in another,
+// which need a trampoline or bank switch, by how often they run.
+//
+// Targets are resolved like rgbasm-budget resolves them, by label name
+// across files. Sections without a BANK[] option are placed by the linker,
+// so a call between two such sections, or between one and a fixed bank, is
+// listed with `?` for the bank: it only works if they end up together. A call
+// site weighs as much as the loops around it in its routine repeat it, the
+// `; @loop N` bound of a loop or 10 without one, times how often its label
+// ran according to a profile, if one is given. Loops around the call of the
+// routine itself are not followed.
+
+#include "layout.h"
+#include "program.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The weight of a loop without a `; @loop N` bound.
+#define LOOP_WEIGHT 10
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-p profile] [-n count] [-v] "
+          "path...\n"
+          "\n"
+          "Prints `weight caller bank callee bank sites file:line` for every\n"
+          "routine calling or jumping to one in another ROMX bank, heaviest\n"
+          "first, then `total` with the count and weight of all. `?` is a\n"
+          "bank the linker picks. `file:line` is the heaviest call site.\n"
+          "\n"
+          "  -I dir      resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -p profile  weigh call sites by how often their label ran, from\n"
+          "              `label count` lines, e.g. of an emulator's profiler\n"
+          "  -n count    print the heaviest count edges only\n"
+          "  -v          also print `routine name bank weight` for every\n"
+          "              callee, the candidates for ROM0, heaviest first\n",
+          argv0);
+}
+
+// How often the code of each label ran, by name.
+typedef struct Profile {
+  RgbasmConstants index; // name -> count
+  bool loaded;
+} Profile;
+
+// Reads `label count` lines; `#` starts a comment.
+static bool profile_read(Profile *self, const char *path) {
+  rgbasm_constants_init(&self->index);
+  Source source;
+  if (!source_read(path, &source)) {
+    fprintf(stderr, "%s: cannot read the profile\n", path);
+    rgbasm_constants_free(&self->index);
+    return false;
+  }
+  self->loaded = true;
+  for (char *line = source.data; *line != '\0';) {
+    char *end = strchr(line, '\n');
+    if (end != NULL) {
+      *end = '\0';
+    }
+    char *comment = strchr(line, '#');
+    if (comment != NULL) {
+      *comment = '\0';
+    }
+    char *name = line + strspn(line, " \t\r");
+    const size_t length = strcspn(name, " \t\r");
+    if (length > 0) {
+      const long long count = strtoll(name + length, NULL, 0);
+      rgbasm_constants_set(&self->index, name, length,
+                           count > INT32_MAX ? INT32_MAX : (int32_t)count);
+    }
+    line = end != NULL ? end + 1 : line + strlen(line);
+  }
+  source_free(&source);
+  return true;
+}
+
+// The name of the global label `name` is part of, its length.
+static size_t global_length(const char *name) {
+  const char *dot = strchr(name, '.');
+  return dot != NULL && dot != name ? (size_t)(dot - name) : strlen(name);
+}
+
+// How often the code under `label` ran: its count, else that of its global
+// label, 0 if neither is listed. 1 without a profile.
+static double profile_count(const Profile *self,
+                            const RgbasmProgram *program, int32_t label) {
+  if (!self->loaded) {
+    return 1;
+  }
+  if (label < 0) {
+    return 0;
+  }
+  const char *name = program->labels[label].name;
+  int32_t count;
+  if (rgbasm_constants_get(&self->index, name, strlen(name), &count) ||
+      rgbasm_constants_get(&self->index, name, global_length(name), &count)) {
+    return count;
+  }
+  return 0;
+}
+
+// Per instruction, how often the loops of its section around it repeat it.
+// A loop is a jump back to an earlier instruction of the same section.
+static double *loop_weights(const RgbasmProgram *program) {
+  const size_t count = program->instruction_count;
+  double *weights = malloc((count + 1) * sizeof(double));
+  for (size_t i = 0; i <= count; i++) {
+    weights[i] = 1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const RgbasmInstruction *jump = &program->instructions[i];
+    const int32_t start = jump->target;
+    if ((jump->flow != RGBASM_FLOW_JUMP && jump->flow != RGBASM_FLOW_BRANCH) ||
+        start < 0 || (size_t)start > i ||
+        program->instructions[start].section != jump->section ||
+        program->instructions[start].file != jump->file) {
+      continue;
+    }
+    const double factor = !jump->has_loop_bound ? LOOP_WEIGHT
+                          : jump->loop_bound > 0 ? jump->loop_bound
+                                                 : 1;
+    // multiplied in at the start, divided out after the jump back
+    weights[start] *= factor;
+    weights[i + 1] /= factor;
+  }
+  for (size_t i = 1; i < count; i++) {
+    weights[i] *= weights[i - 1];
+  }
+  return weights;
+}
+
+// The section the target of `instruction` is in, -1 if it is not known.
+static int32_t target_section(const RgbasmProgram *program,
+                              const RgbasmInstruction *instruction,
+                              int32_t *label) {
+  *label = -1;
+  if (instruction->target_name != NULL) {
+    *label = rgbasm_program_label(program, instruction->target_name);
+    return *label >= 0 ? program->labels[*label].section : -1;
+  }
+  if (instruction->target < 0) {
+    return -1;
+  }
+  const RgbasmInstruction *target =
+      &program->instructions[instruction->target];
+  *label = target->label;
+  return target->section;
+}
+
+static bool is_romx(const RgbasmProgram *program, int32_t section) {
+  return section >= 0 &&
+         strcmp(program->sections[section].size->type, "ROMX") == 0;
+}
+
+// Whether code in `from` can reach code in `to` without a bank switch.
+static bool same_bank(const RgbasmProgram *program, int32_t from,
+                      int32_t to) {
+  const RgbasmSectionSize *caller = program->sections[from].size;
+  const RgbasmSectionSize *callee = program->sections[to].size;
+  if (caller->has_bank && callee->has_bank) {
+    return caller->bank == callee->bank;
+  }
+  // fragments of one section are placed together
+  return strcmp(caller->name, callee->name) == 0;
+}
+
+// The cross-bank calls from one routine to another.
+typedef struct Edge {
+  size_t caller_length; // of the global label's name
+  const char *caller;
+  const char *callee;
+  int32_t caller_section;
+  int32_t callee_section;
+  uint32_t sites;
+  double weight;
+  int32_t site;        // the heaviest
+  double site_weight;
+} Edge;
+
+typedef struct Edges {
+  Edge *items;
+  size_t count;
+  size_t capacity;
+  RgbasmConstants index; // "caller\ncallee" -> item
+} Edges;
+
+static void edges_add(Edges *self, const char *caller, size_t caller_length,
+                      const char *callee, int32_t caller_section,
+                      int32_t callee_section, int32_t site, double weight) {
+  const size_t callee_length = strlen(callee);
+  char *key = malloc(caller_length + callee_length + 2);
+  memcpy(key, caller, caller_length);
+  key[caller_length] = '\n';
+  memcpy(key + caller_length + 1, callee, callee_length + 1);
+  const size_t key_length = caller_length + callee_length + 1;
+  int32_t found;
+  if (!rgbasm_constants_get(&self->index, key, key_length, &found)) {
+    if (self->count == self->capacity) {
+      self->capacity = self->capacity ? self->capacity * 2 : 64;
+      self->items = realloc(self->items, self->capacity * sizeof(Edge));
+    }
+    found = (int32_t)self->count++;
+    self->items[found] = (Edge){
+        .caller = caller,
+        .caller_length = caller_length,
+        .callee = callee,
+        .caller_section = caller_section,
+        .callee_section = callee_section,
+        .site = site,
+        .site_weight = weight,
+    };
+    rgbasm_constants_set(&self->index, key, key_length, found);
+  }
+  free(key);
+  Edge *edge = &self->items[found];
+  edge->sites++;
+  edge->weight += weight;
+  if (weight > edge->site_weight) {
+    edge->site = site;
+    edge->site_weight = weight;
+  }
+}
+
+static int compare_edges(const void *a, const void *b) {
+  const double left = ((const Edge *)a)->weight;
+  const double right = ((const Edge *)b)->weight;
+  return (left < right) - (left > right);
+}
+
+static void print_bank(const RgbasmProgram *program, int32_t section) {
+  const RgbasmSectionSize *size = program->sections[section].size;
+  if (size->has_bank) {
+    printf("\t%d", size->bank);
+  } else {
+    printf("\t?");
+  }
+}
+
+// A callee with the weight of all cross-bank calls to it.
+typedef struct Routine {
+  const char *name;
+  int32_t section;
+  double weight;
+} Routine;
+
+static int compare_routines(const void *a, const void *b) {
+  const double left = ((const Routine *)a)->weight;
+  const double right = ((const Routine *)b)->weight;
+  return (left < right) - (left > right);
+}
+
+static void print_routines(const RgbasmProgram *program,
+                           const Edges *edges) {
+  Routine *routines = malloc((edges->count + 1) * sizeof(Routine));
+  size_t count = 0;
+  RgbasmConstants index;
+  rgbasm_constants_init(&index);
+  for (size_t i = 0; i < edges->count; i++) {
+    const Edge *edge = &edges->items[i];
+    int32_t found;
+    if (!rgbasm_constants_get(&index, edge->callee, strlen(edge->callee),
+                              &found)) {
+      found = (int32_t)count++;
+      routines[found] = (Routine){edge->callee, edge->callee_section, 0};
+      rgbasm_constants_set(&index, edge->callee, strlen(edge->callee),
+                           found);
+    }
+    routines[found].weight += edge->weight;
+  }
+  qsort(routines, count, sizeof(Routine), compare_routines);
+  for (size_t i = 0; i < count; i++) {
+    printf("routine\t%s", routines[i].name);
+    print_bank(program, routines[i].section);
+    printf("\t%.0f\n", routines[i].weight);
+  }
+  rgbasm_constants_free(&index);
+  free(routines);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  bool verbose = false;
+  size_t limit = SIZE_MAX;
+  const char *profile_path = NULL;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      profile_path = argv[++i];
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      limit = (size_t)strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  Profile profile = {0};
+  if (profile_path != NULL && !profile_read(&profile, profile_path)) {
+    return 2;
+  }
+
+  const RgbasmLayoutOptions options = {
+      .include_dirs = include_dirs,
+      .include_dir_count = include_dir_count,
+  };
+  RgbasmProgram program;
+  const bool ok = rgbasm_program_build(
+      &program, (const char *const *)paths.items, paths.count, threads,
+      &options);
+  double *weights = loop_weights(&program);
+
+  Edges edges = {0};
+  rgbasm_constants_init(&edges.index);
+  for (size_t i = 0; i < program.instruction_count; i++) {
+    const RgbasmInstruction *instruction = &program.instructions[i];
+    if (instruction->flow != RGBASM_FLOW_CALL &&
+        instruction->flow != RGBASM_FLOW_CALL_COND &&
+        instruction->flow != RGBASM_FLOW_JUMP &&
+        instruction->flow != RGBASM_FLOW_BRANCH) {
+      continue;
+    }
+    int32_t callee;
+    const int32_t section = target_section(&program, instruction, &callee);
+    if (!is_romx(&program, instruction->section) ||
+        !is_romx(&program, section) ||
+        same_bank(&program, instruction->section, section)) {
+      continue;
+    }
+    const char *caller = instruction->label >= 0
+                             ? program.labels[instruction->label].name
+                             : "?";
+    const double weight =
+        weights[i] * instruction->repeat *
+        profile_count(&profile, &program, instruction->label);
+    edges_add(&edges, caller, global_length(caller),
+              callee >= 0 ? program.labels[callee].name : "?",
+              instruction->section, section, (int32_t)i, weight);
+  }
+  qsort(edges.items, edges.count, sizeof(Edge), compare_edges);
+
+  double total = 0;
+  for (size_t i = 0; i < edges.count; i++) {
+    const Edge *edge = &edges.items[i];
+    total += edge->weight;
+    if (i >= limit) {
+      continue;
+    }
+    printf("%.0f\t%.*s", edge->weight, (int)edge->caller_length,
+           edge->caller);
+    print_bank(&program, edge->caller_section);
+    printf("\t%s", edge->callee);
+    print_bank(&program, edge->callee_section);
+    const RgbasmInstruction *site = &program.instructions[edge->site];
+    printf("\t%u\t%s:%u\n", edge->sites, program.paths[site->file],
+           site->point.row + 1);
+  }
+  printf("total\t%zu\t%.0f\n", edges.count, total);
+  if (verbose) {
+    print_routines(&program, &edges);
+  }
+
+  free(edges.items);
+  rgbasm_constants_free(&edges.index);
+  free(weights);
+  if (profile.loaded) {
+    rgbasm_constants_free(&profile.index);
+  }
+  rgbasm_program_free(&program);
+  path_list_free(&paths);
+  free(include_dirs);
+  return ok ? 0 : 1;
+}
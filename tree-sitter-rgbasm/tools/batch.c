@@ -0,0 +1,81 @@
+#include "batch.h"
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+typedef struct Batch {
+  const char *const *paths;
+  TSParser **parsers; // one per worker, created on first use
+  RgbasmBatchVisit visit;
+  void *context;
+  pthread_mutex_t lock; // guards `failed`
+  bool failed;
+} Batch;
+
+static void run(RgbasmPool *pool, unsigned worker, void *task,
+                void *context) {
+  (void)pool;
+  Batch *batch = context;
+  // tasks are file indices + 1, the pool takes no NULL tasks
+  const size_t index = (size_t)(uintptr_t)task - 1;
+  Source source;
+  if (!source_read(batch->paths[index], &source)) {
+    fprintf(stderr, "%s: could not read file\n", batch->paths[index]);
+    pthread_mutex_lock(&batch->lock);
+    batch->failed = true;
+    pthread_mutex_unlock(&batch->lock);
+    return;
+  }
+  if (batch->parsers[worker] == NULL) {
+    batch->parsers[worker] = ts_parser_new();
+    ts_parser_set_language(batch->parsers[worker], tree_sitter_rgbasm());
+  }
+  TSParser *parser = batch->parsers[worker];
+  TSTree *tree =
+      ts_parser_parse_string(parser, NULL, source.data, source.length);
+  if (tree != NULL) {
+    batch->visit(parser, index, &source, tree, batch->context);
+    ts_tree_delete(tree);
+  }
+  source_free(&source);
+}
+
+bool rgbasm_batch_parse(const char *const *paths, size_t count,
+                        unsigned threads, RgbasmBatchVisit visit,
+                        void *context) {
+  if (threads == 0) {
+    threads = rgbasm_pool_default_threads();
+  }
+  Batch batch = {
+      .paths = paths,
+      .parsers = calloc(threads, sizeof(TSParser *)),
+      .visit = visit,
+      .context = context,
+  };
+  pthread_mutex_init(&batch.lock, NULL);
+  RgbasmPool *pool = rgbasm_pool_new(threads, run, &batch);
+  if (pool == NULL) {
+    pthread_mutex_destroy(&batch.lock);
+    free(batch.parsers);
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    rgbasm_pool_submit(pool, RGBASM_POOL_ANY_WORKER,
+                       (void *)(uintptr_t)(i + 1));
+  }
+  rgbasm_pool_wait(pool);
+  rgbasm_pool_delete(pool);
+  for (unsigned i = 0; i < threads; i++) {
+    if (batch.parsers[i] != NULL) {
+      ts_parser_delete(batch.parsers[i]);
+    }
+  }
+  free(batch.parsers);
+  pthread_mutex_destroy(&batch.lock);
+  return !batch.failed;
+}
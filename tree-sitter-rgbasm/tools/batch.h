@@ -0,0 +1,27 @@
+#ifndef RGBASM_TOOLS_BATCH_H_
+#define RGBASM_TOOLS_BATCH_H_
+
+#include "util.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <tree_sitter/api.h>
+
+// Parses a list of files on the work-stealing pool, one parser per worker,
+// and hands every tree to a callback on the worker that parsed it. The
+// analyses of the command line tools run this way, each file on its own.
+
+// Called once per file that could be read. `index` is the position of the
+// file in the list; calls for different files may overlap. `parser` may be
+// used for further files, e.g. INCLUDEd ones, during the call.
+typedef void (*RgbasmBatchVisit)(TSParser *parser, size_t index,
+                                 const Source *source, TSTree *tree,
+                                 void *context);
+
+// Returns false if a file could not be read; the others are visited
+// nevertheless. `threads` of 0 uses one per core.
+bool rgbasm_batch_parse(const char *const *paths, size_t count,
+                        unsigned threads, RgbasmBatchVisit visit,
+                        void *context);
+
+#endif // RGBASM_TOOLS_BATCH_H_
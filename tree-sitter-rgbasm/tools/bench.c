@@ -0,0 +1,177 @@
+// Parse benchmark for the rgbasm grammar.
+//
+// Parses every file of the benchmark corpus (or the given files and
+// directories) a number of times and reports the parse throughput. It is also
+// the training workload of the profile-guided build, see cmake/pgo.cmake.
+//
+// With --identifier it also parses the text of every `identifier` node with
+// the rgbasm_identifier grammar, the injection done by queries/injections.scm.
+// bench/wasm.mjs runs the same workloads with the WASM builds.
+
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-rgbasm-identifier.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+#ifndef RGBASM_BENCH_CORPUS
+#define RGBASM_BENCH_CORPUS "bench/corpus"
+#endif
+
+typedef struct Timing {
+  double best;
+  double mean;
+  size_t errors; // inputs with errors in the first iteration
+} Timing;
+
+static Timing measure(const TSLanguage *language, const SpanList *inputs,
+                      int iterations) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+  Timing timing = {0};
+  double total = 0;
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    const double start = now_seconds();
+    for (size_t i = 0; i < inputs->count; i++) {
+      const Span *input = &inputs->items[i];
+      TSTree *tree =
+          ts_parser_parse_string(parser, NULL, input->data, input->length);
+      if (iteration == 0 && ts_node_has_error(ts_tree_root_node(tree))) {
+        timing.errors += 1;
+      }
+      ts_tree_delete(tree);
+    }
+    const double elapsed = now_seconds() - start;
+    total += elapsed;
+    if (iteration == 0 || elapsed < timing.best) {
+      timing.best = elapsed;
+    }
+  }
+  timing.mean = total / iterations;
+  ts_parser_delete(parser);
+  return timing;
+}
+
+// Collects the text of all `identifier` nodes, the injection workload.
+static void collect_identifiers(const Span *source, SpanList *identifiers) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_rgbasm());
+  TSTree *tree =
+      ts_parser_parse_string(parser, NULL, source->data, source->length);
+  span_list_collect_nodes(identifiers, source->data, ts_tree_root_node(tree),
+                          "identifier");
+  ts_tree_delete(tree);
+  ts_parser_delete(parser);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-n iterations] [--identifier] [--json] [path...]\n"
+          "\n"
+          "Parses the given files and directories (default: %s)\n"
+          "and reports the parse throughput. --identifier also measures the\n"
+          "identifier injections.\n",
+          argv0, RGBASM_BENCH_CORPUS);
+}
+
+int main(int argc, char **argv) {
+  int iterations = 5;
+  bool json = false;
+  bool identifier = false;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "--identifier") == 0) {
+      identifier = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    path_list_collect(&paths, RGBASM_BENCH_CORPUS);
+  }
+  if (paths.count == 0 || iterations < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Source *sources = calloc(paths.count, sizeof(Source));
+  size_t count = 0;
+  uint64_t bytes = 0;
+  for (size_t i = 0; i < paths.count; i++) {
+    if (source_read(paths.items[i], &sources[count])) {
+      bytes += sources[count].length;
+      count += 1;
+    } else {
+      fprintf(stderr, "%s: could not read file\n", paths.items[i]);
+    }
+  }
+
+  SpanList files = {0};
+  SpanList identifiers = {0};
+  for (size_t i = 0; i < count; i++) {
+    span_list_push(&files, sources[i].data, sources[i].length);
+    if (identifier) {
+      collect_identifiers(&files.items[i], &identifiers);
+    }
+  }
+
+  const Timing timing = measure(tree_sitter_rgbasm(), &files, iterations);
+  Timing identifier_timing = {0};
+  if (identifier) {
+    identifier_timing =
+        measure(tree_sitter_rgbasm_identifier(), &identifiers, iterations);
+  }
+
+  const double mib = (double)bytes / (1024.0 * 1024.0);
+  if (json) {
+    printf("{\"files\":%zu,\"bytes\":%llu,\"iterations\":%d,"
+           "\"best_ms\":%.3f,\"mean_ms\":%.3f,\"mib_per_s\":%.3f,"
+           "\"files_with_errors\":%zu",
+           count, (unsigned long long)bytes, iterations, timing.best * 1e3,
+           timing.mean * 1e3, mib / timing.best, timing.errors);
+    if (identifier) {
+      printf(",\"identifier\":{\"count\":%zu,\"bytes\":%llu,"
+             "\"best_ms\":%.3f,\"mean_ms\":%.3f,\"with_errors\":%zu}",
+             identifiers.count, (unsigned long long)identifiers.bytes,
+             identifier_timing.best * 1e3, identifier_timing.mean * 1e3,
+             identifier_timing.errors);
+    }
+    printf("}\n");
+  } else {
+    printf("files:       %zu (%zu with errors)\n", count, timing.errors);
+    printf("bytes:       %llu\n", (unsigned long long)bytes);
+    printf("iterations:  %d\n", iterations);
+    printf("best:        %.3f ms\n", timing.best * 1e3);
+    printf("mean:        %.3f ms\n", timing.mean * 1e3);
+    printf("throughput:  %.2f MiB/s\n", mib / timing.best);
+    if (identifier) {
+      printf("identifiers: %zu (%zu with errors)\n", identifiers.count,
+             identifier_timing.errors);
+      printf("  best:      %.3f ms\n", identifier_timing.best * 1e3);
+      printf("  mean:      %.3f ms\n", identifier_timing.mean * 1e3);
+    }
+  }
+
+  span_list_free(&files);
+  span_list_free(&identifiers);
+  for (size_t i = 0; i < count; i++) {
+    source_free(&sources[i]);
+  }
+  free(sources);
+  path_list_free(&paths);
+  return 0;
+}
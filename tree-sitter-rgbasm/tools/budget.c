@@ -0,0 +1,154 @@
+// Reports the worst-case cycle count of every interrupt handler of a project
+// and flags those that do not fit a budget, by default the VBlank period.
+//
+// A handler starts at its interrupt vector, the instruction a ROM0 section
+// with a fixed address places at $40, $48, $50, $58 or $60, and follows
+// jumps, branches, calls and returns from there. REPT blocks with a constant
+// count multiply what they contain, loops need a `; @loop N` comment on the
+// line of the jump back to their start.
+
+#include "cycles.h"
+#include "layout.h"
+#include "program.h"
+#include "report.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 4560 dots of VBlank, 4 dots per M-cycle
+#define VBLANK_CYCLES 1140
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-e label]... [-l cycles] [-v] "
+          "path...\n"
+          "\n"
+          "Prints `handler file:line M-cycles T-cycles ok|over` for every\n"
+          "interrupt vector with code and every -e label. Counts that are\n"
+          "not exact are lower bounds, e.g. `>=312`, followed by the first\n"
+          "reason: a loop without a `; @loop N` bound on its jump back, an\n"
+          "indirect or unresolved jump, recursion or an unknown REPT count.\n"
+          "Macro invocations are not expanded and count nothing.\n"
+          "\n"
+          "  -I dir     resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -e label   also analyze the code starting at label\n"
+          "  -l cycles  the budget in M-cycles, default %d (VBlank)\n"
+          "  -v         also print `function name file:line M-cycles` for\n"
+          "             every routine the handlers call, most expensive "
+          "first\n"
+          "\n"
+          "Exits with 1 if a handler is over the budget.\n",
+          argv0, VBLANK_CYCLES);
+}
+
+static bool print_handler(const RgbasmProgram *program, const char *name,
+                          int32_t entry, const RgbasmCost *cost,
+                          uint64_t limit) {
+  const bool over = cost->cycles > limit;
+  printf("%s\t", name);
+  rgbasm_report_location(program, entry);
+  printf("\t%s%llu\t%llu\t%s", cost->exact ? "" : ">=",
+         (unsigned long long)cost->cycles,
+         (unsigned long long)cost->cycles * 4, over ? "over" : "ok");
+  rgbasm_report_reason(program, cost->exact, cost->reason, cost->problem);
+  printf("\n");
+  return over;
+}
+
+static void print_routines(const RgbasmCycles *analysis) {
+  const RgbasmProgram *program = analysis->program;
+  RgbasmRanked *ranked =
+      malloc((program->instruction_count + 1) * sizeof(RgbasmRanked));
+  size_t count = 0;
+  for (size_t i = 0; i < program->instruction_count; i++) {
+    if (analysis->routines.state[i] == RGBASM_ROUTINE_DONE) {
+      const RgbasmCost *cost = &analysis->costs[i];
+      ranked[count++] =
+          (RgbasmRanked){(int32_t)i, (int64_t)cost->cycles, cost->exact};
+    }
+  }
+  rgbasm_report_routines(program, ranked, count);
+  free(ranked);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  bool verbose = false;
+  uint64_t limit = VBLANK_CYCLES;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  const char **entries = calloc((size_t)argc, sizeof(char *));
+  size_t entry_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      entries[entry_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      limit = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const RgbasmLayoutOptions options = {
+      .include_dirs = include_dirs,
+      .include_dir_count = include_dir_count,
+  };
+  RgbasmProgram program;
+  bool ok = rgbasm_program_build(&program, (const char *const *)paths.items,
+                                 paths.count, threads, &options);
+  RgbasmCycles analysis;
+  rgbasm_cycles_init(&analysis, &program, false);
+
+  bool over = false;
+  for (size_t i = 0; i < RGBASM_VECTOR_COUNT; i++) {
+    const int32_t entry =
+        rgbasm_report_rom0_at(&program, rgbasm_vectors[i].address);
+    if (entry < 0) {
+      continue;
+    }
+    const RgbasmCost cost = rgbasm_cycles_routine(&analysis, entry);
+    over |=
+        print_handler(&program, rgbasm_vectors[i].name, entry, &cost, limit);
+  }
+  for (size_t i = 0; i < entry_count; i++) {
+    const int32_t label = rgbasm_program_label(&program, entries[i]);
+    const int32_t entry = label >= 0 ? program.labels[label].instruction : -1;
+    if (entry < 0) {
+      fprintf(stderr, "%s: no code at this label\n", entries[i]);
+      ok = false;
+      continue;
+    }
+    const RgbasmCost cost = rgbasm_cycles_routine(&analysis, entry);
+    over |= print_handler(&program, entries[i], entry, &cost, limit);
+  }
+  if (verbose) {
+    print_routines(&analysis);
+  }
+
+  rgbasm_cycles_free(&analysis);
+  rgbasm_program_free(&program);
+  path_list_free(&paths);
+  free(include_dirs);
+  free(entries);
+  return ok && !over ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include "cfg.h"
+
+#include <stdlib.h>
+
+// The graph being built, with the state of the depth-first walk.
+typedef struct Build {
+  RgbasmCfgBuilder *builder;
+  RgbasmCfg *out;
+  size_t node_capacity;
+  size_t edge_capacity;
+  uint32_t *next_edge; // per node, the edge to follow next
+  bool *on_stack;      // per node
+} Build;
+
+static void problem(RgbasmCfg *cfg, int32_t instruction, const char *reason) {
+  if (cfg->problem < 0) {
+    cfg->problem = instruction;
+    cfg->reason = reason;
+  }
+}
+
+static void add_edge(Build *build, int32_t instruction, int32_t callee,
+                     bool taken) {
+  RgbasmCfg *out = build->out;
+  if (out->edge_count == build->edge_capacity) {
+    build->edge_capacity =
+        build->edge_capacity ? build->edge_capacity * 2 : 64;
+    out->edges =
+        realloc(out->edges, build->edge_capacity * sizeof(*out->edges));
+  }
+  out->edges[out->edge_count++] = (RgbasmCfgEdge){
+      .instruction = instruction,
+      .to = -1,
+      .callee = callee,
+      .delayed = -1,
+      .taken = taken,
+  };
+}
+
+// Adds the node of `instruction` with its edges, the successors unvisited.
+static int32_t add_node(Build *build, int32_t instruction) {
+  RgbasmCfg *out = build->out;
+  if (out->node_count == build->node_capacity) {
+    build->node_capacity =
+        build->node_capacity ? build->node_capacity * 2 : 64;
+    out->nodes =
+        realloc(out->nodes, build->node_capacity * sizeof(*out->nodes));
+    build->next_edge =
+        realloc(build->next_edge, build->node_capacity * sizeof(uint32_t));
+    build->on_stack =
+        realloc(build->on_stack, build->node_capacity * sizeof(bool));
+  }
+  const int32_t index = (int32_t)out->node_count++;
+  build->builder->local[instruction] = index;
+  build->builder->stamp[instruction] = build->builder->build;
+  build->next_edge[index] = 0;
+  build->on_stack[index] = true;
+  out->nodes[index] = (RgbasmCfgNode){
+      .instruction = instruction,
+      .first_edge = (uint32_t)out->edge_count,
+  };
+
+  const RgbasmInstruction *self =
+      &build->builder->program->instructions[instruction];
+  if (self->form == NULL) {
+    problem(out, instruction, "unknown instruction");
+  }
+  if (build->builder->until_enabled &&
+      self->interrupts == RGBASM_INTERRUPTS_ENABLE) {
+    add_edge(build, -1, -1, false);
+    if (self->flow != RGBASM_FLOW_RETURN) {
+      out->edges[out->edge_count - 1].delayed = self->next;
+    }
+    out->nodes[index].edge_count = 1;
+    return index;
+  }
+  const bool continues = self->flow != RGBASM_FLOW_JUMP &&
+                         self->flow != RGBASM_FLOW_RETURN &&
+                         self->flow != RGBASM_FLOW_INDIRECT;
+  if (continues && self->next < 0) {
+    problem(out, instruction, "code running past the end of its section");
+  }
+  const bool jumps = self->flow == RGBASM_FLOW_JUMP ||
+                     self->flow == RGBASM_FLOW_BRANCH ||
+                     self->flow == RGBASM_FLOW_CALL ||
+                     self->flow == RGBASM_FLOW_CALL_COND;
+  if (jumps && self->target < 0) {
+    problem(out, instruction, "unresolved jump or call target");
+  }
+
+  switch (self->flow) {
+  case RGBASM_FLOW_NEXT:
+    add_edge(build, self->next, -1, false);
+    break;
+  case RGBASM_FLOW_JUMP:
+    add_edge(build, self->target, -1, false);
+    break;
+  case RGBASM_FLOW_BRANCH:
+    add_edge(build, self->next, -1, false);
+    add_edge(build, self->target, -1, true);
+    break;
+  case RGBASM_FLOW_CALL:
+    add_edge(build, self->next, self->target, false);
+    break;
+  case RGBASM_FLOW_CALL_COND:
+    add_edge(build, self->next, -1, false);
+    add_edge(build, self->next, self->target, true);
+    break;
+  case RGBASM_FLOW_RETURN:
+    add_edge(build, -1, -1, false);
+    break;
+  case RGBASM_FLOW_RETURN_COND:
+    add_edge(build, self->next, -1, false);
+    add_edge(build, -1, -1, true);
+    break;
+  case RGBASM_FLOW_INDIRECT:
+    problem(out, instruction, "indirect jump");
+    add_edge(build, -1, -1, false);
+    break;
+  }
+  out->nodes[index].edge_count =
+      (uint32_t)out->edge_count - out->nodes[index].first_edge;
+  return index;
+}
+
+void rgbasm_cfg_builder_init(RgbasmCfgBuilder *self,
+                             const RgbasmProgram *program) {
+  *self = (RgbasmCfgBuilder){
+      .program = program,
+      .local = calloc(program->instruction_count + 1, sizeof(int32_t)),
+      .stamp = calloc(program->instruction_count + 1, sizeof(uint32_t)),
+  };
+}
+
+void rgbasm_cfg_builder_free(RgbasmCfgBuilder *self) {
+  free(self->local);
+  free(self->stamp);
+  *self = (RgbasmCfgBuilder){0};
+}
+
+void rgbasm_cfg_build(RgbasmCfgBuilder *builder, int32_t entry,
+                      RgbasmCfg *out) {
+  *out = (RgbasmCfg){.problem = -1};
+  Build build = {.builder = builder, .out = out};
+  builder->build++;
+  add_node(&build, entry);
+
+  size_t stack_capacity = 64;
+  uint32_t *stack = malloc(stack_capacity * sizeof(uint32_t));
+  size_t depth = 0;
+  size_t order_count = 0;
+  size_t order_capacity = build.node_capacity;
+  out->order = malloc(order_capacity * sizeof(uint32_t));
+  stack[depth++] = 0;
+  while (depth > 0) {
+    const uint32_t from = stack[depth - 1];
+    const RgbasmCfgNode *node = &out->nodes[from];
+    if (build.next_edge[from] == node->edge_count) {
+      build.on_stack[from] = false;
+      out->nodes[from].post = (uint32_t)order_count;
+      out->order[order_count++] = from;
+      depth--;
+      continue;
+    }
+    const uint32_t edge = node->first_edge + build.next_edge[from]++;
+    const int32_t instruction = out->edges[edge].instruction;
+    if (instruction < 0) {
+      continue;
+    }
+    if (builder->stamp[instruction] == builder->build) {
+      const int32_t to = builder->local[instruction];
+      out->edges[edge].to = to;
+      out->edges[edge].back = build.on_stack[to];
+      continue;
+    }
+    const int32_t to = add_node(&build, instruction);
+    out->edges[edge].to = to;
+    if (order_capacity < build.node_capacity) {
+      order_capacity = build.node_capacity;
+      out->order = realloc(out->order, order_capacity * sizeof(uint32_t));
+    }
+    if (depth == stack_capacity) {
+      stack_capacity *= 2;
+      stack = realloc(stack, stack_capacity * sizeof(uint32_t));
+    }
+    stack[depth++] = (uint32_t)to;
+  }
+  free(stack);
+  free(build.next_edge);
+  free(build.on_stack);
+}
+
+void rgbasm_cfg_free(RgbasmCfg *self) {
+  free(self->nodes);
+  free(self->edges);
+  free(self->order);
+  *self = (RgbasmCfg){0};
+}
+
+void rgbasm_routines_init(RgbasmRoutines *self, const RgbasmProgram *program) {
+  self->state = calloc(program->instruction_count + 1, sizeof(uint8_t));
+  rgbasm_cfg_builder_init(&self->builder, program);
+}
+
+void rgbasm_routines_free(RgbasmRoutines *self) {
+  rgbasm_cfg_builder_free(&self->builder);
+  free(self->state);
+  self->state = NULL;
+}
+
+RgbasmRoutineState rgbasm_routines_begin(RgbasmRoutines *self, int32_t entry,
+                                         RgbasmCfg *cfg) {
+  const RgbasmRoutineState state = (RgbasmRoutineState)self->state[entry];
+  if (state == RGBASM_ROUTINE_UNSEEN) {
+    self->state[entry] = RGBASM_ROUTINE_RUNNING;
+    rgbasm_cfg_build(&self->builder, entry, cfg);
+  }
+  return state;
+}
+
+void rgbasm_routines_end(RgbasmRoutines *self, int32_t entry, RgbasmCfg *cfg) {
+  rgbasm_cfg_free(cfg);
+  self->state[entry] = RGBASM_ROUTINE_DONE;
+}
@@ -0,0 +1,98 @@
+#ifndef RGBASM_TOOLS_CFG_H_
+#define RGBASM_TOOLS_CFG_H_
+
+#include "program.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Control-flow graphs of the routines of a program.
+//
+// A routine is what runs from an entry instruction until it returns: the
+// instructions reached by falling through, jumps and branches. A call is an
+// edge to the instruction after it that names the routine called on the way,
+// so the analyses compute every routine once and combine them along the
+// calls. Returns, and jumps whose target is not known, leave the routine.
+
+typedef struct RgbasmCfgEdge {
+  int32_t instruction; // the successor, -1 for leaving the routine
+  int32_t to;          // its node, -1 for leaving
+  int32_t callee;      // the routine called on the way, -1 if none
+  int32_t delayed;     // runs before leaving: the one after an `ei`, or -1
+  bool taken;          // the condition of the instruction is true
+  bool back;           // to a node on the depth-first path: closes a loop
+} RgbasmCfgEdge;
+
+typedef struct RgbasmCfgNode {
+  int32_t instruction;
+  uint32_t first_edge;
+  uint32_t edge_count;
+  uint32_t post; // its position in the postorder
+} RgbasmCfgNode;
+
+typedef struct RgbasmCfg {
+  RgbasmCfgNode *nodes; // the entry first
+  size_t node_count;
+  RgbasmCfgEdge *edges;
+  size_t edge_count;
+  // The nodes in depth-first postorder: every node comes after the
+  // successors it has along edges that are not back edges. An inner loop's
+  // first node comes before the first node of the loop around it.
+  uint32_t *order;
+  // The first instruction the flow from which is not fully known, -1 if
+  // none: an unknown instruction, an indirect jump, an unresolved target or
+  // code running past the end of its section.
+  int32_t problem;
+  const char *reason;
+} RgbasmCfg;
+
+// Scratch space for the graphs of one program, for one thread.
+typedef struct RgbasmCfgBuilder {
+  const RgbasmProgram *program;
+  int32_t *local;  // per instruction, its node in the graph being built
+  uint32_t *stamp; // per instruction, the build `local` is valid for
+  uint32_t build;
+  // End routines where interrupts are enabled, for the code that runs with
+  // them disabled: `reti` leaves after itself, `ei` after the instruction
+  // that follows it, which still runs with interrupts disabled. That one is
+  // the `delayed` of the edge leaving, not a node of the graph.
+  bool until_enabled;
+} RgbasmCfgBuilder;
+
+void rgbasm_cfg_builder_init(RgbasmCfgBuilder *self,
+                             const RgbasmProgram *program);
+void rgbasm_cfg_builder_free(RgbasmCfgBuilder *self);
+
+// The graph of the routine starting at the instruction `entry`.
+void rgbasm_cfg_build(RgbasmCfgBuilder *builder, int32_t entry,
+                      RgbasmCfg *out);
+void rgbasm_cfg_free(RgbasmCfg *self);
+
+typedef enum RgbasmRoutineState {
+  RGBASM_ROUTINE_UNSEEN,
+  RGBASM_ROUTINE_RUNNING, // on the way to it: calling it again recurses
+  RGBASM_ROUTINE_DONE,
+} RgbasmRoutineState;
+
+// The routines an analysis has computed, for those that compute every
+// routine once and combine them along the calls. The analysis keeps its
+// results per instruction next to it.
+typedef struct RgbasmRoutines {
+  RgbasmCfgBuilder builder;
+  uint8_t *state; // per instruction, a RgbasmRoutineState
+} RgbasmRoutines;
+
+void rgbasm_routines_init(RgbasmRoutines *self, const RgbasmProgram *program);
+void rgbasm_routines_free(RgbasmRoutines *self);
+
+// Returns the state of the routine starting at `entry`. An unseen one is
+// running from then on and its graph is built into `cfg`; for the others the
+// analysis returns its result or what it assumes for recursion.
+RgbasmRoutineState rgbasm_routines_begin(RgbasmRoutines *self, int32_t entry,
+                                         RgbasmCfg *cfg);
+// Marks the routine starting at `entry` done and frees its graph, once its
+// result is stored.
+void rgbasm_routines_end(RgbasmRoutines *self, int32_t entry, RgbasmCfg *cfg);
+
+#endif // RGBASM_TOOLS_CFG_H_
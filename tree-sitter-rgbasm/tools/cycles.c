@@ -0,0 +1,187 @@
+#include "cycles.h"
+
+#include <stdlib.h>
+
+static void problem(RgbasmCost *cost, int32_t instruction,
+                    const char *reason) {
+  if (cost->exact) {
+    cost->exact = false;
+    cost->problem = instruction;
+    cost->reason = reason;
+  }
+}
+
+static void merge(RgbasmCost *cost, const RgbasmCost *callee) {
+  if (!callee->exact) {
+    problem(cost, callee->problem, callee->reason);
+  }
+}
+
+typedef struct Loop {
+  uint32_t header; // the postorder position of the node the edge goes to
+  uint32_t tail;   // the node it leaves
+  uint32_t edge;
+} Loop;
+
+static int compare_loops(const void *a, const void *b) {
+  const uint32_t left = ((const Loop *)a)->header;
+  const uint32_t right = ((const Loop *)b)->header;
+  return (left > right) - (left < right);
+}
+
+// Adds the repetitions of every bounded loop to `extra` of the node it starts
+// at. Inner loops go first, so an outer loop counts them with their
+// repetitions.
+static void repeat_loops(const RgbasmCycles *self, const RgbasmCfg *cfg,
+                         const uint64_t *cycles, uint64_t *extra,
+                         RgbasmCost *cost) {
+  const size_t count = cfg->node_count;
+  Loop *loops = malloc((cfg->edge_count + 1) * sizeof(Loop));
+  size_t loop_count = 0;
+  for (uint32_t v = 0; v < count; v++) {
+    const RgbasmCfgNode *node = &cfg->nodes[v];
+    for (uint32_t j = 0; j < node->edge_count; j++) {
+      const uint32_t e = node->first_edge + j;
+      if (cfg->edges[e].back) {
+        loops[loop_count++] = (Loop){
+            .header = cfg->nodes[cfg->edges[e].to].post, .tail = v, .edge = e};
+      }
+    }
+  }
+  qsort(loops, loop_count, sizeof(Loop), compare_loops);
+
+  int64_t *longest = malloc((count + 1) * sizeof(int64_t));
+  for (size_t k = 0; k < loop_count; k++) {
+    const uint32_t header = cfg->order[loops[k].header];
+    const uint32_t tail = loops[k].tail;
+    const int32_t jump = cfg->nodes[tail].instruction;
+    const RgbasmInstruction *instruction = &self->program->instructions[jump];
+    if (!instruction->has_loop_bound) {
+      problem(cost, jump, "loop without a `; @loop N` bound");
+      continue;
+    }
+    // the longest way from the header to the tail, without the header's own
+    // repetitions
+    for (size_t i = 0; i < count; i++) {
+      const uint32_t v = cfg->order[i];
+      const RgbasmCfgNode *node = &cfg->nodes[v];
+      const int64_t own = v == header ? 0 : (int64_t)extra[v];
+      longest[v] = v == tail ? own : -1;
+      for (uint32_t j = 0; j < node->edge_count && v != tail; j++) {
+        const uint32_t e = node->first_edge + j;
+        const RgbasmCfgEdge *edge = &cfg->edges[e];
+        if (edge->back || edge->to < 0 || longest[edge->to] < 0) {
+          continue;
+        }
+        const int64_t length = own + (int64_t)cycles[e] + longest[edge->to];
+        longest[v] = length > longest[v] ? length : longest[v];
+      }
+    }
+    if (longest[header] >= 0 && instruction->loop_bound > 0) {
+      const uint64_t iteration =
+          (uint64_t)longest[header] + cycles[loops[k].edge];
+      const uint64_t repeated = iteration * (instruction->loop_bound - 1);
+      extra[header] = repeated > extra[header] ? repeated : extra[header];
+    }
+  }
+  free(longest);
+  free(loops);
+}
+
+void rgbasm_cycles_init(RgbasmCycles *self, const RgbasmProgram *program,
+                        bool until_enabled) {
+  const size_t count = program->instruction_count + 1;
+  *self = (RgbasmCycles){
+      .program = program,
+      .costs = calloc(count, sizeof(RgbasmCost)),
+  };
+  rgbasm_routines_init(&self->routines, program);
+  self->routines.builder.until_enabled = until_enabled;
+}
+
+void rgbasm_cycles_free(RgbasmCycles *self) {
+  rgbasm_routines_free(&self->routines);
+  free(self->costs);
+  *self = (RgbasmCycles){0};
+}
+
+RgbasmCost rgbasm_cycles_routine(RgbasmCycles *self, int32_t entry) {
+  RgbasmCfg cfg;
+  switch (rgbasm_routines_begin(&self->routines, entry, &cfg)) {
+  case RGBASM_ROUTINE_DONE:
+    return self->costs[entry];
+  case RGBASM_ROUTINE_RUNNING:
+    return (RgbasmCost){
+        .exact = false, .problem = entry, .reason = "recursion"};
+  case RGBASM_ROUTINE_UNSEEN:
+    break;
+  }
+  RgbasmCost cost = {.exact = true, .problem = -1};
+  if (cfg.problem >= 0) {
+    problem(&cost, cfg.problem, cfg.reason);
+  }
+
+  // the cycles of every edge, with those of the routine it calls
+  uint64_t *cycles = calloc(cfg.edge_count + 1, sizeof(uint64_t));
+  for (size_t v = 0; v < cfg.node_count; v++) {
+    const RgbasmCfgNode *node = &cfg.nodes[v];
+    const RgbasmInstruction *instruction =
+        &self->program->instructions[node->instruction];
+    uint32_t times = instruction->repeat;
+    if (!instruction->repeat_exact) {
+      times = 1;
+      problem(&cost, node->instruction, "unknown REPT count");
+    }
+    for (uint32_t j = 0; j < node->edge_count; j++) {
+      const uint32_t e = node->first_edge + j;
+      const RgbasmCfgEdge *edge = &cfg.edges[e];
+      if (instruction->form != NULL) {
+        cycles[e] = (uint64_t)times *
+                    (edge->taken ? instruction->form->taken_cycles
+                                 : instruction->form->cycles);
+      }
+      if (edge->callee >= 0) {
+        const RgbasmCost callee = rgbasm_cycles_routine(self, edge->callee);
+        cycles[e] += callee.cycles * times;
+        merge(&cost, &callee);
+      }
+      if (edge->delayed >= 0) {
+        // with its condition true, and without the routine it calls, which
+        // runs with interrupts enabled
+        const RgbasmInstruction *delayed =
+            &self->program->instructions[edge->delayed];
+        if (delayed->form != NULL) {
+          cycles[e] += delayed->form->taken_cycles;
+        }
+      }
+    }
+  }
+  uint64_t *extra = calloc(cfg.node_count + 1, sizeof(uint64_t));
+  repeat_loops(self, &cfg, cycles, extra, &cost);
+
+  uint64_t *longest = malloc((cfg.node_count + 1) * sizeof(uint64_t));
+  for (size_t i = 0; i < cfg.node_count; i++) {
+    const uint32_t v = cfg.order[i];
+    const RgbasmCfgNode *node = &cfg.nodes[v];
+    uint64_t best = 0;
+    for (uint32_t j = 0; j < node->edge_count; j++) {
+      const uint32_t e = node->first_edge + j;
+      const RgbasmCfgEdge *edge = &cfg.edges[e];
+      if (edge->back) {
+        continue;
+      }
+      const uint64_t length =
+          cycles[e] + (edge->to >= 0 ? longest[edge->to] : 0);
+      best = length > best ? length : best;
+    }
+    longest[v] = extra[v] + best;
+  }
+  cost.cycles = longest[0];
+
+  free(longest);
+  free(extra);
+  free(cycles);
+  self->costs[entry] = cost;
+  rgbasm_routines_end(&self->routines, entry, &cfg);
+  return cost;
+}
@@ -0,0 +1,39 @@
+#ifndef RGBASM_TOOLS_CYCLES_H_
+#define RGBASM_TOOLS_CYCLES_H_
+
+#include "cfg.h"
+#include "program.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Worst-case M-cycles of the routines of a program.
+//
+// A routine costs its longest path through its control-flow graph, with the
+// cost of every routine it calls on the way. REPT blocks with a constant
+// count multiply what they contain, loops need a `; @loop N` comment on the
+// line of the jump back to their start. Every routine is computed once.
+
+typedef struct RgbasmCost {
+  uint64_t cycles;
+  bool exact;
+  int32_t problem; // the instruction of the first reason it is not exact
+  const char *reason;
+} RgbasmCost;
+
+typedef struct RgbasmCycles {
+  const RgbasmProgram *program;
+  RgbasmRoutines routines; // those done are in `costs`
+  RgbasmCost *costs;       // per instruction, of the routine starting there
+} RgbasmCycles;
+
+// With `until_enabled`, routines end where interrupts are enabled, see
+// RgbasmCfgBuilder.
+void rgbasm_cycles_init(RgbasmCycles *self, const RgbasmProgram *program,
+                        bool until_enabled);
+void rgbasm_cycles_free(RgbasmCycles *self);
+
+// The cost of the routine starting at the instruction `entry`.
+RgbasmCost rgbasm_cycles_routine(RgbasmCycles *self, int32_t entry);
+
+#endif // RGBASM_TOOLS_CYCLES_H_
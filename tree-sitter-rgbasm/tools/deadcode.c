@@ -0,0 +1,569 @@
+// Reports the global labels nothing reachable refers to and the
+// instructions after an unconditional jp, jr, ret or reti that nothing jumps
+// to, with their sizes in bytes.
+//
+// The project is indexed like rgbasm-index does, in parallel and following
+// INCLUDEs, and every file is laid out while its tree is at hand. A label
+// refers to the names used between it and the next global label or SECTION.
+// The roots are exported labels and names, the labels of ROM0 sections at a
+// fixed address below $150 (the rst and interrupt vectors and the entry
+// point), names used outside of any label, like `dw` tables before the
+// first label or DEFs, and the labels given with -e. The names used in a
+// MACRO body are used by the macro, wherever it is defined, and reached
+// with it from the labels that invoke it. A reference by name is all it
+// takes: a label only used by unreachable code is reported too, one named by
+// a DEF or a macro argument is not.
+
+#define _XOPEN_SOURCE 700 // strndup
+
+#include "indexer.h"
+#include "layout.h"
+#include "sm83.h"
+#include "util.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-e label]... path...\n"
+          "\n"
+          "Prints `label name file:line bytes` for every global label that\n"
+          "is not reachable from the roots and `code file:line count bytes`\n"
+          "for every run of instructions that can never execute, then\n"
+          "`total` with the bytes of both. Sizes that are not exact are\n"
+          "lower bounds, e.g. `>=12`, `?` if the label is not assembled.\n"
+          "Names used in a MACRO body are reached with the labels that\n"
+          "invoke the macro.\n"
+          "\n"
+          "  -I dir    resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -e label  also treat label as reachable, e.g. one whose name a\n"
+          "            macro builds from its arguments\n",
+          argv0);
+}
+
+// The size of a global label, from its offset to the next one in its
+// section.
+typedef struct LabelSize {
+  char *name;
+  uint32_t row;
+  uint32_t bytes;
+  bool exact;
+  bool known; // assembled, so it has a size
+  bool root;  // in a vector or the entry point
+} LabelSize;
+
+// Instructions after an unconditional jump that no label precedes.
+typedef struct DeadRun {
+  uint32_t row;
+  uint32_t count;
+  uint32_t bytes;
+  bool exact;
+} DeadRun;
+
+typedef struct FileScan {
+  char *path;
+  LabelSize *labels;
+  size_t label_count;
+  DeadRun *runs;
+  size_t run_count;
+} FileScan;
+
+typedef struct Scans {
+  pthread_mutex_t lock;
+  const char *const *include_dirs;
+  size_t include_dir_count;
+  FileScan *items;
+  size_t count;
+  size_t capacity;
+} Scans;
+
+// A label as the layout reports it, before its size is known.
+typedef struct Placed {
+  int32_t section;
+  uint32_t offset;
+  bool exact;
+} Placed;
+
+// The state of one file while it is laid out.
+typedef struct Scan {
+  const char *source;
+  FileScan *out;
+  Placed *placed; // per label of `out`
+  bool dead;      // after an unconditional jump
+  TSNode last;    // the instruction before, if `dead`
+  DeadRun run;
+} Scan;
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+static bool unconditional(const RgbasmSm83Form *form) {
+  static const char *const forms[] = {"jp n", "jr n", "jp hl", "ret", "reti"};
+  for (size_t i = 0; form != NULL && i < sizeof(forms) / sizeof(*forms); i++) {
+    if (strcmp(form->form, forms[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static TSNode next_statement(TSNode node) {
+  TSNode sibling = ts_node_next_named_sibling(node);
+  while (!ts_node_is_null(sibling) && (is_type(sibling, "inline_comment") ||
+                                       is_type(sibling, "block_comment"))) {
+    sibling = ts_node_next_named_sibling(sibling);
+  }
+  return sibling;
+}
+
+// Whether `next` is the instruction right after `previous`, with nothing but
+// comments between them: no label, directive or IF branch.
+static bool follows(TSNode previous, TSNode next) {
+  TSNode sibling = next_statement(previous);
+  if (ts_node_is_null(sibling)) {
+    // the next instruction_list of the same block
+    sibling = next_statement(ts_node_parent(previous));
+    next = ts_node_parent(next);
+  }
+  return !ts_node_is_null(sibling) && ts_node_eq(sibling, next);
+}
+
+static void flush(Scan *scan) {
+  FileScan *out = scan->out;
+  if (scan->run.count > 0) {
+    out->runs = realloc(out->runs, (out->run_count + 1) * sizeof(DeadRun));
+    out->runs[out->run_count++] = scan->run;
+  }
+  scan->run = (DeadRun){0};
+  scan->dead = false;
+}
+
+static void on_instruction(const RgbasmLayoutItem *item, void *context) {
+  Scan *scan = context;
+  if (scan->dead && !follows(scan->last, item->node)) {
+    flush(scan);
+  }
+  if (scan->dead) {
+    if (scan->run.count == 0) {
+      scan->run.row = ts_node_start_point(item->node).row;
+      scan->run.exact = true;
+    }
+    scan->run.count++;
+    scan->run.bytes += item->form != NULL ? item->form->bytes : 0;
+    scan->run.exact &= item->form != NULL;
+  }
+  scan->dead = scan->dead || unconditional(item->form);
+  scan->last = item->node;
+}
+
+static void on_label(const RgbasmLayoutItem *item, void *context) {
+  Scan *scan = context;
+  flush(scan);
+  const TSNode name = ts_node_child_by_field_name(item->node, "name", 4);
+  if (!is_type(item->node, "global_label_block") || ts_node_is_null(name)) {
+    return;
+  }
+  FileScan *out = scan->out;
+  const uint32_t start = ts_node_start_byte(name);
+  const uint32_t length = ts_node_end_byte(name) - start;
+  out->labels =
+      realloc(out->labels, (out->label_count + 1) * sizeof(LabelSize));
+  scan->placed =
+      realloc(scan->placed, (out->label_count + 1) * sizeof(Placed));
+  scan->placed[out->label_count] = (Placed){
+      .section = item->section,
+      .offset = item->offset,
+      .exact = item->offset_exact,
+  };
+  out->labels[out->label_count++] = (LabelSize){
+      .name = strndup(scan->source + start, length),
+      .row = ts_node_start_point(name).row,
+      .known = item->section >= 0,
+  };
+}
+
+// Sizes the labels of `out` from the offset of the next label in the same
+// section, or the end of the section.
+static void size_labels(Scan *scan, const RgbasmFileLayout *layout) {
+  FileScan *out = scan->out;
+  for (size_t i = 0; i < out->label_count; i++) {
+    const Placed *placed = &scan->placed[i];
+    LabelSize *label = &out->labels[i];
+    if (!label->known) {
+      continue;
+    }
+    const RgbasmSectionSize *section = &layout->sections[placed->section];
+    uint32_t end = section->bytes;
+    bool exact = section->exact;
+    for (size_t j = i + 1; j < out->label_count; j++) {
+      if (scan->placed[j].section == placed->section) {
+        end = scan->placed[j].offset;
+        exact = scan->placed[j].exact;
+        break;
+      }
+    }
+    label->bytes = end > placed->offset ? end - placed->offset : 0;
+    label->exact = exact && placed->exact;
+    label->root = section->kind == RGBASM_SECTION_SECTION &&
+                  strcmp(section->type, "ROM0") == 0 && section->has_address &&
+                  section->address < 0x150;
+  }
+}
+
+static void scan_file(TSParser *parser, const char *path, const char *source,
+                      TSNode root, void *context) {
+  Scans *scans = context;
+  FileScan file = {.path = strdup(path)};
+  Scan scan = {.source = source, .out = &file};
+  const RgbasmLayoutOptions options = {
+      .include_dirs = scans->include_dirs,
+      .include_dir_count = scans->include_dir_count,
+      .on_instruction = on_instruction,
+      .on_label = on_label,
+      .context = &scan,
+  };
+  RgbasmConstants constants;
+  rgbasm_constants_init(&constants);
+  RgbasmFileLayout layout = {0};
+  rgbasm_layout_file(parser, path, source, root, &options, &constants,
+                     &layout);
+  flush(&scan);
+  size_labels(&scan, &layout);
+  rgbasm_file_layout_free(&layout);
+  rgbasm_constants_free(&constants);
+  free(scan.placed);
+
+  pthread_mutex_lock(&scans->lock);
+  if (scans->count == scans->capacity) {
+    scans->capacity = scans->capacity ? scans->capacity * 2 : 64;
+    scans->items = realloc(scans->items, scans->capacity * sizeof(FileScan));
+  }
+  scans->items[scans->count++] = file;
+  pthread_mutex_unlock(&scans->lock);
+}
+
+static int compare_scans(const void *a, const void *b) {
+  return strcmp(((const FileScan *)a)->path, ((const FileScan *)b)->path);
+}
+
+// A global label or macro of the project and the labels and macros its code
+// refers to.
+typedef struct Label {
+  const char *name;
+  uint32_t file;
+  uint32_t row;
+  const LabelSize *size; // NULL if the file was not laid out or a macro
+  uint32_t first_edge;
+  uint32_t edge_count;
+  bool macro; // never reported
+  bool reached;
+} Label;
+
+typedef struct Edge {
+  int32_t from; // -1 for references outside of any label
+  int32_t to;
+} Edge;
+
+typedef struct Graph {
+  Label *labels; // and macros
+  size_t label_count;
+  RgbasmConstants index; // name -> label
+  Edge *edges;           // sorted by `from`
+  size_t edge_count;
+  size_t edge_capacity;
+} Graph;
+
+static int32_t graph_find(const Graph *graph, const char *name,
+                          size_t length) {
+  int32_t label;
+  return rgbasm_constants_get(&graph->index, name, length, &label) ? label
+                                                                   : -1;
+}
+
+static void graph_link(Graph *graph, int32_t from, int32_t to) {
+  if (graph->edge_count == graph->edge_capacity) {
+    graph->edge_capacity = graph->edge_capacity ? graph->edge_capacity * 2
+                                                : 1024;
+    graph->edges =
+        realloc(graph->edges, graph->edge_capacity * sizeof(Edge));
+  }
+  graph->edges[graph->edge_count++] = (Edge){.from = from, .to = to};
+}
+
+static void graph_edge(Graph *graph, int32_t from, const char *name) {
+  // `Parent.local` is part of Parent
+  const char *dot = strchr(name, '.');
+  const size_t length = dot != NULL ? (size_t)(dot - name) : strlen(name);
+  const int32_t to = length > 0 ? graph_find(graph, name, length) : -1;
+  if (to >= 0 && to != from) {
+    graph_link(graph, from, to);
+  }
+}
+
+static int compare_edges(const void *a, const void *b) {
+  const int32_t left = ((const Edge *)a)->from;
+  const int32_t right = ((const Edge *)b)->from;
+  return (left > right) - (left < right);
+}
+
+static bool is_label(const RgbasmSymbol *symbol) {
+  return symbol->kind == RGBASM_SYMBOL_LABEL &&
+         !(symbol->flags & RGBASM_SYMBOL_IN_MACRO);
+}
+
+// A label or a macro, a node of the graph.
+static bool is_node(const RgbasmSymbol *symbol) {
+  return is_label(symbol) || symbol->kind == RGBASM_SYMBOL_MACRO;
+}
+
+// Collects the labels and macros, then the references of every file by the
+// label whose code or the macro whose body they are in.
+static void graph_build(Graph *graph, const RgbasmProjectIndex *project,
+                        const Scans *scans) {
+  rgbasm_constants_init(&graph->index);
+  for (size_t f = 0; f < project->count; f++) {
+    const RgbasmFileSymbols *symbols = &project->files[f].symbols;
+    for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+      graph->label_count += is_node(&symbols->symbols[i]);
+    }
+  }
+  graph->labels = calloc(graph->label_count + 1, sizeof(Label));
+  size_t count = 0;
+  for (size_t f = 0; f < project->count; f++) {
+    const RgbasmIndexedFile *file = &project->files[f];
+    const RgbasmFileSymbols *symbols = &file->symbols;
+    const FileScan key = {.path = file->path};
+    const FileScan *scan = bsearch(&key, scans->items, scans->count,
+                                   sizeof(FileScan), compare_scans);
+    size_t next_size = 0;
+    for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+      const RgbasmSymbol *symbol = &symbols->symbols[i];
+      if (!is_node(symbol)) {
+        continue;
+      }
+      const char *name = symbols->strings + symbol->name;
+      Label *label = &graph->labels[count];
+      *label = (Label){
+          .name = name,
+          .file = (uint32_t)f,
+          .row = symbol->point.row,
+          .macro = symbol->kind == RGBASM_SYMBOL_MACRO,
+      };
+      // the layout reports the labels it assembles in the same order
+      for (size_t j = next_size;
+           !label->macro && scan != NULL && j < scan->label_count; j++) {
+        if (scan->labels[j].row == symbol->point.row &&
+            strcmp(scan->labels[j].name, name) == 0) {
+          label->size = &scan->labels[j];
+          next_size = j + 1;
+          break;
+        }
+      }
+      int32_t existing;
+      if (rgbasm_constants_get(&graph->index, name, strlen(name),
+                               &existing)) {
+        // defined again, e.g. in another IF branch: reached together
+        graph_link(graph, existing, (int32_t)count);
+      } else {
+        rgbasm_constants_set(&graph->index, name, strlen(name),
+                             (int32_t)count);
+      }
+      count++;
+    }
+  }
+
+  count = 0;
+  for (size_t f = 0; f < project->count; f++) {
+    const RgbasmFileSymbols *symbols = &project->files[f].symbols;
+    // symbols and references are both in source order
+    int32_t current = -1;
+    int32_t macro = -1;
+    uint32_t s = 0;
+    for (uint32_t r = 0; r < symbols->reference_count; r++) {
+      const RgbasmReference *reference = &symbols->references[r];
+      for (; s < symbols->symbol_count &&
+             symbols->symbols[s].start_byte <= reference->start_byte;
+           s++) {
+        const RgbasmSymbol *symbol = &symbols->symbols[s];
+        if (is_label(symbol)) {
+          current = (int32_t)count++;
+        } else if (symbol->kind == RGBASM_SYMBOL_MACRO) {
+          macro = (int32_t)count++;
+        } else if (symbol->kind == RGBASM_SYMBOL_SECTION) {
+          current = -1;
+        }
+      }
+      const int32_t from =
+          reference->flags & RGBASM_REFERENCE_IN_MACRO ? macro : current;
+      graph_edge(graph, from, symbols->strings + reference->name);
+    }
+    for (; s < symbols->symbol_count; s++) {
+      count += is_node(&symbols->symbols[s]);
+    }
+  }
+  qsort(graph->edges, graph->edge_count, sizeof(Edge), compare_edges);
+  for (size_t i = graph->edge_count; i > 0; i--) {
+    const Edge *edge = &graph->edges[i - 1];
+    if (edge->from >= 0) {
+      graph->labels[edge->from].first_edge = (uint32_t)(i - 1);
+      graph->labels[edge->from].edge_count++;
+    }
+  }
+}
+
+static void graph_free(Graph *graph) {
+  free(graph->labels);
+  free(graph->edges);
+  rgbasm_constants_free(&graph->index);
+}
+
+// Marks the labels reachable from `stack[0..count)`.
+static void reach(Graph *graph, int32_t *stack, size_t count) {
+  while (count > 0) {
+    Label *label = &graph->labels[stack[--count]];
+    for (uint32_t i = 0; i < label->edge_count; i++) {
+      const int32_t to = graph->edges[label->first_edge + i].to;
+      if (!graph->labels[to].reached) {
+        graph->labels[to].reached = true;
+        stack[count++] = to;
+      }
+    }
+  }
+}
+
+static void push_root(Graph *graph, int32_t *stack, size_t *count,
+                      int32_t label) {
+  if (label >= 0 && !graph->labels[label].reached) {
+    graph->labels[label].reached = true;
+    stack[(*count)++] = label;
+  }
+}
+
+int main(int argc, char **argv) {
+  RgbasmIndexOptions options = {.follow_includes = true};
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  const char **entries = calloc((size_t)argc, sizeof(char *));
+  size_t entry_count = 0;
+  const char **paths = calloc((size_t)argc, sizeof(char *));
+  size_t path_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      options.threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[options.include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      entries[entry_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      paths[path_count++] = argv[i];
+    }
+  }
+  if (path_count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Scans scans = {
+      .include_dirs = include_dirs,
+      .include_dir_count = options.include_dir_count,
+  };
+  pthread_mutex_init(&scans.lock, NULL);
+  options.include_dirs = include_dirs;
+  options.on_tree = scan_file;
+  options.on_tree_context = &scans;
+  RgbasmProjectIndex project;
+  const bool ok = rgbasm_index_project(paths, path_count, &options, &project);
+  qsort(scans.items, scans.count, sizeof(FileScan), compare_scans);
+
+  Graph graph = {0};
+  graph_build(&graph, &project, &scans);
+  int32_t *stack = malloc((graph.label_count + 1) * sizeof(int32_t));
+  size_t count = 0;
+  for (size_t i = 0; i < graph.edge_count && graph.edges[i].from < 0; i++) {
+    push_root(&graph, stack, &count, graph.edges[i].to);
+  }
+  for (size_t f = 0; f < project.count; f++) {
+    const RgbasmFileSymbols *symbols = &project.files[f].symbols;
+    for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+      const RgbasmSymbol *symbol = &symbols->symbols[i];
+      const char *name = symbols->strings + symbol->name;
+      if (symbol->kind == RGBASM_SYMBOL_EXPORT ||
+          (is_label(symbol) && (symbol->flags & RGBASM_SYMBOL_EXPORTED))) {
+        push_root(&graph, stack, &count, graph_find(&graph, name,
+                                                    strlen(name)));
+      }
+    }
+  }
+  for (size_t i = 0; i < graph.label_count; i++) {
+    if (graph.labels[i].size != NULL && graph.labels[i].size->root) {
+      push_root(&graph, stack, &count, (int32_t)i);
+    }
+  }
+  for (size_t i = 0; i < entry_count; i++) {
+    push_root(&graph, stack, &count,
+              graph_find(&graph, entries[i], strlen(entries[i])));
+  }
+  reach(&graph, stack, count);
+
+  size_t dead_labels = 0;
+  uint64_t label_bytes = 0;
+  for (size_t i = 0; i < graph.label_count; i++) {
+    const Label *label = &graph.labels[i];
+    if (label->reached || label->macro) {
+      continue;
+    }
+    dead_labels++;
+    printf("label\t%s\t%s:%u\t", label->name, project.files[label->file].path,
+           label->row + 1);
+    if (label->size != NULL && label->size->known) {
+      printf("%s%u\n", label->size->exact ? "" : ">=", label->size->bytes);
+      label_bytes += label->size->bytes;
+    } else {
+      printf("?\n");
+    }
+  }
+  size_t dead_runs = 0;
+  uint64_t run_bytes = 0;
+  for (size_t i = 0; i < scans.count; i++) {
+    const FileScan *scan = &scans.items[i];
+    for (size_t j = 0; j < scan->run_count; j++) {
+      const DeadRun *run = &scan->runs[j];
+      printf("code\t%s:%u\t%u\t%s%u\n", scan->path, run->row + 1, run->count,
+             run->exact ? "" : ">=", run->bytes);
+      dead_runs++;
+      run_bytes += run->bytes;
+    }
+  }
+  printf("total\t%zu\t%llu\t%zu\t%llu\n", dead_labels,
+         (unsigned long long)label_bytes, dead_runs,
+         (unsigned long long)run_bytes);
+
+  free(stack);
+  graph_free(&graph);
+  for (size_t i = 0; i < scans.count; i++) {
+    FileScan *scan = &scans.items[i];
+    for (size_t j = 0; j < scan->label_count; j++) {
+      free(scan->labels[j].name);
+    }
+    free(scan->labels);
+    free(scan->runs);
+    free(scan->path);
+  }
+  free(scans.items);
+  pthread_mutex_destroy(&scans.lock);
+  rgbasm_project_index_free(&project);
+  free(include_dirs);
+  free(entries);
+  free(paths);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,310 @@
+#include "expr.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+static int digit_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = (char)tolower((unsigned char)c);
+  return c >= 'a' && c <= 'f' ? c - 'a' + 10 : 99;
+}
+
+bool rgbasm_expr_number(const char *text, size_t length, int32_t *value) {
+  unsigned base = 10;
+  size_t i = 0;
+  if (length > 0 && (text[0] == '$' || text[0] == '&' || text[0] == '%')) {
+    base = text[0] == '$' ? 16 : text[0] == '&' ? 8 : 2;
+    i = 1;
+  } else if (length > 2 && text[0] == '0' && isalpha((unsigned char)text[1])) {
+    const char prefix = (char)tolower((unsigned char)text[1]);
+    base = prefix == 'x' ? 16 : prefix == 'o' ? 8 : prefix == 'b' ? 2 : 0;
+    i = 2;
+  }
+  if (base == 0) {
+    return false;
+  }
+  if (base == 10 && memchr(text, '.', length) != NULL) {
+    // 1.5 or 1.5q8, rounded like rgbasm's double2fix
+    char buffer[64];
+    size_t used = 0;
+    unsigned precision = 16;
+    for (size_t j = 0; j < length && used + 1 < sizeof(buffer); j++) {
+      if (text[j] == 'q' || text[j] == 'Q') {
+        precision = (unsigned)strtoul(text + j + 1, NULL, 10);
+        break;
+      }
+      if (text[j] != '_') {
+        buffer[used++] = text[j];
+      }
+    }
+    buffer[used] = '\0';
+    if (precision < 1 || precision > 31) {
+      return false;
+    }
+    const double scaled = strtod(buffer, NULL) * (double)(1u << precision);
+    *value = (int32_t)(uint32_t)(int64_t)(scaled + 0.5);
+    return true;
+  }
+  uint32_t result = 0;
+  bool any = false;
+  for (; i < length; i++) {
+    if (text[i] == '_') {
+      continue;
+    }
+    const int digit = digit_value(text[i]);
+    if (digit >= (int)base) {
+      return false;
+    }
+    result = result * base + (uint32_t)digit;
+    any = true;
+  }
+  *value = (int32_t)result;
+  return any;
+}
+
+// A backtick literal: one 2-bit color per pixel, low bits in the low byte.
+static bool graphics(const char *text, size_t length, int32_t *value) {
+  uint32_t low = 0;
+  uint32_t high = 0;
+  if (length < 2 || length > 9) {
+    return false;
+  }
+  for (size_t i = 1; i < length; i++) {
+    const char c = text[i];
+    if (c < '0' || c > '3') {
+      // custom OPT g characters
+      return false;
+    }
+    low = low << 1 | ((c - '0') & 1);
+    high = high << 1 | ((c - '0') >> 1);
+  }
+  *value = (int32_t)(high << 8 | low);
+  return true;
+}
+
+static int32_t shift_left(int32_t a, int32_t b) {
+  if (b < 0) {
+    return b <= -32 ? (a < 0 ? -1 : 0) : a >> -b;
+  }
+  return b >= 32 ? 0 : (int32_t)((uint32_t)a << b);
+}
+
+static int32_t shift_right(int32_t a, int32_t b) {
+  if (b < 0) {
+    return shift_left(a, -b);
+  }
+  return b >= 32 ? (a < 0 ? -1 : 0) : a >> b;
+}
+
+static bool binary(const RgbasmExprContext *context, TSNode node,
+                   int32_t *value) {
+  const TSNode left_node = ts_node_child_by_field_name(node, "left", 4);
+  const TSNode right_node = ts_node_child_by_field_name(node, "right", 5);
+  const TSNode op_node = ts_node_child_by_field_name(node, "operator", 8);
+  if (ts_node_is_null(left_node) || ts_node_is_null(right_node) ||
+      ts_node_is_null(op_node)) {
+    return false;
+  }
+  char op[4] = {0};
+  const uint32_t op_start = ts_node_start_byte(op_node);
+  const uint32_t op_length = ts_node_end_byte(op_node) - op_start;
+  if (op_length >= sizeof(op)) {
+    return false;
+  }
+  memcpy(op, context->source + op_start, op_length);
+
+  int32_t a;
+  int32_t b;
+  const bool left_known = rgbasm_expr_eval(context, left_node, &a);
+  const bool right_known = rgbasm_expr_eval(context, right_node, &b);
+  // decided by one side
+  if (strcmp(op, "&&") == 0 &&
+      ((left_known && a == 0) || (right_known && b == 0))) {
+    *value = 0;
+    return true;
+  }
+  if (strcmp(op, "||") == 0 &&
+      ((left_known && a != 0) || (right_known && b != 0))) {
+    *value = 1;
+    return true;
+  }
+  if (!left_known || !right_known) {
+    return false;
+  }
+  const uint32_t ua = (uint32_t)a;
+  const uint32_t ub = (uint32_t)b;
+  if (strcmp(op, "+") == 0) {
+    *value = (int32_t)(ua + ub);
+  } else if (strcmp(op, "-") == 0) {
+    *value = (int32_t)(ua - ub);
+  } else if (strcmp(op, "*") == 0) {
+    *value = (int32_t)(ua * ub);
+  } else if (strcmp(op, "/") == 0 || strcmp(op, "%") == 0) {
+    if (b == 0) {
+      return false;
+    }
+    // floored, the remainder takes the sign of the divisor
+    int64_t quotient = (int64_t)a / b;
+    int64_t remainder = (int64_t)a % b;
+    if (remainder != 0 && (remainder < 0) != (b < 0)) {
+      quotient--;
+      remainder += b;
+    }
+    *value = (int32_t)(uint32_t)(op[0] == '/' ? quotient : remainder);
+  } else if (strcmp(op, "**") == 0) {
+    if (b < 0) {
+      return false;
+    }
+    uint32_t result = 1;
+    uint32_t base = ua;
+    for (uint32_t e = ub; e != 0; e >>= 1) {
+      if (e & 1) {
+        result *= base;
+      }
+      base *= base;
+    }
+    *value = (int32_t)result;
+  } else if (strcmp(op, "&") == 0) {
+    *value = a & b;
+  } else if (strcmp(op, "|") == 0) {
+    *value = a | b;
+  } else if (strcmp(op, "^") == 0) {
+    *value = a ^ b;
+  } else if (strcmp(op, "<<") == 0) {
+    *value = shift_left(a, b);
+  } else if (strcmp(op, ">>") == 0) {
+    *value = shift_right(a, b);
+  } else if (strcmp(op, ">>>") == 0) {
+    *value = b < 0 ? shift_left(a, -b) : b >= 32 ? 0 : (int32_t)(ua >> b);
+  } else if (strcmp(op, "&&") == 0) {
+    *value = 1;
+  } else if (strcmp(op, "||") == 0) {
+    *value = 0;
+  } else if (strcmp(op, "==") == 0) {
+    *value = a == b;
+  } else if (strcmp(op, "!=") == 0) {
+    *value = a != b;
+  } else if (strcmp(op, "<") == 0) {
+    *value = a < b;
+  } else if (strcmp(op, "<=") == 0) {
+    *value = a <= b;
+  } else if (strcmp(op, ">") == 0) {
+    *value = a > b;
+  } else if (strcmp(op, ">=") == 0) {
+    *value = a >= b;
+  } else {
+    // string operators
+    return false;
+  }
+  return true;
+}
+
+static bool call(const RgbasmExprContext *context, TSNode node,
+                 int32_t *value) {
+  const TSNode name = ts_node_named_child(node, 0);
+  const TSNode argument = ts_node_named_child(node, 1);
+  if (ts_node_is_null(name) || ts_node_is_null(argument) ||
+      !is_type(name, "function_name")) {
+    return false;
+  }
+  const uint32_t start = ts_node_start_byte(name);
+  const uint32_t length = ts_node_end_byte(name) - start;
+  char function[16];
+  if (length >= sizeof(function)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < length; i++) {
+    function[i] = (char)toupper((unsigned char)context->source[start + i]);
+  }
+  function[length] = '\0';
+  int32_t a;
+  if (!rgbasm_expr_eval(context, argument, &a)) {
+    return false;
+  }
+  const uint32_t ua = (uint32_t)a;
+  if (strcmp(function, "HIGH") == 0) {
+    *value = (int32_t)(ua >> 8 & 0xFF);
+  } else if (strcmp(function, "LOW") == 0) {
+    *value = (int32_t)(ua & 0xFF);
+  } else if (strcmp(function, "BITWIDTH") == 0) {
+    int32_t width = 0;
+    for (uint32_t v = ua; v != 0; v >>= 1) {
+      width++;
+    }
+    *value = width;
+  } else if (strcmp(function, "TZCOUNT") == 0) {
+    int32_t count = 0;
+    while (count < 32 && !(ua >> count & 1)) {
+      count++;
+    }
+    *value = count;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool rgbasm_expr_eval(const RgbasmExprContext *context, TSNode node,
+                      int32_t *value) {
+  const char *type = ts_node_type(node);
+  const uint32_t start = ts_node_start_byte(node);
+  const uint32_t length = ts_node_end_byte(node) - start;
+  const char *text = context->source + start;
+  if (strcmp(type, "number_literal") == 0) {
+    return rgbasm_expr_number(text, length, value);
+  }
+  if (strcmp(type, "graphics_literal") == 0) {
+    return graphics(text, length, value);
+  }
+  if (strcmp(type, "char_literal") == 0) {
+    // a single plain character, without a charmap
+    if (length == 3 && text[1] != '\\') {
+      *value = (unsigned char)text[1];
+      return true;
+    }
+    return false;
+  }
+  if (strcmp(type, "paren") == 0) {
+    const TSNode inner = ts_node_named_child(node, 0);
+    return !ts_node_is_null(inner) && rgbasm_expr_eval(context, inner, value);
+  }
+  if (strcmp(type, "unary_expression") == 0) {
+    const TSNode operand = ts_node_named_child(node, 0);
+    int32_t a;
+    if (ts_node_is_null(operand) || !rgbasm_expr_eval(context, operand, &a)) {
+      return false;
+    }
+    switch (text[0]) {
+    case '-':
+      *value = (int32_t)(0u - (uint32_t)a);
+      break;
+    case '!':
+      *value = a == 0;
+      break;
+    case '~':
+      *value = ~a;
+      break;
+    default:
+      *value = a;
+    }
+    return true;
+  }
+  if (strcmp(type, "binary_expression") == 0) {
+    return binary(context, node, value);
+  }
+  if (strcmp(type, "function_call") == 0) {
+    return call(context, node, value);
+  }
+  if ((strcmp(type, "variable") == 0 || strcmp(type, "constant") == 0) &&
+      context->lookup != NULL) {
+    return context->lookup(text, length, value, context->lookup_context);
+  }
+  return false;
+}
@@ -0,0 +1,31 @@
+#ifndef RGBASM_TOOLS_EXPR_H_
+#define RGBASM_TOOLS_EXPR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Evaluation of constant numeric expressions with rgbasm's 32-bit semantics,
+// like lua/rgbds/eval.lua does for numbers. Strings, labels and the section
+// functions have no value here.
+
+// Sets `*value` to the value of the constant `name` and returns true, or
+// returns false if it has none (yet).
+typedef bool (*RgbasmExprLookup)(const char *name, size_t length,
+                                 int32_t *value, void *context);
+
+typedef struct RgbasmExprContext {
+  const char *source;
+  RgbasmExprLookup lookup;
+  void *lookup_context;
+} RgbasmExprContext;
+
+// Returns false if the value of `node` is unknown.
+bool rgbasm_expr_eval(const RgbasmExprContext *context, TSNode node,
+                      int32_t *value);
+
+// The value of a number literal, fixed-point ones with 16 fractional bits.
+bool rgbasm_expr_number(const char *text, size_t length, int32_t *value);
+
+#endif // RGBASM_TOOLS_EXPR_H_
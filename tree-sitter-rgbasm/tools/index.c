@@ -0,0 +1,393 @@
+// Indexes a project: labels, constants, macros, sections and exports of all
+// given files and the files they include. Writes or queries the on-disk index.
+
+#define _XOPEN_SOURCE 700 // realpath
+
+#include "index_format.h"
+#include "indexer.h"
+#include "util.h"
+#include "watch.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [--no-follow] [--files] "
+          "[--stats] [--references name]... [-o index [-c file]... "
+          "[--watch]] path...\n"
+          "       %s --lookup index name...\n"
+          "       %s --search index [--fuzzy] [-n count] [--stats] query\n"
+          "\n"
+          "Prints `kind name file:line:column [exported] [macro]` for every\n"
+          "symbol, or with --files every file with its includes.\n"
+          "\n"
+          "  -I dir       resolve INCLUDE paths in dir, like rgbasm -I\n"
+          "  --no-follow  do not index included files outside the paths\n"
+          "  --stats      print counts and the time to stderr\n"
+          "  --references name\n"
+          "               print the references of name instead, qualified\n"
+          "               like Parent.local, file by file as soon as each is\n"
+          "               indexed\n"
+          "  -o index     write the binary index instead; files unchanged\n"
+          "               since the index already there are not parsed again\n"
+          "  -c file      only update the index for these changed, created or\n"
+          "               deleted files and print the files this affects\n"
+          "  --watch      keep the index up to date as files change, printing\n"
+          "               the affected files after every update (inotify)\n"
+          "  --lookup     print the definitions and references of the names\n"
+          "               from an index\n"
+          "  --search     print the definitions of the names containing the\n"
+          "               query, ignoring case, best first (default 20); with\n"
+          "               --fuzzy also of names sharing most of its trigrams\n",
+          argv0, argv0, argv0);
+}
+
+static void print_symbols(const RgbasmIndexedFile *file) {
+  const RgbasmFileSymbols *symbols = &file->symbols;
+  for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+    const RgbasmSymbol *symbol = &symbols->symbols[i];
+    printf("%s\t%s\t%s:%u:%u", rgbasm_symbol_kind_name(symbol->kind),
+           symbols->strings + symbol->name, file->path, symbol->point.row + 1,
+           symbol->point.column + 1);
+    if (symbol->flags & RGBASM_SYMBOL_EXPORTED) {
+      printf("\texported");
+    }
+    if (symbol->flags & RGBASM_SYMBOL_IN_MACRO) {
+      printf("\tmacro");
+    }
+    printf("\n");
+  }
+}
+
+// The names of --references. Workers print the matches of a file at once.
+typedef struct ReferenceQuery {
+  const char *const *names;
+  size_t count;
+  pthread_mutex_t lock;
+} ReferenceQuery;
+
+static void print_references(const RgbasmIndexedFile *file, void *context) {
+  ReferenceQuery *query = context;
+  const RgbasmFileSymbols *symbols = &file->symbols;
+  bool printed = false;
+  pthread_mutex_lock(&query->lock);
+  for (uint32_t i = 0; i < symbols->reference_count; i++) {
+    const RgbasmReference *reference = &symbols->references[i];
+    const char *name = symbols->strings + reference->name;
+    for (size_t j = 0; j < query->count; j++) {
+      if (strcmp(name, query->names[j]) == 0) {
+        printf("reference\t%s\t%s:%u:%u\n", name, file->path,
+               reference->point.row + 1, reference->point.column + 1);
+        printed = true;
+        break;
+      }
+    }
+  }
+  if (printed) {
+    // the reader shows the first hits while other files are parsed
+    fflush(stdout);
+  }
+  pthread_mutex_unlock(&query->lock);
+}
+
+static void print_file(const RgbasmIndexedFile *file) {
+  printf("%s\t%016llx\t%u symbols%s\n", file->path,
+         (unsigned long long)file->hash, file->symbols.symbol_count,
+         file->has_errors ? "\terrors" : "");
+  for (uint32_t i = 0; i < file->symbols.include_count; i++) {
+    const RgbasmInclude *include = &file->symbols.includes[i];
+    printf("\tinclude %s -> %s\n", file->symbols.strings + include->name,
+           file->include_paths[i] ? file->include_paths[i] : "(not found)");
+  }
+}
+
+static int lookup(const char *index_path, char **names, int count) {
+  RgbasmIndexView view;
+  if (!rgbasm_index_view_open(&view, index_path)) {
+    fprintf(stderr, "%s: not an index of this version\n", index_path);
+    return 1;
+  }
+  int status = 0;
+  for (int i = 0; i < count; i++) {
+    const RgbasmIndexName *name =
+        rgbasm_index_view_lookup(&view, names[i], strlen(names[i]));
+    if (name == NULL) {
+      fprintf(stderr, "%s: not found\n", names[i]);
+      status = 1;
+      continue;
+    }
+    for (uint32_t j = 0; j < name->symbol_count; j++) {
+      const RgbasmIndexSymbol *symbol =
+          &view.symbols[view.postings[name->first_symbol + j]];
+      printf("%s\t%s\t%s:%u:%u\n", rgbasm_symbol_kind_name(symbol->kind),
+             names[i],
+             rgbasm_index_view_string(&view, view.files[symbol->file].path),
+             symbol->row + 1, symbol->column + 1);
+    }
+    for (uint32_t j = 0; j < name->reference_count; j++) {
+      const RgbasmIndexReference *reference =
+          &view.references[view.postings[name->first_reference + j]];
+      printf("reference\t%s\t%s:%u:%u\n", names[i],
+             rgbasm_index_view_string(&view, view.files[reference->file].path),
+             reference->row + 1, reference->column + 1);
+    }
+  }
+  rgbasm_index_view_close(&view);
+  return status;
+}
+
+static int search(const char *index_path, int argc, char **argv) {
+  bool fuzzy = false;
+  bool stats = false;
+  size_t limit = 20;
+  const char *query = NULL;
+  for (int i = 0; i < argc; i++) {
+    if (strcmp(argv[i], "--fuzzy") == 0) {
+      fuzzy = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      stats = true;
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      limit = (size_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      query = argv[i];
+    }
+  }
+  RgbasmIndexView view;
+  if (query == NULL || !rgbasm_index_view_open(&view, index_path)) {
+    fprintf(stderr, "%s: not an index of this version\n", index_path);
+    return 1;
+  }
+  RgbasmIndexMatch *matches = calloc(limit + 1, sizeof(RgbasmIndexMatch));
+  const double start = now_seconds();
+  const size_t count = rgbasm_index_view_search(&view, query, strlen(query),
+                                                fuzzy, matches, limit);
+  const double elapsed = now_seconds() - start;
+  for (size_t i = 0; i < count; i++) {
+    const RgbasmIndexName *name = &view.names[matches[i].name];
+    for (uint32_t j = 0; j < name->symbol_count; j++) {
+      const RgbasmIndexSymbol *symbol =
+          &view.symbols[view.postings[name->first_symbol + j]];
+      if (symbol->kind == RGBASM_SYMBOL_SECTION ||
+          symbol->kind == RGBASM_SYMBOL_EXPORT) {
+        continue;
+      }
+      printf("%s\t%s\t%s:%u:%u\n", rgbasm_symbol_kind_name(symbol->kind),
+             rgbasm_index_view_string(&view, name->name),
+             rgbasm_index_view_string(&view, view.files[symbol->file].path),
+             symbol->row + 1, symbol->column + 1);
+    }
+  }
+  if (stats) {
+    fprintf(stderr, "%zu of %u names, %.3f ms\n", count,
+            view.header->search_name_count, elapsed * 1e3);
+  }
+  free(matches);
+  rgbasm_index_view_close(&view);
+  return count > 0 ? 0 : 1;
+}
+
+static void print_changes(const RgbasmIndexChanges *changes) {
+  for (size_t i = 0; i < changes->count; i++) {
+    printf("%s\n", changes->files[i]);
+  }
+}
+
+// Watches the directories of the roots and of every indexed file.
+static void watch_index(RgbasmWatch *watch, const RgbasmProjectIndex *index,
+                        const char *const *paths, size_t path_count) {
+  for (size_t i = 0; i < path_count; i++) {
+    char *path = realpath(paths[i], NULL);
+    struct stat info;
+    if (path != NULL && stat(path, &info) == 0 && S_ISDIR(info.st_mode)) {
+      rgbasm_watch_add(watch, path, true);
+    }
+    free(path);
+  }
+  for (size_t i = 0; i < index->count; i++) {
+    char *dir = strdup(index->files[i].path);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL && slash != dir) {
+      *slash = '\0';
+      rgbasm_watch_add(watch, dir, false);
+    }
+    free(dir);
+  }
+}
+
+static bool watch_loop(RgbasmProjectIndex *index, const char *const *paths,
+                       size_t path_count, const RgbasmIndexOptions *options,
+                       const char *output, bool stats) {
+  RgbasmWatch *watch = rgbasm_watch_new();
+  if (watch == NULL) {
+    fprintf(stderr, "--watch needs inotify\n");
+    return false;
+  }
+  watch_index(watch, index, paths, path_count);
+  PathList changed = {0};
+  while (rgbasm_watch_next(watch, &changed, 50)) {
+    const double start = now_seconds();
+    RgbasmIndexChanges changes;
+    rgbasm_index_update(index, paths, path_count,
+                        (const char *const *)changed.items, changed.count,
+                        options, &changes);
+    if (changes.count > 0) {
+      rgbasm_index_write(index, output);
+      // included files found by the update are watched from now on
+      watch_index(watch, index, NULL, 0);
+    }
+    if (stats) {
+      fprintf(stderr, "%zu changed, %zu affected, %.1f ms\n", changed.count,
+              changes.count, (now_seconds() - start) * 1e3);
+    }
+    print_changes(&changes);
+    fflush(stdout);
+    rgbasm_index_changes_free(&changes);
+    path_list_free(&changed);
+  }
+  path_list_free(&changed);
+  rgbasm_watch_delete(watch);
+  return false;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 3 && strcmp(argv[1], "--lookup") == 0) {
+    return lookup(argv[2], argv + 3, argc - 3);
+  }
+  if (argc >= 3 && strcmp(argv[1], "--search") == 0) {
+    return search(argv[2], argc - 3, argv + 3);
+  }
+
+  RgbasmIndexOptions options = {.follow_includes = true};
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  const char **paths = calloc((size_t)argc, sizeof(char *));
+  size_t path_count = 0;
+  bool files = false;
+  bool stats = false;
+  bool watch = false;
+  const char *output = NULL;
+  char **changed = calloc((size_t)argc, sizeof(char *));
+  size_t changed_count = 0;
+  const char **references = calloc((size_t)argc, sizeof(char *));
+  ReferenceQuery query = {.names = references};
+  pthread_mutex_init(&query.lock, NULL);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      options.threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[options.include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "--no-follow") == 0) {
+      options.follow_includes = false;
+    } else if (strcmp(argv[i], "--files") == 0) {
+      files = true;
+    } else if (strcmp(argv[i], "--stats") == 0) {
+      stats = true;
+    } else if (strcmp(argv[i], "--references") == 0 && i + 1 < argc) {
+      references[query.count++] = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      changed[changed_count] = path_canonical(argv[++i]);
+      changed_count += changed[changed_count] != NULL;
+    } else if (strcmp(argv[i], "--watch") == 0) {
+      watch = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      paths[path_count++] = argv[i];
+    }
+  }
+  if (path_count == 0 || (output == NULL && (changed_count > 0 || watch))) {
+    usage(argv[0]);
+    return 2;
+  }
+  options.include_dirs = include_dirs;
+  if (query.count > 0) {
+    options.on_file = print_references;
+    options.on_file_context = &query;
+  }
+
+  RgbasmIndexView previous;
+  if (output != NULL && rgbasm_index_view_open(&previous, output)) {
+    options.previous = &previous;
+  }
+
+  RgbasmProjectIndex index;
+  const double start = now_seconds();
+  bool ok;
+  if (changed_count > 0 && options.previous != NULL) {
+    // work proportional to the change, the rest is copied
+    rgbasm_index_view_load(&previous, &index);
+    rgbasm_index_view_close(&previous);
+    options.previous = NULL;
+    RgbasmIndexChanges changes;
+    ok = rgbasm_index_update(&index, paths, path_count,
+                             (const char *const *)changed, changed_count,
+                             &options, &changes);
+    if (query.count == 0) {
+      print_changes(&changes);
+    }
+    rgbasm_index_changes_free(&changes);
+  } else {
+    ok = rgbasm_index_project(paths, path_count, &options, &index);
+  }
+  if (output != NULL) {
+    ok = rgbasm_index_write(&index, output) && ok;
+  }
+  const double elapsed = now_seconds() - start;
+
+  uint64_t symbol_count = 0;
+  uint64_t reference_count = 0;
+  uint64_t unresolved = 0;
+  size_t parsed = 0;
+  for (size_t i = 0; i < index.count; i++) {
+    const RgbasmIndexedFile *file = &index.files[i];
+    if (files) {
+      print_file(file);
+    } else if (output == NULL && changed_count == 0 && query.count == 0) {
+      print_symbols(file);
+    }
+    symbol_count += file->symbols.symbol_count;
+    reference_count += file->symbols.reference_count;
+    parsed += !file->reused;
+    for (uint32_t j = 0; j < file->symbols.include_count; j++) {
+      unresolved += file->include_paths[j] == NULL;
+    }
+  }
+  if (stats) {
+    fprintf(stderr,
+            "files: %zu (%zu parsed), symbols: %llu, references: %llu, "
+            "unresolved includes: %llu, %.1f ms\n",
+            index.count, parsed, (unsigned long long)symbol_count,
+            (unsigned long long)reference_count,
+            (unsigned long long)unresolved, elapsed * 1e3);
+  }
+
+  if (options.previous != NULL) {
+    rgbasm_index_view_close(&previous);
+    options.previous = NULL;
+  }
+  if (watch) {
+    ok = watch_loop(&index, paths, path_count, &options, output, stats);
+  }
+
+  rgbasm_project_index_free(&index);
+  for (size_t i = 0; i < changed_count; i++) {
+    free(changed[i]);
+  }
+  free(changed);
+  pthread_mutex_destroy(&query.lock);
+  free(references);
+  free(include_dirs);
+  free(paths);
+  return ok ? 0 : 1;
+}
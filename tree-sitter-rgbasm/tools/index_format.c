@@ -0,0 +1,1091 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "index_format.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The deduplicated string pool of the index being written.
+typedef struct StringTable {
+  char *data;
+  uint32_t length;
+  uint32_t capacity;
+  uint32_t *slots; // offset + 1, 0 for empty
+  uint32_t slot_capacity;
+  uint32_t count;
+} StringTable;
+
+// Maps the string offset of a name to its index in `names`.
+typedef struct NameTable {
+  RgbasmIndexName *names;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t *slots; // name index + 1, 0 for empty
+  uint32_t slot_capacity;
+} NameTable;
+
+uint32_t rgbasm_index_name_hash(const char *name, size_t length) {
+  uint32_t hash = 0x811c9dc5u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+static void string_table_grow(StringTable *table) {
+  const uint32_t capacity =
+      table->slot_capacity ? table->slot_capacity * 2 : 4096;
+  uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+  for (uint32_t i = 0; i < table->slot_capacity; i++) {
+    const uint32_t slot = table->slots[i];
+    if (slot != 0) {
+      const char *string = table->data + slot - 1;
+      uint32_t j = rgbasm_index_name_hash(string, strlen(string)) &
+                   (capacity - 1);
+      while (slots[j] != 0) {
+        j = (j + 1) & (capacity - 1);
+      }
+      slots[j] = slot;
+    }
+  }
+  free(table->slots);
+  table->slots = slots;
+  table->slot_capacity = capacity;
+}
+
+static uint32_t intern(StringTable *table, const char *string) {
+  const size_t length = strlen(string);
+  if ((table->count + 1) * 2 > table->slot_capacity) {
+    string_table_grow(table);
+  }
+  const uint32_t mask = table->slot_capacity - 1;
+  uint32_t i = rgbasm_index_name_hash(string, length) & mask;
+  for (; table->slots[i] != 0; i = (i + 1) & mask) {
+    const char *other = table->data + table->slots[i] - 1;
+    if (memcmp(other, string, length) == 0 && other[length] == '\0') {
+      return table->slots[i] - 1;
+    }
+  }
+  if (table->length + length + 1 > table->capacity) {
+    uint32_t capacity = table->capacity ? table->capacity : 65536;
+    while (table->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    table->data = realloc(table->data, capacity);
+    table->capacity = capacity;
+  }
+  const uint32_t offset = table->length;
+  memcpy(table->data + offset, string, length + 1);
+  table->length += (uint32_t)length + 1;
+  table->slots[i] = offset + 1;
+  table->count += 1;
+  return offset;
+}
+
+static uint32_t offset_hash(uint32_t offset) {
+  return offset * 0x9e3779b1u;
+}
+
+static void name_table_grow(NameTable *table) {
+  const uint32_t capacity =
+      table->slot_capacity ? table->slot_capacity * 2 : 4096;
+  uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+  for (uint32_t i = 0; i < table->count; i++) {
+    uint32_t j = offset_hash(table->names[i].name) & (capacity - 1);
+    while (slots[j] != 0) {
+      j = (j + 1) & (capacity - 1);
+    }
+    slots[j] = i + 1;
+  }
+  free(table->slots);
+  table->slots = slots;
+  table->slot_capacity = capacity;
+}
+
+// The index of the name at string offset `name`, added if it is new.
+static uint32_t name_index(NameTable *table, const StringTable *strings,
+                           uint32_t name) {
+  if ((table->count + 1) * 2 > table->slot_capacity) {
+    name_table_grow(table);
+  }
+  const uint32_t mask = table->slot_capacity - 1;
+  uint32_t i = offset_hash(name) & mask;
+  for (; table->slots[i] != 0; i = (i + 1) & mask) {
+    if (table->names[table->slots[i] - 1].name == name) {
+      return table->slots[i] - 1;
+    }
+  }
+  if (table->count == table->capacity) {
+    table->capacity = table->capacity ? table->capacity * 2 : 1024;
+    table->names =
+        realloc(table->names, table->capacity * sizeof(RgbasmIndexName));
+  }
+  const char *string = strings->data + name;
+  table->names[table->count] = (RgbasmIndexName){
+      .name = name,
+      .hash = rgbasm_index_name_hash(string, strlen(string)),
+  };
+  table->slots[i] = table->count + 1;
+  return table->count++;
+}
+
+static char fold(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+static int compare_keys(const void *a, const void *b) {
+  const uint32_t x = *(const uint32_t *)a;
+  const uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// The distinct lowercased trigrams of `string`, sorted into `*keys` (grown as
+// needed). Returns their number.
+static uint32_t trigrams_of(const char *string, size_t length, uint32_t **keys,
+                            uint32_t *capacity) {
+  if (length < 3) {
+    return 0;
+  }
+  if (length - 2 > *capacity) {
+    *capacity = (uint32_t)length;
+    *keys = realloc(*keys, *capacity * sizeof(uint32_t));
+  }
+  uint32_t count = 0;
+  for (size_t i = 0; i + 2 < length; i++) {
+    (*keys)[count++] = (uint32_t)(unsigned char)fold(string[i]) << 16 |
+                       (uint32_t)(unsigned char)fold(string[i + 1]) << 8 |
+                       (unsigned char)fold(string[i + 2]);
+  }
+  qsort(*keys, count, sizeof(uint32_t), compare_keys);
+  uint32_t distinct = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (distinct == 0 || (*keys)[distinct - 1] != (*keys)[i]) {
+      (*keys)[distinct++] = (*keys)[i];
+    }
+  }
+  return distinct;
+}
+
+// Compares like strcmp, ignoring ASCII case; `length` bytes of `b` at most.
+static int compare_folded(const char *a, const char *b, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    const unsigned char x = (unsigned char)fold(a[i]);
+    const unsigned char y = (unsigned char)fold(b[i]);
+    if (x != y || x == '\0') {
+      return x - y;
+    }
+  }
+  return 0;
+}
+
+typedef struct SearchName {
+  const char *string;
+  uint32_t name;
+} SearchName;
+
+static int compare_search_names(const void *a, const void *b) {
+  const SearchName *x = a;
+  const SearchName *y = b;
+  const int order = compare_folded(x->string, y->string, SIZE_MAX);
+  return order != 0 ? order : strcmp(x->string, y->string);
+}
+
+// The trigram postings of the search names being written.
+typedef struct TrigramTable {
+  RgbasmIndexTrigram *trigrams;
+  uint32_t count;
+  uint32_t *postings;
+  uint32_t posting_count;
+} TrigramTable;
+
+static uint32_t key_hash(uint32_t key) {
+  return key * 0x9e3779b1u;
+}
+
+// Builds the trigram postings in two passes over the names, counting and
+// then filling, so the postings of a trigram come out in name order without
+// sorting them.
+static void build_trigrams(TrigramTable *table, const StringTable *strings,
+                           const RgbasmIndexName *names,
+                           const uint32_t *search_names, uint32_t count) {
+  // trigram key + 1 -> index into `trigrams`, by open addressing
+  uint32_t slot_capacity = 4096;
+  uint32_t *slot_keys = calloc(slot_capacity, sizeof(uint32_t));
+  uint32_t *slot_values = calloc(slot_capacity, sizeof(uint32_t));
+  uint32_t *keys = NULL;
+  uint32_t key_capacity = 0;
+  *table = (TrigramTable){0};
+  uint32_t capacity = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const char *name = strings->data + names[search_names[i]].name;
+    const uint32_t n = trigrams_of(name, strlen(name), &keys, &key_capacity);
+    for (uint32_t j = 0; j < n; j++) {
+      if ((table->count + 1) * 2 > slot_capacity) {
+        const uint32_t grown = slot_capacity * 2;
+        uint32_t *grown_keys = calloc(grown, sizeof(uint32_t));
+        uint32_t *grown_values = calloc(grown, sizeof(uint32_t));
+        for (uint32_t k = 0; k < slot_capacity; k++) {
+          if (slot_keys[k] != 0) {
+            uint32_t m = key_hash(slot_keys[k]) & (grown - 1);
+            while (grown_keys[m] != 0) {
+              m = (m + 1) & (grown - 1);
+            }
+            grown_keys[m] = slot_keys[k];
+            grown_values[m] = slot_values[k];
+          }
+        }
+        free(slot_keys);
+        free(slot_values);
+        slot_keys = grown_keys;
+        slot_values = grown_values;
+        slot_capacity = grown;
+      }
+      uint32_t m = key_hash(keys[j] + 1) & (slot_capacity - 1);
+      while (slot_keys[m] != 0 && slot_keys[m] != keys[j] + 1) {
+        m = (m + 1) & (slot_capacity - 1);
+      }
+      if (slot_keys[m] == 0) {
+        if (table->count == capacity) {
+          capacity = capacity ? capacity * 2 : 4096;
+          table->trigrams = realloc(table->trigrams,
+                                    capacity * sizeof(RgbasmIndexTrigram));
+        }
+        slot_keys[m] = keys[j] + 1;
+        slot_values[m] = table->count;
+        table->trigrams[table->count++] =
+            (RgbasmIndexTrigram){.key = keys[j]};
+      }
+      table->trigrams[slot_values[m]].count += 1;
+      table->posting_count += 1;
+    }
+  }
+
+  // sort the trigrams by key, then lay out their ranges
+  RgbasmIndexTrigram *sorted =
+      calloc(table->count + 1, sizeof(RgbasmIndexTrigram));
+  memcpy(sorted, table->trigrams, table->count * sizeof(RgbasmIndexTrigram));
+  qsort(sorted, table->count, sizeof(RgbasmIndexTrigram), compare_keys);
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < table->count; i++) {
+    sorted[i].first = first;
+    first += sorted[i].count;
+    sorted[i].count = 0;
+    uint32_t m = key_hash(sorted[i].key + 1) & (slot_capacity - 1);
+    while (slot_keys[m] != sorted[i].key + 1) {
+      m = (m + 1) & (slot_capacity - 1);
+    }
+    slot_values[m] = i;
+  }
+  free(table->trigrams);
+  table->trigrams = sorted;
+
+  table->postings = calloc(table->posting_count + 1, sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; i++) {
+    const char *name = strings->data + names[search_names[i]].name;
+    const uint32_t n = trigrams_of(name, strlen(name), &keys, &key_capacity);
+    for (uint32_t j = 0; j < n; j++) {
+      uint32_t m = key_hash(keys[j] + 1) & (slot_capacity - 1);
+      while (slot_keys[m] != keys[j] + 1) {
+        m = (m + 1) & (slot_capacity - 1);
+      }
+      RgbasmIndexTrigram *trigram = &table->trigrams[slot_values[m]];
+      table->postings[trigram->first + trigram->count++] = i;
+    }
+  }
+  free(keys);
+  free(slot_keys);
+  free(slot_values);
+}
+
+static size_t align8(size_t offset) {
+  return (offset + 7) & ~(size_t)7;
+}
+
+// Reserves an 8-byte aligned table of `size` bytes at the end of the file
+// being laid out and returns its offset.
+static uint32_t place(size_t *end, size_t size) {
+  const size_t offset = align8(*end);
+  *end = offset + size;
+  return (uint32_t)offset;
+}
+
+bool rgbasm_index_write(const RgbasmProjectIndex *project, const char *path) {
+  uint64_t include_count = 0;
+  uint64_t symbol_count = 0;
+  uint64_t reference_count = 0;
+  for (size_t i = 0; i < project->count; i++) {
+    const RgbasmFileSymbols *symbols = &project->files[i].symbols;
+    include_count += symbols->include_count;
+    symbol_count += symbols->symbol_count;
+    reference_count += symbols->reference_count;
+  }
+  if (project->count > UINT32_MAX || symbol_count + reference_count > UINT32_MAX) {
+    fprintf(stderr, "%s: too many symbols for the index format\n", path);
+    return false;
+  }
+
+  StringTable strings = {0};
+  NameTable names = {0};
+  intern(&strings, "");
+  RgbasmIndexFile *files = calloc(project->count + 1, sizeof(RgbasmIndexFile));
+  RgbasmIndexInclude *includes =
+      calloc(include_count + 1, sizeof(RgbasmIndexInclude));
+  RgbasmIndexSymbol *symbols =
+      calloc(symbol_count + 1, sizeof(RgbasmIndexSymbol));
+  RgbasmIndexReference *references =
+      calloc(reference_count + 1, sizeof(RgbasmIndexReference));
+  // the name index of every symbol and reference
+  uint32_t *symbol_names = calloc(symbol_count + 1, sizeof(uint32_t));
+  uint32_t *reference_names = calloc(reference_count + 1, sizeof(uint32_t));
+
+  uint32_t include_end = 0;
+  uint32_t symbol_end = 0;
+  uint32_t reference_end = 0;
+  for (uint32_t i = 0; i < project->count; i++) {
+    const RgbasmIndexedFile *file = &project->files[i];
+    const RgbasmFileSymbols *source = &file->symbols;
+    files[i] = (RgbasmIndexFile){
+        .path = intern(&strings, file->path),
+        .flags = file->has_errors ? RGBASM_INDEX_FILE_HAS_ERRORS : 0,
+        .hash = file->hash,
+        .mtime_ns = file->mtime_ns,
+        .size = file->size,
+        .first_include = include_end,
+        .include_count = source->include_count,
+        .first_symbol = symbol_end,
+        .symbol_count = source->symbol_count,
+        .first_reference = reference_end,
+        .reference_count = source->reference_count,
+    };
+    for (uint32_t j = 0; j < source->include_count; j++) {
+      const RgbasmInclude *include = &source->includes[j];
+      includes[include_end++] = (RgbasmIndexInclude){
+          .name = intern(&strings, source->strings + include->name),
+          .path = file->include_paths[j]
+                      ? intern(&strings, file->include_paths[j])
+                      : 0,
+          .row = include->point.row,
+          .column = include->point.column,
+      };
+    }
+    for (uint32_t j = 0; j < source->symbol_count; j++) {
+      const RgbasmSymbol *symbol = &source->symbols[j];
+      const uint32_t name = intern(&strings, source->strings + symbol->name);
+      symbol_names[symbol_end] = name_index(&names, &strings, name);
+      names.names[symbol_names[symbol_end]].symbol_count += 1;
+      symbols[symbol_end++] = (RgbasmIndexSymbol){
+          .name = name,
+          .scope = intern(&strings, source->strings + symbol->scope),
+          .file = i,
+          .kind = symbol->kind,
+          .flags = symbol->flags,
+          .row = symbol->point.row,
+          .column = symbol->point.column,
+          .start_byte = symbol->start_byte,
+          .end_byte = symbol->end_byte,
+      };
+    }
+    for (uint32_t j = 0; j < source->reference_count; j++) {
+      const RgbasmReference *reference = &source->references[j];
+      const uint32_t name =
+          intern(&strings, source->strings + reference->name);
+      reference_names[reference_end] = name_index(&names, &strings, name);
+      names.names[reference_names[reference_end]].reference_count += 1;
+      references[reference_end++] = (RgbasmIndexReference){
+          .name = name,
+          .file = i,
+          .flags = reference->flags,
+          .row = reference->point.row,
+          .column = reference->point.column,
+          .start_byte = reference->start_byte,
+          .end_byte = reference->end_byte,
+      };
+    }
+  }
+
+  // postings: the symbols of every name, then the references of every name
+  const uint32_t posting_count = symbol_end + reference_end;
+  uint32_t *postings = calloc(posting_count + 1, sizeof(uint32_t));
+  uint32_t next_symbol = 0;
+  uint32_t next_reference = symbol_end;
+  for (uint32_t i = 0; i < names.count; i++) {
+    RgbasmIndexName *name = &names.names[i];
+    name->first_symbol = next_symbol;
+    name->first_reference = next_reference;
+    next_symbol += name->symbol_count;
+    next_reference += name->reference_count;
+    // filled below, counted up again
+    name->symbol_count = 0;
+    name->reference_count = 0;
+  }
+  for (uint32_t i = 0; i < symbol_end; i++) {
+    RgbasmIndexName *name = &names.names[symbol_names[i]];
+    postings[name->first_symbol + name->symbol_count++] = i;
+  }
+  for (uint32_t i = 0; i < reference_end; i++) {
+    RgbasmIndexName *name = &names.names[reference_names[i]];
+    postings[name->first_reference + name->reference_count++] = i;
+  }
+
+  uint32_t bucket_count = 16;
+  while (bucket_count < names.count * 2) {
+    bucket_count *= 2;
+  }
+  uint32_t *buckets = calloc(bucket_count, sizeof(uint32_t));
+  for (uint32_t i = 0; i < names.count; i++) {
+    uint32_t j = names.names[i].hash & (bucket_count - 1);
+    while (buckets[j] != 0) {
+      j = (j + 1) & (bucket_count - 1);
+    }
+    buckets[j] = i + 1;
+  }
+
+  // the names worth searching for: those that are defined somewhere
+  bool *defined = calloc(names.count + 1, sizeof(bool));
+  for (uint32_t i = 0; i < symbol_end; i++) {
+    defined[symbol_names[i]] |= symbols[i].kind != RGBASM_SYMBOL_SECTION &&
+                                symbols[i].kind != RGBASM_SYMBOL_EXPORT;
+  }
+  SearchName *sorted = calloc(names.count + 1, sizeof(SearchName));
+  uint32_t search_name_count = 0;
+  for (uint32_t i = 0; i < names.count; i++) {
+    if (defined[i]) {
+      sorted[search_name_count++] =
+          (SearchName){strings.data + names.names[i].name, i};
+    }
+  }
+  qsort(sorted, search_name_count, sizeof(SearchName), compare_search_names);
+  uint32_t *search_names = calloc(search_name_count + 1, sizeof(uint32_t));
+  for (uint32_t i = 0; i < search_name_count; i++) {
+    search_names[i] = sorted[i].name;
+  }
+  free(sorted);
+  free(defined);
+  TrigramTable trigrams;
+  build_trigrams(&trigrams, &strings, names.names, search_names,
+                 search_name_count);
+
+  RgbasmIndexHeader header = {
+      .version = RGBASM_INDEX_VERSION,
+      .byte_order = RGBASM_INDEX_BYTE_ORDER,
+      .strings_size = strings.length,
+      .file_count = (uint32_t)project->count,
+      .include_count = include_end,
+      .symbol_count = symbol_end,
+      .reference_count = reference_end,
+      .name_count = names.count,
+      .posting_count = posting_count,
+      .bucket_count = bucket_count,
+      .search_name_count = search_name_count,
+      .trigram_count = trigrams.count,
+      .trigram_posting_count = trigrams.posting_count,
+  };
+  memcpy(header.magic, RGBASM_INDEX_MAGIC, sizeof(header.magic));
+  size_t end = sizeof(header);
+  header.strings_offset = place(&end, strings.length);
+  header.files_offset = place(&end, project->count * sizeof(RgbasmIndexFile));
+  header.includes_offset =
+      place(&end, include_end * sizeof(RgbasmIndexInclude));
+  header.symbols_offset = place(&end, symbol_end * sizeof(RgbasmIndexSymbol));
+  header.references_offset =
+      place(&end, reference_end * sizeof(RgbasmIndexReference));
+  header.names_offset = place(&end, names.count * sizeof(RgbasmIndexName));
+  header.postings_offset = place(&end, posting_count * sizeof(uint32_t));
+  header.buckets_offset = place(&end, bucket_count * sizeof(uint32_t));
+  header.search_names_offset =
+      place(&end, search_name_count * sizeof(uint32_t));
+  header.trigrams_offset =
+      place(&end, trigrams.count * sizeof(RgbasmIndexTrigram));
+  header.trigram_postings_offset =
+      place(&end, trigrams.posting_count * sizeof(uint32_t));
+  header.size = align8(end);
+
+  bool ok = header.size <= UINT32_MAX;
+  unsigned char *image = ok ? calloc(1, header.size) : NULL;
+  if (image != NULL) {
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + header.strings_offset, strings.data, strings.length);
+    memcpy(image + header.files_offset, files,
+           project->count * sizeof(RgbasmIndexFile));
+    memcpy(image + header.includes_offset, includes,
+           include_end * sizeof(RgbasmIndexInclude));
+    memcpy(image + header.symbols_offset, symbols,
+           symbol_end * sizeof(RgbasmIndexSymbol));
+    memcpy(image + header.references_offset, references,
+           reference_end * sizeof(RgbasmIndexReference));
+    memcpy(image + header.names_offset, names.names,
+           names.count * sizeof(RgbasmIndexName));
+    memcpy(image + header.postings_offset, postings,
+           posting_count * sizeof(uint32_t));
+    memcpy(image + header.buckets_offset, buckets,
+           bucket_count * sizeof(uint32_t));
+    memcpy(image + header.search_names_offset, search_names,
+           search_name_count * sizeof(uint32_t));
+    memcpy(image + header.trigrams_offset, trigrams.trigrams,
+           trigrams.count * sizeof(RgbasmIndexTrigram));
+    memcpy(image + header.trigram_postings_offset, trigrams.postings,
+           trigrams.posting_count * sizeof(uint32_t));
+
+    // readers map the old file until they reopen, so never write into it
+    const size_t temp_size = strlen(path) + 32;
+    char *temp = malloc(temp_size);
+    snprintf(temp, temp_size, "%s.%ld.tmp", path, (long)getpid());
+    FILE *out = fopen(temp, "wb");
+    ok = out != NULL && fwrite(image, 1, header.size, out) == header.size;
+    ok = out != NULL && fclose(out) == 0 && ok;
+    ok = ok && rename(temp, path) == 0;
+    if (!ok) {
+      remove(temp);
+    }
+    free(temp);
+    free(image);
+  } else {
+    ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "%s: could not write index\n", path);
+  }
+
+  free(trigrams.postings);
+  free(trigrams.trigrams);
+  free(search_names);
+  free(buckets);
+  free(postings);
+  free(reference_names);
+  free(symbol_names);
+  free(references);
+  free(symbols);
+  free(includes);
+  free(files);
+  free(names.names);
+  free(names.slots);
+  free(strings.data);
+  free(strings.slots);
+  return ok;
+}
+
+// Whether the table at `offset` with `count` entries of `size` bytes lies in
+// the file and is aligned.
+static bool table_fits(const RgbasmIndexHeader *header, uint32_t offset,
+                       uint32_t count, size_t size) {
+  return offset % 8 == 0 && offset >= sizeof(RgbasmIndexHeader) &&
+         offset <= header->size &&
+         (uint64_t)count * size <= header->size - offset;
+}
+
+// Whether `first + count` entries fit in a table of `size` entries.
+static bool range_fits(uint32_t first, uint32_t count, uint32_t size) {
+  return (uint64_t)first + count <= size;
+}
+
+// Whether every entry of `values[0..count)` is below `bound`.
+static bool all_below(const uint32_t *values, uint32_t count,
+                      uint32_t bound) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (values[i] >= bound) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether the records only refer to strings, records and postings that
+// exist, so lookups, references and searches never leave the mapping. Run
+// once on open, against stale or corrupt files.
+static bool records_valid(const RgbasmIndexView *self) {
+  const RgbasmIndexHeader *header = self->header;
+  const uint32_t strings = header->strings_size;
+  for (uint32_t i = 0; i < header->file_count; i++) {
+    const RgbasmIndexFile *file = &self->files[i];
+    if (file->path >= strings ||
+        !range_fits(file->first_include, file->include_count,
+                    header->include_count) ||
+        !range_fits(file->first_symbol, file->symbol_count,
+                    header->symbol_count) ||
+        !range_fits(file->first_reference, file->reference_count,
+                    header->reference_count)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->include_count; i++) {
+    const RgbasmIndexInclude *include = &self->includes[i];
+    if (include->name >= strings || include->path >= strings) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->symbol_count; i++) {
+    const RgbasmIndexSymbol *symbol = &self->symbols[i];
+    if (symbol->name >= strings || symbol->scope >= strings ||
+        symbol->file >= header->file_count) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->reference_count; i++) {
+    const RgbasmIndexReference *reference = &self->references[i];
+    if (reference->name >= strings ||
+        reference->file >= header->file_count) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->name_count; i++) {
+    const RgbasmIndexName *name = &self->names[i];
+    if (name->name >= strings ||
+        !range_fits(name->first_symbol, name->symbol_count,
+                    header->posting_count) ||
+        !range_fits(name->first_reference, name->reference_count,
+                    header->posting_count) ||
+        !all_below(self->postings + name->first_symbol, name->symbol_count,
+                   header->symbol_count) ||
+        !all_below(self->postings + name->first_reference,
+                   name->reference_count, header->reference_count)) {
+      return false;
+    }
+  }
+  // a probe ends at an empty bucket, so there must be one
+  bool empty = false;
+  for (uint32_t i = 0; i < header->bucket_count; i++) {
+    if (self->buckets[i] > header->name_count) {
+      return false;
+    }
+    empty |= self->buckets[i] == 0;
+  }
+  if (!empty) {
+    return false;
+  }
+  for (uint32_t i = 0; i < header->trigram_count; i++) {
+    if (!range_fits(self->trigrams[i].first, self->trigrams[i].count,
+                    header->trigram_posting_count)) {
+      return false;
+    }
+  }
+  return all_below(self->search_names, header->search_name_count,
+                   header->name_count) &&
+         all_below(self->trigram_postings, header->trigram_posting_count,
+                   header->search_name_count);
+}
+
+bool rgbasm_index_view_open(RgbasmIndexView *self, const char *path) {
+  *self = (RgbasmIndexView){0};
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      (size_t)info.st_size < sizeof(RgbasmIndexHeader)) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  self->data = data;
+  self->size = (size_t)info.st_size;
+
+  const RgbasmIndexHeader *header = data;
+  const bool valid =
+      memcmp(header->magic, RGBASM_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+      header->version == RGBASM_INDEX_VERSION &&
+      header->byte_order == RGBASM_INDEX_BYTE_ORDER &&
+      header->size == self->size &&
+      table_fits(header, header->strings_offset, header->strings_size, 1) &&
+      header->strings_size > 0 &&
+      self->data[header->strings_offset + header->strings_size - 1] == '\0' &&
+      table_fits(header, header->files_offset, header->file_count,
+                 sizeof(RgbasmIndexFile)) &&
+      table_fits(header, header->includes_offset, header->include_count,
+                 sizeof(RgbasmIndexInclude)) &&
+      table_fits(header, header->symbols_offset, header->symbol_count,
+                 sizeof(RgbasmIndexSymbol)) &&
+      table_fits(header, header->references_offset, header->reference_count,
+                 sizeof(RgbasmIndexReference)) &&
+      table_fits(header, header->names_offset, header->name_count,
+                 sizeof(RgbasmIndexName)) &&
+      table_fits(header, header->postings_offset, header->posting_count,
+                 sizeof(uint32_t)) &&
+      table_fits(header, header->buckets_offset, header->bucket_count,
+                 sizeof(uint32_t)) &&
+      header->bucket_count > 0 &&
+      (header->bucket_count & (header->bucket_count - 1)) == 0 &&
+      table_fits(header, header->search_names_offset,
+                 header->search_name_count, sizeof(uint32_t)) &&
+      table_fits(header, header->trigrams_offset, header->trigram_count,
+                 sizeof(RgbasmIndexTrigram)) &&
+      table_fits(header, header->trigram_postings_offset,
+                 header->trigram_posting_count, sizeof(uint32_t));
+  if (!valid) {
+    rgbasm_index_view_close(self);
+    return false;
+  }
+  self->header = header;
+  self->strings = (const char *)self->data + header->strings_offset;
+  self->files = (const void *)(self->data + header->files_offset);
+  self->includes = (const void *)(self->data + header->includes_offset);
+  self->symbols = (const void *)(self->data + header->symbols_offset);
+  self->references = (const void *)(self->data + header->references_offset);
+  self->names = (const void *)(self->data + header->names_offset);
+  self->postings = (const void *)(self->data + header->postings_offset);
+  self->buckets = (const void *)(self->data + header->buckets_offset);
+  self->search_names =
+      (const void *)(self->data + header->search_names_offset);
+  self->trigrams = (const void *)(self->data + header->trigrams_offset);
+  self->trigram_postings =
+      (const void *)(self->data + header->trigram_postings_offset);
+  if (!records_valid(self)) {
+    rgbasm_index_view_close(self);
+    return false;
+  }
+  return true;
+}
+
+void rgbasm_index_view_close(RgbasmIndexView *self) {
+  if (self->data != NULL) {
+    munmap((void *)self->data, self->size);
+  }
+  *self = (RgbasmIndexView){0};
+}
+
+const RgbasmIndexName *rgbasm_index_view_lookup(const RgbasmIndexView *self,
+                                                const char *name,
+                                                size_t length) {
+  const uint32_t hash = rgbasm_index_name_hash(name, length);
+  const uint32_t mask = self->header->bucket_count - 1;
+  uint32_t i = hash & mask;
+  for (uint32_t probes = 0; probes <= mask && self->buckets[i] != 0;
+       probes++, i = (i + 1) & mask) {
+    const RgbasmIndexName *entry = &self->names[self->buckets[i] - 1];
+    if (entry->hash != hash) {
+      continue;
+    }
+    const char *string = self->strings + entry->name;
+    if (strncmp(string, name, length) == 0 && string[length] == '\0') {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+// How `name` contains the lowercased `query`, RGBASM_INDEX_MATCH_FUZZY if
+// it does not.
+static RgbasmIndexMatchKind match_kind(const char *name, size_t name_length,
+                                       const char *query, size_t length) {
+  for (size_t start = 0; start + length <= name_length; start++) {
+    size_t i = 0;
+    while (i < length && fold(name[start + i]) == query[i]) {
+      i++;
+    }
+    if (i == length) {
+      return start > 0                 ? RGBASM_INDEX_MATCH_SUBSTRING
+             : length == name_length ? RGBASM_INDEX_MATCH_EXACT
+                                     : RGBASM_INDEX_MATCH_PREFIX;
+    }
+  }
+  return RGBASM_INDEX_MATCH_FUZZY;
+}
+
+static bool ranks_before(const RgbasmIndexView *self, const RgbasmIndexMatch *a,
+                         const RgbasmIndexMatch *b) {
+  if (a->kind != b->kind) {
+    return a->kind < b->kind;
+  }
+  if (a->similarity != b->similarity) {
+    return a->similarity > b->similarity;
+  }
+  if (a->length != b->length) {
+    return a->length < b->length;
+  }
+  return strcmp(self->strings + self->names[a->name].name,
+                self->strings + self->names[b->name].name) < 0;
+}
+
+// Inserts `match` into the ranked `matches` if it is among the best `limit`.
+static void offer(const RgbasmIndexView *self, RgbasmIndexMatch *matches,
+                  size_t *count, size_t limit, RgbasmIndexMatch match) {
+  if (*count == limit &&
+      (limit == 0 || !ranks_before(self, &match, &matches[limit - 1]))) {
+    return;
+  }
+  size_t i = *count < limit ? (*count)++ : limit - 1;
+  while (i > 0 && ranks_before(self, &match, &matches[i - 1])) {
+    matches[i] = matches[i - 1];
+    i--;
+  }
+  matches[i] = match;
+}
+
+static const RgbasmIndexTrigram *find_trigram(const RgbasmIndexView *self,
+                                              uint32_t key) {
+  uint32_t low = 0;
+  uint32_t high = self->header->trigram_count;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    if (self->trigrams[middle].key == key) {
+      return &self->trigrams[middle];
+    }
+    if (self->trigrams[middle].key < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+static bool posting_contains(const RgbasmIndexView *self,
+                             const RgbasmIndexTrigram *trigram,
+                             uint32_t search_name) {
+  const uint32_t *postings = self->trigram_postings + trigram->first;
+  uint32_t low = 0;
+  uint32_t high = trigram->count;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    if (postings[middle] == search_name) {
+      return true;
+    }
+    if (postings[middle] < search_name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return false;
+}
+
+static int compare_trigram_counts(const void *a, const void *b) {
+  const RgbasmIndexTrigram *x = *(const RgbasmIndexTrigram *const *)a;
+  const RgbasmIndexTrigram *y = *(const RgbasmIndexTrigram *const *)b;
+  return (x->count > y->count) - (x->count < y->count);
+}
+
+// Offers the search name `search_name` that shares `shared` of the query's
+// `trigram_count` trigrams.
+static void offer_name(const RgbasmIndexView *self, const char *query,
+                       size_t length, uint32_t search_name, uint32_t shared,
+                       uint32_t trigram_count, RgbasmIndexMatch *matches,
+                       size_t *count, size_t limit) {
+  // Names sharing fewer than half the query's trigrams are dropped. A typo
+  // touches up to three trigrams, so half still keeps a name one typo off
+  // a query of eight bytes or more, while names that merely share a common
+  // trigram like "ing" do not flood the results. Only a name with all the
+  // trigrams can contain the query; the others are fuzzy matches.
+  if (shared * 2 < trigram_count) {
+    return;
+  }
+  const uint32_t name = self->search_names[search_name];
+  const char *string = self->strings + self->names[name].name;
+  const size_t name_length = strlen(string);
+  RgbasmIndexMatch match = {
+      .name = name,
+      .length = (uint32_t)name_length,
+      .kind = shared < trigram_count
+                  ? RGBASM_INDEX_MATCH_FUZZY
+                  : match_kind(string, name_length, query, length),
+      .similarity = 1,
+  };
+  if (match.kind == RGBASM_INDEX_MATCH_FUZZY) {
+    // the name's trigrams are counted with repeats, close enough
+    const uint32_t name_trigrams =
+        name_length > 2 ? (uint32_t)name_length - 2 : 1;
+    match.similarity =
+        (double)shared / (trigram_count + name_trigrams - shared);
+  }
+  offer(self, matches, count, limit, match);
+}
+
+size_t rgbasm_index_view_search(const RgbasmIndexView *self, const char *query,
+                                size_t length, bool fuzzy,
+                                RgbasmIndexMatch *matches, size_t limit) {
+  char *folded = malloc(length + 1);
+  for (size_t i = 0; i < length; i++) {
+    folded[i] = fold(query[i]);
+  }
+  uint32_t *keys = NULL;
+  uint32_t key_capacity = 0;
+  const uint32_t key_count = trigrams_of(folded, length, &keys, &key_capacity);
+  size_t count = 0;
+
+  if (key_count == 0) {
+    // too short for a trigram: the names starting with it are a range
+    uint32_t low = 0;
+    uint32_t high = self->header->search_name_count;
+    while (low < high) {
+      const uint32_t middle = low + (high - low) / 2;
+      const char *string =
+          self->strings + self->names[self->search_names[middle]].name;
+      if (compare_folded(string, folded, length) < 0) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    for (uint32_t i = low; i < self->header->search_name_count; i++) {
+      const char *string =
+          self->strings + self->names[self->search_names[i]].name;
+      if (compare_folded(string, folded, length) != 0) {
+        break;
+      }
+      offer_name(self, folded, length, i, 0, 0, matches, &count, limit);
+    }
+  } else if (!fuzzy) {
+    // every trigram must occur: walk the rarest one, probe the others
+    const RgbasmIndexTrigram **lists =
+        calloc(key_count, sizeof(RgbasmIndexTrigram *));
+    bool missing = false;
+    for (uint32_t i = 0; i < key_count; i++) {
+      lists[i] = find_trigram(self, keys[i]);
+      missing |= lists[i] == NULL;
+    }
+    if (!missing) {
+      qsort(lists, key_count, sizeof(RgbasmIndexTrigram *),
+            compare_trigram_counts);
+      const uint32_t *postings = self->trigram_postings + lists[0]->first;
+      for (uint32_t i = 0; i < lists[0]->count; i++) {
+        uint32_t j = 1;
+        while (j < key_count && posting_contains(self, lists[j], postings[i])) {
+          j++;
+        }
+        if (j == key_count) {
+          offer_name(self, folded, length, postings[i], key_count, key_count,
+                     matches, &count, limit);
+        }
+      }
+    }
+    free(lists);
+  } else {
+    // count the query trigrams of every name that has one
+    uint8_t *shared = calloc(self->header->search_name_count + 1, 1);
+    uint32_t *touched = NULL;
+    uint32_t touched_count = 0;
+    uint32_t touched_capacity = 0;
+    for (uint32_t i = 0; i < key_count && i < UINT8_MAX; i++) {
+      const RgbasmIndexTrigram *trigram = find_trigram(self, keys[i]);
+      for (uint32_t j = 0; trigram != NULL && j < trigram->count; j++) {
+        const uint32_t name = self->trigram_postings[trigram->first + j];
+        if (shared[name]++ == 0) {
+          if (touched_count == touched_capacity) {
+            touched_capacity = touched_capacity ? touched_capacity * 2 : 1024;
+            touched =
+                realloc(touched, touched_capacity * sizeof(uint32_t));
+          }
+          touched[touched_count++] = name;
+        }
+      }
+    }
+    const uint32_t counted = key_count < UINT8_MAX ? key_count : UINT8_MAX;
+    for (uint32_t i = 0; i < touched_count; i++) {
+      offer_name(self, folded, length, touched[i], shared[touched[i]], counted,
+                 matches, &count, limit);
+    }
+    free(touched);
+    free(shared);
+  }
+  free(keys);
+  free(folded);
+  return count;
+}
+
+const RgbasmIndexFile *rgbasm_index_view_find_file(const RgbasmIndexView *self,
+                                                   const char *path) {
+  uint32_t low = 0;
+  uint32_t high = self->header->file_count;
+  while (low < high) {
+    const uint32_t middle = low + (high - low) / 2;
+    const int order = strcmp(self->strings + self->files[middle].path, path);
+    if (order == 0) {
+      return &self->files[middle];
+    }
+    if (order < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+static uint32_t copy_string(RgbasmFileSymbols *out, const RgbasmIndexView *view,
+                            uint32_t offset) {
+  if (offset == 0) {
+    return 0;
+  }
+  const char *string = view->strings + offset;
+  return rgbasm_file_symbols_add_string(out, string, (uint32_t)strlen(string));
+}
+
+void rgbasm_index_view_load_file(const RgbasmIndexView *self,
+                                 const RgbasmIndexFile *file,
+                                 RgbasmIndexedFile *out) {
+  *out = (RgbasmIndexedFile){
+      .path = strdup(self->strings + file->path),
+      .hash = file->hash,
+      .mtime_ns = file->mtime_ns,
+      .size = file->size,
+      .has_errors = (file->flags & RGBASM_INDEX_FILE_HAS_ERRORS) != 0,
+      .reused = true,
+  };
+  RgbasmFileSymbols *symbols = &out->symbols;
+  rgbasm_file_symbols_init(symbols);
+
+  symbols->include_count = symbols->include_capacity = file->include_count;
+  symbols->includes = calloc(file->include_count + 1, sizeof(RgbasmInclude));
+  out->include_paths = calloc(file->include_count + 1, sizeof(char *));
+  for (uint32_t i = 0; i < file->include_count; i++) {
+    const RgbasmIndexInclude *include = &self->includes[file->first_include + i];
+    symbols->includes[i] = (RgbasmInclude){
+        .name = copy_string(symbols, self, include->name),
+        .point = {include->row, include->column},
+    };
+    if (include->path != 0) {
+      out->include_paths[i] = strdup(self->strings + include->path);
+    }
+  }
+
+  symbols->symbol_count = symbols->symbol_capacity = file->symbol_count;
+  symbols->symbols = calloc(file->symbol_count + 1, sizeof(RgbasmSymbol));
+  for (uint32_t i = 0; i < file->symbol_count; i++) {
+    const RgbasmIndexSymbol *symbol = &self->symbols[file->first_symbol + i];
+    symbols->symbols[i] = (RgbasmSymbol){
+        .name = copy_string(symbols, self, symbol->name),
+        .scope = copy_string(symbols, self, symbol->scope),
+        .kind = symbol->kind,
+        .flags = symbol->flags,
+        .point = {symbol->row, symbol->column},
+        .start_byte = symbol->start_byte,
+        .end_byte = symbol->end_byte,
+    };
+  }
+
+  symbols->reference_count = symbols->reference_capacity =
+      file->reference_count;
+  symbols->references =
+      calloc(file->reference_count + 1, sizeof(RgbasmReference));
+  for (uint32_t i = 0; i < file->reference_count; i++) {
+    const RgbasmIndexReference *reference =
+        &self->references[file->first_reference + i];
+    symbols->references[i] = (RgbasmReference){
+        .name = copy_string(symbols, self, reference->name),
+        .flags = reference->flags,
+        .point = {reference->row, reference->column},
+        .start_byte = reference->start_byte,
+        .end_byte = reference->end_byte,
+    };
+  }
+}
+
+void rgbasm_index_view_load(const RgbasmIndexView *self,
+                            RgbasmProjectIndex *out) {
+  out->count = self->header->file_count;
+  out->files = calloc(out->count + 1, sizeof(RgbasmIndexedFile));
+  for (size_t i = 0; i < out->count; i++) {
+    rgbasm_index_view_load_file(self, &self->files[i], &out->files[i]);
+  }
+}
@@ -0,0 +1,206 @@
+#ifndef RGBASM_TOOLS_INDEX_FORMAT_H_
+#define RGBASM_TOOLS_INDEX_FORMAT_H_
+
+#include "indexer.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The on-disk project index.
+//
+// A single file that is mapped read-only by the tools and by the Neovim plugin
+// (lua/rgbds/index.lua, through the LuaJIT FFI), so a lookup touches only the
+// pages it needs and nothing is parsed on load. All integers are in the byte
+// order of the writer; a reader that sees another `byte_order` or `version`
+// rebuilds the index. Offsets are from the start of the file and every table
+// is 8-byte aligned.
+//
+//   header
+//   strings      NUL terminated, deduplicated, offset 0 is ""
+//   files        sorted by path, each owns a range of includes, symbols and
+//                references
+//   includes     in source order per file
+//   symbols      definitions, in source order per file
+//   references   in source order per file
+//   names        every defined or referenced name with its postings
+//   postings     symbol and reference indices, grouped by name
+//   buckets      open addressing over names by FNV-1a, name index + 1 or 0
+//   search names the names with a definition other than a section or an
+//                export, sorted by their ASCII lowercased text
+//   trigrams     every trigram of the search names, ASCII lowercased and
+//                sorted, each owning a range of trigram postings
+//   trigram postings
+//                search name indices, ascending per trigram
+//
+// A name is looked up in O(1): hash it, probe `buckets` linearly and compare
+// the strings of the names found. The postings of a name list its
+// definitions and references in file and source order.
+//
+// Substring search intersects the postings of the query's trigrams and
+// checks the few names left; fuzzy search counts the trigrams each name
+// shares with the query instead, so a typo costs only the trigrams it
+// touches. Queries shorter than a trigram match name prefixes only, a binary
+// search in the search names.
+//
+// Files are stored whole, so an update re-parses only files whose mtime, size
+// and content hash changed and copies the records of the others (see
+// RgbasmIndexOptions.previous). The new index is written next to the old one
+// and renamed over it, so mapped readers keep a consistent view.
+
+#define RGBASM_INDEX_MAGIC "RGBDSIDX"
+#define RGBASM_INDEX_VERSION 2
+#define RGBASM_INDEX_BYTE_ORDER 0x01020304u
+// Name of the index in a project's root directory.
+#define RGBASM_INDEX_FILE_NAME ".rgbds-index"
+
+enum {
+  RGBASM_INDEX_FILE_HAS_ERRORS = 1 << 0,
+};
+
+typedef struct RgbasmIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t size; // of the whole file
+  uint32_t strings_offset, strings_size;
+  uint32_t files_offset, file_count;
+  uint32_t includes_offset, include_count;
+  uint32_t symbols_offset, symbol_count;
+  uint32_t references_offset, reference_count;
+  uint32_t names_offset, name_count;
+  uint32_t postings_offset, posting_count;
+  uint32_t buckets_offset, bucket_count; // a power of two
+  uint32_t search_names_offset, search_name_count;
+  uint32_t trigrams_offset, trigram_count;
+  uint32_t trigram_postings_offset, trigram_posting_count;
+} RgbasmIndexHeader;
+
+typedef struct RgbasmIndexFile {
+  uint32_t path; // canonical
+  uint32_t flags;
+  uint64_t hash; // rgbasm_content_hash
+  int64_t mtime_ns;
+  uint64_t size;
+  uint32_t first_include, include_count;
+  uint32_t first_symbol, symbol_count;
+  uint32_t first_reference, reference_count;
+} RgbasmIndexFile;
+
+typedef struct RgbasmIndexInclude {
+  uint32_t name; // as written
+  uint32_t path; // canonical, 0 if it was not found
+  uint32_t row, column;
+} RgbasmIndexInclude;
+
+typedef struct RgbasmIndexSymbol {
+  uint32_t name;
+  uint32_t scope;
+  uint32_t file;
+  uint8_t kind; // RgbasmSymbolKind
+  uint8_t flags;
+  uint16_t reserved;
+  uint32_t row, column;
+  uint32_t start_byte, end_byte;
+} RgbasmIndexSymbol;
+
+typedef struct RgbasmIndexReference {
+  uint32_t name;
+  uint32_t file;
+  uint8_t flags;
+  uint8_t reserved[3];
+  uint32_t row, column;
+  uint32_t start_byte, end_byte;
+} RgbasmIndexReference;
+
+typedef struct RgbasmIndexName {
+  uint32_t name;
+  uint32_t hash;
+  // ranges of `postings`, holding symbol and reference indices
+  uint32_t first_symbol, symbol_count;
+  uint32_t first_reference, reference_count;
+} RgbasmIndexName;
+
+typedef struct RgbasmIndexTrigram {
+  uint32_t key; // the three lowercased bytes, first byte highest
+  uint32_t first, count; // range of trigram postings
+} RgbasmIndexTrigram;
+
+// A mapped index. The pointers are into the mapping.
+typedef struct RgbasmIndexView {
+  const unsigned char *data;
+  size_t size;
+  const RgbasmIndexHeader *header;
+  const char *strings;
+  const RgbasmIndexFile *files;
+  const RgbasmIndexInclude *includes;
+  const RgbasmIndexSymbol *symbols;
+  const RgbasmIndexReference *references;
+  const RgbasmIndexName *names;
+  const uint32_t *postings;
+  const uint32_t *buckets;
+  const uint32_t *search_names;
+  const RgbasmIndexTrigram *trigrams;
+  const uint32_t *trigram_postings;
+} RgbasmIndexView;
+
+// How a name matched a search, better first.
+typedef enum RgbasmIndexMatchKind {
+  RGBASM_INDEX_MATCH_EXACT,
+  RGBASM_INDEX_MATCH_PREFIX,
+  RGBASM_INDEX_MATCH_SUBSTRING,
+  RGBASM_INDEX_MATCH_FUZZY, // shares at least half the query's trigrams
+} RgbasmIndexMatchKind;
+
+typedef struct RgbasmIndexMatch {
+  uint32_t name; // index into `names`
+  uint32_t length;
+  RgbasmIndexMatchKind kind;
+  // of the trigram sets (Jaccard), 1 for substring matches
+  double similarity;
+} RgbasmIndexMatch;
+
+// 32-bit FNV-1a of a name, the hash of the bucket table.
+uint32_t rgbasm_index_name_hash(const char *name, size_t length);
+
+// Writes the index of `project` to `path` atomically. Returns false and
+// leaves `path` untouched if it could not be written.
+bool rgbasm_index_write(const RgbasmProjectIndex *project, const char *path);
+
+// Maps `path` and checks its header, its table bounds and that every record
+// refers to strings, records and postings within them. Returns false if it
+// does not exist or is not a valid index of this version.
+bool rgbasm_index_view_open(RgbasmIndexView *self, const char *path);
+void rgbasm_index_view_close(RgbasmIndexView *self);
+
+// The definitions and references of `name`, or NULL if it is neither.
+const RgbasmIndexName *rgbasm_index_view_lookup(const RgbasmIndexView *self,
+                                                const char *name,
+                                                size_t length);
+// Finds up to `limit` defined names containing `query`, ignoring ASCII case,
+// or with `fuzzy` also names similar to it. Queries of one or two bytes
+// only find names starting with them. The matches are ranked by kind,
+// then similarity, then shorter names first. Returns the number of matches.
+size_t rgbasm_index_view_search(const RgbasmIndexView *self, const char *query,
+                                size_t length, bool fuzzy,
+                                RgbasmIndexMatch *matches, size_t limit);
+// The record of the file with canonical path `path`, or NULL.
+const RgbasmIndexFile *rgbasm_index_view_find_file(const RgbasmIndexView *self,
+                                                   const char *path);
+
+static inline const char *rgbasm_index_view_string(const RgbasmIndexView *self,
+                                                   uint32_t offset) {
+  return self->strings + offset;
+}
+
+// Rebuilds the indexed file `file` of the view, e.g. to carry it over into a
+// new index unchanged.
+void rgbasm_index_view_load_file(const RgbasmIndexView *self,
+                                 const RgbasmIndexFile *file,
+                                 RgbasmIndexedFile *out);
+// Rebuilds the whole project index of the view, e.g. to update it with
+// rgbasm_index_update.
+void rgbasm_index_view_load(const RgbasmIndexView *self,
+                            RgbasmProjectIndex *out);
+
+#endif // RGBASM_TOOLS_INDEX_FORMAT_H_
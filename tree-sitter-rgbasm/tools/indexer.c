@@ -0,0 +1,688 @@
+#define _XOPEN_SOURCE 700 // realpath
+
+#include "indexer.h"
+
+#include "index_format.h"
+#include "pool.h"
+#include "util.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+// Canonical paths already queued, so every file is parsed once.
+typedef struct PathSet {
+  char **slots;
+  size_t capacity;
+  size_t count;
+} PathSet;
+
+typedef struct Indexer {
+  const RgbasmIndexOptions *options;
+  PathList fallback_dirs; // directories of the roots
+  TSParser **parsers;     // one per worker, created on first use
+  // the index being updated, read-only while the pool runs
+  const RgbasmProjectIndex *existing;
+  pthread_mutex_t lock; // guards `queued`, `files` and `failed`
+  PathSet queued;
+  RgbasmIndexedFile *files;
+  size_t count;
+  size_t capacity;
+  bool failed;
+} Indexer;
+
+uint64_t rgbasm_content_hash(const char *data, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint64_t path_hash(const char *path) {
+  return rgbasm_content_hash(path, strlen(path));
+}
+
+// Returns false if `path` was already in the set. Takes ownership otherwise.
+static bool path_set_insert(PathSet *set, char *path) {
+  if ((set->count + 1) * 2 > set->capacity) {
+    const size_t capacity = set->capacity ? set->capacity * 2 : 256;
+    char **slots = calloc(capacity, sizeof(char *));
+    for (size_t i = 0; i < set->capacity; i++) {
+      if (set->slots[i] != NULL) {
+        size_t j = path_hash(set->slots[i]) & (capacity - 1);
+        while (slots[j] != NULL) {
+          j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = set->slots[i];
+      }
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+  }
+  size_t i = path_hash(path) & (set->capacity - 1);
+  while (set->slots[i] != NULL) {
+    if (strcmp(set->slots[i], path) == 0) {
+      return false;
+    }
+    i = (i + 1) & (set->capacity - 1);
+  }
+  set->slots[i] = path;
+  set->count += 1;
+  return true;
+}
+
+static bool path_set_contains(const PathSet *set, const char *path) {
+  if (set->capacity == 0) {
+    return false;
+  }
+  size_t i = path_hash(path) & (set->capacity - 1);
+  while (set->slots[i] != NULL) {
+    if (strcmp(set->slots[i], path) == 0) {
+      return true;
+    }
+    i = (i + 1) & (set->capacity - 1);
+  }
+  return false;
+}
+
+static void path_set_add(PathSet *set, const char *path) {
+  char *copy = strdup(path);
+  if (!path_set_insert(set, copy)) {
+    free(copy);
+  }
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void path_set_free(PathSet *set) {
+  for (size_t i = 0; i < set->capacity; i++) {
+    free(set->slots[i]);
+  }
+  free(set->slots);
+}
+
+static bool is_file(const char *path) {
+  struct stat info;
+  return stat(path, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+// The canonical path of `name` in `dir` if it is a file.
+static char *resolve_in(const char *dir, const char *name) {
+  char buffer[PATH_MAX];
+  if (dir != NULL) {
+    if (snprintf(buffer, sizeof(buffer), "%s/%s", dir, name) >=
+        (int)sizeof(buffer)) {
+      return NULL;
+    }
+    name = buffer;
+  }
+  return is_file(name) ? realpath(name, NULL) : NULL;
+}
+
+static char *resolve_include(const Indexer *indexer, const char *includer,
+                             const char *name) {
+  if (name[0] == '/') {
+    return resolve_in(NULL, name);
+  }
+  char *path = resolve_in(NULL, name);
+  const RgbasmIndexOptions *options = indexer->options;
+  for (size_t i = 0; path == NULL && i < options->include_dir_count; i++) {
+    path = resolve_in(options->include_dirs[i], name);
+  }
+  if (path == NULL) {
+    char *dir = strdup(includer);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL) {
+      *slash = '\0';
+      path = resolve_in(dir, name);
+    }
+    free(dir);
+  }
+  for (size_t i = 0; path == NULL && i < indexer->fallback_dirs.count; i++) {
+    path = resolve_in(indexer->fallback_dirs.items[i], name);
+  }
+  return path;
+}
+
+static int compare_files(const void *a, const void *b) {
+  return strcmp(((const RgbasmIndexedFile *)a)->path,
+                ((const RgbasmIndexedFile *)b)->path);
+}
+
+static RgbasmIndexedFile *find_indexed(const RgbasmProjectIndex *index,
+                                       const char *path) {
+  const RgbasmIndexedFile key = {.path = (char *)path};
+  return bsearch(&key, index->files, index->count, sizeof(RgbasmIndexedFile),
+                 compare_files);
+}
+
+// Queues `path` (canonical, owned) unless it was seen before.
+static void enqueue(Indexer *indexer, RgbasmPool *pool, unsigned worker,
+                    char *path) {
+  if (indexer->existing != NULL && find_indexed(indexer->existing, path)) {
+    free(path);
+    return;
+  }
+  pthread_mutex_lock(&indexer->lock);
+  const bool inserted = path_set_insert(&indexer->queued, path);
+  pthread_mutex_unlock(&indexer->lock);
+  if (inserted) {
+    // the set owns `path` until the pool is drained
+    rgbasm_pool_submit(pool, worker, path);
+  } else {
+    free(path);
+  }
+}
+
+static void mark_failed(Indexer *indexer, const char *path) {
+  fprintf(stderr, "%s: could not read file\n", path);
+  pthread_mutex_lock(&indexer->lock);
+  indexer->failed = true;
+  pthread_mutex_unlock(&indexer->lock);
+}
+
+static int64_t mtime_ns(const struct stat *info) {
+  return (int64_t)info->st_mtim.tv_sec * 1000000000 + info->st_mtim.tv_nsec;
+}
+
+typedef enum ReadResult {
+  READ_FAILED,
+  READ_DONE,
+  READ_UNCHANGED, // the file being updated has the same contents
+} ReadResult;
+
+// Reads and parses `path` unless its content is that of `old` or `current`.
+static ReadResult read_file(Indexer *indexer, unsigned worker,
+                            const char *path, const struct stat *info,
+                            const RgbasmIndexFile *old,
+                            const RgbasmIndexedFile *current,
+                            RgbasmIndexedFile *file) {
+  Source source;
+  if (!source_read(path, &source)) {
+    return READ_FAILED;
+  }
+  const uint64_t hash = rgbasm_content_hash(source.data, source.length);
+  if (current != NULL && current->hash == hash) {
+    source_free(&source);
+    return READ_UNCHANGED;
+  }
+  if (old != NULL && old->hash == hash) {
+    // touched but not changed
+    source_free(&source);
+    rgbasm_index_view_load_file(indexer->options->previous, old, file);
+    file->mtime_ns = mtime_ns(info);
+    return READ_DONE;
+  }
+
+  if (indexer->parsers[worker] == NULL) {
+    indexer->parsers[worker] = ts_parser_new();
+    ts_parser_set_language(indexer->parsers[worker], tree_sitter_rgbasm());
+  }
+  TSTree *tree = ts_parser_parse_string(indexer->parsers[worker], NULL,
+                                        source.data, source.length);
+  const TSNode root = ts_tree_root_node(tree);
+
+  *file = (RgbasmIndexedFile){
+      .path = strdup(path),
+      .hash = hash,
+      .mtime_ns = mtime_ns(info),
+      .size = (uint64_t)info->st_size,
+      .has_errors = ts_node_has_error(root),
+  };
+  rgbasm_file_symbols_init(&file->symbols);
+  rgbasm_extract_symbols(&file->symbols, root, source.data);
+  if (indexer->options->on_tree != NULL) {
+    indexer->options->on_tree(indexer->parsers[worker], path, source.data,
+                              root, indexer->options->on_tree_context);
+  }
+  ts_tree_delete(tree);
+  source_free(&source);
+  return READ_DONE;
+}
+
+static void index_file(RgbasmPool *pool, unsigned worker, void *task,
+                       void *context) {
+  Indexer *indexer = context;
+  const char *path = task;
+
+  struct stat info;
+  if (stat(path, &info) != 0) {
+    mark_failed(indexer, path);
+    return;
+  }
+  const RgbasmIndexView *previous = indexer->options->previous;
+  const RgbasmIndexFile *old =
+      previous ? rgbasm_index_view_find_file(previous, path) : NULL;
+  const RgbasmIndexedFile *current =
+      indexer->existing ? find_indexed(indexer->existing, path) : NULL;
+  RgbasmIndexedFile file;
+  if (old != NULL && old->mtime_ns == mtime_ns(&info) &&
+      old->size == (uint64_t)info.st_size) {
+    rgbasm_index_view_load_file(previous, old, &file);
+  } else {
+    switch (read_file(indexer, worker, path, &info, old, current, &file)) {
+    case READ_FAILED:
+      mark_failed(indexer, path);
+      return;
+    case READ_UNCHANGED:
+      return;
+    case READ_DONE:
+      break;
+    }
+  }
+
+  // resolved again for reused files too, a new file may shadow the old one
+  const uint32_t include_count = file.symbols.include_count;
+  if (file.include_paths == NULL) {
+    file.include_paths =
+        calloc(include_count ? include_count : 1, sizeof(char *));
+  }
+  for (uint32_t i = 0; i < include_count; i++) {
+    const char *name = file.symbols.strings + file.symbols.includes[i].name;
+    free(file.include_paths[i]);
+    file.include_paths[i] = resolve_include(indexer, path, name);
+    if (file.include_paths[i] != NULL && indexer->options->follow_includes) {
+      enqueue(indexer, pool, worker, strdup(file.include_paths[i]));
+    }
+  }
+
+  if (indexer->options->on_file != NULL) {
+    indexer->options->on_file(&file, indexer->options->on_file_context);
+  }
+
+  pthread_mutex_lock(&indexer->lock);
+  if (indexer->count == indexer->capacity) {
+    indexer->capacity = indexer->capacity ? indexer->capacity * 2 : 64;
+    indexer->files = realloc(indexer->files,
+                             indexer->capacity * sizeof(RgbasmIndexedFile));
+  }
+  indexer->files[indexer->count++] = file;
+  pthread_mutex_unlock(&indexer->lock);
+}
+
+// Sets up `indexer` and its pool. Collects the files of `paths` into `roots`
+// and the directories among them as fallback include directories.
+static RgbasmPool *indexer_start(Indexer *indexer,
+                                 const RgbasmIndexOptions *options,
+                                 const char *const *paths, size_t path_count,
+                                 PathList *roots) {
+  const unsigned threads =
+      options->threads ? options->threads : rgbasm_pool_default_threads();
+  *indexer = (Indexer){
+      .options = options,
+      .parsers = calloc(threads, sizeof(TSParser *)),
+  };
+  pthread_mutex_init(&indexer->lock, NULL);
+  RgbasmPool *pool = rgbasm_pool_new(threads, index_file, indexer);
+  if (pool == NULL) {
+    pthread_mutex_destroy(&indexer->lock);
+    free(indexer->parsers);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < path_count; i++) {
+    struct stat info;
+    if (stat(paths[i], &info) != 0) {
+      fprintf(stderr, "%s: could not read file\n", paths[i]);
+      indexer->failed = true;
+    } else if (S_ISDIR(info.st_mode)) {
+      path_list_push(&indexer->fallback_dirs, paths[i]);
+      if (roots != NULL) {
+        path_list_collect(roots, paths[i]);
+      }
+    } else if (roots != NULL) {
+      path_list_push(roots, paths[i]);
+    }
+  }
+  return pool;
+}
+
+static void indexer_finish(Indexer *indexer, RgbasmPool *pool) {
+  rgbasm_pool_delete(pool);
+  const unsigned threads = indexer->options->threads
+                               ? indexer->options->threads
+                               : rgbasm_pool_default_threads();
+  for (unsigned i = 0; i < threads; i++) {
+    if (indexer->parsers[i] != NULL) {
+      ts_parser_delete(indexer->parsers[i]);
+    }
+  }
+  free(indexer->parsers);
+  path_set_free(&indexer->queued);
+  path_list_free(&indexer->fallback_dirs);
+  pthread_mutex_destroy(&indexer->lock);
+  free(indexer->files);
+}
+
+bool rgbasm_index_project(const char *const *paths, size_t path_count,
+                          const RgbasmIndexOptions *options,
+                          RgbasmProjectIndex *index) {
+  Indexer indexer;
+  PathList roots = {0};
+  RgbasmPool *pool =
+      indexer_start(&indexer, options, paths, path_count, &roots);
+  if (pool == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < roots.count; i++) {
+    char *path = realpath(roots.items[i], NULL);
+    if (path != NULL) {
+      enqueue(&indexer, pool, RGBASM_POOL_ANY_WORKER, path);
+    }
+  }
+  rgbasm_pool_wait(pool);
+  path_list_free(&roots);
+
+  qsort(indexer.files, indexer.count, sizeof(RgbasmIndexedFile),
+        compare_files);
+  index->files = indexer.files;
+  index->count = indexer.count;
+  indexer.files = NULL;
+  const bool failed = indexer.failed;
+  indexer_finish(&indexer, pool);
+  return !failed;
+}
+
+static const char *base_name(const char *path) {
+  const char *slash = strrchr(path, '/');
+  return slash ? slash + 1 : path;
+}
+
+static bool path_list_contains(const PathList *list, const char *path) {
+  for (size_t i = 0; i < list->count; i++) {
+    if (strcmp(list->items[i], path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether an INCLUDE of `name` may resolve to one of the created files.
+static bool may_resolve_to(const PathList *created, const char *name) {
+  for (size_t i = 0; i < created->count; i++) {
+    if (strcmp(base_name(created->items[i]), base_name(name)) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether `path` is one of the given files or an rgbasm file below one of the
+// given directories, all canonical.
+static bool is_root(const PathList *roots, const char *path) {
+  for (size_t i = 0; i < roots->count; i++) {
+    const char *root = roots->items[i];
+    const size_t length = strlen(root);
+    if (strcmp(root, path) == 0 ||
+        (strncmp(root, path, length) == 0 && path[length] == '/' &&
+         is_rgbasm_path(path))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Queues a changed file even though it is indexed already.
+static void submit_changed(Indexer *indexer, RgbasmPool *pool,
+                           const char *path) {
+  char *copy = strdup(path);
+  pthread_mutex_lock(&indexer->lock);
+  const bool inserted = path_set_insert(&indexer->queued, copy);
+  pthread_mutex_unlock(&indexer->lock);
+  if (inserted) {
+    rgbasm_pool_submit(pool, RGBASM_POOL_ANY_WORKER, copy);
+  } else {
+    free(copy);
+  }
+}
+
+// Moves the files parsed by the pool into `index`, replacing their records.
+static void merge_parsed(Indexer *indexer, RgbasmProjectIndex *index,
+                         PathSet *dirty) {
+  if (indexer->count == 0) {
+    return;
+  }
+  index->files = realloc(index->files, (index->count + indexer->count) *
+                                           sizeof(RgbasmIndexedFile));
+  const size_t sorted = index->count;
+  for (size_t i = 0; i < indexer->count; i++) {
+    RgbasmIndexedFile *file = &indexer->files[i];
+    path_set_add(dirty, file->path);
+    const RgbasmProjectIndex old = {index->files, sorted};
+    RgbasmIndexedFile *current = find_indexed(&old, file->path);
+    if (current != NULL) {
+      rgbasm_indexed_file_free(current);
+      *current = *file;
+    } else {
+      index->files[index->count++] = *file;
+    }
+  }
+  indexer->count = 0;
+  qsort(index->files, index->count, sizeof(RgbasmIndexedFile), compare_files);
+}
+
+// Drops the files for which `drop` is set, keeping the order.
+static void remove_files(RgbasmProjectIndex *index, const bool *drop,
+                         PathSet *dirty) {
+  size_t kept = 0;
+  for (size_t i = 0; i < index->count; i++) {
+    if (drop[i]) {
+      path_set_add(dirty, index->files[i].path);
+      rgbasm_indexed_file_free(&index->files[i]);
+    } else {
+      index->files[kept++] = index->files[i];
+    }
+  }
+  index->count = kept;
+}
+
+// Drops the files no root reaches through includes any more.
+static void remove_unreachable(RgbasmProjectIndex *index,
+                               const PathList *roots, PathSet *dirty) {
+  bool *reached = calloc(index->count + 1, sizeof(bool));
+  size_t *stack = malloc((index->count + 1) * sizeof(size_t));
+  size_t depth = 0;
+  for (size_t i = 0; i < index->count; i++) {
+    if (is_root(roots, index->files[i].path)) {
+      reached[i] = true;
+      stack[depth++] = i;
+    }
+  }
+  while (depth > 0) {
+    const RgbasmIndexedFile *file = &index->files[stack[--depth]];
+    for (uint32_t j = 0; j < file->symbols.include_count; j++) {
+      const RgbasmIndexedFile *included =
+          file->include_paths[j] ? find_indexed(index, file->include_paths[j])
+                                 : NULL;
+      if (included != NULL && !reached[included - index->files]) {
+        reached[included - index->files] = true;
+        stack[depth++] = (size_t)(included - index->files);
+      }
+    }
+  }
+  for (size_t i = 0; i < index->count; i++) {
+    reached[i] = !reached[i];
+  }
+  remove_files(index, reached, dirty);
+  free(stack);
+  free(reached);
+}
+
+bool rgbasm_index_update(RgbasmProjectIndex *index, const char *const *paths,
+                         size_t path_count, const char *const *changed,
+                         size_t changed_count,
+                         const RgbasmIndexOptions *options,
+                         RgbasmIndexChanges *changes) {
+  *changes = (RgbasmIndexChanges){0};
+  Indexer indexer;
+  RgbasmPool *pool = indexer_start(&indexer, options, paths, path_count, NULL);
+  if (pool == NULL) {
+    return false;
+  }
+  indexer.existing = index;
+  PathList roots = {0};
+  for (size_t i = 0; i < path_count; i++) {
+    char *root = realpath(paths[i], NULL);
+    if (root != NULL) {
+      path_list_push(&roots, root);
+      free(root);
+    }
+  }
+
+  // parsed again, added or removed; then their includers
+  PathSet dirty = {0};
+  PathList removed = {0};
+  PathList created = {0};
+  for (size_t i = 0; i < changed_count; i++) {
+    const char *path = changed[i];
+    RgbasmIndexedFile *current = find_indexed(index, path);
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+      if (current != NULL) {
+        path_list_push(&removed, path);
+      }
+    } else if (current != NULL) {
+      // kept as is if only the mtime changed, replaced otherwise
+      current->mtime_ns = mtime_ns(&info);
+      current->size = (uint64_t)info.st_size;
+      submit_changed(&indexer, pool, path);
+    } else {
+      path_list_push(&created, path);
+      if (is_root(&roots, path)) {
+        submit_changed(&indexer, pool, path);
+      }
+    }
+  }
+  rgbasm_pool_wait(pool);
+  bool includes_changed = indexer.count > 0 || removed.count > 0;
+  merge_parsed(&indexer, index, &dirty);
+
+  if (removed.count > 0) {
+    bool *drop = calloc(index->count + 1, sizeof(bool));
+    for (size_t i = 0; i < index->count; i++) {
+      drop[i] = path_list_contains(&removed, index->files[i].path);
+    }
+    remove_files(index, drop, &dirty);
+    free(drop);
+  }
+
+  // includes of removed files may resolve elsewhere now, unresolved ones to
+  // a created file
+  for (size_t i = 0; i < index->count; i++) {
+    RgbasmIndexedFile *file = &index->files[i];
+    for (uint32_t j = 0; j < file->symbols.include_count; j++) {
+      const char *name = file->symbols.strings + file->symbols.includes[j].name;
+      char *old = file->include_paths[j];
+      if (old != NULL ? !path_list_contains(&removed, old)
+                      : !may_resolve_to(&created, name)) {
+        continue;
+      }
+      char *path = resolve_include(&indexer, file->path, name);
+      if ((old == NULL) != (path == NULL) ||
+          (path != NULL && strcmp(old, path) != 0)) {
+        path_set_add(&dirty, file->path);
+        includes_changed = true;
+      }
+      free(old);
+      file->include_paths[j] = path;
+      if (path != NULL && options->follow_includes) {
+        enqueue(&indexer, pool, RGBASM_POOL_ANY_WORKER, strdup(path));
+      }
+    }
+  }
+  rgbasm_pool_wait(pool);
+  merge_parsed(&indexer, index, &dirty);
+  if (includes_changed) {
+    remove_unreachable(index, &roots, &dirty);
+  }
+
+  // everything that includes a changed file, directly or not
+  for (bool grew = true; grew;) {
+    grew = false;
+    for (size_t i = 0; i < index->count; i++) {
+      const RgbasmIndexedFile *file = &index->files[i];
+      if (path_set_contains(&dirty, file->path)) {
+        continue;
+      }
+      for (uint32_t j = 0; j < file->symbols.include_count; j++) {
+        if (file->include_paths[j] != NULL &&
+            path_set_contains(&dirty, file->include_paths[j])) {
+          path_set_add(&dirty, file->path);
+          grew = true;
+          break;
+        }
+      }
+    }
+  }
+  changes->files = calloc(dirty.count + 1, sizeof(char *));
+  for (size_t i = 0; i < dirty.capacity; i++) {
+    if (dirty.slots[i] != NULL) {
+      changes->files[changes->count++] = dirty.slots[i];
+      dirty.slots[i] = NULL;
+    }
+  }
+  qsort(changes->files, changes->count, sizeof(char *), compare_paths);
+
+  const bool failed = indexer.failed;
+  path_set_free(&dirty);
+  path_list_free(&removed);
+  path_list_free(&created);
+  path_list_free(&roots);
+  indexer_finish(&indexer, pool);
+  return !failed;
+}
+
+void rgbasm_index_changes_free(RgbasmIndexChanges *changes) {
+  for (size_t i = 0; i < changes->count; i++) {
+    free(changes->files[i]);
+  }
+  free(changes->files);
+  *changes = (RgbasmIndexChanges){0};
+}
+
+void rgbasm_indexed_file_free(RgbasmIndexedFile *file) {
+  for (uint32_t i = 0; i < file->symbols.include_count; i++) {
+    free(file->include_paths[i]);
+  }
+  free(file->include_paths);
+  rgbasm_file_symbols_free(&file->symbols);
+  free(file->path);
+}
+
+void rgbasm_project_index_copy(RgbasmProjectIndex *index,
+                               const RgbasmProjectIndex *from) {
+  index->count = from->count;
+  index->files = calloc(from->count + 1, sizeof(RgbasmIndexedFile));
+  for (size_t i = 0; i < from->count; i++) {
+    const RgbasmIndexedFile *file = &from->files[i];
+    RgbasmIndexedFile *copy = &index->files[i];
+    *copy = *file;
+    copy->path = strdup(file->path);
+    rgbasm_file_symbols_copy(&copy->symbols, &file->symbols);
+    copy->include_paths =
+        calloc(file->symbols.include_count + 1, sizeof(char *));
+    for (uint32_t j = 0; j < file->symbols.include_count; j++) {
+      if (file->include_paths != NULL && file->include_paths[j] != NULL) {
+        copy->include_paths[j] = strdup(file->include_paths[j]);
+      }
+    }
+  }
+}
+
+void rgbasm_project_index_free(RgbasmProjectIndex *index) {
+  for (size_t i = 0; i < index->count; i++) {
+    rgbasm_indexed_file_free(&index->files[i]);
+  }
+  free(index->files);
+  index->files = NULL;
+  index->count = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef RGBASM_TOOLS_INDEXER_H_
+#define RGBASM_TOOLS_INDEXER_H_
+
+#include "symbols.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parallel indexing of a project.
+//
+// Parses the given files and directories and, transitively, the files they
+// INCLUDE on a work-stealing pool with one parser per worker, and extracts
+// the symbols of every file.
+
+struct RgbasmIndexView;
+struct RgbasmIndexedFile;
+
+typedef struct RgbasmIndexOptions {
+  unsigned threads; // 0 for one per core
+  // INCLUDE paths are resolved like rgbasm does, relative to the working
+  // directory and then to these directories (`-I`). The directory of the
+  // including file and the given directories are tried last.
+  const char *const *include_dirs;
+  size_t include_dir_count;
+  bool follow_includes;
+  // A previous index of the project, see index_format.h. Files whose mtime
+  // and size, or else content hash, are unchanged are taken from it instead
+  // of being parsed again.
+  const struct RgbasmIndexView *previous;
+  // Called on the worker as soon as a file is indexed, so results can be
+  // reported before the whole project is done. `file` is valid during the
+  // call only; calls from different workers may overlap.
+  void (*on_file)(const struct RgbasmIndexedFile *file, void *context);
+  void *on_file_context;
+  // Called on the worker with the syntax tree of every file it parses, not
+  // of files taken from `previous`, for analyses that need more than the
+  // symbols. `parser` can parse other files, e.g. INCLUDEd ones; everything
+  // is valid during the call only.
+  void (*on_tree)(TSParser *parser, const char *path, const char *source,
+                  TSNode root, void *context);
+  void *on_tree_context;
+} RgbasmIndexOptions;
+
+typedef struct RgbasmIndexedFile {
+  char *path; // canonical
+  uint64_t hash;
+  int64_t mtime_ns;
+  uint64_t size;
+  bool has_errors;
+  bool reused; // taken from the previous index
+  RgbasmFileSymbols symbols;
+  // canonical path per entry of symbols.includes, NULL if not found
+  char **include_paths;
+} RgbasmIndexedFile;
+
+typedef struct RgbasmProjectIndex {
+  RgbasmIndexedFile *files; // sorted by path
+  size_t count;
+} RgbasmProjectIndex;
+
+// Returns false if a given path could not be read; the other files are
+// indexed nevertheless.
+bool rgbasm_index_project(const char *const *paths, size_t path_count,
+                          const RgbasmIndexOptions *options,
+                          RgbasmProjectIndex *index);
+void rgbasm_project_index_free(RgbasmProjectIndex *index);
+// Makes `index` an independent copy of `from`, e.g. to update it while
+// `from` is still being read.
+void rgbasm_project_index_copy(RgbasmProjectIndex *index,
+                               const RgbasmProjectIndex *from);
+
+// The files an update touched: parsed again, added or removed, or with an
+// include that resolves differently now, and every file including one of
+// them, directly or not. Canonical paths, sorted.
+typedef struct RgbasmIndexChanges {
+  char **files;
+  size_t count;
+} RgbasmIndexChanges;
+
+// Brings `index`, built by rgbasm_index_project from the same `paths` and
+// `options`, up to date after the files `changed` (canonical paths) were
+// modified, created or deleted. Only files whose content hash changed are
+// parsed again, together with files they or a created file make reachable;
+// includes are resolved again only where a removed or created file can
+// change their target. Files no longer reachable are dropped.
+bool rgbasm_index_update(RgbasmProjectIndex *index, const char *const *paths,
+                         size_t path_count, const char *const *changed,
+                         size_t changed_count,
+                         const RgbasmIndexOptions *options,
+                         RgbasmIndexChanges *changes);
+void rgbasm_index_changes_free(RgbasmIndexChanges *changes);
+
+void rgbasm_indexed_file_free(RgbasmIndexedFile *file);
+
+// 64-bit FNV-1a of a file's contents.
+uint64_t rgbasm_content_hash(const char *data, size_t length);
+
+#endif // RGBASM_TOOLS_INDEXER_H_
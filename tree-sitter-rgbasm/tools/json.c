@@ -0,0 +1,411 @@
+#include "json.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Parser {
+  const char *next;
+  const char *end;
+  unsigned depth;
+} Parser;
+
+// Requests are shallow, this only guards the recursion.
+#define MAX_DEPTH 256
+
+static bool parse_value(Parser *parser, JsonValue *out);
+
+static void skip_space(Parser *parser) {
+  while (parser->next < parser->end &&
+         (*parser->next == ' ' || *parser->next == '\t' ||
+          *parser->next == '\n' || *parser->next == '\r')) {
+    parser->next++;
+  }
+}
+
+static bool consume(Parser *parser, const char *literal) {
+  const size_t length = strlen(literal);
+  if ((size_t)(parser->end - parser->next) < length ||
+      memcmp(parser->next, literal, length) != 0) {
+    return false;
+  }
+  parser->next += length;
+  return true;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool parse_hex4(Parser *parser, uint32_t *out) {
+  if (parser->end - parser->next < 4) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    const int digit = hex_digit(parser->next[i]);
+    if (digit < 0) {
+      return false;
+    }
+    value = value * 16 + (uint32_t)digit;
+  }
+  parser->next += 4;
+  *out = value;
+  return true;
+}
+
+static size_t encode_utf8(uint32_t code_point, char *out) {
+  if (code_point < 0x80) {
+    out[0] = (char)code_point;
+    return 1;
+  }
+  if (code_point < 0x800) {
+    out[0] = (char)(0xc0 | (code_point >> 6));
+    out[1] = (char)(0x80 | (code_point & 0x3f));
+    return 2;
+  }
+  if (code_point < 0x10000) {
+    out[0] = (char)(0xe0 | (code_point >> 12));
+    out[1] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+    out[2] = (char)(0x80 | (code_point & 0x3f));
+    return 3;
+  }
+  out[0] = (char)(0xf0 | (code_point >> 18));
+  out[1] = (char)(0x80 | ((code_point >> 12) & 0x3f));
+  out[2] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+  out[3] = (char)(0x80 | (code_point & 0x3f));
+  return 4;
+}
+
+static bool parse_string(Parser *parser, JsonValue *out) {
+  parser->next++; // "
+  // the decoded string is never longer than the encoded one
+  const char *start = parser->next;
+  while (parser->next < parser->end && *parser->next != '"') {
+    parser->next += *parser->next == '\\' ? 2 : 1;
+  }
+  if (parser->next >= parser->end) {
+    return false;
+  }
+  char *string = malloc((size_t)(parser->next - start) + 1);
+  size_t length = 0;
+  parser->next = start;
+  while (*parser->next != '"') {
+    const char c = *parser->next++;
+    if (c != '\\') {
+      string[length++] = c;
+      continue;
+    }
+    const char escape = *parser->next++;
+    switch (escape) {
+    case 'b':
+      string[length++] = '\b';
+      break;
+    case 'f':
+      string[length++] = '\f';
+      break;
+    case 'n':
+      string[length++] = '\n';
+      break;
+    case 'r':
+      string[length++] = '\r';
+      break;
+    case 't':
+      string[length++] = '\t';
+      break;
+    case 'u': {
+      uint32_t code_point;
+      if (!parse_hex4(parser, &code_point)) {
+        free(string);
+        return false;
+      }
+      // a surrogate pair is 12 bytes encoded and at most 4 decoded
+      uint32_t low;
+      if (code_point >= 0xd800 && code_point < 0xdc00 &&
+          parser->end - parser->next >= 6 && parser->next[0] == '\\' &&
+          parser->next[1] == 'u') {
+        parser->next += 2;
+        if (!parse_hex4(parser, &low)) {
+          free(string);
+          return false;
+        }
+        code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low - 0xdc00);
+      }
+      length += encode_utf8(code_point, string + length);
+      break;
+    }
+    default:
+      string[length++] = escape;
+      break;
+    }
+  }
+  parser->next++; // "
+  string[length] = '\0';
+  out->type = JSON_STRING;
+  out->string = string;
+  out->length = length;
+  return true;
+}
+
+static bool parse_number(Parser *parser, JsonValue *out) {
+  char buffer[64];
+  size_t length = 0;
+  while (parser->next < parser->end && length + 1 < sizeof(buffer) &&
+         strchr("+-0123456789.eE", *parser->next) != NULL) {
+    buffer[length++] = *parser->next++;
+  }
+  buffer[length] = '\0';
+  char *end;
+  out->type = JSON_NUMBER;
+  out->number = strtod(buffer, &end);
+  return length > 0 && end == buffer + length;
+}
+
+// Parses the items of an array or the members of an object.
+static bool parse_items(Parser *parser, JsonValue *out, char close,
+                        bool members) {
+  parser->next++; // [ or {
+  size_t capacity = 0;
+  skip_space(parser);
+  if (parser->next < parser->end && *parser->next == close) {
+    parser->next++;
+    return true;
+  }
+  for (;;) {
+    if (out->count * (members ? 2 : 1) + 2 > capacity) {
+      capacity = capacity ? capacity * 2 : 8;
+      out->items = realloc(out->items, capacity * sizeof(JsonValue));
+    }
+    JsonValue *item = &out->items[out->count * (members ? 2 : 1)];
+    skip_space(parser);
+    if (members) {
+      if (parser->next >= parser->end || *parser->next != '"') {
+        return false;
+      }
+      item[0] = (JsonValue){0};
+      item[1] = (JsonValue){0};
+      out->count++;
+      if (!parse_string(parser, &item[0])) {
+        return false;
+      }
+      skip_space(parser);
+      if (!consume(parser, ":")) {
+        return false;
+      }
+      skip_space(parser);
+      if (!parse_value(parser, &item[1])) {
+        return false;
+      }
+    } else {
+      item[0] = (JsonValue){0};
+      out->count++;
+      if (!parse_value(parser, &item[0])) {
+        return false;
+      }
+    }
+    skip_space(parser);
+    if (consume(parser, ",")) {
+      continue;
+    }
+    if (parser->next < parser->end && *parser->next == close) {
+      parser->next++;
+      return true;
+    }
+    return false;
+  }
+}
+
+static bool parse_value(Parser *parser, JsonValue *out) {
+  *out = (JsonValue){0};
+  skip_space(parser);
+  if (parser->next >= parser->end || parser->depth > MAX_DEPTH) {
+    return false;
+  }
+  switch (*parser->next) {
+  case '"':
+    return parse_string(parser, out);
+  case '[':
+  case '{': {
+    const bool object = *parser->next == '{';
+    out->type = object ? JSON_OBJECT : JSON_ARRAY;
+    parser->depth++;
+    const bool ok = parse_items(parser, out, object ? '}' : ']', object);
+    parser->depth--;
+    return ok;
+  }
+  case 't':
+    out->type = JSON_TRUE;
+    return consume(parser, "true");
+  case 'f':
+    out->type = JSON_FALSE;
+    return consume(parser, "false");
+  case 'n':
+    out->type = JSON_NULL;
+    return consume(parser, "null");
+  default:
+    return parse_number(parser, out);
+  }
+}
+
+bool json_parse(const char *text, size_t length, JsonValue *out) {
+  Parser parser = {.next = text, .end = text + length};
+  if (!parse_value(&parser, out)) {
+    json_free(out);
+    return false;
+  }
+  skip_space(&parser);
+  if (parser.next != parser.end) {
+    json_free(out);
+    return false;
+  }
+  return true;
+}
+
+void json_free(JsonValue *value) {
+  const size_t count =
+      value->type == JSON_OBJECT ? value->count * 2 : value->count;
+  for (size_t i = 0; i < count; i++) {
+    json_free(&value->items[i]);
+  }
+  free(value->items);
+  free(value->string);
+  *value = (JsonValue){0};
+}
+
+const JsonValue *json_get(const JsonValue *object, const char *key) {
+  if (object == NULL || object->type != JSON_OBJECT) {
+    return NULL;
+  }
+  for (size_t i = 0; i < object->count; i++) {
+    if (strcmp(object->items[2 * i].string, key) == 0) {
+      return &object->items[2 * i + 1];
+    }
+  }
+  return NULL;
+}
+
+const char *json_string(const JsonValue *value) {
+  return value != NULL && value->type == JSON_STRING ? value->string : NULL;
+}
+
+double json_number(const JsonValue *value, double fallback) {
+  return value != NULL && value->type == JSON_NUMBER ? value->number
+                                                     : fallback;
+}
+
+bool json_bool(const JsonValue *value, bool fallback) {
+  if (value == NULL || (value->type != JSON_TRUE && value->type != JSON_FALSE)) {
+    return fallback;
+  }
+  return value->type == JSON_TRUE;
+}
+
+static void reserve(JsonBuffer *buffer, size_t length) {
+  if (buffer->length + length + 1 > buffer->capacity) {
+    size_t capacity = buffer->capacity ? buffer->capacity : 1024;
+    while (buffer->length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    buffer->data = realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+  }
+}
+
+void json_append(JsonBuffer *buffer, const char *data, size_t length) {
+  reserve(buffer, length);
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+  buffer->data[buffer->length] = '\0';
+}
+
+void json_appendf(JsonBuffer *buffer, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  const int length = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  if (length < 0) {
+    return;
+  }
+  reserve(buffer, (size_t)length);
+  va_start(args, format);
+  vsnprintf(buffer->data + buffer->length, (size_t)length + 1, format, args);
+  va_end(args);
+  buffer->length += (size_t)length;
+}
+
+void json_append_string(JsonBuffer *buffer, const char *string,
+                        size_t length) {
+  reserve(buffer, length + 2);
+  buffer->data[buffer->length++] = '"';
+  for (size_t i = 0; i < length; i++) {
+    const unsigned char c = (unsigned char)string[i];
+    if (c == '"' || c == '\\') {
+      const char escaped[2] = {'\\', (char)c};
+      json_append(buffer, escaped, 2);
+    } else if (c < 0x20) {
+      json_appendf(buffer, "\\u%04x", c);
+    } else {
+      reserve(buffer, 1);
+      buffer->data[buffer->length++] = (char)c;
+    }
+  }
+  json_append(buffer, "\"", 1);
+}
+
+void json_append_value(JsonBuffer *buffer, const JsonValue *value) {
+  switch (value->type) {
+  case JSON_NULL:
+    json_append(buffer, "null", 4);
+    break;
+  case JSON_FALSE:
+    json_append(buffer, "false", 5);
+    break;
+  case JSON_TRUE:
+    json_append(buffer, "true", 4);
+    break;
+  case JSON_NUMBER:
+    json_appendf(buffer, "%.17g", value->number);
+    break;
+  case JSON_STRING:
+    json_append_string(buffer, value->string, value->length);
+    break;
+  case JSON_ARRAY:
+    json_append(buffer, "[", 1);
+    for (size_t i = 0; i < value->count; i++) {
+      if (i > 0) {
+        json_append(buffer, ",", 1);
+      }
+      json_append_value(buffer, &value->items[i]);
+    }
+    json_append(buffer, "]", 1);
+    break;
+  case JSON_OBJECT:
+    json_append(buffer, "{", 1);
+    for (size_t i = 0; i < value->count; i++) {
+      if (i > 0) {
+        json_append(buffer, ",", 1);
+      }
+      json_append_value(buffer, &value->items[2 * i]);
+      json_append(buffer, ":", 1);
+      json_append_value(buffer, &value->items[2 * i + 1]);
+    }
+    json_append(buffer, "}", 1);
+    break;
+  }
+}
+
+void json_buffer_free(JsonBuffer *buffer) {
+  free(buffer->data);
+  *buffer = (JsonBuffer){0};
+}
@@ -0,0 +1,57 @@
+#ifndef RGBASM_TOOLS_JSON_H_
+#define RGBASM_TOOLS_JSON_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Just enough JSON for the language server: a tree parser for requests and an
+// append-only writer for responses.
+
+typedef enum JsonType {
+  JSON_NULL,
+  JSON_FALSE,
+  JSON_TRUE,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT,
+} JsonType;
+
+typedef struct JsonValue {
+  JsonType type;
+  double number;
+  char *string; // decoded and NUL terminated
+  size_t length;
+  // arrays hold `count` items, objects `count` members as key (a string)
+  // and value pairs in 2 * count items
+  struct JsonValue *items;
+  size_t count;
+} JsonValue;
+
+// Returns false on a syntax error. `out` must be freed on success only.
+bool json_parse(const char *text, size_t length, JsonValue *out);
+void json_free(JsonValue *value);
+
+// The member `key` of an object, or NULL if there is none or `object` is not
+// an object (or NULL).
+const JsonValue *json_get(const JsonValue *object, const char *key);
+// The string, or NULL if `value` is not a string.
+const char *json_string(const JsonValue *value);
+double json_number(const JsonValue *value, double fallback);
+bool json_bool(const JsonValue *value, bool fallback);
+
+typedef struct JsonBuffer {
+  char *data;
+  size_t length;
+  size_t capacity;
+} JsonBuffer;
+
+void json_append(JsonBuffer *buffer, const char *data, size_t length);
+void json_appendf(JsonBuffer *buffer, const char *format, ...);
+// Appends `string` quoted and escaped.
+void json_append_string(JsonBuffer *buffer, const char *string, size_t length);
+// Appends `value` as JSON, e.g. to echo a request id.
+void json_append_value(JsonBuffer *buffer, const JsonValue *value);
+void json_buffer_free(JsonBuffer *buffer);
+
+#endif // RGBASM_TOOLS_JSON_H_
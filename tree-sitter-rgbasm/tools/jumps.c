@@ -0,0 +1,166 @@
+// Reports `jp` instructions that could be `jr`, a byte and an M-cycle
+// cheaper, and `jr` instructions whose target is out of range.
+//
+// `jr` reaches -128 to +127 bytes from the end of the instruction. Distances
+// come from the byte offsets rgbasm-size lays the sections out with, so only
+// jumps within a section and with offsets that do not depend on unknown
+// sizes are checked. Turning a `jp` into a `jr` only shrinks code, which
+// never moves another target out of reach: every `jp` listed can be turned
+// into a `jr` together.
+
+#include "layout.h"
+#include "program.h"
+#include "sm83.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... path...\n"
+          "\n"
+          "Prints `file:line jp distance` for every jp whose target is in\n"
+          "range for jr, and `file:line jr distance` for every jr whose\n"
+          "target is not, then `total` with the jp count and the bytes\n"
+          "and M-cycles they would save. Distances are those of the jr,\n"
+          "from the end of the instruction. Jumps and targets repeated by\n"
+          "REPT or FOR and jumps to other sections are skipped.\n"
+          "\n"
+          "  -I dir  resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "\n"
+          "Exits with 1 if a jr is out of range.\n",
+          argv0);
+}
+
+typedef enum JumpKind {
+  JUMP_NONE,
+  JUMP_JP,
+  JUMP_JR,
+} JumpKind;
+
+static JumpKind kind_of(const RgbasmInstruction *instruction) {
+  if (instruction->form == NULL) {
+    return JUMP_NONE;
+  }
+  const char *form = instruction->form->form;
+  if (strcmp(form, "jp n") == 0 || strcmp(form, "jp cc,n") == 0) {
+    return JUMP_JP;
+  }
+  if (strcmp(form, "jr n") == 0 || strcmp(form, "jr cc,n") == 0) {
+    return JUMP_JR;
+  }
+  return JUMP_NONE;
+}
+
+// Sets `*offset` to the offset of the target of `instruction` in its own
+// section and returns true, false if that is not known. A target repeated by
+// REPT or FOR has more than one.
+static bool target_offset(const RgbasmProgram *program,
+                          const RgbasmInstruction *instruction,
+                          uint32_t *offset) {
+  if (instruction->target_name != NULL) {
+    const int32_t label =
+        rgbasm_program_label(program, instruction->target_name);
+    if (label < 0) {
+      return false;
+    }
+    const RgbasmProgramLabel *target = &program->labels[label];
+    *offset = target->offset;
+    return target->section == instruction->section && target->offset_exact &&
+           target->repeat == 1 && target->repeat_exact;
+  }
+  if (instruction->has_target_address && instruction->target >= 0) {
+    const RgbasmInstruction *target =
+        &program->instructions[instruction->target];
+    *offset = target->offset;
+    return target->section == instruction->section && target->offset_exact &&
+           target->repeat == 1 && target->repeat_exact;
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const RgbasmLayoutOptions options = {
+      .include_dirs = include_dirs,
+      .include_dir_count = include_dir_count,
+  };
+  RgbasmProgram program;
+  const bool ok = rgbasm_program_build(
+      &program, (const char *const *)paths.items, paths.count, threads,
+      &options);
+
+  size_t shorter = 0;
+  int64_t bytes = 0;
+  int64_t cycles = 0;
+  bool overflow = false;
+  for (size_t i = 0; i < program.instruction_count; i++) {
+    const RgbasmInstruction *instruction = &program.instructions[i];
+    const JumpKind kind = kind_of(instruction);
+    uint32_t target;
+    if (kind == JUMP_NONE || instruction->section < 0 ||
+        !instruction->offset_exact || instruction->repeat != 1 ||
+        !instruction->repeat_exact ||
+        !target_offset(&program, instruction, &target)) {
+      continue;
+    }
+    // from the end of a 2-byte jr; a jp shrinking by a byte moves a target
+    // after it along
+    int64_t distance = (int64_t)target - instruction->offset - 2;
+    if (kind == JUMP_JP && target > instruction->offset) {
+      distance--;
+    }
+    const bool fits = distance >= -128 && distance <= 127;
+    if (kind == JUMP_JP && fits) {
+      // jp n to jr n, jp cc,n to jr cc,n
+      const RgbasmSm83Form *jr = rgbasm_sm83_form(
+          strcmp(instruction->form->form, "jp n") == 0 ? "jr n" : "jr cc,n");
+      shorter++;
+      bytes += instruction->form->bytes - jr->bytes;
+      cycles += instruction->form->taken_cycles - jr->taken_cycles;
+    } else if (kind == JUMP_JR && !fits) {
+      overflow = true;
+    } else {
+      continue;
+    }
+    printf("%s:%u\t%s\t%+lld\n", program.paths[instruction->file],
+           instruction->point.row + 1, kind == JUMP_JP ? "jp" : "jr",
+           (long long)distance);
+  }
+  printf("total\t%zu\t%lld\t%lld\n", shorter, (long long)bytes,
+         (long long)cycles);
+
+  rgbasm_program_free(&program);
+  path_list_free(&paths);
+  free(include_dirs);
+  if (!ok) {
+    return 1;
+  }
+  return overflow ? 1 : 0;
+}
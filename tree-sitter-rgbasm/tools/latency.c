@@ -0,0 +1,222 @@
+// Reports the code that runs with interrupts disabled: every region from a
+// `di` to the `ei` or `reti` that ends it, and every interrupt handler up to
+// its `reti` or `ei`, since the CPU disables interrupts when it calls one.
+// An `ei` enables them after the instruction that follows it, which counts
+// too; a `halt` right after an `ei` waits with interrupts enabled.
+// While such code runs a STAT or timer interrupt waits, so the worst case of
+// a region is the latency it adds to raster effects.
+//
+// Regions follow jumps, branches and calls like rgbasm-budget does, with the
+// same `; @loop N` bounds, but end where interrupts are enabled. Every `halt`
+// is listed with whether it is reached with interrupts disabled.
+
+#include "cycles.h"
+#include "layout.h"
+#include "program.h"
+#include "report.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-l cycles] path...\n"
+          "\n"
+          "Prints `region function file:line M-cycles T-cycles` for every\n"
+          "di, and `handler name file:line ...` for every interrupt vector\n"
+          "with code, longest first: the cycles until interrupts are\n"
+          "enabled again, counting the ei and the instruction after it.\n"
+          "Counts that are not exact are lower bounds, e.g. `>=312`,\n"
+          "followed by the first reason, e.g. a return with interrupts\n"
+          "disabled: the region goes on in a caller.\n"
+          "Then `halt function file:line enabled|disabled` for every halt;\n"
+          "a halt with interrupts disabled only waits for one to be\n"
+          "requested, and on the DMG runs into the halt bug if one already\n"
+          "is. Macro invocations are not expanded.\n"
+          "\n"
+          "  -I dir     resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -l cycles  the most M-cycles a region may take: also print ok\n"
+          "             or over\n"
+          "\n"
+          "Exits with 1 if a region is over the limit given with -l.\n",
+          argv0);
+}
+
+typedef struct Region {
+  const char *handler; // the name of the vector, NULL for a di
+  int32_t entry;
+  RgbasmCost cost;
+} Region;
+
+static int compare_regions(const void *a, const void *b) {
+  const uint64_t left = ((const Region *)a)->cost.cycles;
+  const uint64_t right = ((const Region *)b)->cost.cycles;
+  return (left < right) - (left > right);
+}
+
+// Marks the instructions of the region at `entry` and of the routines it
+// calls in `disabled`, and returns the first instruction that returns with
+// interrupts still disabled, -1 if none.
+static int32_t mark(RgbasmCycles *cycles, int32_t entry, bool *disabled,
+                    bool *marked) {
+  const RgbasmProgram *program = cycles->program;
+  int32_t returns = -1;
+  size_t capacity = 16;
+  size_t count = 0;
+  int32_t *pending = malloc(capacity * sizeof(int32_t));
+  pending[count++] = entry;
+  bool top = true;
+  while (count > 0) {
+    const int32_t start = pending[--count];
+    RgbasmCfg cfg;
+    rgbasm_cfg_build(&cycles->routines.builder, start, &cfg);
+    for (size_t v = 0; v < cfg.node_count; v++) {
+      const RgbasmCfgNode *node = &cfg.nodes[v];
+      const RgbasmInstruction *self = &program->instructions[node->instruction];
+      disabled[node->instruction] = true;
+      for (uint32_t j = 0; j < node->edge_count; j++) {
+        const RgbasmCfgEdge *edge = &cfg.edges[node->first_edge + j];
+        if (top && returns < 0 && edge->instruction < 0 &&
+            self->interrupts != RGBASM_INTERRUPTS_ENABLE &&
+            (self->flow == RGBASM_FLOW_RETURN ||
+             self->flow == RGBASM_FLOW_RETURN_COND)) {
+          returns = node->instruction;
+        }
+        if (edge->callee < 0 || marked[edge->callee]) {
+          continue;
+        }
+        marked[edge->callee] = true;
+        if (count == capacity) {
+          capacity *= 2;
+          pending = realloc(pending, capacity * sizeof(int32_t));
+        }
+        pending[count++] = edge->callee;
+      }
+    }
+    rgbasm_cfg_free(&cfg);
+    top = false;
+  }
+  free(pending);
+  return returns;
+}
+
+// Returns true if the region is over a given limit.
+static bool print_region(const RgbasmProgram *program, const Region *region,
+                         int64_t limit) {
+  const RgbasmCost *cost = &region->cost;
+  const bool over = limit >= 0 && cost->cycles > (uint64_t)limit;
+  if (region->handler != NULL) {
+    printf("handler\t%s\t", region->handler);
+  } else {
+    printf("region\t");
+    rgbasm_report_function(program, region->entry);
+    printf("\t");
+  }
+  rgbasm_report_location(program, region->entry);
+  printf("\t%s%llu\t%llu", cost->exact ? "" : ">=",
+         (unsigned long long)cost->cycles,
+         (unsigned long long)cost->cycles * 4);
+  if (limit >= 0) {
+    printf("\t%s", over ? "over" : "ok");
+  }
+  rgbasm_report_reason(program, cost->exact, cost->reason, cost->problem);
+  printf("\n");
+  return over;
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  int64_t limit = -1;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      limit = strtoll(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const RgbasmLayoutOptions options = {
+      .include_dirs = include_dirs,
+      .include_dir_count = include_dir_count,
+  };
+  RgbasmProgram program;
+  const bool ok = rgbasm_program_build(
+      &program, (const char *const *)paths.items, paths.count, threads,
+      &options);
+  RgbasmCycles cycles;
+  rgbasm_cycles_init(&cycles, &program, true);
+  const size_t count = program.instruction_count + 1;
+  bool *disabled = calloc(count, sizeof(bool));
+  bool *marked = calloc(count, sizeof(bool));
+  Region *regions = malloc(count * sizeof(Region));
+  size_t region_count = 0;
+
+  for (size_t i = 0; i < RGBASM_VECTOR_COUNT; i++) {
+    const int32_t entry =
+        rgbasm_report_rom0_at(&program, rgbasm_vectors[i].address);
+    if (entry < 0) {
+      continue;
+    }
+    regions[region_count++] = (Region){rgbasm_vectors[i].name, entry, {0}};
+  }
+  for (size_t i = 0; i < program.instruction_count; i++) {
+    if (program.instructions[i].interrupts == RGBASM_INTERRUPTS_DISABLE) {
+      regions[region_count++] = (Region){NULL, (int32_t)i, {0}};
+    }
+  }
+
+  for (size_t i = 0; i < region_count; i++) {
+    Region *region = &regions[i];
+    region->cost = rgbasm_cycles_routine(&cycles, region->entry);
+    const int32_t returns = mark(&cycles, region->entry, disabled, marked);
+    if (returns >= 0 && region->cost.exact) {
+      region->cost.exact = false;
+      region->cost.problem = returns;
+      region->cost.reason = "return with interrupts disabled";
+    }
+  }
+  qsort(regions, region_count, sizeof(Region), compare_regions);
+  bool over = false;
+  for (size_t i = 0; i < region_count; i++) {
+    over |= print_region(&program, &regions[i], limit);
+  }
+
+  for (size_t i = 0; i < program.instruction_count; i++) {
+    if (program.instructions[i].halt) {
+      printf("halt\t");
+      rgbasm_report_function(&program, (int32_t)i);
+      printf("\t");
+      rgbasm_report_location(&program, (int32_t)i);
+      printf("\t%s\n", disabled[i] ? "disabled" : "enabled");
+    }
+  }
+
+  free(regions);
+  free(marked);
+  free(disabled);
+  rgbasm_cycles_free(&cycles);
+  rgbasm_program_free(&program);
+  path_list_free(&paths);
+  free(include_dirs);
+  return ok && !over ? 0 : 1;
+}
@@ -0,0 +1,845 @@
+#define _XOPEN_SOURCE 700 // realpath
+
+#include "layout.h"
+
+#include "expr.h"
+#include "sm83.h"
+#include "util.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define INCLUDE_DEPTH_MAX 16
+
+typedef struct RgbasmConstant {
+  char *name; // NULL for an empty slot
+  size_t length;
+  int32_t value;
+  bool known;
+} RgbasmConstant;
+
+static uint64_t name_hash(const char *name, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (unsigned char)name[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+// The slot holding `name`, or the empty one it would go to.
+static RgbasmConstant *constant_slot(const RgbasmConstants *self,
+                                     const char *name, size_t length) {
+  size_t i = name_hash(name, length) & (self->capacity - 1);
+  for (;;) {
+    RgbasmConstant *slot = &self->slots[i];
+    if (slot->name == NULL ||
+        (slot->length == length && memcmp(slot->name, name, length) == 0)) {
+      return slot;
+    }
+    i = (i + 1) & (self->capacity - 1);
+  }
+}
+
+void rgbasm_constants_init(RgbasmConstants *self) {
+  *self = (RgbasmConstants){0};
+}
+
+void rgbasm_constants_free(RgbasmConstants *self) {
+  for (size_t i = 0; i < self->capacity; i++) {
+    free(self->slots[i].name);
+  }
+  free(self->slots);
+  *self = (RgbasmConstants){0};
+}
+
+static void constants_grow(RgbasmConstants *self) {
+  RgbasmConstants grown = {
+      .slots = calloc(self->capacity ? self->capacity * 2 : 64,
+                      sizeof(RgbasmConstant)),
+      .capacity = self->capacity ? self->capacity * 2 : 64,
+      .count = self->count,
+  };
+  for (size_t i = 0; i < self->capacity; i++) {
+    const RgbasmConstant *old = &self->slots[i];
+    if (old->name != NULL) {
+      *constant_slot(&grown, old->name, old->length) = *old;
+    }
+  }
+  free(self->slots);
+  *self = grown;
+}
+
+static void constants_put(RgbasmConstants *self, const char *name,
+                          size_t length, int32_t value, bool known) {
+  if ((self->count + 1) * 2 > self->capacity) {
+    constants_grow(self);
+  }
+  RgbasmConstant *slot = constant_slot(self, name, length);
+  if (slot->name == NULL) {
+    slot->name = malloc(length + 1);
+    memcpy(slot->name, name, length);
+    slot->name[length] = '\0';
+    slot->length = length;
+    self->count++;
+  }
+  slot->value = value;
+  slot->known = known;
+}
+
+void rgbasm_constants_set(RgbasmConstants *self, const char *name,
+                          size_t length, int32_t value) {
+  constants_put(self, name, length, value, true);
+}
+
+void rgbasm_constants_unset(RgbasmConstants *self, const char *name,
+                            size_t length) {
+  if (self->count > 0) {
+    constants_put(self, name, length, 0, false);
+  }
+}
+
+bool rgbasm_constants_get(const RgbasmConstants *self, const char *name,
+                          size_t length, int32_t *value) {
+  if (self->count == 0) {
+    return false;
+  }
+  const RgbasmConstant *slot = constant_slot(self, name, length);
+  if (slot->name == NULL || !slot->known) {
+    return false;
+  }
+  *value = slot->value;
+  return true;
+}
+
+// The bytes of a section emitted so far. Its start is known in the low
+// `known` bits of `offset`, which advances with every byte.
+typedef struct Layout {
+  uint32_t offset;
+  unsigned known;
+  uint32_t bytes;
+  bool exact;
+} Layout;
+
+typedef struct Walk {
+  TSParser *parser;
+  const char *path;
+  const char *source;
+  const RgbasmLayoutOptions *options;
+  RgbasmConstants *constants;
+  RgbasmFileLayout *out; // NULL in INCLUDEd files
+  unsigned depth;
+  bool uncertain; // in a block that may be assembled never or repeatedly
+  // where the layout being filled starts in the current section
+  uint32_t base;
+  bool base_exact;
+  int32_t section; // index into out->sections, -1 outside
+  uint32_t repeat;
+  bool repeat_exact;
+} Walk;
+
+// The start of the current layout, saved while a nested one is filled.
+typedef struct Base {
+  uint32_t base;
+  bool exact;
+} Base;
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+static TSNode field(TSNode node, const char *name) {
+  return ts_node_child_by_field_name(node, name, (uint32_t)strlen(name));
+}
+
+static Span node_text(const Walk *walk, TSNode node) {
+  const uint32_t start = ts_node_start_byte(node);
+  return (Span){walk->source + start, ts_node_end_byte(node) - start};
+}
+
+// The uppercase text of a keyword, empty if it is too long.
+static void keyword(const Walk *walk, TSNode node, char *out, size_t size) {
+  const Span text = node_text(walk, node);
+  size_t length = text.length < size ? text.length : 0;
+  for (size_t i = 0; i < length; i++) {
+    out[i] = (char)toupper((unsigned char)text.data[i]);
+  }
+  out[length] = '\0';
+}
+
+static bool lookup(const char *name, size_t length, int32_t *value,
+                   void *context) {
+  return rgbasm_constants_get(context, name, length, value);
+}
+
+static bool evaluate(const Walk *walk, TSNode node, int32_t *value) {
+  if (ts_node_is_null(node)) {
+    return false;
+  }
+  const RgbasmExprContext context = {
+      .source = walk->source,
+      .lookup = lookup,
+      .lookup_context = walk->constants,
+  };
+  return rgbasm_expr_eval(&context, node, value);
+}
+
+// The contents of a string literal, quotes removed. Returns false if it is
+// not one.
+static bool string_contents(const Walk *walk, TSNode node, Span *out) {
+  if (!is_type(node, "string_literal") && !is_type(node, "raw_string_literal")) {
+    return false;
+  }
+  Span text = node_text(walk, node);
+  if (text.length > 0 && text.data[0] == '#') {
+    text.data++;
+    text.length--;
+  }
+  uint32_t quotes = 0;
+  while (quotes < 3 && quotes < text.length && text.data[quotes] == '"') {
+    quotes++;
+  }
+  if (quotes == 2) {
+    quotes = 1;
+  }
+  if (text.length < 2 * quotes) {
+    return false;
+  }
+  *out = (Span){text.data + quotes, text.length - 2 * quotes};
+  return true;
+}
+
+// The number of characters a string emits without a charmap. Returns false
+// for interpolations.
+static bool string_length(const Walk *walk, TSNode node, uint32_t *length) {
+  Span contents;
+  if (!string_contents(walk, node, &contents)) {
+    return false;
+  }
+  const bool raw = is_type(node, "raw_string_literal");
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < contents.length; i++) {
+    if (!raw && contents.data[i] == '{') {
+      return false;
+    }
+    if (!raw && contents.data[i] == '\\') {
+      i++;
+    }
+    count++;
+  }
+  *length = count;
+  return true;
+}
+
+static void emit(Layout *layout, uint64_t bytes, bool exact) {
+  if (bytes > UINT32_MAX - layout->bytes) {
+    bytes = UINT32_MAX - layout->bytes;
+    exact = false;
+  }
+  layout->bytes += (uint32_t)bytes;
+  layout->offset += (uint32_t)bytes;
+  if (!exact) {
+    layout->exact = false;
+    layout->known = 0;
+  }
+}
+
+// A layout for a block measured on its own, starting where `from` is.
+static Layout nested(const Layout *from) {
+  return (Layout){.offset = from->offset, .known = from->known, .exact = true};
+}
+
+// Enters a block measured with its own layout, starting where `outer` is.
+static Base enter(Walk *walk, const Layout *outer) {
+  const Base saved = {walk->base, walk->base_exact};
+  walk->base += outer->bytes;
+  walk->base_exact = walk->base_exact && outer->exact;
+  return saved;
+}
+
+static void leave(Walk *walk, Base saved) {
+  walk->base = saved.base;
+  walk->base_exact = saved.exact;
+}
+
+static void report(Walk *walk, TSNode node, const struct RgbasmSm83Form *form,
+                   const Layout *layout,
+                   void (*hook)(const RgbasmLayoutItem *, void *)) {
+  if (hook == NULL || walk->out == NULL) {
+    return;
+  }
+  const RgbasmLayoutItem item = {
+      .node = node,
+      .form = form,
+      .section = walk->section,
+      .offset = walk->base + layout->bytes,
+      .offset_exact = walk->base_exact && layout->exact,
+      .repeat = walk->repeat,
+      .repeat_exact = walk->repeat_exact,
+      .constants = walk->constants,
+  };
+  hook(&item, walk->options->context);
+}
+
+static void visit(Walk *walk, TSNode node, Layout *layout);
+
+static void visit_children(Walk *walk, TSNode node, Layout *layout) {
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    visit(walk, ts_node_named_child(node, i), layout);
+  }
+}
+
+// ALIGN[bits, target]: pads up to the next offset that is `target` modulo
+// 2^bits, exact only if that many bits of the offset are known.
+static void align(Walk *walk, Layout *layout, TSNode bits_node,
+                  TSNode target_node) {
+  int32_t bits;
+  int32_t target = 0;
+  if (!evaluate(walk, bits_node, &bits) || bits < 0 || bits > 16 ||
+      (!ts_node_is_null(target_node) &&
+       !evaluate(walk, target_node, &target))) {
+    layout->exact = false;
+    layout->known = 0;
+    return;
+  }
+  const uint32_t mask = (1u << bits) - 1;
+  if ((unsigned)bits <= layout->known) {
+    emit(layout, ((uint32_t)target - layout->offset) & mask, true);
+  } else {
+    // somewhere below 2^bits bytes
+    layout->exact = false;
+    layout->offset = (uint32_t)target;
+    layout->known = (unsigned)bits;
+  }
+}
+
+static char *resolve_in(const char *dir, const char *name) {
+  char buffer[PATH_MAX];
+  if (dir != NULL) {
+    if (snprintf(buffer, sizeof(buffer), "%s/%s", dir, name) >=
+        (int)sizeof(buffer)) {
+      return NULL;
+    }
+    name = buffer;
+  }
+  struct stat info;
+  return stat(name, &info) == 0 && S_ISREG(info.st_mode) ? realpath(name, NULL)
+                                                         : NULL;
+}
+
+// The path of an INCLUDE or INCBIN argument, NULL if it is not found.
+static char *resolve(const Walk *walk, TSNode argument) {
+  Span contents;
+  char name[PATH_MAX];
+  if (!string_contents(walk, argument, &contents) ||
+      contents.length >= sizeof(name)) {
+    return NULL;
+  }
+  memcpy(name, contents.data, contents.length);
+  name[contents.length] = '\0';
+  if (name[0] == '/') {
+    return resolve_in(NULL, name);
+  }
+  char *path = resolve_in(NULL, name);
+  for (size_t i = 0; path == NULL && i < walk->options->include_dir_count;
+       i++) {
+    path = resolve_in(walk->options->include_dirs[i], name);
+  }
+  if (path == NULL) {
+    char *dir = strdup(walk->path);
+    char *slash = strrchr(dir, '/');
+    if (slash != NULL) {
+      *slash = '\0';
+      path = resolve_in(dir, name);
+    }
+    free(dir);
+  }
+  return path;
+}
+
+// Evaluates the constants of an INCLUDEd file.
+static void include(Walk *walk, TSNode node) {
+  TSNode arguments = {0};
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    if (is_type(ts_node_named_child(node, i), "argument_list")) {
+      arguments = ts_node_named_child(node, i);
+    }
+  }
+  if (walk->depth >= INCLUDE_DEPTH_MAX || ts_node_is_null(arguments)) {
+    return;
+  }
+  char *path = resolve(walk, ts_node_named_child(arguments, 0));
+  Source source;
+  if (path == NULL || !source_read(path, &source)) {
+    free(path);
+    return;
+  }
+  TSTree *tree =
+      ts_parser_parse_string(walk->parser, NULL, source.data, source.length);
+  if (tree != NULL) {
+    Walk included = *walk;
+    included.path = path;
+    included.source = source.data;
+    included.out = NULL;
+    included.depth++;
+    Layout ignored = {0};
+    visit_children(&included, ts_tree_root_node(tree), &ignored);
+    ts_tree_delete(tree);
+  }
+  source_free(&source);
+  free(path);
+}
+
+static void define(Walk *walk, TSNode node) {
+  const TSNode name = field(node, "name");
+  const TSNode assign = field(node, "assign_type");
+  if (ts_node_is_null(name) || ts_node_is_null(assign)) {
+    return;
+  }
+  const Span text = node_text(walk, name);
+  const char *op = ts_node_type(assign);
+  int32_t value;
+  bool known = !walk->uncertain && evaluate(walk, field(node, "value"), &value);
+  int32_t previous;
+  if (known && strcmp(op, "equ_keyword") != 0 && strcmp(op, "=") != 0 &&
+      rgbasm_constants_get(walk->constants, text.data, text.length,
+                           &previous)) {
+    const uint32_t a = (uint32_t)previous;
+    const uint32_t b = (uint32_t)value;
+    if (strcmp(op, "+=") == 0) {
+      value = (int32_t)(a + b);
+    } else if (strcmp(op, "-=") == 0) {
+      value = (int32_t)(a - b);
+    } else if (strcmp(op, "*=") == 0) {
+      value = (int32_t)(a * b);
+    } else if (strcmp(op, "&=") == 0) {
+      value = (int32_t)(a & b);
+    } else if (strcmp(op, "|=") == 0) {
+      value = (int32_t)(a | b);
+    } else if (strcmp(op, "^=") == 0) {
+      value = (int32_t)(a ^ b);
+    } else if (strcmp(op, "<<=") == 0 && b < 32) {
+      value = (int32_t)(a << b);
+    } else if (strcmp(op, ">>=") == 0 && b < 32) {
+      value = previous >> b;
+    } else {
+      // division and out of range shifts
+      known = false;
+    }
+  } else if (strcmp(op, "equ_keyword") != 0 && strcmp(op, "=") != 0) {
+    // EQUS, RB/RW/RL, or a compound assignment to an unknown variable
+    known = false;
+  }
+  if (known) {
+    rgbasm_constants_set(walk->constants, text.data, text.length, value);
+  } else {
+    rgbasm_constants_unset(walk->constants, text.data, text.length);
+  }
+}
+
+static void simple_directive(Walk *walk, TSNode node, Layout *layout) {
+  char name[8];
+  keyword(walk, ts_node_named_child(node, 0), name, sizeof(name));
+  const TSNode arguments = ts_node_named_child(node, 1);
+  const uint32_t count = ts_node_is_null(arguments)
+                             ? 0
+                             : ts_node_named_child_count(arguments);
+  const unsigned width = strcmp(name, "DB") == 0   ? 1
+                         : strcmp(name, "DW") == 0 ? 2
+                         : strcmp(name, "DL") == 0 ? 4
+                                                   : 0;
+  if (width != 0) {
+    // without arguments like DS
+    uint64_t bytes = count == 0 ? width : 0;
+    bool exact = true;
+    for (uint32_t i = 0; i < count; i++) {
+      const TSNode argument = ts_node_named_child(arguments, i);
+      uint32_t length = 1;
+      if ((is_type(argument, "string_literal") ||
+           is_type(argument, "raw_string_literal")) &&
+          !string_length(walk, argument, &length)) {
+        exact = false;
+      }
+      bytes += (uint64_t)width * length;
+    }
+    emit(layout, bytes, exact);
+  } else if (strcmp(name, "ALIGN") == 0 && count > 0) {
+    align(walk, layout, ts_node_named_child(arguments, 0),
+          ts_node_named_child(arguments, 1));
+  } else if (strcmp(name, "INCBIN") == 0 && count > 0) {
+    int32_t start = 0;
+    int32_t length;
+    if (count > 2) {
+      const bool known =
+          evaluate(walk, ts_node_named_child(arguments, 2), &length);
+      emit(layout, known && length > 0 ? (uint32_t)length : 0, known);
+      return;
+    }
+    char *path = resolve(walk, ts_node_named_child(arguments, 0));
+    struct stat info;
+    const bool known =
+        path != NULL && stat(path, &info) == 0 &&
+        (count < 2 ||
+         evaluate(walk, ts_node_named_child(arguments, 1), &start));
+    const int64_t size = known ? (int64_t)info.st_size - start : 0;
+    emit(layout, size > 0 ? (uint64_t)size : 0, known);
+    free(path);
+  }
+}
+
+static void ds_directive(Walk *walk, TSNode node, Layout *layout) {
+  const TSNode size = field(node, "size");
+  if (ts_node_is_null(size)) {
+    const TSNode option = ts_node_named_child(node, 1);
+    if (!ts_node_is_null(option) && is_type(option, "align_option")) {
+      align(walk, layout, field(option, "align"), field(option, "offset"));
+    }
+    return;
+  }
+  int32_t bytes;
+  const bool known = evaluate(walk, size, &bytes);
+  emit(layout, known && bytes > 0 ? (uint32_t)bytes : 0, known);
+}
+
+// Counts the first branch whose condition is true. Once a condition is
+// unknown, the largest of the branches that may be taken counts instead.
+static void if_block(Walk *walk, TSNode node, Layout *layout) {
+  const uint32_t count = ts_node_named_child_count(node);
+  TSNode branches[64];
+  TSNode conditions[64];
+  uint32_t branch_count = 0;
+  branches[branch_count] = node;
+  conditions[branch_count++] = field(node, "condition");
+  for (uint32_t i = 0; i < count && branch_count < 64; i++) {
+    const TSNode child = ts_node_named_child(node, i);
+    if (is_type(child, "elif_clause")) {
+      branches[branch_count] = child;
+      conditions[branch_count++] = ts_node_named_child(child, 1);
+    } else if (is_type(child, "else_clause")) {
+      branches[branch_count] = child;
+      conditions[branch_count++] = (TSNode){0};
+    }
+  }
+
+  bool uncertain = false;
+  uint32_t largest = 0;
+  for (uint32_t b = 0; b < branch_count; b++) {
+    int32_t value = 1;
+    const bool known = ts_node_is_null(conditions[b]) ||
+                       evaluate(walk, conditions[b], &value);
+    if (known && value == 0) {
+      continue;
+    }
+    Layout branch = uncertain || !known ? nested(layout) : *layout;
+    Layout *target = uncertain || !known ? &branch : layout;
+    const bool outer = walk->uncertain;
+    walk->uncertain = outer || uncertain || !known;
+    const Base base = target == layout ? (Base){walk->base, walk->base_exact}
+                                       : enter(walk, layout);
+    // the clauses of the IF itself are branches of their own
+    const uint32_t children = ts_node_named_child_count(branches[b]);
+    for (uint32_t i = 0; i < children; i++) {
+      const TSNode child = ts_node_named_child(branches[b], i);
+      if (!is_type(child, "elif_clause") && !is_type(child, "else_clause")) {
+        visit(walk, child, target);
+      }
+    }
+    walk->uncertain = outer;
+    leave(walk, base);
+    if (target == layout) {
+      // taken for sure
+      return;
+    }
+    uncertain = true;
+    if (branch.bytes > largest) {
+      largest = branch.bytes;
+    }
+    if (known) {
+      break;
+    }
+  }
+  if (uncertain) {
+    emit(layout, largest, false);
+  }
+}
+
+static void repeat(Walk *walk, TSNode node, Layout *layout) {
+  int32_t count = 1;
+  bool known = false;
+  if (is_type(node, "rept_block")) {
+    known = evaluate(walk, field(node, "count"), &count);
+  } else {
+    // FOR name, [start,] stop [, step], on the line of the FOR
+    TSNode args[5];
+    uint32_t arg_count = 0;
+    const uint32_t row = ts_node_start_point(node).row;
+    const uint32_t children = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < children && arg_count < 5; i++) {
+      const TSNode child = ts_node_named_child(node, i);
+      if (ts_node_start_point(child).row != row) {
+        break;
+      }
+      if (!is_type(child, "for_keyword") && !is_type(child, "quiet") &&
+          !is_type(child, "inline_comment")) {
+        args[arg_count++] = child;
+      }
+    }
+    int32_t start = 0;
+    int32_t stop = 0;
+    int32_t step = 1;
+    if (arg_count == 2) {
+      known = evaluate(walk, args[1], &stop);
+    } else if (arg_count >= 3) {
+      known = evaluate(walk, args[1], &start) &&
+              evaluate(walk, args[2], &stop) &&
+              (arg_count == 3 || evaluate(walk, args[3], &step));
+    }
+    known = known && step != 0;
+    if (known) {
+      const int64_t span = (int64_t)stop - start;
+      // ceil(span / step), at least 0
+      int64_t iterations =
+          step > 0 ? (span + step - 1) / step : (span + step + 1) / step;
+      count = iterations > 0 ? (int32_t)iterations : 0;
+    }
+  }
+  // alignment inside repeated blocks is not tracked, items are reported at
+  // their offsets in the first repetition
+  Layout body = {.exact = true};
+  const bool outer = walk->uncertain;
+  const uint32_t outer_repeat = walk->repeat;
+  const bool outer_repeat_exact = walk->repeat_exact;
+  const Base base = enter(walk, layout);
+  walk->uncertain = true;
+  walk->repeat *= count > 0 ? (uint32_t)count : 0;
+  walk->repeat_exact = walk->repeat_exact && known;
+  visit_children(walk, node, &body);
+  walk->uncertain = outer;
+  walk->repeat = outer_repeat;
+  walk->repeat_exact = outer_repeat_exact;
+  leave(walk, base);
+  emit(layout, (uint64_t)body.bytes * (uint64_t)(count > 0 ? count : 0),
+       known && body.exact);
+}
+
+static void union_block(Walk *walk, TSNode node, Layout *layout) {
+  Layout part = nested(layout);
+  uint32_t largest = 0;
+  bool exact = true;
+  const Base base = enter(walk, layout);
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(node, i);
+    if (is_type(child, "nextu_block")) {
+      Layout next = nested(layout);
+      visit_children(walk, child, &next);
+      largest = next.bytes > largest ? next.bytes : largest;
+      exact = exact && next.exact;
+    } else {
+      visit(walk, child, &part);
+    }
+  }
+  leave(walk, base);
+  largest = part.bytes > largest ? part.bytes : largest;
+  emit(layout, largest, exact && part.exact);
+}
+
+// The name, type, bank and address of a section, LOAD or PUSHS; sets the
+// start of `layout` from its address or alignment.
+static void section_header(Walk *walk, TSNode header,
+                           RgbasmSectionSize *section, Layout *layout) {
+  const TSNode name = field(header, "name");
+  if (!ts_node_is_null(name)) {
+    Span text;
+    if (!string_contents(walk, name, &text)) {
+      text = node_text(walk, name);
+    }
+    section->name = malloc(text.length + 1);
+    memcpy(section->name, text.data, text.length);
+    section->name[text.length] = '\0';
+  } else {
+    section->name = strdup("");
+  }
+  section->is_union = !ts_node_is_null(field(header, "union"));
+  section->is_fragment = !ts_node_is_null(field(header, "fragment"));
+  section->point = ts_node_start_point(header);
+
+  const uint32_t count = ts_node_named_child_count(header);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(header, i);
+    if (is_type(child, "section_type")) {
+      keyword(walk, child, section->type, sizeof(section->type));
+    } else if (is_type(child, "section_address")) {
+      section->has_address =
+          evaluate(walk, field(child, "address"), &section->address);
+      if (section->has_address) {
+        layout->offset = (uint32_t)section->address;
+        layout->known = 16;
+      }
+    } else if (is_type(child, "section_options")) {
+      const uint32_t options = ts_node_named_child_count(child);
+      for (uint32_t j = 0; j < options; j++) {
+        const TSNode option =
+            ts_node_named_child(ts_node_named_child(child, j), 0);
+        int32_t bits;
+        int32_t offset = 0;
+        if (ts_node_is_null(option)) {
+          continue;
+        } else if (is_type(option, "bank_option")) {
+          section->has_bank =
+              evaluate(walk, field(option, "bank"), &section->bank);
+        } else if (is_type(option, "align_option") && layout->known < 16 &&
+                   evaluate(walk, field(option, "align"), &bits) &&
+                   bits >= 0 && bits <= 16) {
+          const TSNode offset_node = field(option, "offset");
+          if (ts_node_is_null(offset_node) ||
+              evaluate(walk, offset_node, &offset)) {
+            layout->offset = (uint32_t)offset;
+            layout->known = (unsigned)bits;
+          }
+        }
+      }
+    }
+  }
+}
+
+static void section(Walk *walk, TSNode node, Layout *outer) {
+  const bool is_block = is_type(node, "section_block");
+  const TSNode header = is_block ? ts_node_named_child(node, 0) : node;
+  RgbasmSectionSize section = {
+      .kind = is_block                        ? RGBASM_SECTION_SECTION
+              : is_type(node, "load_block") ? RGBASM_SECTION_LOAD
+                                              : RGBASM_SECTION_PUSHS,
+  };
+  Layout layout = {.exact = true};
+  section_header(walk, header, &section, &layout);
+
+  // the entry goes before the LOAD blocks and sections nested in it
+  RgbasmFileLayout *out = walk->out;
+  size_t index = 0;
+  if (out != NULL) {
+    if (out->count == out->capacity) {
+      out->capacity = out->capacity ? out->capacity * 2 : 16;
+      out->sections =
+          realloc(out->sections, out->capacity * sizeof(RgbasmSectionSize));
+    }
+    index = out->count++;
+  }
+  const Base base = {walk->base, walk->base_exact};
+  const int32_t outer_section = walk->section;
+  walk->base = 0;
+  walk->base_exact = true;
+  walk->section = out != NULL ? (int32_t)index : -1;
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = is_block ? 1 : 0; i < count; i++) {
+    visit(walk, ts_node_named_child(node, i), &layout);
+  }
+  leave(walk, base);
+  walk->section = outer_section;
+  if (section.kind == RGBASM_SECTION_LOAD) {
+    // the code of a LOAD block is stored in the enclosing section
+    emit(outer, layout.bytes, layout.exact);
+  }
+  section.bytes = layout.bytes;
+  section.exact = layout.exact;
+  if (out != NULL) {
+    out->sections[index] = section;
+  } else {
+    free(section.name);
+  }
+}
+
+static void visit(Walk *walk, TSNode node, Layout *layout) {
+  const char *type = ts_node_type(node);
+  if (strcmp(type, "instruction_list") == 0) {
+    const uint32_t count = ts_node_named_child_count(node);
+    for (uint32_t i = 0; i < count; i++) {
+      const TSNode instruction = ts_node_named_child(node, i);
+      const RgbasmSm83Form *form =
+          rgbasm_sm83_lookup(instruction, walk->source);
+      report(walk, instruction, form, layout,
+             walk->options->on_instruction);
+      emit(layout, form != NULL ? form->bytes : 0, form != NULL);
+    }
+  } else if (strcmp(type, "simple_directive") == 0) {
+    simple_directive(walk, node, layout);
+  } else if (strcmp(type, "ds_directive") == 0) {
+    ds_directive(walk, node, layout);
+  } else if (strcmp(type, "def_directive") == 0) {
+    define(walk, node);
+  } else if (strcmp(type, "include_directive") == 0) {
+    include(walk, node);
+  } else if (strcmp(type, "if_block") == 0) {
+    if_block(walk, node, layout);
+  } else if (strcmp(type, "rept_block") == 0 ||
+             strcmp(type, "for_block") == 0) {
+    repeat(walk, node, layout);
+  } else if (strcmp(type, "union_block") == 0) {
+    union_block(walk, node, layout);
+  } else if (strcmp(type, "macro_invocation") == 0) {
+    emit(layout, 0, false);
+  } else if (strcmp(type, "section_block") == 0 ||
+             strcmp(type, "load_block") == 0 ||
+             strcmp(type, "pushs_block") == 0) {
+    section(walk, node, layout);
+  } else if (strcmp(type, "global_label_block") == 0 ||
+             strcmp(type, "local_label_block") == 0) {
+    report(walk, node, NULL, layout, walk->options->on_label);
+    visit_children(walk, node, layout);
+  } else if (strcmp(type, "directive") == 0) {
+    visit_children(walk, node, layout);
+  }
+}
+
+void rgbasm_layout_file(TSParser *parser, const char *path, const char *source,
+                        TSNode root, const RgbasmLayoutOptions *options,
+                        RgbasmConstants *constants, RgbasmFileLayout *out) {
+  Walk walk = {
+      .parser = parser,
+      .path = path,
+      .source = source,
+      .options = options,
+      .constants = constants,
+      .out = out,
+      .base_exact = true,
+      .section = -1,
+      .repeat = 1,
+      .repeat_exact = true,
+  };
+  Layout outside = {.exact = true};
+  visit_children(&walk, root, &outside);
+}
+
+void rgbasm_file_layout_free(RgbasmFileLayout *self) {
+  for (size_t i = 0; i < self->count; i++) {
+    free(self->sections[i].name);
+  }
+  free(self->sections);
+  *self = (RgbasmFileLayout){0};
+}
+
+uint32_t rgbasm_section_capacity(const char *type) {
+  static const struct {
+    const char *type;
+    uint32_t bytes;
+  } capacities[] = {
+      {"ROM0", 0x4000}, {"ROMX", 0x4000},  {"VRAM", 0x2000}, {"SRAM", 0x2000},
+      {"WRAM0", 0x1000}, {"WRAMX", 0x1000}, {"OAM", 0xA0},    {"HRAM", 0x7F},
+  };
+  for (size_t i = 0; i < sizeof(capacities) / sizeof(*capacities); i++) {
+    if (strcmp(type, capacities[i].type) == 0) {
+      return capacities[i].bytes;
+    }
+  }
+  return 0;
+}
+
+bool rgbasm_section_type_banked(const char *type) {
+  return strcmp(type, "ROMX") == 0 || strcmp(type, "VRAM") == 0 ||
+         strcmp(type, "SRAM") == 0 || strcmp(type, "WRAMX") == 0;
+}
@@ -0,0 +1,103 @@
+#ifndef RGBASM_TOOLS_LAYOUT_H_
+#define RGBASM_TOOLS_LAYOUT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Byte sizes of the SECTIONs of a file, like lua/rgbds/sizes.lua computes
+// them in the editor.
+//
+// The file is walked in document order, evaluating DEFs as they come, so
+// every DS, REPT or IF sees the constants defined before it, including those
+// of INCLUDEd files. Branches of an IF whose condition is unknown count with
+// their largest size; ALIGN padding is exact where the section's address or
+// alignment says enough about the offset. Sizes that depend on anything else
+// are lower bounds, marked as not exact. Code in INCLUDEd files is not
+// counted, so every file can be measured on its own.
+
+// Numeric constants by name.
+typedef struct RgbasmConstants {
+  struct RgbasmConstant *slots;
+  size_t capacity;
+  size_t count;
+} RgbasmConstants;
+
+void rgbasm_constants_init(RgbasmConstants *self);
+void rgbasm_constants_free(RgbasmConstants *self);
+void rgbasm_constants_set(RgbasmConstants *self, const char *name,
+                          size_t length, int32_t value);
+// Forgets the value, e.g. of a constant defined where it is unknown.
+void rgbasm_constants_unset(RgbasmConstants *self, const char *name,
+                            size_t length);
+bool rgbasm_constants_get(const RgbasmConstants *self, const char *name,
+                          size_t length, int32_t *value);
+
+typedef enum RgbasmSectionKind {
+  RGBASM_SECTION_SECTION,
+  RGBASM_SECTION_LOAD,
+  RGBASM_SECTION_PUSHS,
+} RgbasmSectionKind;
+
+typedef struct RgbasmSectionSize {
+  char *name;
+  char type[8]; // ROM0, ROMX, VRAM, SRAM, WRAM0, WRAMX, OAM or HRAM
+  RgbasmSectionKind kind;
+  bool is_union;
+  bool is_fragment;
+  bool has_bank;
+  bool has_address;
+  int32_t bank;
+  int32_t address;
+  uint32_t bytes;
+  bool exact;
+  TSPoint point;
+} RgbasmSectionSize;
+
+typedef struct RgbasmFileLayout {
+  RgbasmSectionSize *sections; // in document order
+  size_t count;
+  size_t capacity;
+} RgbasmFileLayout;
+
+// An instruction or label of the measured file.
+typedef struct RgbasmLayoutItem {
+  TSNode node;                       // the `instruction` or label block
+  const struct RgbasmSm83Form *form; // of instructions, NULL if unknown
+  int32_t section;                   // index into the sections, -1 outside
+  uint32_t offset;                   // bytes before it in the section
+  bool offset_exact;
+  uint32_t repeat; // times enclosing REPT and FOR blocks repeat it
+  bool repeat_exact;
+  const RgbasmConstants *constants; // as defined up to the item
+} RgbasmLayoutItem;
+
+typedef struct RgbasmLayoutOptions {
+  // INCLUDE and INCBIN paths are resolved relative to the working directory,
+  // then to these directories and last to the directory of the file.
+  const char *const *include_dirs;
+  size_t include_dir_count;
+  // Called in document order for every instruction and label of the file,
+  // not of INCLUDEd ones, if not NULL. A block whose IF condition is false is
+  // skipped, both branches of an unknown one are visited.
+  void (*on_instruction)(const RgbasmLayoutItem *item, void *context);
+  void (*on_label)(const RgbasmLayoutItem *item, void *context);
+  void *context;
+} RgbasmLayoutOptions;
+
+// Measures the sections of the file `path` parsed into `root`. `parser` is
+// used for INCLUDEd files. `constants` may hold predefined ones and holds
+// the constants of the file afterwards.
+void rgbasm_layout_file(TSParser *parser, const char *path, const char *source,
+                        TSNode root, const RgbasmLayoutOptions *options,
+                        RgbasmConstants *constants, RgbasmFileLayout *out);
+void rgbasm_file_layout_free(RgbasmFileLayout *self);
+
+// Bytes per bank of a section type, 0 for unknown types.
+uint32_t rgbasm_section_capacity(const char *type);
+
+// Whether sections of `type` are placed in one of several banks.
+bool rgbasm_section_type_banked(const char *type);
+
+#endif // RGBASM_TOOLS_LAYOUT_H_
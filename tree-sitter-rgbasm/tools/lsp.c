@@ -0,0 +1,1391 @@
+// A language server for rgbasm on stdin and stdout.
+//
+// The request loop only reads messages and applies document edits. Parsing
+// and every request that needs a tree or the project index run on a
+// work-stealing pool, one parser per worker, and write their responses
+// themselves. Open documents keep their tree and are reparsed incrementally;
+// the other files of the workspace come from a project index that is updated
+// for saved and changed files.
+
+#define _XOPEN_SOURCE 700 // realpath
+
+#include "indexer.h"
+#include "json.h"
+#include "lsp_document.h"
+#include "pool.h"
+#include "symbols.h"
+#include "util.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+// LSP error codes
+#define PARSE_ERROR -32700
+#define METHOD_NOT_FOUND -32601
+
+// The semantic token legend. The grammar's highlight queries already color
+// the syntax; the server adds what needs the project: what a name refers to.
+static const char *const token_types[] = {
+    "function", "macro", "variable", "string", "namespace",
+};
+enum {
+  TOKEN_FUNCTION,
+  TOKEN_MACRO,
+  TOKEN_VARIABLE,
+  TOKEN_STRING,
+  TOKEN_NAMESPACE,
+};
+static const char *const token_modifiers[] = {"declaration", "readonly"};
+enum {
+  MODIFIER_DECLARATION = 1 << 0,
+  MODIFIER_READONLY = 1 << 1,
+};
+
+#define NO_ENTRY UINT32_MAX
+
+// Definitions by name. Entries of the same name are chained.
+typedef struct SymbolEntry {
+  const char *name;
+  uint64_t hash;
+  const RgbasmIndexedFile *file; // NULL for an open document's symbol
+  const RgbasmSymbol *symbol;
+  uint32_t next;
+} SymbolEntry;
+
+typedef struct SymbolMap {
+  uint32_t *slots; // first entry + 1 of a name, 0 for empty
+  uint32_t slot_capacity;
+  SymbolEntry *entries;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t name_count;
+} SymbolMap;
+
+typedef struct Server {
+  RgbasmPool *pool;
+  TSParser **parsers; // one per worker, created on first use
+  pthread_mutex_t output_lock;
+  pthread_mutex_t documents_lock; // guards the table and the refs
+  RgbasmDocument **documents;
+  size_t document_count;
+  size_t document_capacity;
+  pthread_rwlock_t project_lock; // guards `project` and `definitions`
+  // Held while the index is built or updated, one after the other; the
+  // project lock is only taken to swap the result in.
+  pthread_mutex_t update_lock;
+  RgbasmProjectIndex project;
+  SymbolMap definitions;
+  bool indexed; // updates before the first index are left to it
+  char *root;
+  PathList include_dirs;
+  RgbasmIndexOptions index_options;
+  bool utf8; // positions count bytes instead of UTF-16 code units
+  bool shutdown;
+} Server;
+
+typedef enum TaskKind {
+  TASK_PARSE,   // reparse `document`
+  TASK_REQUEST, // answer `message` about `document`
+  TASK_INDEX,   // index the workspace
+  TASK_UPDATE,  // update the index for `paths`
+} TaskKind;
+
+typedef struct Task {
+  TaskKind kind;
+  RgbasmDocument *document;
+  JsonValue message;
+  PathList paths;
+} Task;
+
+static void symbol_map_grow(SymbolMap *map) {
+  const uint32_t capacity = map->slot_capacity ? map->slot_capacity * 2 : 1024;
+  uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+  for (uint32_t i = 0; i < map->slot_capacity; i++) {
+    if (map->slots[i] != 0) {
+      uint32_t j = map->entries[map->slots[i] - 1].hash & (capacity - 1);
+      while (slots[j] != 0) {
+        j = (j + 1) & (capacity - 1);
+      }
+      slots[j] = map->slots[i];
+    }
+  }
+  free(map->slots);
+  map->slots = slots;
+  map->slot_capacity = capacity;
+}
+
+// The slot of `name`, empty if it is not in the map.
+static uint32_t symbol_map_slot(const SymbolMap *map, const char *name,
+                                uint64_t hash) {
+  const uint32_t mask = map->slot_capacity - 1;
+  uint32_t i = hash & mask;
+  while (map->slots[i] != 0 &&
+         strcmp(map->entries[map->slots[i] - 1].name, name) != 0) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static void symbol_map_add(SymbolMap *map, const char *name,
+                           const RgbasmIndexedFile *file,
+                           const RgbasmSymbol *symbol) {
+  if ((map->name_count + 1) * 2 > map->slot_capacity) {
+    symbol_map_grow(map);
+  }
+  if (map->count == map->capacity) {
+    map->capacity = map->capacity ? map->capacity * 2 : 1024;
+    map->entries = realloc(map->entries, map->capacity * sizeof(SymbolEntry));
+  }
+  const uint64_t hash = rgbasm_content_hash(name, strlen(name));
+  const uint32_t slot = symbol_map_slot(map, name, hash);
+  map->entries[map->count] = (SymbolEntry){
+      .name = name,
+      .hash = hash,
+      .file = file,
+      .symbol = symbol,
+      .next = map->slots[slot] ? map->slots[slot] - 1 : NO_ENTRY,
+  };
+  map->name_count += map->slots[slot] == 0;
+  map->slots[slot] = ++map->count;
+}
+
+// The first definition of `name`, follow `next` for the others.
+static const SymbolEntry *symbol_map_find(const SymbolMap *map,
+                                          const char *name) {
+  if (map->slot_capacity == 0) {
+    return NULL;
+  }
+  const uint32_t slot =
+      symbol_map_slot(map, name, rgbasm_content_hash(name, strlen(name)));
+  return map->slots[slot] ? &map->entries[map->slots[slot] - 1] : NULL;
+}
+
+static const SymbolEntry *symbol_map_next(const SymbolMap *map,
+                                          const SymbolEntry *entry) {
+  return entry->next != NO_ENTRY ? &map->entries[entry->next] : NULL;
+}
+
+static void symbol_map_add_symbols(SymbolMap *map,
+                                   const RgbasmFileSymbols *symbols,
+                                   const RgbasmIndexedFile *file) {
+  for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+    const RgbasmSymbol *symbol = &symbols->symbols[i];
+    // EXPORT only marks a definition elsewhere
+    if (symbol->kind != RGBASM_SYMBOL_EXPORT) {
+      symbol_map_add(map, symbols->strings + symbol->name, file, symbol);
+    }
+  }
+}
+
+static void symbol_map_free(SymbolMap *map) {
+  free(map->slots);
+  free(map->entries);
+  *map = (SymbolMap){0};
+}
+
+// ----- Output -----
+
+static void send_message(Server *server, const JsonBuffer *body) {
+  pthread_mutex_lock(&server->output_lock);
+  fprintf(stdout, "Content-Length: %zu\r\n\r\n", body->length);
+  fwrite(body->data, 1, body->length, stdout);
+  fflush(stdout);
+  pthread_mutex_unlock(&server->output_lock);
+}
+
+// Starts a response to `request`; the caller appends the result and "}".
+static void begin_response(JsonBuffer *out, const JsonValue *request) {
+  json_append(out, "{\"jsonrpc\":\"2.0\",\"id\":", 22);
+  const JsonValue *id = json_get(request, "id");
+  if (id != NULL) {
+    json_append_value(out, id);
+  } else {
+    json_append(out, "null", 4);
+  }
+  json_append(out, ",\"result\":", 10);
+}
+
+static void respond_raw(Server *server, const JsonValue *request,
+                        const char *result) {
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_appendf(&out, "%s}", result);
+  send_message(server, &out);
+  json_buffer_free(&out);
+}
+
+static void respond_error(Server *server, const JsonValue *request, int code,
+                          const char *message) {
+  JsonBuffer out = {0};
+  json_append(&out, "{\"jsonrpc\":\"2.0\",\"id\":", 22);
+  const JsonValue *id = json_get(request, "id");
+  if (id != NULL) {
+    json_append_value(&out, id);
+  } else {
+    json_append(&out, "null", 4);
+  }
+  json_appendf(&out, ",\"error\":{\"code\":%d,\"message\":", code);
+  json_append_string(&out, message, strlen(message));
+  json_append(&out, "}}", 2);
+  send_message(server, &out);
+  json_buffer_free(&out);
+}
+
+static void append_file_uri(JsonBuffer *out, const char *path) {
+  JsonBuffer uri = {0};
+  json_append(&uri, "file://", 7);
+  for (const char *c = path; *c != '\0'; c++) {
+    if ((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+        (*c >= '0' && *c <= '9') || strchr("/-._~", *c) != NULL) {
+      json_append(&uri, c, 1);
+    } else {
+      json_appendf(&uri, "%%%02X", (unsigned char)*c);
+    }
+  }
+  json_append_string(out, uri.data, uri.length);
+  json_buffer_free(&uri);
+}
+
+static void append_range(JsonBuffer *out, uint32_t line, uint32_t start,
+                         uint32_t end) {
+  json_appendf(out,
+               "{\"start\":{\"line\":%u,\"character\":%u},"
+               "\"end\":{\"line\":%u,\"character\":%u}}",
+               line, start, line, end);
+}
+
+// ----- Documents -----
+
+static void document_release(Server *server, RgbasmDocument *document) {
+  pthread_mutex_lock(&server->documents_lock);
+  const bool last = --document->refs == 0;
+  pthread_mutex_unlock(&server->documents_lock);
+  if (last) {
+    rgbasm_document_delete(document);
+  }
+}
+
+// The open document with `uri`, retained, or NULL.
+static RgbasmDocument *find_document(Server *server, const char *uri) {
+  RgbasmDocument *found = NULL;
+  pthread_mutex_lock(&server->documents_lock);
+  for (size_t i = 0; uri != NULL && i < server->document_count; i++) {
+    if (strcmp(server->documents[i]->uri, uri) == 0) {
+      found = server->documents[i];
+      found->refs++;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&server->documents_lock);
+  return found;
+}
+
+// Retained references to all open documents, for cross-file requests.
+static RgbasmDocument **open_documents(Server *server, size_t *count) {
+  pthread_mutex_lock(&server->documents_lock);
+  *count = server->document_count;
+  RgbasmDocument **documents =
+      calloc(server->document_count + 1, sizeof(RgbasmDocument *));
+  for (size_t i = 0; i < server->document_count; i++) {
+    documents[i] = server->documents[i];
+    documents[i]->refs++;
+  }
+  pthread_mutex_unlock(&server->documents_lock);
+  return documents;
+}
+
+static void release_documents(Server *server, RgbasmDocument **documents,
+                              size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    document_release(server, documents[i]);
+  }
+  free(documents);
+}
+
+// Whether a project file is shadowed by an open document.
+static bool is_open(RgbasmDocument *const *documents, size_t count,
+                    const char *path) {
+  for (size_t i = 0; i < count; i++) {
+    if (documents[i]->path != NULL && strcmp(documents[i]->path, path) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static TSParser *worker_parser(Server *server, unsigned worker) {
+  if (server->parsers[worker] == NULL) {
+    server->parsers[worker] = ts_parser_new();
+    ts_parser_set_language(server->parsers[worker], tree_sitter_rgbasm());
+  }
+  return server->parsers[worker];
+}
+
+static void submit(Server *server, Task task) {
+  Task *copy = malloc(sizeof(Task));
+  *copy = task;
+  rgbasm_pool_submit(server->pool, RGBASM_POOL_ANY_WORKER, copy);
+}
+
+// ----- Positions and names -----
+
+// The byte position of a request's `position` in `document`.
+static TSPoint request_point(const Server *server,
+                             const RgbasmDocument *document,
+                             const JsonValue *params) {
+  const JsonValue *position = json_get(params, "position");
+  const uint32_t line = (uint32_t)json_number(json_get(position, "line"), 0);
+  const uint32_t character =
+      (uint32_t)json_number(json_get(position, "character"), 0);
+  const uint32_t offset =
+      rgbasm_document_offset(document, line, character, server->utf8);
+  return (TSPoint){line, line < document->line_count
+                             ? offset - document->lines[line]
+                             : 0};
+}
+
+static bool is_name_type(const char *type) {
+  return strcmp(type, "variable") == 0 || strcmp(type, "global_symbol") == 0 ||
+         strcmp(type, "local_symbol") == 0 ||
+         strcmp(type, "qualified_symbol") == 0;
+}
+
+static char *node_text(const char *source, TSNode node) {
+  const uint32_t start = ts_node_start_byte(node);
+  return strndup(source + start, ts_node_end_byte(node) - start);
+}
+
+// The name of the label a local label at `node` belongs to, or NULL.
+static char *enclosing_label(const char *source, TSNode node) {
+  for (TSNode parent = ts_node_parent(node); !ts_node_is_null(parent);
+       parent = ts_node_parent(parent)) {
+    if (strcmp(ts_node_type(parent), "global_label_block") == 0) {
+      const TSNode name = ts_node_child_by_field_name(parent, "name", 4);
+      return ts_node_is_null(name) ? NULL : node_text(source, name);
+    }
+  }
+  return NULL;
+}
+
+// The name of a symbol node as the index stores it: locals qualified with
+// their parent label.
+static char *symbol_name(const char *source, TSNode node) {
+  char *text = node_text(source, node);
+  if (strcmp(ts_node_type(node), "local_symbol") != 0) {
+    return text;
+  }
+  char *scope = enclosing_label(source, node);
+  if (scope == NULL) {
+    return text;
+  }
+  const size_t length = strlen(scope) + strlen(text) + 1;
+  char *name = malloc(length);
+  snprintf(name, length, "%s%s", scope, text);
+  free(scope);
+  free(text);
+  return name;
+}
+
+// The name at the request's position, or NULL.
+static char *name_at(const Server *server, const RgbasmDocument *document,
+                     const JsonValue *params) {
+  const TSPoint point = request_point(server, document, params);
+  TSNode node = ts_node_named_descendant_for_point_range(
+      ts_tree_root_node(document->tree), point, point);
+  // the cursor is on the injected identifier or an affix of the name
+  for (int i = 0; i < 3 && !ts_node_is_null(node); i++) {
+    if (is_name_type(ts_node_type(node))) {
+      return symbol_name(document->text, node);
+    }
+    node = ts_node_parent(node);
+  }
+  return NULL;
+}
+
+// ----- Requests -----
+
+static int symbol_kind(uint8_t kind) {
+  // LSP SymbolKind
+  switch (kind) {
+  case RGBASM_SYMBOL_LABEL:
+  case RGBASM_SYMBOL_LOCAL:
+    return 12; // Function
+  case RGBASM_SYMBOL_CONSTANT:
+    return 14; // Constant
+  case RGBASM_SYMBOL_VARIABLE:
+    return 13; // Variable
+  case RGBASM_SYMBOL_STRING:
+    return 15; // String
+  case RGBASM_SYMBOL_MACRO:
+    return 6; // Method
+  default:
+    return 3; // Namespace
+  }
+}
+
+static int completion_kind(uint8_t kind) {
+  // LSP CompletionItemKind
+  switch (kind) {
+  case RGBASM_SYMBOL_LABEL:
+  case RGBASM_SYMBOL_LOCAL:
+    return 3; // Function
+  case RGBASM_SYMBOL_CONSTANT:
+    return 21; // Constant
+  case RGBASM_SYMBOL_VARIABLE:
+    return 6; // Variable
+  case RGBASM_SYMBOL_STRING:
+    return 1; // Text
+  case RGBASM_SYMBOL_MACRO:
+    return 2; // Method
+  default:
+    return 9; // Module
+  }
+}
+
+// The range of a symbol or reference at byte `point` spanning `bytes`.
+static void append_symbol_range(const Server *server, JsonBuffer *out,
+                                const RgbasmDocument *document, TSPoint point,
+                                uint32_t bytes) {
+  uint32_t start = point.column;
+  uint32_t end = point.column + bytes;
+  if (document != NULL) {
+    start = rgbasm_document_character(document, point.row, start, server->utf8);
+    end = rgbasm_document_character(document, point.row, end, server->utf8);
+  }
+  // files that are not open are taken to be ASCII, as rgbasm sources are
+  append_range(out, point.row, start, end);
+}
+
+static void document_symbols(Server *server, RgbasmDocument *document,
+                             const JsonValue *request) {
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_append(&out, "[", 1);
+  const RgbasmFileSymbols *symbols = &document->symbols;
+  bool first = true;
+  for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+    const RgbasmSymbol *symbol = &symbols->symbols[i];
+    if (symbol->kind == RGBASM_SYMBOL_EXPORT) {
+      continue;
+    }
+    json_append(&out, first ? "{\"name\":" : ",{\"name\":", first ? 8 : 9);
+    first = false;
+    const char *name = symbols->strings + symbol->name;
+    json_append_string(&out, name, strlen(name));
+    json_appendf(&out, ",\"kind\":%d,\"location\":{\"uri\":",
+                 symbol_kind(symbol->kind));
+    json_append_string(&out, document->uri, strlen(document->uri));
+    json_append(&out, ",\"range\":", 9);
+    append_symbol_range(server, &out, document, symbol->point,
+                        symbol->end_byte - symbol->start_byte);
+    json_append(&out, "}", 1);
+    if (symbol->scope != 0) {
+      const char *scope = symbols->strings + symbol->scope;
+      json_append(&out, ",\"containerName\":", 17);
+      json_append_string(&out, scope, strlen(scope));
+    }
+    json_append(&out, "}", 1);
+  }
+  json_append(&out, "]}", 2);
+  send_message(server, &out);
+  json_buffer_free(&out);
+}
+
+// Appends `{"uri":...,"range":...}` for a location in a document or file.
+static void append_location(const Server *server, JsonBuffer *out,
+                            const RgbasmDocument *document, const char *path,
+                            TSPoint point, uint32_t bytes) {
+  json_append(out, "{\"uri\":", 7);
+  if (document != NULL) {
+    json_append_string(out, document->uri, strlen(document->uri));
+  } else {
+    append_file_uri(out, path);
+  }
+  json_append(out, ",\"range\":", 9);
+  append_symbol_range(server, out, document, point, bytes);
+  json_append(out, "}", 1);
+}
+
+// Appends the locations of the definitions of `name` and, with `references`,
+// of its uses: in the open documents and then in the other project files.
+static void append_locations(Server *server, TSParser *parser, JsonBuffer *out,
+                             const char *name, bool definitions,
+                             bool references) {
+  size_t count;
+  RgbasmDocument **documents = open_documents(server, &count);
+  bool first = true;
+  for (size_t i = 0; i < count; i++) {
+    RgbasmDocument *document = documents[i];
+    pthread_mutex_lock(&document->lock);
+    rgbasm_document_sync(document, parser);
+    const RgbasmFileSymbols *symbols = &document->symbols;
+    for (uint32_t j = 0; definitions && j < symbols->symbol_count; j++) {
+      const RgbasmSymbol *symbol = &symbols->symbols[j];
+      if (symbol->kind != RGBASM_SYMBOL_EXPORT &&
+          strcmp(symbols->strings + symbol->name, name) == 0) {
+        json_append(out, ",", !first);
+        first = false;
+        append_location(server, out, document, NULL, symbol->point,
+                        symbol->end_byte - symbol->start_byte);
+      }
+    }
+    for (uint32_t j = 0; references && j < symbols->reference_count; j++) {
+      const RgbasmReference *reference = &symbols->references[j];
+      if (strcmp(symbols->strings + reference->name, name) == 0) {
+        json_append(out, ",", !first);
+        first = false;
+        append_location(server, out, document, NULL, reference->point,
+                        reference->end_byte - reference->start_byte);
+      }
+    }
+    pthread_mutex_unlock(&document->lock);
+  }
+
+  pthread_rwlock_rdlock(&server->project_lock);
+  for (const SymbolEntry *entry = definitions ? symbol_map_find(
+                                                    &server->definitions, name)
+                                              : NULL;
+       entry != NULL; entry = symbol_map_next(&server->definitions, entry)) {
+    if (!is_open(documents, count, entry->file->path)) {
+      json_append(out, ",", !first);
+      first = false;
+      append_location(server, out, NULL, entry->file->path,
+                      entry->symbol->point,
+                      entry->symbol->end_byte - entry->symbol->start_byte);
+    }
+  }
+  for (size_t i = 0; references && i < server->project.count; i++) {
+    const RgbasmIndexedFile *file = &server->project.files[i];
+    if (is_open(documents, count, file->path)) {
+      continue;
+    }
+    const RgbasmFileSymbols *symbols = &file->symbols;
+    for (uint32_t j = 0; j < symbols->reference_count; j++) {
+      const RgbasmReference *reference = &symbols->references[j];
+      if (strcmp(symbols->strings + reference->name, name) == 0) {
+        json_append(out, ",", !first);
+        first = false;
+        append_location(server, out, NULL, file->path, reference->point,
+                        reference->end_byte - reference->start_byte);
+      }
+    }
+  }
+  pthread_rwlock_unlock(&server->project_lock);
+  release_documents(server, documents, count);
+}
+
+// textDocument/definition and textDocument/references
+static void locations(Server *server, TSParser *parser,
+                      RgbasmDocument *document, const JsonValue *request,
+                      bool references) {
+  const JsonValue *params = json_get(request, "params");
+  pthread_mutex_lock(&document->lock);
+  rgbasm_document_sync(document, parser);
+  char *name = name_at(server, document, params);
+  pthread_mutex_unlock(&document->lock);
+  if (name == NULL) {
+    respond_raw(server, request, "null");
+    return;
+  }
+  const bool declarations =
+      !references ||
+      json_bool(json_get(json_get(params, "context"), "includeDeclaration"),
+                true);
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_append(&out, "[", 1);
+  append_locations(server, parser, &out, name, declarations, references);
+  json_append(&out, "]}", 2);
+  send_message(server, &out);
+  json_buffer_free(&out);
+  free(name);
+}
+
+// The characters of a symbol name, `.` for locals.
+static bool is_name_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '@' ||
+         c == '#' || c == '$';
+}
+
+#define MAX_COMPLETIONS 200
+
+typedef struct Completion {
+  JsonBuffer out;
+  const char *prefix;
+  size_t prefix_length;
+  size_t skip; // bytes of the name not inserted: the scope of a local
+  unsigned count;
+  bool incomplete;
+} Completion;
+
+static void add_completion(Completion *completion, const char *name,
+                           uint8_t kind) {
+  if (strncmp(name, completion->prefix, completion->prefix_length) != 0) {
+    return;
+  }
+  if (completion->count == MAX_COMPLETIONS) {
+    completion->incomplete = true;
+    return;
+  }
+  json_append(&completion->out, ",{\"label\":", 10);
+  json_append_string(&completion->out, name + completion->skip,
+                     strlen(name + completion->skip));
+  json_appendf(&completion->out, ",\"kind\":%d}", completion_kind(kind));
+  completion->count++;
+}
+
+// textDocument/completion of the symbols of the document and the project.
+// A name starting with `.` completes the locals of the enclosing label.
+static void complete(Server *server, TSParser *parser,
+                     RgbasmDocument *document, const JsonValue *request) {
+  const JsonValue *params = json_get(request, "params");
+  pthread_mutex_lock(&document->lock);
+  rgbasm_document_sync(document, parser);
+  const TSPoint point = request_point(server, document, params);
+  const uint32_t offset =
+      point.row < document->line_count ? document->lines[point.row] + point.column
+                                       : document->length;
+  uint32_t start = offset;
+  while (start > 0 && is_name_char(document->text[start - 1])) {
+    start--;
+  }
+  char *prefix = strndup(document->text + start, offset - start);
+
+  // the enclosing label is the last one defined before the cursor
+  const RgbasmFileSymbols *symbols = &document->symbols;
+  const char *scope = NULL;
+  for (uint32_t i = 0; i < symbols->symbol_count; i++) {
+    const RgbasmSymbol *symbol = &symbols->symbols[i];
+    if (symbol->start_byte >= offset) {
+      break;
+    }
+    if (symbol->kind == RGBASM_SYMBOL_LABEL) {
+      scope = symbols->strings + symbol->name;
+    }
+  }
+  Completion completion = {.prefix = prefix};
+  if (prefix[0] == '.' && scope != NULL) {
+    const size_t length = strlen(scope) + strlen(prefix) + 1;
+    char *qualified = malloc(length);
+    snprintf(qualified, length, "%s%s", scope, prefix);
+    free(prefix);
+    prefix = qualified;
+    completion.prefix = prefix;
+    completion.skip = strlen(scope);
+  }
+  completion.prefix_length = strlen(completion.prefix);
+
+  // names defined more than once are offered once
+  SymbolMap seen = {0};
+  symbol_map_add_symbols(&seen, symbols, NULL);
+  for (uint32_t i = 0; i < seen.slot_capacity; i++) {
+    if (seen.slots[i] != 0) {
+      const SymbolEntry *entry = &seen.entries[seen.slots[i] - 1];
+      add_completion(&completion, entry->name, entry->symbol->kind);
+    }
+  }
+  pthread_rwlock_rdlock(&server->project_lock);
+  const SymbolMap *definitions = &server->definitions;
+  for (uint32_t i = 0; i < definitions->slot_capacity; i++) {
+    if (definitions->slots[i] == 0) {
+      continue;
+    }
+    const SymbolEntry *entry = &definitions->entries[definitions->slots[i] - 1];
+    if (symbol_map_find(&seen, entry->name) != NULL) {
+      continue;
+    }
+    // the project's copy of this document is out of date
+    while (entry != NULL && document->path != NULL &&
+           strcmp(entry->file->path, document->path) == 0) {
+      entry = symbol_map_next(definitions, entry);
+    }
+    if (entry != NULL) {
+      add_completion(&completion, entry->name, entry->symbol->kind);
+    }
+  }
+  pthread_rwlock_unlock(&server->project_lock);
+  symbol_map_free(&seen);
+  pthread_mutex_unlock(&document->lock);
+
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_appendf(&out, "{\"isIncomplete\":%s,\"items\":[",
+               completion.incomplete ? "true" : "false");
+  // the items were appended each with a leading comma but the first
+  if (completion.count > 0) {
+    json_append(&out, completion.out.data + 1, completion.out.length - 1);
+  }
+  json_append(&out, "]}}", 3);
+  send_message(server, &out);
+  json_buffer_free(&out);
+  json_buffer_free(&completion.out);
+  free(prefix);
+}
+
+// The token type of a symbol kind, -1 for none.
+static int token_type(uint8_t kind, unsigned *modifiers) {
+  switch (kind) {
+  case RGBASM_SYMBOL_LABEL:
+  case RGBASM_SYMBOL_LOCAL:
+    return TOKEN_FUNCTION;
+  case RGBASM_SYMBOL_MACRO:
+    return TOKEN_MACRO;
+  case RGBASM_SYMBOL_CONSTANT:
+    *modifiers |= MODIFIER_READONLY;
+    return TOKEN_VARIABLE;
+  case RGBASM_SYMBOL_VARIABLE:
+    return TOKEN_VARIABLE;
+  case RGBASM_SYMBOL_STRING:
+    return TOKEN_STRING;
+  default:
+    // section names are string literals, the highlight queries cover them
+    return -1;
+  }
+}
+
+// The kind of the definition of `name`, in the document first.
+static int definition_kind(const Server *server, const SymbolMap *local,
+                           const char *name) {
+  const SymbolEntry *entry = symbol_map_find(local, name);
+  if (entry == NULL) {
+    entry = symbol_map_find(&server->definitions, name);
+  }
+  return entry != NULL ? entry->symbol->kind : -1;
+}
+
+typedef struct Tokens {
+  uint32_t *data;
+  uint32_t count;
+  uint32_t capacity;
+  TSPoint last;
+} Tokens;
+
+static void push_token(const Server *server, const RgbasmDocument *document,
+                       Tokens *tokens, TSPoint point, uint32_t bytes, int type,
+                       unsigned modifiers) {
+  if (tokens->count + 5 > tokens->capacity) {
+    tokens->capacity = tokens->capacity ? tokens->capacity * 2 : 1280;
+    tokens->data = realloc(tokens->data, tokens->capacity * sizeof(uint32_t));
+  }
+  const uint32_t start = rgbasm_document_character(document, point.row,
+                                                   point.column, server->utf8);
+  const uint32_t end = rgbasm_document_character(
+      document, point.row, point.column + bytes, server->utf8);
+  // positions are relative to the previous token
+  const uint32_t line = point.row - tokens->last.row;
+  uint32_t *token = &tokens->data[tokens->count];
+  token[0] = line;
+  token[1] = line == 0 ? start - tokens->last.column : start;
+  token[2] = end - start;
+  token[3] = (uint32_t)type;
+  token[4] = modifiers;
+  tokens->count += 5;
+  tokens->last = (TSPoint){point.row, start};
+}
+
+// The tokens of every definition and resolved reference, in document order.
+static void collect_tokens(const Server *server, const RgbasmDocument *document,
+                           Tokens *tokens) {
+  const RgbasmFileSymbols *symbols = &document->symbols;
+  SymbolMap local = {0};
+  symbol_map_add_symbols(&local, symbols, NULL);
+  uint32_t i = 0;
+  uint32_t j = 0;
+  while (i < symbols->symbol_count || j < symbols->reference_count) {
+    const RgbasmSymbol *symbol =
+        i < symbols->symbol_count ? &symbols->symbols[i] : NULL;
+    const RgbasmReference *reference =
+        j < symbols->reference_count ? &symbols->references[j] : NULL;
+    unsigned modifiers = 0;
+    int type = -1;
+    if (symbol != NULL &&
+        (reference == NULL || symbol->start_byte <= reference->start_byte)) {
+      i++;
+      if (symbol->kind == RGBASM_SYMBOL_EXPORT) {
+        const int kind =
+            definition_kind(server, &local, symbols->strings + symbol->name);
+        type = kind >= 0 ? token_type((uint8_t)kind, &modifiers) : -1;
+      } else {
+        modifiers = MODIFIER_DECLARATION;
+        type = token_type(symbol->kind, &modifiers);
+      }
+      if (type >= 0) {
+        push_token(server, document, tokens, symbol->point,
+                   symbol->end_byte - symbol->start_byte, type, modifiers);
+      }
+      continue;
+    }
+    j++;
+    if (reference->flags & RGBASM_REFERENCE_MACRO_CALL) {
+      type = TOKEN_MACRO;
+    } else {
+      const int kind =
+          definition_kind(server, &local, symbols->strings + reference->name);
+      type = kind >= 0 ? token_type((uint8_t)kind, &modifiers) : -1;
+    }
+    if (type >= 0) {
+      push_token(server, document, tokens, reference->point,
+                 reference->end_byte - reference->start_byte, type, modifiers);
+    }
+  }
+  symbol_map_free(&local);
+}
+
+static void append_tokens(JsonBuffer *out, const uint32_t *data,
+                          uint32_t count) {
+  json_append(out, "[", 1);
+  for (uint32_t i = 0; i < count; i++) {
+    json_appendf(out, i ? ",%u" : "%u", data[i]);
+  }
+  json_append(out, "]", 1);
+}
+
+// textDocument/semanticTokens/full and, with `delta`, .../full/delta. A delta
+// is a single edit replacing what lies between the common prefix and suffix
+// of the previous and the new tokens.
+static void semantic_tokens(Server *server, TSParser *parser,
+                            RgbasmDocument *document, const JsonValue *request,
+                            bool delta) {
+  pthread_mutex_lock(&document->lock);
+  rgbasm_document_sync(document, parser);
+  Tokens tokens = {0};
+  pthread_rwlock_rdlock(&server->project_lock);
+  collect_tokens(server, document, &tokens);
+  pthread_rwlock_unlock(&server->project_lock);
+
+  const char *previous =
+      json_string(json_get(json_get(request, "params"), "previousResultId"));
+  char result[16];
+  snprintf(result, sizeof(result), "%u", document->token_result);
+  delta = delta && document->tokens != NULL && previous != NULL &&
+          strcmp(previous, result) == 0;
+  snprintf(result, sizeof(result), "%u", ++document->token_result);
+
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_append(&out, "{\"resultId\":", 12);
+  json_append_string(&out, result, strlen(result));
+  if (delta) {
+    const uint32_t *old = document->tokens;
+    const uint32_t old_count = document->token_count;
+    const uint32_t shorter =
+        old_count < tokens.count ? old_count : tokens.count;
+    uint32_t prefix = 0;
+    while (prefix < shorter && old[prefix] == tokens.data[prefix]) {
+      prefix++;
+    }
+    uint32_t suffix = 0;
+    while (suffix < shorter - prefix &&
+           old[old_count - 1 - suffix] == tokens.data[tokens.count - 1 - suffix]) {
+      suffix++;
+    }
+    json_append(&out, ",\"edits\":[", 10);
+    if (prefix + suffix < old_count || prefix + suffix < tokens.count) {
+      json_appendf(&out, "{\"start\":%u,\"deleteCount\":%u,\"data\":", prefix,
+                   old_count - prefix - suffix);
+      append_tokens(&out, tokens.data + prefix,
+                    tokens.count - prefix - suffix);
+      json_append(&out, "}", 1);
+    }
+    json_append(&out, "]}}", 3);
+  } else {
+    json_append(&out, ",\"data\":", 8);
+    append_tokens(&out, tokens.data, tokens.count);
+    json_append(&out, "}}", 2);
+  }
+  free(document->tokens);
+  document->tokens = tokens.data;
+  document->token_count = tokens.count;
+  pthread_mutex_unlock(&document->lock);
+  send_message(server, &out);
+  json_buffer_free(&out);
+}
+
+static void document_symbols_request(Server *server, TSParser *parser,
+                                     RgbasmDocument *document,
+                                     const JsonValue *request) {
+  pthread_mutex_lock(&document->lock);
+  rgbasm_document_sync(document, parser);
+  document_symbols(server, document, request);
+  pthread_mutex_unlock(&document->lock);
+}
+
+// ----- Project -----
+
+static void build_definitions(SymbolMap *definitions,
+                              const RgbasmProjectIndex *project) {
+  for (size_t i = 0; i < project->count; i++) {
+    const RgbasmIndexedFile *file = &project->files[i];
+    symbol_map_add_symbols(definitions, &file->symbols, file);
+  }
+}
+
+// Swaps in `project` and its `definitions`, built outside the lock, and
+// frees the ones they replace once no request reads them any more.
+static void swap_project(Server *server, RgbasmProjectIndex *project,
+                         SymbolMap *definitions) {
+  pthread_rwlock_wrlock(&server->project_lock);
+  const RgbasmProjectIndex old_project = server->project;
+  const SymbolMap old_definitions = server->definitions;
+  server->project = *project;
+  server->definitions = *definitions;
+  pthread_rwlock_unlock(&server->project_lock);
+  *project = old_project;
+  *definitions = old_definitions;
+  rgbasm_project_index_free(project);
+  symbol_map_free(definitions);
+}
+
+// Indexes the workspace outside the lock and swaps the result in.
+static void index_project(Server *server) {
+  if (server->root == NULL) {
+    return;
+  }
+  const char *paths[] = {server->root};
+  RgbasmProjectIndex project = {0};
+  SymbolMap definitions = {0};
+  pthread_mutex_lock(&server->update_lock);
+  rgbasm_index_project(paths, 1, &server->index_options, &project);
+  build_definitions(&definitions, &project);
+  swap_project(server, &project, &definitions);
+  server->indexed = true;
+  pthread_mutex_unlock(&server->update_lock);
+}
+
+// Updates a copy of the index, so requests keep reading the current one
+// while files are parsed again, and swaps it in.
+static void update_project(Server *server, const PathList *paths) {
+  if (server->root == NULL) {
+    return;
+  }
+  const char *roots[] = {server->root};
+  RgbasmIndexChanges changes = {0};
+  pthread_mutex_lock(&server->update_lock);
+  if (server->indexed) {
+    // only updates write the index, so reading it needs no lock here
+    RgbasmProjectIndex project;
+    rgbasm_project_index_copy(&project, &server->project);
+    rgbasm_index_update(&project, roots, 1,
+                        (const char *const *)paths->items, paths->count,
+                        &server->index_options, &changes);
+    SymbolMap definitions = {0};
+    build_definitions(&definitions, &project);
+    swap_project(server, &project, &definitions);
+  }
+  pthread_mutex_unlock(&server->update_lock);
+  rgbasm_index_changes_free(&changes);
+}
+
+static void run_task(RgbasmPool *pool, unsigned worker, void *data,
+                     void *context) {
+  (void)pool;
+  Server *server = context;
+  Task *task = data;
+  TSParser *parser = worker_parser(server, worker);
+  const char *method = json_string(json_get(&task->message, "method"));
+  switch (task->kind) {
+  case TASK_PARSE:
+    pthread_mutex_lock(&task->document->lock);
+    rgbasm_document_sync(task->document, parser);
+    pthread_mutex_unlock(&task->document->lock);
+    break;
+  case TASK_REQUEST:
+    if (strcmp(method, "textDocument/documentSymbol") == 0) {
+      document_symbols_request(server, parser, task->document, &task->message);
+    } else if (strcmp(method, "textDocument/definition") == 0) {
+      locations(server, parser, task->document, &task->message, false);
+    } else if (strcmp(method, "textDocument/references") == 0) {
+      locations(server, parser, task->document, &task->message, true);
+    } else if (strcmp(method, "textDocument/completion") == 0) {
+      complete(server, parser, task->document, &task->message);
+    } else {
+      semantic_tokens(server, parser, task->document, &task->message,
+                      strcmp(method, "textDocument/semanticTokens/full/delta") ==
+                          0);
+    }
+    break;
+  case TASK_INDEX:
+    index_project(server);
+    break;
+  case TASK_UPDATE:
+    update_project(server, &task->paths);
+    break;
+  }
+  if (task->document != NULL) {
+    document_release(server, task->document);
+  }
+  if (task->kind == TASK_REQUEST) {
+    json_free(&task->message);
+  }
+  path_list_free(&task->paths);
+  free(task);
+}
+
+// ----- Notifications and the request loop -----
+
+static void initialize(Server *server, const JsonValue *request) {
+  const JsonValue *params = json_get(request, "params");
+  const JsonValue *encodings = json_get(
+      json_get(json_get(params, "capabilities"), "general"),
+      "positionEncodings");
+  for (size_t i = 0; encodings != NULL && encodings->type == JSON_ARRAY &&
+                     i < encodings->count;
+       i++) {
+    const char *encoding = json_string(&encodings->items[i]);
+    server->utf8 |= encoding != NULL && strcmp(encoding, "utf-8") == 0;
+  }
+
+  const char *root_uri = json_string(json_get(params, "rootUri"));
+  char *root = root_uri != NULL ? rgbasm_uri_path(root_uri) : NULL;
+  if (root == NULL && json_string(json_get(params, "rootPath")) != NULL) {
+    root = strdup(json_string(json_get(params, "rootPath")));
+  }
+  if (root != NULL) {
+    server->root = realpath(root, NULL);
+    free(root);
+  }
+  const JsonValue *include_dirs =
+      json_get(json_get(params, "initializationOptions"), "includeDirs");
+  for (size_t i = 0; include_dirs != NULL && include_dirs->type == JSON_ARRAY &&
+                     i < include_dirs->count;
+       i++) {
+    const char *dir = json_string(&include_dirs->items[i]);
+    if (dir != NULL) {
+      path_list_push(&server->include_dirs, dir);
+    }
+  }
+  server->index_options.include_dirs =
+      (const char *const *)server->include_dirs.items;
+  server->index_options.include_dir_count = server->include_dirs.count;
+
+  JsonBuffer out = {0};
+  begin_response(&out, request);
+  json_appendf(&out,
+               "{\"capabilities\":{\"positionEncoding\":\"%s\","
+               "\"textDocumentSync\":{\"openClose\":true,\"change\":2,"
+               "\"save\":true},"
+               "\"documentSymbolProvider\":true,"
+               "\"definitionProvider\":true,"
+               "\"referencesProvider\":true,"
+               "\"completionProvider\":{\"triggerCharacters\":[\".\"]},"
+               "\"semanticTokensProvider\":{\"legend\":{\"tokenTypes\":",
+               server->utf8 ? "utf-8" : "utf-16");
+  json_append(&out, "[", 1);
+  for (size_t i = 0; i < sizeof(token_types) / sizeof(token_types[0]); i++) {
+    json_append(&out, ",", i > 0);
+    json_append_string(&out, token_types[i], strlen(token_types[i]));
+  }
+  json_append(&out, "],\"tokenModifiers\":[", 20);
+  for (size_t i = 0; i < sizeof(token_modifiers) / sizeof(token_modifiers[0]);
+       i++) {
+    json_append(&out, ",", i > 0);
+    json_append_string(&out, token_modifiers[i], strlen(token_modifiers[i]));
+  }
+  static const char rest[] = "]},\"full\":{\"delta\":true}}},"
+                             "\"serverInfo\":{\"name\":\"rgbasm-lsp\"}}}";
+  json_append(&out, rest, sizeof(rest) - 1);
+  send_message(server, &out);
+  json_buffer_free(&out);
+}
+
+static void open_document(Server *server, const JsonValue *params) {
+  const JsonValue *item = json_get(params, "textDocument");
+  const char *uri = json_string(json_get(item, "uri"));
+  const JsonValue *text = json_get(item, "text");
+  if (uri == NULL || text == NULL || text->type != JSON_STRING) {
+    return;
+  }
+  RgbasmDocument *document =
+      rgbasm_document_new(uri, text->string, (uint32_t)text->length,
+                          (int)json_number(json_get(item, "version"), 0));
+  // compared with the canonical paths of the index
+  if (document->path != NULL) {
+    char *path = realpath(document->path, NULL);
+    if (path != NULL) {
+      free(document->path);
+      document->path = path;
+    }
+  }
+  document->refs = 2; // the table's and the parse task's
+  pthread_mutex_lock(&server->documents_lock);
+  if (server->document_count == server->document_capacity) {
+    server->document_capacity =
+        server->document_capacity ? server->document_capacity * 2 : 16;
+    server->documents =
+        realloc(server->documents,
+                server->document_capacity * sizeof(RgbasmDocument *));
+  }
+  server->documents[server->document_count++] = document;
+  pthread_mutex_unlock(&server->documents_lock);
+  submit(server, (Task){.kind = TASK_PARSE, .document = document});
+}
+
+static void change_document(Server *server, const JsonValue *params) {
+  const JsonValue *item = json_get(params, "textDocument");
+  RgbasmDocument *document =
+      find_document(server, json_string(json_get(item, "uri")));
+  if (document == NULL) {
+    return;
+  }
+  const JsonValue *changes = json_get(params, "contentChanges");
+  pthread_mutex_lock(&document->lock);
+  for (size_t i = 0; changes != NULL && changes->type == JSON_ARRAY &&
+                     i < changes->count;
+       i++) {
+    const JsonValue *change = &changes->items[i];
+    const JsonValue *text = json_get(change, "text");
+    if (text == NULL || text->type != JSON_STRING) {
+      continue;
+    }
+    const JsonValue *range = json_get(change, "range");
+    uint32_t start = 0;
+    uint32_t end = document->length;
+    if (range != NULL) {
+      const JsonValue *from = json_get(range, "start");
+      const JsonValue *to = json_get(range, "end");
+      start = rgbasm_document_offset(
+          document, (uint32_t)json_number(json_get(from, "line"), 0),
+          (uint32_t)json_number(json_get(from, "character"), 0), server->utf8);
+      end = rgbasm_document_offset(
+          document, (uint32_t)json_number(json_get(to, "line"), 0),
+          (uint32_t)json_number(json_get(to, "character"), 0), server->utf8);
+    }
+    rgbasm_document_replace(document, start, end, text->string,
+                            (uint32_t)text->length);
+  }
+  document->version = (int)json_number(json_get(item, "version"), 0);
+  pthread_mutex_unlock(&document->lock);
+  // the reference is handed to the task
+  submit(server, (Task){.kind = TASK_PARSE, .document = document});
+}
+
+static void close_document(Server *server, const JsonValue *params) {
+  const char *uri =
+      json_string(json_get(json_get(params, "textDocument"), "uri"));
+  RgbasmDocument *document = NULL;
+  pthread_mutex_lock(&server->documents_lock);
+  for (size_t i = 0; uri != NULL && i < server->document_count; i++) {
+    if (strcmp(server->documents[i]->uri, uri) == 0) {
+      document = server->documents[i];
+      server->documents[i] = server->documents[--server->document_count];
+      break;
+    }
+  }
+  pthread_mutex_unlock(&server->documents_lock);
+  if (document != NULL) {
+    document_release(server, document);
+  }
+}
+
+// Adds the canonical path of a file: URI to the files of an update.
+static void add_changed_file(PathList *paths, const char *uri) {
+  char *path = uri != NULL ? rgbasm_uri_path(uri) : NULL;
+  char *canonical = path != NULL ? path_canonical(path) : NULL;
+  if (canonical != NULL) {
+    path_list_push(paths, canonical);
+  }
+  free(canonical);
+  free(path);
+}
+
+static void submit_update(Server *server, Task task) {
+  if (task.paths.count > 0) {
+    submit(server, task);
+  } else {
+    path_list_free(&task.paths);
+  }
+}
+
+static bool is_document_request(const char *method) {
+  static const char *const methods[] = {
+      "textDocument/documentSymbol",
+      "textDocument/definition",
+      "textDocument/references",
+      "textDocument/completion",
+      "textDocument/semanticTokens/full",
+      "textDocument/semanticTokens/full/delta",
+  };
+  for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+    if (strcmp(method, methods[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Handles one message. Takes `message`; returns false after `exit`.
+static bool dispatch(Server *server, JsonValue *message) {
+  const char *method = json_string(json_get(message, "method"));
+  const JsonValue *params = json_get(message, "params");
+  const bool request = json_get(message, "id") != NULL;
+  bool keep = false; // `message` moved to a task
+  bool running = true;
+  if (method == NULL) {
+    // a response to a request of ours, we send none
+  } else if (is_document_request(method)) {
+    RgbasmDocument *document = find_document(
+        server, json_string(json_get(json_get(params, "textDocument"), "uri")));
+    if (document == NULL) {
+      respond_raw(server, message, "null");
+    } else {
+      submit(server, (Task){.kind = TASK_REQUEST,
+                            .document = document,
+                            .message = *message});
+      keep = true;
+    }
+  } else if (strcmp(method, "initialize") == 0) {
+    initialize(server, message);
+  } else if (strcmp(method, "initialized") == 0) {
+    submit(server, (Task){.kind = TASK_INDEX});
+  } else if (strcmp(method, "textDocument/didOpen") == 0) {
+    open_document(server, params);
+  } else if (strcmp(method, "textDocument/didChange") == 0) {
+    change_document(server, params);
+  } else if (strcmp(method, "textDocument/didClose") == 0) {
+    close_document(server, params);
+  } else if (strcmp(method, "textDocument/didSave") == 0) {
+    Task task = {.kind = TASK_UPDATE};
+    add_changed_file(&task.paths, json_string(json_get(
+                                      json_get(params, "textDocument"), "uri")));
+    submit_update(server, task);
+  } else if (strcmp(method, "workspace/didChangeWatchedFiles") == 0) {
+    const JsonValue *changes = json_get(params, "changes");
+    Task task = {.kind = TASK_UPDATE};
+    for (size_t i = 0; changes != NULL && changes->type == JSON_ARRAY &&
+                       i < changes->count;
+         i++) {
+      add_changed_file(&task.paths,
+                       json_string(json_get(&changes->items[i], "uri")));
+    }
+    submit_update(server, task);
+  } else if (strcmp(method, "shutdown") == 0) {
+    server->shutdown = true;
+    respond_raw(server, message, "null");
+  } else if (strcmp(method, "exit") == 0) {
+    running = false;
+  } else if (request) {
+    respond_error(server, message, METHOD_NOT_FOUND, method);
+  }
+  if (!keep) {
+    json_free(message);
+  }
+  return running;
+}
+
+// Reads the next message body, NULL at the end of the input.
+static char *read_message(size_t *length) {
+  char header[256];
+  size_t content_length = 0;
+  bool found = false;
+  while (fgets(header, sizeof(header), stdin) != NULL) {
+    if (strcmp(header, "\r\n") == 0 || strcmp(header, "\n") == 0) {
+      if (!found) {
+        continue;
+      }
+      char *body = malloc(content_length + 1);
+      if (fread(body, 1, content_length, stdin) != content_length) {
+        free(body);
+        return NULL;
+      }
+      body[content_length] = '\0';
+      *length = content_length;
+      return body;
+    }
+    if (strncmp(header, "Content-Length:", 15) == 0) {
+      content_length = strtoul(header + 15, NULL, 10);
+      found = true;
+    }
+  }
+  return NULL;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]...\n"
+          "\n"
+          "Language server for rgbasm on stdin and stdout. Indexes the\n"
+          "workspace root and the files it includes.\n"
+          "\n"
+          "  -j threads  parse on this many threads, default one per core\n"
+          "  -I dir      resolve INCLUDE paths in dir, like rgbasm -I;\n"
+          "              the `includeDirs` initialization option adds more\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  Server server = {0};
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      path_list_push(&server.include_dirs, argv[++i]);
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (strcmp(argv[i], "--stdio") != 0) {
+      // --stdio is what clients commonly pass, and the only transport
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (threads == 0) {
+    threads = rgbasm_pool_default_threads();
+  }
+
+  pthread_mutex_init(&server.output_lock, NULL);
+  pthread_mutex_init(&server.documents_lock, NULL);
+  pthread_rwlock_init(&server.project_lock, NULL);
+  pthread_mutex_init(&server.update_lock, NULL);
+  server.index_options.threads = threads;
+  server.index_options.follow_includes = true;
+  server.index_options.include_dirs =
+      (const char *const *)server.include_dirs.items;
+  server.index_options.include_dir_count = server.include_dirs.count;
+  server.parsers = calloc(threads, sizeof(TSParser *));
+  server.pool = rgbasm_pool_new(threads, run_task, &server);
+  if (server.pool == NULL) {
+    fprintf(stderr, "could not start the threads\n");
+    return 1;
+  }
+
+  size_t length;
+  char *body;
+  while ((body = read_message(&length)) != NULL) {
+    JsonValue message;
+    const bool parsed = json_parse(body, length, &message);
+    free(body);
+    if (!parsed) {
+      respond_error(&server, NULL, PARSE_ERROR, "Parse error");
+      continue;
+    }
+    if (!dispatch(&server, &message)) {
+      break;
+    }
+  }
+
+  rgbasm_pool_delete(server.pool);
+  for (unsigned i = 0; i < threads; i++) {
+    if (server.parsers[i] != NULL) {
+      ts_parser_delete(server.parsers[i]);
+    }
+  }
+  free(server.parsers);
+  for (size_t i = 0; i < server.document_count; i++) {
+    rgbasm_document_delete(server.documents[i]);
+  }
+  free(server.documents);
+  symbol_map_free(&server.definitions);
+  rgbasm_project_index_free(&server.project);
+  path_list_free(&server.include_dirs);
+  free(server.root);
+  pthread_mutex_destroy(&server.output_lock);
+  pthread_mutex_destroy(&server.documents_lock);
+  pthread_rwlock_destroy(&server.project_lock);
+  pthread_mutex_destroy(&server.update_lock);
+  return server.shutdown ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "lsp_document.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+char *rgbasm_uri_path(const char *uri) {
+  static const char prefix[] = "file://";
+  if (strncmp(uri, prefix, sizeof(prefix) - 1) != 0) {
+    return NULL;
+  }
+  const char *encoded = uri + sizeof(prefix) - 1;
+  char *path = malloc(strlen(encoded) + 1);
+  size_t length = 0;
+  for (const char *c = encoded; *c != '\0'; c++) {
+    if (c[0] == '%' && hex_value(c[1]) >= 0 && hex_value(c[2]) >= 0) {
+      path[length++] = (char)(hex_value(c[1]) * 16 + hex_value(c[2]));
+      c += 2;
+    } else {
+      path[length++] = *c;
+    }
+  }
+  path[length] = '\0';
+  return path;
+}
+
+static void index_lines(RgbasmDocument *self) {
+  self->line_count = 0;
+  for (uint32_t i = 0; i <= self->length; i++) {
+    if (i == 0 || self->text[i - 1] == '\n') {
+      if (self->line_count == self->line_capacity) {
+        self->line_capacity = self->line_capacity ? self->line_capacity * 2 : 256;
+        self->lines =
+            realloc(self->lines, self->line_capacity * sizeof(uint32_t));
+      }
+      self->lines[self->line_count++] = i;
+    }
+  }
+}
+
+RgbasmDocument *rgbasm_document_new(const char *uri, const char *text,
+                                    uint32_t length, int version) {
+  RgbasmDocument *self = calloc(1, sizeof(RgbasmDocument));
+  self->uri = strdup(uri);
+  self->path = rgbasm_uri_path(uri);
+  self->version = version;
+  pthread_mutex_init(&self->lock, NULL);
+  self->capacity = length + 1;
+  self->text = malloc(self->capacity);
+  memcpy(self->text, text, length);
+  self->text[length] = '\0';
+  self->length = length;
+  self->dirty = true;
+  rgbasm_file_symbols_init(&self->symbols);
+  index_lines(self);
+  return self;
+}
+
+void rgbasm_document_delete(RgbasmDocument *self) {
+  if (self->tree != NULL) {
+    ts_tree_delete(self->tree);
+  }
+  rgbasm_file_symbols_free(&self->symbols);
+  pthread_mutex_destroy(&self->lock);
+  free(self->tokens);
+  free(self->lines);
+  free(self->text);
+  free(self->path);
+  free(self->uri);
+  free(self);
+}
+
+static uint32_t line_end(const RgbasmDocument *self, uint32_t line) {
+  uint32_t end = line + 1 < self->line_count ? self->lines[line + 1]
+                                             : self->length;
+  // the line break is not part of the line
+  while (end > self->lines[line] &&
+         (self->text[end - 1] == '\n' || self->text[end - 1] == '\r')) {
+    end--;
+  }
+  return end;
+}
+
+// UTF-16 code units of the UTF-8 sequence starting with `lead`.
+static uint32_t utf16_units(unsigned char lead) {
+  return lead >= 0xf0 ? 2 : 1;
+}
+
+static bool is_continuation(unsigned char byte) {
+  return (byte & 0xc0) == 0x80;
+}
+
+uint32_t rgbasm_document_offset(const RgbasmDocument *self, uint32_t line,
+                                uint32_t character, bool utf8) {
+  if (line >= self->line_count) {
+    return self->length;
+  }
+  const uint32_t start = self->lines[line];
+  const uint32_t end = line_end(self, line);
+  if (utf8) {
+    return character < end - start ? start + character : end;
+  }
+  uint32_t offset = start;
+  uint32_t units = 0;
+  while (offset < end && units < character) {
+    units += utf16_units((unsigned char)self->text[offset]);
+    offset++;
+    while (offset < end && is_continuation((unsigned char)self->text[offset])) {
+      offset++;
+    }
+  }
+  return offset;
+}
+
+uint32_t rgbasm_document_character(const RgbasmDocument *self, uint32_t line,
+                                   uint32_t column, bool utf8) {
+  if (utf8 || line >= self->line_count) {
+    return column;
+  }
+  const uint32_t start = self->lines[line];
+  const uint32_t end = start + column < self->length ? start + column
+                                                     : self->length;
+  uint32_t units = 0;
+  for (uint32_t i = start; i < end; i++) {
+    const unsigned char byte = (unsigned char)self->text[i];
+    if (!is_continuation(byte)) {
+      units += utf16_units(byte);
+    }
+  }
+  return units;
+}
+
+static TSPoint point_of(const RgbasmDocument *self, uint32_t offset) {
+  uint32_t low = 0;
+  uint32_t high = self->line_count;
+  while (high - low > 1) {
+    const uint32_t middle = low + (high - low) / 2;
+    if (self->lines[middle] <= offset) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+  return (TSPoint){low, offset - self->lines[low]};
+}
+
+void rgbasm_document_replace(RgbasmDocument *self, uint32_t start,
+                             uint32_t end, const char *text, uint32_t length) {
+  if (end > self->length) {
+    end = self->length;
+  }
+  if (start > end) {
+    start = end;
+  }
+  const TSPoint start_point = point_of(self, start);
+  const TSPoint old_end_point = point_of(self, end);
+
+  const uint32_t new_length = self->length - (end - start) + length;
+  if (new_length + 1 > self->capacity) {
+    self->capacity = (new_length + 1) * 2;
+    self->text = realloc(self->text, self->capacity);
+  }
+  memmove(self->text + start + length, self->text + end, self->length - end);
+  memcpy(self->text + start, text, length);
+  self->length = new_length;
+  self->text[new_length] = '\0';
+
+  TSPoint new_end_point = start_point;
+  for (uint32_t i = 0; i < length; i++) {
+    if (text[i] == '\n') {
+      new_end_point.row++;
+      new_end_point.column = 0;
+    } else {
+      new_end_point.column++;
+    }
+  }
+  if (self->tree != NULL) {
+    const TSInputEdit edit = {
+        .start_byte = start,
+        .old_end_byte = end,
+        .new_end_byte = start + length,
+        .start_point = start_point,
+        .old_end_point = old_end_point,
+        .new_end_point = new_end_point,
+    };
+    ts_tree_edit(self->tree, &edit);
+  }
+  self->dirty = true;
+  index_lines(self);
+}
+
+void rgbasm_document_sync(RgbasmDocument *self, TSParser *parser) {
+  if (!self->dirty) {
+    return;
+  }
+  TSTree *tree =
+      ts_parser_parse_string(parser, self->tree, self->text, self->length);
+  if (self->tree != NULL) {
+    ts_tree_delete(self->tree);
+  }
+  self->tree = tree;
+  self->dirty = false;
+  rgbasm_file_symbols_free(&self->symbols);
+  rgbasm_file_symbols_init(&self->symbols);
+  rgbasm_extract_symbols(&self->symbols, ts_tree_root_node(tree), self->text);
+}
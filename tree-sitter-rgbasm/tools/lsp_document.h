@@ -0,0 +1,64 @@
+#ifndef RGBASM_TOOLS_LSP_DOCUMENT_H_
+#define RGBASM_TOOLS_LSP_DOCUMENT_H_
+
+#include "symbols.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// An open document of the language server: its text, the syntax tree that
+// is reparsed incrementally after edits, and the symbols of that tree.
+//
+// Edits are applied to the text and the old tree right away; the reparse is
+// deferred to whoever needs the tree next (rgbasm_document_sync), so a burst
+// of changes costs one parse.
+
+typedef struct RgbasmDocument {
+  char *uri;
+  char *path; // NULL unless a file: URI
+  int version;
+  unsigned refs;        // the server's and those of queued tasks
+  pthread_mutex_t lock; // guards everything below
+  char *text;
+  uint32_t length;
+  uint32_t capacity;
+  uint32_t *lines; // byte offset of every line start
+  uint32_t line_count;
+  uint32_t line_capacity;
+  TSTree *tree;
+  bool dirty; // `tree` is edited but not reparsed
+  RgbasmFileSymbols symbols;
+  // the semantic tokens last sent, for deltas
+  uint32_t *tokens;
+  uint32_t token_count;
+  unsigned token_result;
+} RgbasmDocument;
+
+// The path of a file: URI, percent-decoded, or NULL for other schemes.
+char *rgbasm_uri_path(const char *uri);
+
+RgbasmDocument *rgbasm_document_new(const char *uri, const char *text,
+                                    uint32_t length, int version);
+void rgbasm_document_delete(RgbasmDocument *self);
+
+// Character positions are counted in UTF-16 code units or, with `utf8`, in
+// bytes, as negotiated with the client.
+
+// The byte offset of a position, clamped to the line and the document.
+uint32_t rgbasm_document_offset(const RgbasmDocument *self, uint32_t line,
+                                uint32_t character, bool utf8);
+// The character of byte `column` in line `line`.
+uint32_t rgbasm_document_character(const RgbasmDocument *self, uint32_t line,
+                                   uint32_t column, bool utf8);
+
+// Replaces the bytes from `start` to `end` by `text` and edits the tree.
+void rgbasm_document_replace(RgbasmDocument *self, uint32_t start,
+                             uint32_t end, const char *text, uint32_t length);
+
+// Reparses with `parser` if the document was edited and extracts its
+// symbols again. Call with the lock held.
+void rgbasm_document_sync(RgbasmDocument *self, TSParser *parser);
+
+#endif // RGBASM_TOOLS_LSP_DOCUMENT_H_
@@ -0,0 +1,581 @@
+// Lists instructions with a cheaper equivalent, like `xor a` for `ld a, 0`,
+// with the bytes and cycles the rewrite saves.
+//
+// The rules are the patterns of queries/peephole.scm, shared with the
+// editor: a match captures the instructions it replaces as @rewrite, its
+// `#set!` directives name the rule, the replacement and the replacement's
+// SM83 form, and `#rgbds-keyword?` and `#rgbds-value?` check the text and the
+// value of captures. Files are matched in parallel; values are those of the
+// constants defined above the instruction, including INCLUDEd ones.
+
+#include "batch.h"
+#include "expr.h"
+#include "layout.h"
+#include "sm83.h"
+#include "util.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+#ifndef RGBASM_GRAMMAR_DIR
+#define RGBASM_GRAMMAR_DIR "."
+#endif
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-q query] [-r rule]... "
+          "path...\n"
+          "\n"
+          "Prints `file:line rule bytes cycles replacement note` for every\n"
+          "match of a rule, with the bytes and M-cycles it saves, and a\n"
+          "`total` line. Instructions in IF branches that are not assembled\n"
+          "and in macro definitions are skipped.\n"
+          "\n"
+          "  -I dir    resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -q query  the rules, default %s/queries/peephole.scm\n"
+          "  -r rule   only report this rule\n",
+          argv0, RGBASM_GRAMMAR_DIR);
+}
+
+typedef enum CheckKind {
+  CHECK_KEYWORD,
+  CHECK_VALUE,
+} CheckKind;
+
+typedef struct Check {
+  CheckKind kind;
+  uint32_t capture;
+  Span *words; // for CHECK_KEYWORD, written lowercase
+  uint32_t word_count;
+  int32_t min; // for CHECK_VALUE
+  int32_t max;
+} Check;
+
+// The pattern of a rule.
+typedef struct Rule {
+  Span name;
+  Span replace;
+  const RgbasmSm83Form *form;
+  Span note;
+  Check *checks;
+  uint32_t check_count;
+  bool enabled;
+} Rule;
+
+typedef struct Rules {
+  TSQuery *query;
+  Rule *rules; // per pattern
+  uint32_t count;
+  uint32_t rewrite; // the capture id of @rewrite
+} Rules;
+
+static Span string_value(const TSQuery *query,
+                         const TSQueryPredicateStep *step) {
+  Span span;
+  span.data = ts_query_string_value_for_id(query, step->value_id, &span.length);
+  return span;
+}
+
+static bool span_is(Span span, const char *string) {
+  return span.length == strlen(string) &&
+         memcmp(span.data, string, span.length) == 0;
+}
+
+// Compiles the predicate in `steps[0..count)`, the operator first.
+static const char *compile(const TSQuery *query,
+                           const TSQueryPredicateStep *steps, uint32_t count,
+                           Rule *rule) {
+  const Span name = string_value(query, &steps[0]);
+  if (span_is(name, "set!")) {
+    if (count != 3 || steps[1].type != TSQueryPredicateStepTypeString ||
+        steps[2].type != TSQueryPredicateStepTypeString) {
+      return "#set! takes a key and a value";
+    }
+    const Span key = string_value(query, &steps[1]);
+    const Span value = string_value(query, &steps[2]);
+    if (span_is(key, "rule")) {
+      rule->name = value;
+    } else if (span_is(key, "replace")) {
+      rule->replace = value;
+    } else if (span_is(key, "note")) {
+      rule->note = value;
+    } else if (span_is(key, "form")) {
+      rule->form = rgbasm_sm83_form(value.data);
+      if (rule->form == NULL) {
+        return "#set! form is not an SM83 form";
+      }
+    }
+    return NULL;
+  }
+  const bool keyword = span_is(name, "rgbds-keyword?");
+  if (!keyword && !span_is(name, "rgbds-value?")) {
+    return "unknown predicate";
+  }
+  if (count < 3 || steps[1].type != TSQueryPredicateStepTypeCapture) {
+    return "predicate needs a capture and a value";
+  }
+  Check check = {.kind = keyword ? CHECK_KEYWORD : CHECK_VALUE,
+                 .capture = steps[1].value_id};
+  if (keyword) {
+    check.word_count = count - 2;
+    check.words = malloc(check.word_count * sizeof(Span));
+    for (uint32_t i = 2; i < count; i++) {
+      check.words[i - 2] = string_value(query, &steps[i]);
+    }
+  } else {
+    const Span min = count == 4 ? string_value(query, &steps[2]) : (Span){0};
+    const Span max = count == 4 ? string_value(query, &steps[3]) : (Span){0};
+    if (count != 4 || !rgbasm_expr_number(min.data, min.length, &check.min) ||
+        !rgbasm_expr_number(max.data, max.length, &check.max)) {
+      return "#rgbds-value? takes a capture, a minimum and a maximum";
+    }
+  }
+  rule->checks =
+      realloc(rule->checks, (rule->check_count + 1) * sizeof(Check));
+  rule->checks[rule->check_count++] = check;
+  return NULL;
+}
+
+// Returns why `replace` is not valid, NULL if every `{name}` in it names a
+// capture of the query.
+static const char *check_replace(const TSQuery *query, Span replace) {
+  for (uint32_t i = 0; i < replace.length; i++) {
+    const char *close = memchr(&replace.data[i], '}', replace.length - i);
+    if (replace.data[i] != '{' || close == NULL) {
+      continue;
+    }
+    const uint32_t name_length = (uint32_t)(close - &replace.data[i] - 1);
+    bool found = false;
+    for (uint32_t j = 0; j < ts_query_capture_count(query) && !found; j++) {
+      uint32_t length;
+      const char *name = ts_query_capture_name_for_id(query, j, &length);
+      found = length == name_length &&
+              memcmp(name, &replace.data[i + 1], name_length) == 0;
+    }
+    if (!found) {
+      return "#set! replace names a capture the query does not have";
+    }
+    i += name_length + 1;
+  }
+  return NULL;
+}
+
+static void rules_free(Rules *self) {
+  for (uint32_t i = 0; i < self->count; i++) {
+    for (uint32_t j = 0; j < self->rules[i].check_count; j++) {
+      free(self->rules[i].checks[j].words);
+    }
+    free(self->rules[i].checks);
+  }
+  free(self->rules);
+  if (self->query != NULL) {
+    ts_query_delete(self->query);
+  }
+}
+
+// Returns false and prints why if `path` does not hold valid rules.
+static bool rules_load(Rules *self, const char *path, const char **only,
+                       size_t only_count) {
+  *self = (Rules){0};
+  Source source;
+  if (!source_read(path, &source)) {
+    fprintf(stderr, "%s: could not read file\n", path);
+    return false;
+  }
+  uint32_t error_offset;
+  TSQueryError error_type;
+  self->query = ts_query_new(tree_sitter_rgbasm(), source.data, source.length,
+                             &error_offset, &error_type);
+  if (self->query == NULL) {
+    uint32_t line = 1;
+    for (uint32_t i = 0; i < error_offset; i++) {
+      line += source.data[i] == '\n';
+    }
+    fprintf(stderr, "%s:%u: invalid query (error %d)\n", path, line,
+            (int)error_type);
+    source_free(&source);
+    return false;
+  }
+  source_free(&source);
+
+  self->rewrite = UINT32_MAX;
+  for (uint32_t i = 0; i < ts_query_capture_count(self->query); i++) {
+    uint32_t length;
+    const char *name = ts_query_capture_name_for_id(self->query, i, &length);
+    if (length == 7 && memcmp(name, "rewrite", 7) == 0) {
+      self->rewrite = i;
+    }
+  }
+  self->count = ts_query_pattern_count(self->query);
+  self->rules = calloc(self->count + 1, sizeof(Rule));
+  for (uint32_t i = 0; i < self->count; i++) {
+    Rule *rule = &self->rules[i];
+    uint32_t step_count;
+    const TSQueryPredicateStep *steps =
+        ts_query_predicates_for_pattern(self->query, i, &step_count);
+    uint32_t start = 0;
+    const char *error = NULL;
+    for (uint32_t j = 0; j < step_count && error == NULL; j++) {
+      if (steps[j].type == TSQueryPredicateStepTypeDone) {
+        error = compile(self->query, &steps[start], j - start, rule);
+        start = j + 1;
+      }
+    }
+    if (error == NULL && (rule->name.data == NULL ||
+                          rule->replace.data == NULL || rule->form == NULL)) {
+      error = "a rule needs #set! rule, replace and form";
+    }
+    if (error == NULL) {
+      error = check_replace(self->query, rule->replace);
+    }
+    if (error == NULL && self->rewrite == UINT32_MAX) {
+      error = "no @rewrite capture";
+    }
+    if (error != NULL) {
+      const uint32_t offset = ts_query_start_byte_for_pattern(self->query, i);
+      fprintf(stderr, "%s: pattern at byte %u: %s\n", path, offset, error);
+      return false;
+    }
+    rule->enabled = only_count == 0;
+    for (size_t j = 0; j < only_count; j++) {
+      rule->enabled |= span_is(rule->name, only[j]);
+    }
+  }
+  return true;
+}
+
+static bool keyword_matches(const Check *check, const char *source,
+                            TSNode node) {
+  const uint32_t start = ts_node_start_byte(node);
+  const uint32_t length = ts_node_end_byte(node) - start;
+  for (uint32_t i = 0; i < check->word_count; i++) {
+    const Span word = check->words[i];
+    if (word.length != length) {
+      continue;
+    }
+    uint32_t k = 0;
+    while (k < length &&
+           tolower((unsigned char)source[start + k]) == word.data[k]) {
+      k++;
+    }
+    if (k == length) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// A match of a rule whose keywords fit, waiting for the constants of its
+// first instruction to check its values.
+typedef struct Candidate {
+  uint32_t pattern;
+  TSQueryCapture *captures;
+  uint16_t capture_count;
+  TSNode first; // the first and last @rewrite
+  TSNode last;
+  uint32_t bytes; // of the instructions replaced
+  uint32_t cycles;
+} Candidate;
+
+typedef struct Finding {
+  uint32_t pattern;
+  TSPoint point;
+  char *replacement;
+  int32_t bytes; // saved
+  int32_t cycles;
+} Finding;
+
+typedef struct FileFindings {
+  Finding *items;
+  size_t count;
+} FileFindings;
+
+typedef struct PeepholeTask {
+  const char *const *paths;
+  const Rules *rules;
+  RgbasmLayoutOptions options;
+  FileFindings *findings; // per path
+} PeepholeTask;
+
+// The state of one file while it is laid out.
+typedef struct Visit {
+  const Rules *rules;
+  const char *source;
+  Candidate *candidates; // by the start of `first`
+  size_t count;
+  size_t next;
+  FileFindings *out;
+} Visit;
+
+static int compare_candidates(const void *a, const void *b) {
+  const uint32_t left = ts_node_start_byte(((const Candidate *)a)->first);
+  const uint32_t right = ts_node_start_byte(((const Candidate *)b)->first);
+  return (left > right) - (left < right);
+}
+
+static bool lookup(const char *name, size_t length, int32_t *value,
+                   void *context) {
+  return rgbasm_constants_get(context, name, length, value);
+}
+
+// The replacement text, `{name}` replaced by the text of the capture @name,
+// which rules_load() checked the query has.
+static char *expand(const Rules *rules, const Candidate *candidate,
+                    const char *source) {
+  const Span replace = rules->rules[candidate->pattern].replace;
+  size_t capacity = replace.length + 1;
+  size_t length = 0;
+  char *out = malloc(capacity);
+  for (uint32_t i = 0; i < replace.length; i++) {
+    const char *text = &replace.data[i];
+    size_t text_length = 1;
+    const char *close = memchr(text, '}', replace.length - i);
+    if (*text == '{' && close != NULL) {
+      const uint32_t name_length = (uint32_t)(close - text - 1);
+      text_length = name_length + 2; // kept if the match lacks the capture
+      for (uint16_t j = 0; j < candidate->capture_count; j++) {
+        uint32_t capture_length;
+        const char *capture = ts_query_capture_name_for_id(
+            rules->query, candidate->captures[j].index, &capture_length);
+        if (capture_length == name_length &&
+            memcmp(capture, text + 1, name_length) == 0) {
+          const TSNode node = candidate->captures[j].node;
+          text = source + ts_node_start_byte(node);
+          text_length = ts_node_end_byte(node) - ts_node_start_byte(node);
+          break;
+        }
+      }
+      i += name_length + 1;
+    }
+    if (length + text_length + 1 > capacity) {
+      capacity = (length + text_length + 1) * 2;
+      out = realloc(out, capacity);
+    }
+    memcpy(out + length, text, text_length);
+    length += text_length;
+  }
+  out[length] = '\0';
+  return out;
+}
+
+static void check_values(Visit *visit, const Candidate *candidate,
+                         const RgbasmConstants *constants) {
+  const Rule *rule = &visit->rules->rules[candidate->pattern];
+  const RgbasmExprContext context = {
+      .source = visit->source,
+      .lookup = lookup,
+      .lookup_context = (void *)constants,
+  };
+  for (uint32_t i = 0; i < rule->check_count; i++) {
+    const Check *check = &rule->checks[i];
+    if (check->kind != CHECK_VALUE) {
+      continue;
+    }
+    for (uint16_t j = 0; j < candidate->capture_count; j++) {
+      int32_t value;
+      if (candidate->captures[j].index == check->capture &&
+          (!rgbasm_expr_eval(&context, candidate->captures[j].node,
+                             &value) ||
+           value < check->min || value > check->max)) {
+        return;
+      }
+    }
+  }
+  FileFindings *out = visit->out;
+  out->items = realloc(out->items, (out->count + 1) * sizeof(Finding));
+  out->items[out->count++] = (Finding){
+      .pattern = candidate->pattern,
+      .point = ts_node_start_point(candidate->first),
+      .replacement = expand(visit->rules, candidate, visit->source),
+      .bytes = (int32_t)candidate->bytes - rule->form->bytes,
+      .cycles = (int32_t)candidate->cycles - rule->form->cycles,
+  };
+}
+
+static void on_instruction(const RgbasmLayoutItem *item, void *context) {
+  Visit *visit = context;
+  const uint32_t start = ts_node_start_byte(item->node);
+  while (visit->next < visit->count &&
+         ts_node_start_byte(visit->candidates[visit->next].first) < start) {
+    // not assembled, e.g. in an IF branch that is skipped
+    visit->next++;
+  }
+  while (visit->next < visit->count &&
+         ts_node_start_byte(visit->candidates[visit->next].first) == start) {
+    check_values(visit, &visit->candidates[visit->next++], item->constants);
+  }
+}
+
+// Adds the match as a candidate if its keywords fit.
+static void consider(Visit *visit, const TSQueryMatch *match) {
+  const Rules *rules = visit->rules;
+  const Rule *rule = &rules->rules[match->pattern_index];
+  if (!rule->enabled) {
+    return;
+  }
+  for (uint32_t i = 0; i < rule->check_count; i++) {
+    const Check *check = &rule->checks[i];
+    for (uint16_t j = 0; j < match->capture_count; j++) {
+      if (check->kind == CHECK_KEYWORD &&
+          match->captures[j].index == check->capture &&
+          !keyword_matches(check, visit->source, match->captures[j].node)) {
+        return;
+      }
+    }
+  }
+  Candidate candidate = {.pattern = match->pattern_index};
+  bool found = false;
+  for (uint16_t j = 0; j < match->capture_count; j++) {
+    if (match->captures[j].index != rules->rewrite) {
+      continue;
+    }
+    const TSNode node = match->captures[j].node;
+    const RgbasmSm83Form *form = rgbasm_sm83_lookup(node, visit->source);
+    if (form == NULL) {
+      return;
+    }
+    candidate.bytes += form->bytes;
+    candidate.cycles += form->cycles;
+    if (!found || ts_node_start_byte(node) <
+                      ts_node_start_byte(candidate.first)) {
+      candidate.first = node;
+    }
+    if (!found ||
+        ts_node_end_byte(node) > ts_node_end_byte(candidate.last)) {
+      candidate.last = node;
+    }
+    found = true;
+  }
+  if (!found) {
+    return;
+  }
+  candidate.capture_count = match->capture_count;
+  candidate.captures = malloc(match->capture_count * sizeof(TSQueryCapture));
+  memcpy(candidate.captures, match->captures,
+         match->capture_count * sizeof(TSQueryCapture));
+  visit->candidates = realloc(visit->candidates,
+                              (visit->count + 1) * sizeof(Candidate));
+  visit->candidates[visit->count++] = candidate;
+}
+
+static void match_file(TSParser *parser, size_t index, const Source *source,
+                       TSTree *tree, void *context) {
+  PeepholeTask *task = context;
+  Visit visit = {
+      .rules = task->rules,
+      .source = source->data,
+      .out = &task->findings[index],
+  };
+  const TSNode root = ts_tree_root_node(tree);
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  ts_query_cursor_exec(cursor, task->rules->query, root);
+  TSQueryMatch match;
+  while (ts_query_cursor_next_match(cursor, &match)) {
+    consider(&visit, &match);
+  }
+  ts_query_cursor_delete(cursor);
+  if (visit.count == 0) {
+    return;
+  }
+  qsort(visit.candidates, visit.count, sizeof(Candidate), compare_candidates);
+
+  RgbasmLayoutOptions options = task->options;
+  options.on_instruction = on_instruction;
+  options.context = &visit;
+  RgbasmConstants constants;
+  rgbasm_constants_init(&constants);
+  RgbasmFileLayout layout = {0};
+  rgbasm_layout_file(parser, task->paths[index], source->data, root, &options,
+                     &constants, &layout);
+  rgbasm_file_layout_free(&layout);
+  rgbasm_constants_free(&constants);
+  for (size_t i = 0; i < visit.count; i++) {
+    free(visit.candidates[i].captures);
+  }
+  free(visit.candidates);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  const char *query_path = RGBASM_GRAMMAR_DIR "/queries/peephole.scm";
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  const char **only = calloc((size_t)argc, sizeof(char *));
+  size_t only_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+      query_path = argv[++i];
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      only[only_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+  Rules rules;
+  if (!rules_load(&rules, query_path, only, only_count)) {
+    rules_free(&rules);
+    return 2;
+  }
+
+  PeepholeTask task = {
+      .paths = (const char *const *)paths.items,
+      .rules = &rules,
+      .options = {.include_dirs = include_dirs,
+                  .include_dir_count = include_dir_count},
+      .findings = calloc(paths.count, sizeof(FileFindings)),
+  };
+  const bool ok = rgbasm_batch_parse(task.paths, paths.count, threads,
+                                     match_file, &task);
+
+  size_t total = 0;
+  int64_t bytes = 0;
+  int64_t cycles = 0;
+  for (size_t i = 0; i < paths.count; i++) {
+    const FileFindings *findings = &task.findings[i];
+    for (size_t j = 0; j < findings->count; j++) {
+      const Finding *finding = &findings->items[j];
+      const Rule *rule = &rules.rules[finding->pattern];
+      printf("%s:%u\t%.*s\t%d\t%d\t%s", task.paths[i], finding->point.row + 1,
+             (int)rule->name.length, rule->name.data, finding->bytes,
+             finding->cycles, finding->replacement);
+      if (rule->note.data != NULL) {
+        printf("\t%.*s", (int)rule->note.length, rule->note.data);
+      }
+      printf("\n");
+      total++;
+      bytes += finding->bytes;
+      cycles += finding->cycles;
+      free(finding->replacement);
+    }
+    free(findings->items);
+  }
+  printf("total\t%zu\t%lld\t%lld\n", total, (long long)bytes,
+         (long long)cycles);
+
+  free(task.findings);
+  rules_free(&rules);
+  path_list_free(&paths);
+  free(include_dirs);
+  free(only);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// A growable ring buffer. The owner works at the bottom, thieves at the top.
+typedef struct Deque {
+  pthread_mutex_t lock;
+  void **items;
+  size_t capacity;
+  size_t top;
+  size_t count;
+} Deque;
+
+typedef struct Worker {
+  pthread_t thread;
+  Deque deque;
+  RgbasmPool *pool;
+  unsigned index;
+  bool started;
+} Worker;
+
+struct RgbasmPool {
+  RgbasmPoolRun run;
+  void *context;
+  Worker *workers;
+  unsigned count;
+  atomic_uint next_worker;
+  atomic_size_t queued;  // tasks in deques
+  atomic_size_t pending; // tasks submitted and not yet finished
+  pthread_mutex_t lock;
+  pthread_cond_t work_available;
+  pthread_cond_t done;
+  bool stopping;
+};
+
+// `queued` changes under the deque lock together with the deque, so idle
+// workers never spin on tasks that are not pushed yet.
+static void deque_push(Deque *deque, void *task, atomic_size_t *queued) {
+  pthread_mutex_lock(&deque->lock);
+  if (deque->count == deque->capacity) {
+    const size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+    void **items = malloc(capacity * sizeof(void *));
+    for (size_t i = 0; i < deque->count; i++) {
+      items[i] = deque->items[(deque->top + i) % deque->capacity];
+    }
+    free(deque->items);
+    deque->items = items;
+    deque->capacity = capacity;
+    deque->top = 0;
+  }
+  deque->items[(deque->top + deque->count) % deque->capacity] = task;
+  deque->count += 1;
+  atomic_fetch_add(queued, 1);
+  pthread_mutex_unlock(&deque->lock);
+}
+
+static void *deque_pop(Deque *deque, atomic_size_t *queued) {
+  void *task = NULL;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->count > 0) {
+    deque->count -= 1;
+    task = deque->items[(deque->top + deque->count) % deque->capacity];
+    atomic_fetch_sub(queued, 1);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return task;
+}
+
+static void *deque_steal(Deque *deque, atomic_size_t *queued) {
+  void *task = NULL;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->count > 0) {
+    task = deque->items[deque->top];
+    deque->top = (deque->top + 1) % deque->capacity;
+    deque->count -= 1;
+    atomic_fetch_sub(queued, 1);
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return task;
+}
+
+static void *next_task(RgbasmPool *pool, unsigned index) {
+  void *task = deque_pop(&pool->workers[index].deque, &pool->queued);
+  for (unsigned i = 1; task == NULL && i < pool->count; i++) {
+    task = deque_steal(&pool->workers[(index + i) % pool->count].deque,
+                       &pool->queued);
+  }
+  return task;
+}
+
+static void *worker_main(void *payload) {
+  Worker *worker = payload;
+  RgbasmPool *pool = worker->pool;
+  for (;;) {
+    void *task = next_task(pool, worker->index);
+    if (task != NULL) {
+      pool->run(pool, worker->index, task, pool->context);
+      if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+      }
+      continue;
+    }
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->stopping && atomic_load(&pool->queued) == 0) {
+      pthread_cond_wait(&pool->work_available, &pool->lock);
+    }
+    const bool stop = pool->stopping && atomic_load(&pool->queued) == 0;
+    pthread_mutex_unlock(&pool->lock);
+    if (stop) {
+      return NULL;
+    }
+  }
+}
+
+RgbasmPool *rgbasm_pool_new(unsigned threads, RgbasmPoolRun run,
+                            void *context) {
+  RgbasmPool *self = calloc(1, sizeof(RgbasmPool));
+  self->run = run;
+  self->context = context;
+  self->count = threads ? threads : 1;
+  self->workers = calloc(self->count, sizeof(Worker));
+  atomic_init(&self->next_worker, 0);
+  atomic_init(&self->queued, 0);
+  atomic_init(&self->pending, 0);
+  pthread_mutex_init(&self->lock, NULL);
+  pthread_cond_init(&self->work_available, NULL);
+  pthread_cond_init(&self->done, NULL);
+  for (unsigned i = 0; i < self->count; i++) {
+    Worker *worker = &self->workers[i];
+    pthread_mutex_init(&worker->deque.lock, NULL);
+    worker->pool = self;
+    worker->index = i;
+  }
+  for (unsigned i = 0; i < self->count; i++) {
+    Worker *worker = &self->workers[i];
+    worker->started =
+        pthread_create(&worker->thread, NULL, worker_main, worker) == 0;
+  }
+  // tasks can run on any started worker, but there has to be one
+  if (!self->workers[0].started) {
+    rgbasm_pool_delete(self);
+    return NULL;
+  }
+  return self;
+}
+
+void rgbasm_pool_delete(RgbasmPool *self) {
+  pthread_mutex_lock(&self->lock);
+  self->stopping = true;
+  pthread_cond_broadcast(&self->work_available);
+  pthread_mutex_unlock(&self->lock);
+  for (unsigned i = 0; i < self->count; i++) {
+    if (self->workers[i].started) {
+      pthread_join(self->workers[i].thread, NULL);
+    }
+  }
+  for (unsigned i = 0; i < self->count; i++) {
+    Worker *worker = &self->workers[i];
+    pthread_mutex_destroy(&worker->deque.lock);
+    free(worker->deque.items);
+  }
+  pthread_cond_destroy(&self->done);
+  pthread_cond_destroy(&self->work_available);
+  pthread_mutex_destroy(&self->lock);
+  free(self->workers);
+  free(self);
+}
+
+unsigned rgbasm_pool_thread_count(const RgbasmPool *self) {
+  return self->count;
+}
+
+void rgbasm_pool_submit(RgbasmPool *self, unsigned worker, void *task) {
+  if (worker >= self->count || !self->workers[worker].started) {
+    worker = atomic_fetch_add(&self->next_worker, 1) % self->count;
+    while (!self->workers[worker].started) {
+      worker = (worker + 1) % self->count;
+    }
+  }
+  atomic_fetch_add(&self->pending, 1);
+  deque_push(&self->workers[worker].deque, task, &self->queued);
+  pthread_mutex_lock(&self->lock);
+  pthread_cond_signal(&self->work_available);
+  pthread_mutex_unlock(&self->lock);
+}
+
+void rgbasm_pool_wait(RgbasmPool *self) {
+  pthread_mutex_lock(&self->lock);
+  while (atomic_load(&self->pending) > 0) {
+    pthread_cond_wait(&self->done, &self->lock);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+unsigned rgbasm_pool_default_threads(void) {
+  const long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (unsigned)count : 1;
+}
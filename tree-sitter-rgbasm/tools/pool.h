@@ -0,0 +1,42 @@
+#ifndef RGBASM_TOOLS_POOL_H_
+#define RGBASM_TOOLS_POOL_H_
+
+#include <stddef.h>
+
+// A work-stealing thread pool.
+//
+// Every worker owns a deque. Tasks submitted by a running task go to the
+// worker's own deque and are popped LIFO, which keeps e.g. an included file
+// on the core that found it; idle workers steal the oldest task of another
+// worker. The pool lives until it is deleted, so it can serve a sequence of
+// batches.
+
+typedef struct RgbasmPool RgbasmPool;
+
+// Runs `task` on worker `worker` (0 <= worker < thread count).
+typedef void (*RgbasmPoolRun)(RgbasmPool *pool, unsigned worker, void *task,
+                              void *context);
+
+#define RGBASM_POOL_ANY_WORKER ((unsigned)-1)
+
+// Returns NULL if no thread could be started.
+RgbasmPool *rgbasm_pool_new(unsigned threads, RgbasmPoolRun run,
+                            void *context);
+
+// Stops the workers after the submitted tasks are done.
+void rgbasm_pool_delete(RgbasmPool *self);
+
+unsigned rgbasm_pool_thread_count(const RgbasmPool *self);
+
+// Queues a non-NULL task on `worker`'s deque, RGBASM_POOL_ANY_WORKER picks one round
+// robin. Safe to call from any thread, including from running tasks.
+void rgbasm_pool_submit(RgbasmPool *self, unsigned worker, void *task);
+
+// Blocks until all submitted tasks, including the ones they submitted, are
+// done.
+void rgbasm_pool_wait(RgbasmPool *self);
+
+// The number of online processors, at least 1.
+unsigned rgbasm_pool_default_threads(void);
+
+#endif // RGBASM_TOOLS_POOL_H_
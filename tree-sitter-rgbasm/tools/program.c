@@ -0,0 +1,532 @@
+#include "program.h"
+
+#include "batch.h"
+#include "expr.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct RgbasmProgramAddress {
+  int32_t address;
+  int32_t instruction;
+} RgbasmProgramAddress;
+
+// What a file contributes, with indices local to the file.
+typedef struct FileProgram {
+  RgbasmFileLayout layout;
+  RgbasmInstruction *instructions;
+  size_t instruction_count;
+  size_t instruction_capacity;
+  RgbasmProgramLabel *labels;
+  size_t label_count;
+  size_t label_capacity;
+} FileProgram;
+
+typedef struct Collect {
+  FileProgram *out;
+  uint32_t file;
+  const char *source;
+  char *scope;    // the global label local ones belong to
+  int32_t label;  // the innermost label so far, -1 before the first
+  size_t pending; // labels from here on wait for their instruction
+  int32_t *last;  // per section, its last instruction so far
+  size_t last_count;
+} Collect;
+
+typedef struct BuildTask {
+  const char *const *paths;
+  const RgbasmLayoutOptions *options;
+  FileProgram *files;
+} BuildTask;
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+static TSNode field(TSNode node, const char *name) {
+  return ts_node_child_by_field_name(node, name, (uint32_t)strlen(name));
+}
+
+static char *copy_text(const char *source, TSNode node, const char *prefix) {
+  const uint32_t start = ts_node_start_byte(node);
+  const uint32_t length = ts_node_end_byte(node) - start;
+  const size_t prefix_length = prefix ? strlen(prefix) : 0;
+  char *out = malloc(prefix_length + length + 1);
+  memcpy(out, prefix ? prefix : "", prefix_length);
+  memcpy(out + prefix_length, source + start, length);
+  out[prefix_length + length] = '\0';
+  return out;
+}
+
+static bool lookup(const char *name, size_t length, int32_t *value,
+                   void *context) {
+  return rgbasm_constants_get(context, name, length, value);
+}
+
+static RgbasmFlow flow_of(const RgbasmSm83Form *form) {
+  if (form == NULL) {
+    return RGBASM_FLOW_NEXT;
+  }
+  static const struct {
+    const char *form;
+    RgbasmFlow flow;
+  } flows[] = {
+      {"jp n", RGBASM_FLOW_JUMP},
+      {"jr n", RGBASM_FLOW_JUMP},
+      {"jp cc,n", RGBASM_FLOW_BRANCH},
+      {"jr cc,n", RGBASM_FLOW_BRANCH},
+      {"call n", RGBASM_FLOW_CALL},
+      {"rst n", RGBASM_FLOW_CALL},
+      {"call cc,n", RGBASM_FLOW_CALL_COND},
+      {"ret", RGBASM_FLOW_RETURN},
+      {"reti", RGBASM_FLOW_RETURN},
+      {"ret cc", RGBASM_FLOW_RETURN_COND},
+      {"jp hl", RGBASM_FLOW_INDIRECT},
+  };
+  for (size_t i = 0; i < sizeof(flows) / sizeof(*flows); i++) {
+    if (strcmp(form->form, flows[i].form) == 0) {
+      return flows[i].flow;
+    }
+  }
+  return RGBASM_FLOW_NEXT;
+}
+
+static RgbasmInterrupts interrupts_of(const RgbasmSm83Form *form) {
+  if (strcmp(form->form, "di") == 0) {
+    return RGBASM_INTERRUPTS_DISABLE;
+  } else if (strcmp(form->form, "ei") == 0 ||
+             strcmp(form->form, "reti") == 0) {
+    return RGBASM_INTERRUPTS_ENABLE;
+  }
+  return RGBASM_INTERRUPTS_KEEP;
+}
+
+// The operands of an `instruction` node, at most `size`. Returns how many
+// there are.
+static uint32_t operands(TSNode instruction, TSNode *out, uint32_t size) {
+  const TSNode inner = ts_node_named_child(instruction, 0);
+  if (ts_node_is_null(inner)) {
+    return 0;
+  }
+  uint32_t found = 0;
+  const uint32_t count = ts_node_named_child_count(inner);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(inner, i);
+    if (is_type(child, "instruction_name")) {
+      continue;
+    }
+    const bool list = is_type(child, "operand_list");
+    const uint32_t listed = list ? ts_node_named_child_count(child) : 1;
+    for (uint32_t j = 0; j < listed; j++) {
+      if (found < size) {
+        out[found] = list ? ts_node_named_child(child, j) : child;
+      }
+      found++;
+    }
+  }
+  return found;
+}
+
+// The last operand of an `instruction` node, the target of jumps and calls.
+static TSNode last_operand(TSNode instruction) {
+  TSNode found[2];
+  const uint32_t count = operands(instruction, found, 2);
+  return count == 0 || count > 2 ? (TSNode){0} : found[count - 1];
+}
+
+static bool is_sp(const char *source, TSNode node) {
+  const uint32_t start = ts_node_start_byte(node);
+  return is_type(node, "register") && ts_node_end_byte(node) - start == 2 &&
+         tolower((unsigned char)source[start]) == 's' &&
+         tolower((unsigned char)source[start + 1]) == 'p';
+}
+
+static void stack_effect(Collect *collect, const RgbasmLayoutItem *item,
+                         RgbasmInstruction *instruction) {
+  const char *form = item->form->form;
+  if (strncmp(form, "push ", 5) == 0) {
+    instruction->stack_delta = 2;
+    return;
+  } else if (strncmp(form, "pop ", 4) == 0) {
+    instruction->stack_delta = -2;
+    return;
+  }
+  TSNode found[2];
+  const uint32_t count = operands(item->node, found, 2);
+  if (count == 0 || count > 2 || !is_sp(collect->source, found[0])) {
+    return;
+  }
+  if (strcmp(form, "inc rr") == 0) {
+    instruction->stack_delta = -1;
+  } else if (strcmp(form, "dec rr") == 0) {
+    instruction->stack_delta = 1;
+  } else if (strcmp(form, "ld rr,n") == 0) {
+    instruction->stack_set = true;
+  } else if (strcmp(form, "ld sp,hl") == 0) {
+    instruction->stack_unknown = true;
+  } else if (strcmp(form, "add sp,n") == 0) {
+    const RgbasmExprContext context = {
+        .source = collect->source,
+        .lookup = lookup,
+        .lookup_context = (void *)item->constants,
+    };
+    int32_t offset;
+    if (rgbasm_expr_eval(&context, found[1], &offset)) {
+      instruction->stack_delta = -offset;
+    } else {
+      instruction->stack_unknown = true;
+    }
+  }
+}
+
+static void target(Collect *collect, const RgbasmLayoutItem *item,
+                   RgbasmInstruction *instruction) {
+  const TSNode operand = last_operand(item->node);
+  if (ts_node_is_null(operand)) {
+    return;
+  }
+  const RgbasmExprContext context = {
+      .source = collect->source,
+      .lookup = lookup,
+      .lookup_context = (void *)item->constants,
+  };
+  if (rgbasm_expr_eval(&context, operand, &instruction->target_address)) {
+    instruction->has_target_address = true;
+  } else if (is_type(operand, "local_symbol")) {
+    instruction->target_name =
+        copy_text(collect->source, operand, collect->scope);
+  } else if (is_type(operand, "variable") ||
+             is_type(operand, "qualified_symbol")) {
+    instruction->target_name = copy_text(collect->source, operand, NULL);
+  }
+}
+
+// `; @loop N` in the comment after the instruction, N a number or constant.
+static void loop_bound(Collect *collect, const RgbasmLayoutItem *item,
+                       RgbasmInstruction *instruction) {
+  const TSNode list = ts_node_parent(item->node);
+  if (ts_node_is_null(list)) {
+    return;
+  }
+  const TSNode comment = ts_node_next_named_sibling(list);
+  if (ts_node_is_null(comment) || !is_type(comment, "inline_comment") ||
+      ts_node_start_point(comment).row != instruction->point.row) {
+    return;
+  }
+  const uint32_t start = ts_node_start_byte(comment);
+  const uint32_t end = ts_node_end_byte(comment);
+  const char *text = collect->source + start;
+  const char *found = NULL;
+  for (const char *at = text; at + 5 <= collect->source + end; at++) {
+    if (memcmp(at, "@loop", 5) == 0) {
+      found = at + 5;
+      break;
+    }
+  }
+  if (found == NULL) {
+    return;
+  }
+  const char *limit = collect->source + end;
+  while (found < limit && (*found == ' ' || *found == '\t')) {
+    found++;
+  }
+  size_t length = 0;
+  while (found + length < limit &&
+         (isalnum((unsigned char)found[length]) || found[length] == '_' ||
+          found[length] == '$' || found[length] == '%' ||
+          found[length] == '.')) {
+    length++;
+  }
+  int32_t value;
+  if (length > 0 && (rgbasm_expr_number(found, length, &value) ||
+                     rgbasm_constants_get(item->constants, found, length,
+                                          &value))) {
+    instruction->has_loop_bound = value >= 0;
+    instruction->loop_bound = value >= 0 ? (uint32_t)value : 0;
+  }
+}
+
+static void on_instruction(const RgbasmLayoutItem *item, void *context) {
+  Collect *collect = context;
+  FileProgram *out = collect->out;
+  if (out->instruction_count == out->instruction_capacity) {
+    out->instruction_capacity =
+        out->instruction_capacity ? out->instruction_capacity * 2 : 256;
+    out->instructions =
+        realloc(out->instructions,
+                out->instruction_capacity * sizeof(*out->instructions));
+  }
+  const int32_t index = (int32_t)out->instruction_count++;
+  RgbasmInstruction *instruction = &out->instructions[index];
+  *instruction = (RgbasmInstruction){
+      .file = collect->file,
+      .section = item->section,
+      .offset = item->offset,
+      .offset_exact = item->offset_exact,
+      .point = ts_node_start_point(item->node),
+      .start_byte = ts_node_start_byte(item->node),
+      .end_byte = ts_node_end_byte(item->node),
+      .form = item->form,
+      .repeat = item->repeat,
+      .repeat_exact = item->repeat_exact,
+      .flow = flow_of(item->form),
+      .target = -1,
+      .next = -1,
+      .label = -1,
+  };
+  if (instruction->flow != RGBASM_FLOW_NEXT &&
+      instruction->flow != RGBASM_FLOW_RETURN &&
+      instruction->flow != RGBASM_FLOW_RETURN_COND &&
+      instruction->flow != RGBASM_FLOW_INDIRECT) {
+    target(collect, item, instruction);
+  }
+  loop_bound(collect, item, instruction);
+  if (item->form != NULL) {
+    stack_effect(collect, item, instruction);
+    instruction->interrupts = interrupts_of(item->form);
+    instruction->halt = strcmp(item->form->form, "halt") == 0;
+  }
+
+  for (size_t i = collect->pending; i < out->label_count; i++) {
+    if (out->labels[i].section == item->section) {
+      out->labels[i].instruction = index;
+    }
+  }
+  collect->pending = out->label_count;
+  if (collect->label >= 0 &&
+      out->labels[collect->label].section == item->section) {
+    instruction->label = collect->label;
+  }
+
+  if (item->section < 0) {
+    return;
+  }
+  const size_t section = (size_t)item->section;
+  if (section >= collect->last_count) {
+    collect->last = realloc(collect->last, (section + 1) * sizeof(int32_t));
+    for (size_t i = collect->last_count; i <= section; i++) {
+      collect->last[i] = -1;
+    }
+    collect->last_count = section + 1;
+  }
+  if (collect->last[section] >= 0) {
+    out->instructions[collect->last[section]].next = index;
+  }
+  collect->last[section] = index;
+}
+
+static void on_label(const RgbasmLayoutItem *item, void *context) {
+  Collect *collect = context;
+  FileProgram *out = collect->out;
+  const TSNode name = field(item->node, "name");
+  if (ts_node_is_null(name)) {
+    return;
+  }
+  bool exported = false;
+  char *text;
+  if (is_type(item->node, "global_label_block")) {
+    text = copy_text(collect->source, name, NULL);
+    free(collect->scope);
+    collect->scope = copy_text(collect->source, name, NULL);
+    const TSNode colon = ts_node_next_sibling(name);
+    exported = !ts_node_is_null(colon) && is_type(colon, "::");
+  } else {
+    text = copy_text(collect->source, name,
+                     is_type(name, "local_symbol") ? collect->scope : NULL);
+  }
+  if (out->label_count == out->label_capacity) {
+    out->label_capacity = out->label_capacity ? out->label_capacity * 2 : 64;
+    out->labels =
+        realloc(out->labels, out->label_capacity * sizeof(*out->labels));
+  }
+  collect->label = (int32_t)out->label_count;
+  out->labels[out->label_count++] = (RgbasmProgramLabel){
+      .name = text,
+      .file = collect->file,
+      .section = item->section,
+      .offset = item->offset,
+      .offset_exact = item->offset_exact,
+      .repeat = item->repeat,
+      .repeat_exact = item->repeat_exact,
+      .point = ts_node_start_point(item->node),
+      .exported = exported,
+      .instruction = -1,
+  };
+}
+
+static void collect_file(TSParser *parser, size_t index, const Source *source,
+                         TSTree *tree, void *context) {
+  BuildTask *task = context;
+  Collect collect = {
+      .out = &task->files[index],
+      .file = (uint32_t)index,
+      .source = source->data,
+      .label = -1,
+  };
+  RgbasmLayoutOptions options = *task->options;
+  options.on_instruction = on_instruction;
+  options.on_label = on_label;
+  options.context = &collect;
+  RgbasmConstants constants;
+  rgbasm_constants_init(&constants);
+  rgbasm_layout_file(parser, task->paths[index], source->data,
+                     ts_tree_root_node(tree), &options, &constants,
+                     &collect.out->layout);
+  rgbasm_constants_free(&constants);
+  free(collect.scope);
+  free(collect.last);
+}
+
+static int compare_addresses(const void *a, const void *b) {
+  const int32_t left = ((const RgbasmProgramAddress *)a)->address;
+  const int32_t right = ((const RgbasmProgramAddress *)b)->address;
+  return (left > right) - (left < right);
+}
+
+// Joins the files, indices made global, and resolves the targets.
+static void join(RgbasmProgram *out, FileProgram *files) {
+  size_t instruction_count = 0;
+  for (size_t i = 0; i < out->file_count; i++) {
+    out->section_count += files[i].layout.count;
+    instruction_count += files[i].instruction_count;
+    out->label_count += files[i].label_count;
+  }
+  out->sections = calloc(out->section_count + 1, sizeof(*out->sections));
+  out->instructions = calloc(instruction_count + 1, sizeof(*out->instructions));
+  out->labels = calloc(out->label_count + 1, sizeof(*out->labels));
+  out->layouts = calloc(out->file_count + 1, sizeof(*out->layouts));
+
+  size_t section_base = 0;
+  size_t label_base = 0;
+  for (size_t i = 0; i < out->file_count; i++) {
+    FileProgram *file = &files[i];
+    const int32_t instruction_base = (int32_t)out->instruction_count;
+    out->layouts[i] = file->layout;
+    for (size_t j = 0; j < file->layout.count; j++) {
+      out->sections[section_base + j] = (RgbasmProgramSection){
+          .file = (uint32_t)i,
+          .size = &out->layouts[i].sections[j],
+          .first = -1,
+      };
+    }
+    for (size_t j = 0; j < file->instruction_count; j++) {
+      RgbasmInstruction instruction = file->instructions[j];
+      if (instruction.section >= 0) {
+        instruction.section += (int32_t)section_base;
+        RgbasmProgramSection *section = &out->sections[instruction.section];
+        if (section->first < 0) {
+          section->first = (int32_t)out->instruction_count;
+        }
+      }
+      if (instruction.next >= 0) {
+        instruction.next += instruction_base;
+      }
+      if (instruction.label >= 0) {
+        instruction.label += (int32_t)label_base;
+      }
+      out->instructions[out->instruction_count++] = instruction;
+    }
+    for (size_t j = 0; j < file->label_count; j++) {
+      RgbasmProgramLabel label = file->labels[j];
+      if (label.section >= 0) {
+        label.section += (int32_t)section_base;
+      }
+      if (label.instruction >= 0) {
+        label.instruction += instruction_base;
+      }
+      out->labels[label_base + j] = label;
+      rgbasm_constants_set(&out->label_index, label.name, strlen(label.name),
+                           (int32_t)(label_base + j));
+    }
+    section_base += file->layout.count;
+    label_base += file->label_count;
+    free(file->instructions);
+    free(file->labels);
+  }
+
+  // instructions at a fixed address outside of switchable banks
+  out->addresses =
+      calloc(out->instruction_count + 1, sizeof(*out->addresses));
+  for (size_t i = 0; i < out->instruction_count; i++) {
+    const RgbasmInstruction *instruction = &out->instructions[i];
+    if (instruction->section < 0 || !instruction->offset_exact) {
+      continue;
+    }
+    const RgbasmSectionSize *size = out->sections[instruction->section].size;
+    if (size->has_address && size->type[0] != '\0' &&
+        !rgbasm_section_type_banked(size->type)) {
+      out->addresses[out->address_count++] = (RgbasmProgramAddress){
+          .address = size->address + (int32_t)instruction->offset,
+          .instruction = (int32_t)i,
+      };
+    }
+  }
+  qsort(out->addresses, out->address_count, sizeof(*out->addresses),
+        compare_addresses);
+
+  for (size_t i = 0; i < out->instruction_count; i++) {
+    RgbasmInstruction *instruction = &out->instructions[i];
+    if (instruction->target_name != NULL) {
+      const int32_t label =
+          rgbasm_program_label(out, instruction->target_name);
+      instruction->target = label >= 0 ? out->labels[label].instruction : -1;
+    } else if (instruction->has_target_address) {
+      instruction->target =
+          rgbasm_program_at_address(out, instruction->target_address);
+    }
+  }
+}
+
+bool rgbasm_program_build(RgbasmProgram *out, const char *const *paths,
+                          size_t count, unsigned threads,
+                          const RgbasmLayoutOptions *options) {
+  *out = (RgbasmProgram){.paths = paths, .file_count = count};
+  rgbasm_constants_init(&out->label_index);
+  BuildTask task = {
+      .paths = paths,
+      .options = options,
+      .files = calloc(count + 1, sizeof(FileProgram)),
+  };
+  const bool ok =
+      rgbasm_batch_parse(paths, count, threads, collect_file, &task);
+  join(out, task.files);
+  free(task.files);
+  return ok;
+}
+
+void rgbasm_program_free(RgbasmProgram *self) {
+  for (size_t i = 0; i < self->file_count; i++) {
+    rgbasm_file_layout_free(&self->layouts[i]);
+  }
+  for (size_t i = 0; i < self->instruction_count; i++) {
+    free(self->instructions[i].target_name);
+  }
+  for (size_t i = 0; i < self->label_count; i++) {
+    free(self->labels[i].name);
+  }
+  free(self->layouts);
+  free(self->sections);
+  free(self->instructions);
+  free(self->labels);
+  free(self->addresses);
+  rgbasm_constants_free(&self->label_index);
+  *self = (RgbasmProgram){0};
+}
+
+int32_t rgbasm_program_label(const RgbasmProgram *self, const char *name) {
+  int32_t index;
+  return rgbasm_constants_get(&self->label_index, name, strlen(name), &index)
+             ? index
+             : -1;
+}
+
+int32_t rgbasm_program_at_address(const RgbasmProgram *self,
+                                  int32_t address) {
+  const RgbasmProgramAddress key = {.address = address};
+  const RgbasmProgramAddress *found =
+      bsearch(&key, self->addresses, self->address_count,
+              sizeof(*self->addresses), compare_addresses);
+  return found ? found->instruction : -1;
+}
@@ -0,0 +1,116 @@
+#ifndef RGBASM_TOOLS_PROGRAM_H_
+#define RGBASM_TOOLS_PROGRAM_H_
+
+#include "layout.h"
+#include "sm83.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// The instructions, labels and sections of a project with their control flow,
+// for the analyses of the command line tools.
+//
+// Files are laid out in parallel like rgbasm-size measures them, then the
+// jumps, calls and `rst`s are resolved across files: by label name, or by
+// address for targets in ROM0 sections with a fixed address. Macro
+// invocations are not expanded, so the instructions they assemble are
+// missing.
+
+typedef enum RgbasmFlow {
+  RGBASM_FLOW_NEXT,        // falls through
+  RGBASM_FLOW_JUMP,        // jp n, jr n
+  RGBASM_FLOW_BRANCH,      // jp cc,n, jr cc,n
+  RGBASM_FLOW_CALL,        // call n, rst n
+  RGBASM_FLOW_CALL_COND,   // call cc,n
+  RGBASM_FLOW_RETURN,      // ret, reti
+  RGBASM_FLOW_RETURN_COND, // ret cc
+  RGBASM_FLOW_INDIRECT,    // jp hl
+} RgbasmFlow;
+
+typedef enum RgbasmInterrupts {
+  RGBASM_INTERRUPTS_KEEP,
+  RGBASM_INTERRUPTS_DISABLE, // di
+  RGBASM_INTERRUPTS_ENABLE,  // ei, reti
+} RgbasmInterrupts;
+
+typedef struct RgbasmInstruction {
+  uint32_t file;
+  int32_t section; // into the program's sections, -1 outside
+  uint32_t offset; // bytes before it in the section
+  bool offset_exact;
+  TSPoint point;
+  uint32_t start_byte;
+  uint32_t end_byte;
+  const RgbasmSm83Form *form; // NULL if unknown
+  uint32_t repeat;            // times enclosing REPT and FOR blocks repeat it
+  bool repeat_exact;
+  RgbasmFlow flow;
+  char *target_name;       // of a jump or call by symbol, NULL otherwise
+  bool has_target_address; // of a jump or call by a constant value
+  int32_t target_address;
+  int32_t target; // the instruction jumped or called to, -1 if unresolved
+  int32_t next;   // the one after it in its section, -1 at the end
+  int32_t label;  // the innermost label it is under, -1 if none
+  // `; @loop N` on its line: the loop it jumps back to runs at most N times
+  bool has_loop_bound;
+  uint32_t loop_bound;
+  // bytes it pushes onto the stack, negative for pops, without calls and
+  // returns
+  int32_t stack_delta;
+  bool stack_set;     // ld sp, n starts a new stack
+  bool stack_unknown; // ld sp, hl or add sp, n with n unknown
+  RgbasmInterrupts interrupts;
+  bool halt;
+} RgbasmInstruction;
+
+typedef struct RgbasmProgramLabel {
+  char *name; // `Parent.local` for local labels
+  uint32_t file;
+  int32_t section;
+  uint32_t offset;
+  bool offset_exact;
+  uint32_t repeat; // times enclosing REPT and FOR blocks repeat it
+  bool repeat_exact;
+  TSPoint point;
+  bool exported;
+  int32_t instruction; // the first one after it in its section, -1 if none
+} RgbasmProgramLabel;
+
+typedef struct RgbasmProgramSection {
+  uint32_t file;
+  const RgbasmSectionSize *size;
+  int32_t first; // its first instruction, -1 if it has none
+} RgbasmProgramSection;
+
+typedef struct RgbasmProgram {
+  const char *const *paths;
+  size_t file_count;
+  RgbasmFileLayout *layouts; // per file
+  RgbasmProgramSection *sections;
+  size_t section_count;
+  RgbasmInstruction *instructions; // by file, in document order
+  size_t instruction_count;
+  RgbasmProgramLabel *labels;
+  size_t label_count;
+  RgbasmConstants label_index; // name -> index into labels
+  struct RgbasmProgramAddress *addresses; // fixed ones, sorted
+  size_t address_count;
+} RgbasmProgram;
+
+// Parses and lays out `paths` on `threads` workers, 0 for one per core.
+// Returns false if a file could not be read; `out` holds the others.
+bool rgbasm_program_build(RgbasmProgram *out, const char *const *paths,
+                          size_t count, unsigned threads,
+                          const RgbasmLayoutOptions *options);
+void rgbasm_program_free(RgbasmProgram *self);
+
+// The label `name`, -1 if there is none.
+int32_t rgbasm_program_label(const RgbasmProgram *self, const char *name);
+
+// The instruction assembled at `address` by a ROM0 section with a fixed
+// address, -1 if there is none.
+int32_t rgbasm_program_at_address(const RgbasmProgram *self, int32_t address);
+
+#endif // RGBASM_TOOLS_PROGRAM_H_
@@ -0,0 +1,357 @@
+// Per-pattern profiler for the tree-sitter queries.
+//
+// Runs each query over the syntax trees of the benchmark corpus (or the given
+// files and directories) and reports match counts and the time of every
+// pattern, measured with all other patterns disabled. Predicates and
+// `#set! priority` are evaluated like the editors do. Queries of the
+// rgbasm_identifier grammar run on the injected `identifier` nodes.
+
+#include "query_predicates.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/api.h>
+#include <tree_sitter/tree-sitter-rgbasm-identifier.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+#ifndef RGBASM_BENCH_CORPUS
+#define RGBASM_BENCH_CORPUS "bench/corpus"
+#endif
+
+#ifndef RGBASM_GRAMMAR_DIR
+#define RGBASM_GRAMMAR_DIR "."
+#endif
+
+typedef struct Input {
+  const char *data;
+  TSTree *tree;
+} Input;
+
+typedef struct InputList {
+  Input *items;
+  size_t count;
+} InputList;
+
+typedef struct QueryFile {
+  const char *path;
+  bool identifier;
+} QueryFile;
+
+typedef struct PatternStats {
+  uint32_t index;
+  uint32_t line;
+  uint64_t matches;
+  uint64_t rejected; // matches failing a predicate
+  double best;
+} PatternStats;
+
+typedef enum SortOrder { SORT_TIME, SORT_MATCHES, SORT_INDEX } SortOrder;
+
+static int priority_sink;
+
+static InputList parse_all(const TSLanguage *language, const Span *spans,
+                           size_t count) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+  InputList inputs = {calloc(count, sizeof(Input)), count};
+  for (size_t i = 0; i < count; i++) {
+    inputs.items[i].data = spans[i].data;
+    inputs.items[i].tree =
+        ts_parser_parse_string(parser, NULL, spans[i].data, spans[i].length);
+  }
+  ts_parser_delete(parser);
+  return inputs;
+}
+
+static void input_list_free(InputList *inputs) {
+  for (size_t i = 0; i < inputs->count; i++) {
+    ts_tree_delete(inputs->items[i].tree);
+  }
+  free(inputs->items);
+}
+
+// One pass of `query` over all inputs. Counts into `stats` if not NULL.
+static double run(const TSQuery *query, RgbasmQueryPredicates *predicates,
+                  TSQueryCursor *cursor, const InputList *inputs,
+                  PatternStats *stats) {
+  const double start = now_seconds();
+  for (size_t i = 0; i < inputs->count; i++) {
+    const Input *input = &inputs->items[i];
+    ts_query_cursor_exec(cursor, query, ts_tree_root_node(input->tree));
+    TSQueryMatch match;
+    while (ts_query_cursor_next_match(cursor, &match)) {
+      int priority;
+      const bool accepted = rgbasm_query_predicates_match(
+          predicates, &match, input->data, &priority);
+      priority_sink += priority;
+      if (stats != NULL) {
+        if (accepted) {
+          stats[match.pattern_index].matches += 1;
+        } else {
+          stats[match.pattern_index].rejected += 1;
+        }
+      }
+    }
+  }
+  return now_seconds() - start;
+}
+
+static double best_run(const TSQuery *query, RgbasmQueryPredicates *predicates,
+                       TSQueryCursor *cursor, const InputList *inputs,
+                       int iterations) {
+  double best = 0;
+  for (int i = 0; i < iterations; i++) {
+    const double elapsed = run(query, predicates, cursor, inputs, NULL);
+    if (i == 0 || elapsed < best) {
+      best = elapsed;
+    }
+  }
+  return best;
+}
+
+static SortOrder sort_order;
+
+static int compare_stats(const void *a, const void *b) {
+  const PatternStats *x = a;
+  const PatternStats *y = b;
+  switch (sort_order) {
+  case SORT_TIME:
+    if (x->best != y->best) {
+      return x->best < y->best ? 1 : -1;
+    }
+    break;
+  case SORT_MATCHES:
+    if (x->matches != y->matches) {
+      return x->matches < y->matches ? 1 : -1;
+    }
+    break;
+  case SORT_INDEX:
+    break;
+  }
+  return x->index < y->index ? -1 : x->index > y->index;
+}
+
+// The first line of the pattern's source, shortened to `width` columns.
+static void print_excerpt(const char *source, uint32_t start, uint32_t end,
+                          int width) {
+  while (start < end && (source[start] == ' ' || source[start] == '\n')) {
+    start++;
+  }
+  uint32_t stop = start;
+  while (stop < end && source[stop] != '\n') {
+    stop++;
+  }
+  if ((int)(stop - start) > width) {
+    printf("%.*s...", width - 3, source + start);
+  } else {
+    printf("%.*s", (int)(stop - start), source + start);
+  }
+}
+
+static bool profile(const QueryFile *file, const InputList *inputs,
+                    int iterations) {
+  Source source;
+  if (!source_read(file->path, &source)) {
+    fprintf(stderr, "%s: could not read file\n", file->path);
+    return false;
+  }
+  const TSLanguage *language = file->identifier
+                                   ? tree_sitter_rgbasm_identifier()
+                                   : tree_sitter_rgbasm();
+  uint32_t error_offset;
+  TSQueryError error_type;
+  TSQuery *query = ts_query_new(language, source.data, source.length,
+                                &error_offset, &error_type);
+  if (query == NULL) {
+    uint32_t line = 1;
+    for (uint32_t i = 0; i < error_offset; i++) {
+      line += source.data[i] == '\n';
+    }
+    fprintf(stderr, "%s:%u: invalid query (error %d)\n", file->path, line,
+            (int)error_type);
+    source_free(&source);
+    return false;
+  }
+  const char *message = NULL;
+  RgbasmQueryPredicates *predicates =
+      rgbasm_query_predicates_new(query, &message);
+  if (predicates == NULL) {
+    fprintf(stderr, "%s: %s\n", file->path, message);
+    ts_query_delete(query);
+    source_free(&source);
+    return false;
+  }
+  if (rgbasm_query_predicates_unsupported(predicates) != NULL) {
+    fprintf(stderr, "%s: #%s is not evaluated\n", file->path,
+            rgbasm_query_predicates_unsupported(predicates));
+  }
+
+  const uint32_t count = ts_query_pattern_count(query);
+  PatternStats *stats = calloc(count, sizeof(PatternStats));
+  TSQueryCursor *cursor = ts_query_cursor_new();
+  run(query, predicates, cursor, inputs, stats);
+  const double all = best_run(query, predicates, cursor, inputs, iterations);
+
+  double sum = 0;
+  uint32_t line = 1;
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const uint32_t start = ts_query_start_byte_for_pattern(query, i);
+    for (; offset < start; offset++) {
+      line += source.data[offset] == '\n';
+    }
+    stats[i].index = i;
+    stats[i].line = line;
+
+    // disabling is permanent, so every pattern gets its own copy
+    TSQuery *single = ts_query_new(language, source.data, source.length,
+                                   &error_offset, &error_type);
+    for (uint32_t j = 0; j < count; j++) {
+      if (j != i) {
+        ts_query_disable_pattern(single, j);
+      }
+    }
+    stats[i].best = best_run(single, predicates, cursor, inputs, iterations);
+    sum += stats[i].best;
+    ts_query_delete(single);
+  }
+
+  printf("%s: %u patterns on %zu %s, all patterns %.3f ms\n", file->path,
+         count, inputs->count, file->identifier ? "identifiers" : "files",
+         all * 1e3);
+  printf("%7s %5s %9s %6s %8s %8s  %s\n", "pattern", "line", "ms", "share",
+         "matches", "rejected", "source");
+  qsort(stats, count, sizeof(PatternStats), compare_stats);
+  uint32_t never = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const PatternStats *s = &stats[i];
+    printf("%7u %5u %9.3f %5.1f%% %8llu %8llu  ", s->index, s->line,
+           s->best * 1e3, sum > 0 ? s->best / sum * 100 : 0,
+           (unsigned long long)s->matches, (unsigned long long)s->rejected);
+    print_excerpt(source.data, ts_query_start_byte_for_pattern(query, s->index),
+                  ts_query_end_byte_for_pattern(query, s->index), 60);
+    printf("\n");
+    never += s->matches == 0;
+  }
+  if (never > 0) {
+    printf("%u of %u patterns never matched\n", never, count);
+  }
+  printf("\n");
+
+  ts_query_cursor_delete(cursor);
+  free(stats);
+  rgbasm_query_predicates_delete(predicates);
+  ts_query_delete(query);
+  source_free(&source);
+  return true;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-n iterations] [--sort time|matches|index]\n"
+          "       [--query file]... [--identifier-query file]... [path...]\n"
+          "\n"
+          "Profiles every pattern of the queries (default: the queries of\n"
+          "both grammars) on the given files and directories (default: %s).\n",
+          argv0, RGBASM_BENCH_CORPUS);
+}
+
+int main(int argc, char **argv) {
+  int iterations = 5;
+  PathList paths = {0};
+  QueryFile *queries = calloc((size_t)argc + 4, sizeof(QueryFile));
+  size_t query_count = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+      const char *order = argv[++i];
+      if (strcmp(order, "time") == 0) {
+        sort_order = SORT_TIME;
+      } else if (strcmp(order, "matches") == 0) {
+        sort_order = SORT_MATCHES;
+      } else if (strcmp(order, "index") == 0) {
+        sort_order = SORT_INDEX;
+      } else {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--query") == 0 && i + 1 < argc) {
+      queries[query_count++] = (QueryFile){argv[++i], false};
+    } else if (strcmp(argv[i], "--identifier-query") == 0 && i + 1 < argc) {
+      queries[query_count++] = (QueryFile){argv[++i], true};
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (query_count == 0) {
+    queries[query_count++] =
+        (QueryFile){RGBASM_GRAMMAR_DIR "/queries/highlights.scm", false};
+    queries[query_count++] =
+        (QueryFile){RGBASM_GRAMMAR_DIR "/queries/folds.scm", false};
+    queries[query_count++] =
+        (QueryFile){RGBASM_GRAMMAR_DIR "/queries/injections.scm", false};
+    queries[query_count++] = (QueryFile){
+        RGBASM_GRAMMAR_DIR "/identifier/queries/highlights.scm", true};
+  }
+  if (paths.count == 0) {
+    path_list_collect(&paths, RGBASM_BENCH_CORPUS);
+  }
+  if (paths.count == 0 || iterations < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Source *sources = calloc(paths.count, sizeof(Source));
+  SpanList files = {0};
+  for (size_t i = 0; i < paths.count; i++) {
+    if (source_read(paths.items[i], &sources[files.count])) {
+      span_list_push(&files, sources[files.count].data,
+                     sources[files.count].length);
+    } else {
+      fprintf(stderr, "%s: could not read file\n", paths.items[i]);
+    }
+  }
+
+  InputList trees = parse_all(tree_sitter_rgbasm(), files.items, files.count);
+  SpanList identifiers = {0};
+  for (size_t i = 0; i < trees.count; i++) {
+    span_list_collect_nodes(&identifiers, trees.items[i].data,
+                            ts_tree_root_node(trees.items[i].tree),
+                            "identifier");
+  }
+  // identifier trees are parsed from the span alone, so node offsets are
+  // relative to its start
+  InputList identifier_trees = parse_all(tree_sitter_rgbasm_identifier(),
+                                         identifiers.items, identifiers.count);
+
+  int status = 0;
+  for (size_t i = 0; i < query_count; i++) {
+    const InputList *inputs =
+        queries[i].identifier ? &identifier_trees : &trees;
+    if (!profile(&queries[i], inputs, iterations)) {
+      status = 1;
+    }
+  }
+
+  input_list_free(&identifier_trees);
+  input_list_free(&trees);
+  span_list_free(&identifiers);
+  for (size_t i = 0; i < files.count; i++) {
+    source_free(&sources[i]);
+  }
+  span_list_free(&files);
+  free(sources);
+  free(queries);
+  path_list_free(&paths);
+  return status;
+}
@@ -0,0 +1,256 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "query_predicates.h"
+
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum PredicateKind {
+  PREDICATE_EQ,
+  PREDICATE_MATCH,
+  PREDICATE_ANY_OF,
+  PREDICATE_PRIORITY,
+} PredicateKind;
+
+typedef struct Word {
+  const char *data;
+  uint32_t length;
+} Word;
+
+typedef struct Predicate {
+  PredicateKind kind;
+  bool negated;
+  uint32_t capture;
+  int64_t other_capture; // `#eq? @a @b`, -1 otherwise
+  Word value;            // `#eq?` string or `#set! priority` value
+  regex_t regex;
+  Word *words; // sorted by length, then bytes
+  uint32_t word_count;
+} Predicate;
+
+typedef struct Pattern {
+  Predicate *predicates;
+  uint32_t count;
+} Pattern;
+
+struct RgbasmQueryPredicates {
+  Pattern *patterns;
+  uint32_t pattern_count;
+  const char *unsupported;
+  char *scratch;
+  size_t scratch_capacity;
+};
+
+static int word_compare(const void *a, const void *b) {
+  const Word *x = a;
+  const Word *y = b;
+  if (x->length != y->length) {
+    return x->length < y->length ? -1 : 1;
+  }
+  return memcmp(x->data, y->data, x->length);
+}
+
+static bool word_is(Word word, const char *string) {
+  return word.length == strlen(string) &&
+         memcmp(word.data, string, word.length) == 0;
+}
+
+static Word string_value(const TSQuery *query, const TSQueryPredicateStep *step) {
+  Word word;
+  word.data = ts_query_string_value_for_id(query, step->value_id, &word.length);
+  return word;
+}
+
+// Compiles the predicate in `steps[0..count)`, the operator first.
+static const char *compile(RgbasmQueryPredicates *self, const TSQuery *query,
+                           const TSQueryPredicateStep *steps, uint32_t count,
+                           Pattern *pattern) {
+  const Word name = string_value(query, &steps[0]);
+  Predicate predicate = {.other_capture = -1};
+  const char *operator = name.data;
+  if (name.length > 4 && memcmp(operator, "not-", 4) == 0) {
+    predicate.negated = true;
+    operator += 4;
+  }
+
+  if (strcmp(operator, "set!") == 0) {
+    // `#set! [@capture] key value`, only the priority matters here
+    if (count < 3 || steps[count - 2].type != TSQueryPredicateStepTypeString) {
+      return NULL;
+    }
+    if (!word_is(string_value(query, &steps[count - 2]), "priority")) {
+      return NULL;
+    }
+    predicate.kind = PREDICATE_PRIORITY;
+    predicate.value = string_value(query, &steps[count - 1]);
+  } else if (strcmp(operator, "eq?") == 0 || strcmp(operator, "match?") == 0 ||
+             strcmp(operator, "any-of?") == 0) {
+    if (count < 3 || steps[1].type != TSQueryPredicateStepTypeCapture) {
+      return "predicate needs a capture and a value";
+    }
+    predicate.capture = steps[1].value_id;
+    if (operator[0] == 'e') {
+      if (count != 3) {
+        return "#eq? takes two arguments";
+      }
+      predicate.kind = PREDICATE_EQ;
+      if (steps[2].type == TSQueryPredicateStepTypeCapture) {
+        predicate.other_capture = steps[2].value_id;
+      } else {
+        predicate.value = string_value(query, &steps[2]);
+      }
+    } else if (operator[0] == 'm') {
+      if (count != 3 || steps[2].type != TSQueryPredicateStepTypeString) {
+        return "#match? takes a capture and a regex";
+      }
+      predicate.kind = PREDICATE_MATCH;
+      const Word pattern = string_value(query, &steps[2]);
+      if (regcomp(&predicate.regex, pattern.data, REG_EXTENDED | REG_NOSUB) !=
+          0) {
+        return "invalid regex in #match?";
+      }
+    } else {
+      predicate.kind = PREDICATE_ANY_OF;
+      predicate.word_count = count - 2;
+      predicate.words = malloc(predicate.word_count * sizeof(Word));
+      for (uint32_t i = 2; i < count; i++) {
+        if (steps[i].type != TSQueryPredicateStepTypeString) {
+          free(predicate.words);
+          return "#any-of? takes a capture and strings";
+        }
+        predicate.words[i - 2] = string_value(query, &steps[i]);
+      }
+      qsort(predicate.words, predicate.word_count, sizeof(Word), word_compare);
+    }
+  } else {
+    if (self->unsupported == NULL) {
+      self->unsupported = name.data;
+    }
+    return NULL;
+  }
+
+  pattern->predicates = realloc(pattern->predicates,
+                                (pattern->count + 1) * sizeof(Predicate));
+  pattern->predicates[pattern->count++] = predicate;
+  return NULL;
+}
+
+RgbasmQueryPredicates *rgbasm_query_predicates_new(const TSQuery *query,
+                                                   const char **error) {
+  RgbasmQueryPredicates *self = calloc(1, sizeof(RgbasmQueryPredicates));
+  self->pattern_count = ts_query_pattern_count(query);
+  self->patterns = calloc(self->pattern_count, sizeof(Pattern));
+  for (uint32_t i = 0; i < self->pattern_count; i++) {
+    uint32_t step_count;
+    const TSQueryPredicateStep *steps =
+        ts_query_predicates_for_pattern(query, i, &step_count);
+    uint32_t start = 0;
+    for (uint32_t j = 0; j < step_count; j++) {
+      if (steps[j].type != TSQueryPredicateStepTypeDone) {
+        continue;
+      }
+      const char *message =
+          compile(self, query, &steps[start], j - start, &self->patterns[i]);
+      if (message != NULL) {
+        *error = message;
+        rgbasm_query_predicates_delete(self);
+        return NULL;
+      }
+      start = j + 1;
+    }
+  }
+  return self;
+}
+
+void rgbasm_query_predicates_delete(RgbasmQueryPredicates *self) {
+  for (uint32_t i = 0; i < self->pattern_count; i++) {
+    Pattern *pattern = &self->patterns[i];
+    for (uint32_t j = 0; j < pattern->count; j++) {
+      Predicate *predicate = &pattern->predicates[j];
+      if (predicate->kind == PREDICATE_MATCH) {
+        regfree(&predicate->regex);
+      }
+      free(predicate->words);
+    }
+    free(pattern->predicates);
+  }
+  free(self->patterns);
+  free(self->scratch);
+  free(self);
+}
+
+static Word node_text(TSNode node, const char *source) {
+  const uint32_t start = ts_node_start_byte(node);
+  return (Word){source + start, ts_node_end_byte(node) - start};
+}
+
+static bool regex_matches(RgbasmQueryPredicates *self, const regex_t *regex,
+                          Word text) {
+  if (text.length + 1 > self->scratch_capacity) {
+    self->scratch_capacity = text.length + 1 > 256 ? text.length + 1 : 256;
+    self->scratch = realloc(self->scratch, self->scratch_capacity);
+  }
+  memcpy(self->scratch, text.data, text.length);
+  self->scratch[text.length] = '\0';
+  return regexec(regex, self->scratch, 0, NULL, 0) == 0;
+}
+
+static bool holds(RgbasmQueryPredicates *self, const Predicate *predicate,
+                  const TSQueryMatch *match, Word text, const char *source) {
+  switch (predicate->kind) {
+  case PREDICATE_EQ:
+    if (predicate->other_capture >= 0) {
+      for (uint16_t i = 0; i < match->capture_count; i++) {
+        if (match->captures[i].index == predicate->other_capture) {
+          const Word other = node_text(match->captures[i].node, source);
+          return word_compare(&text, &other) == 0;
+        }
+      }
+      return false;
+    }
+    return word_compare(&text, &predicate->value) == 0;
+  case PREDICATE_MATCH:
+    return regex_matches(self, &predicate->regex, text);
+  case PREDICATE_ANY_OF:
+    return bsearch(&text, predicate->words, predicate->word_count, sizeof(Word),
+                   word_compare) != NULL;
+  case PREDICATE_PRIORITY:
+    break;
+  }
+  return true;
+}
+
+bool rgbasm_query_predicates_match(RgbasmQueryPredicates *self,
+                                   const TSQueryMatch *match,
+                                   const char *source, int *priority) {
+  const Pattern *pattern = &self->patterns[match->pattern_index];
+  if (priority != NULL) {
+    *priority = RGBASM_DEFAULT_PRIORITY;
+  }
+  for (uint32_t i = 0; i < pattern->count; i++) {
+    const Predicate *predicate = &pattern->predicates[i];
+    if (predicate->kind == PREDICATE_PRIORITY) {
+      if (priority != NULL) {
+        *priority = (int)strtol(predicate->value.data, NULL, 10);
+      }
+      continue;
+    }
+    // quantified captures hold if every captured node does
+    for (uint16_t j = 0; j < match->capture_count; j++) {
+      if (match->captures[j].index != predicate->capture) {
+        continue;
+      }
+      const Word text = node_text(match->captures[j].node, source);
+      if (holds(self, predicate, match, text, source) == predicate->negated) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+const char *rgbasm_query_predicates_unsupported(
+    const RgbasmQueryPredicates *self) {
+  return self->unsupported;
+}
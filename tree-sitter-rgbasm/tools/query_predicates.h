@@ -0,0 +1,35 @@
+#ifndef RGBASM_TOOLS_QUERY_PREDICATES_H_
+#define RGBASM_TOOLS_QUERY_PREDICATES_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Evaluation of the text predicates of a query, as done by the editors.
+//
+// Supported are `#eq?`, `#match?` and `#any-of?` with their `#not-` forms
+// (regular expressions are POSIX extended ones) and `#set! priority`. Other
+// predicates are accepted and treated as true.
+
+#define RGBASM_DEFAULT_PRIORITY 100
+
+typedef struct RgbasmQueryPredicates RgbasmQueryPredicates;
+
+// Compiles the predicates of all patterns of `query`. Returns NULL and sets
+// `error` if a predicate is malformed or a regex does not compile.
+RgbasmQueryPredicates *rgbasm_query_predicates_new(const TSQuery *query,
+                                                   const char **error);
+void rgbasm_query_predicates_delete(RgbasmQueryPredicates *self);
+
+// Returns true if `match` satisfies the predicates of its pattern. `source` is
+// the text the match's tree was parsed from. If `priority` is not NULL it is
+// set to the `#set! priority` of the pattern, or RGBASM_DEFAULT_PRIORITY.
+bool rgbasm_query_predicates_match(RgbasmQueryPredicates *self,
+                                   const TSQueryMatch *match,
+                                   const char *source, int *priority);
+
+// The name of a predicate that is not evaluated, or NULL if all are.
+const char *rgbasm_query_predicates_unsupported(
+    const RgbasmQueryPredicates *self);
+
+#endif // RGBASM_TOOLS_QUERY_PREDICATES_H_
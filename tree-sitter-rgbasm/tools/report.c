@@ -0,0 +1,74 @@
+#include "report.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const RgbasmVector rgbasm_vectors[RGBASM_VECTOR_COUNT] = {
+    {"vblank", 0x40}, {"stat", 0x48},   {"timer", 0x50},
+    {"serial", 0x58}, {"joypad", 0x60},
+};
+
+int32_t rgbasm_report_rom0_at(const RgbasmProgram *program, int32_t address) {
+  const int32_t found = rgbasm_program_at_address(program, address);
+  if (found < 0 ||
+      strcmp(program->sections[program->instructions[found].section]
+                 .size->type,
+             "ROM0") != 0) {
+    return -1;
+  }
+  return found;
+}
+
+const char *rgbasm_report_name(const RgbasmProgram *program,
+                               int32_t instruction) {
+  const int32_t label = program->instructions[instruction].label;
+  if (label >= 0 && program->labels[label].instruction == instruction) {
+    return program->labels[label].name;
+  }
+  return "?";
+}
+
+void rgbasm_report_location(const RgbasmProgram *program,
+                            int32_t instruction) {
+  const RgbasmInstruction *self = &program->instructions[instruction];
+  printf("%s:%u", program->paths[self->file], self->point.row + 1);
+}
+
+void rgbasm_report_function(const RgbasmProgram *program,
+                            int32_t instruction) {
+  const int32_t label = program->instructions[instruction].label;
+  if (label < 0) {
+    printf("?");
+    return;
+  }
+  const char *name = program->labels[label].name;
+  const char *dot = strchr(name, '.');
+  printf("%.*s", dot != NULL ? (int)(dot - name) : (int)strlen(name), name);
+}
+
+void rgbasm_report_reason(const RgbasmProgram *program, bool exact,
+                          const char *reason, int32_t problem) {
+  if (!exact) {
+    printf("\t%s at ", reason);
+    rgbasm_report_location(program, problem);
+  }
+}
+
+static int compare_ranked(const void *a, const void *b) {
+  const int64_t left = ((const RgbasmRanked *)a)->value;
+  const int64_t right = ((const RgbasmRanked *)b)->value;
+  return (left < right) - (left > right);
+}
+
+void rgbasm_report_routines(const RgbasmProgram *program,
+                            RgbasmRanked *routines, size_t count) {
+  qsort(routines, count, sizeof(RgbasmRanked), compare_ranked);
+  for (size_t i = 0; i < count; i++) {
+    printf("function\t%s\t",
+           rgbasm_report_name(program, routines[i].instruction));
+    rgbasm_report_location(program, routines[i].instruction);
+    printf("\t%s%lld\n", routines[i].exact ? "" : ">=",
+           (long long)routines[i].value);
+  }
+}
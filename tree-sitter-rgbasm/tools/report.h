@@ -0,0 +1,56 @@
+#ifndef RGBASM_TOOLS_REPORT_H_
+#define RGBASM_TOOLS_REPORT_H_
+
+#include "program.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// What the tools analyzing a program start from and how they print it:
+// rgbasm-budget, rgbasm-stack and rgbasm-latency.
+
+typedef struct RgbasmVector {
+  const char *name; // e.g. "vblank"
+  int32_t address;
+} RgbasmVector;
+
+#define RGBASM_VECTOR_COUNT 5
+
+// The interrupt vectors, $40 to $60.
+extern const RgbasmVector rgbasm_vectors[RGBASM_VECTOR_COUNT];
+
+// The instruction a ROM0 section with a fixed address places at `address`,
+// -1 if there is none.
+int32_t rgbasm_report_rom0_at(const RgbasmProgram *program, int32_t address);
+
+// The label at `instruction`, "?" if none starts there.
+const char *rgbasm_report_name(const RgbasmProgram *program,
+                               int32_t instruction);
+
+// Prints `file:line` of `instruction`.
+void rgbasm_report_location(const RgbasmProgram *program,
+                            int32_t instruction);
+
+// Prints `Parent` of the label `Parent.local` `instruction` is under, `?` if
+// it is under none.
+void rgbasm_report_function(const RgbasmProgram *program,
+                            int32_t instruction);
+
+// Prints `\treason at file:line` for a result that is not exact.
+void rgbasm_report_reason(const RgbasmProgram *program, bool exact,
+                          const char *reason, int32_t problem);
+
+typedef struct RgbasmRanked {
+  int32_t instruction; // where the routine starts
+  int64_t value;
+  bool exact;
+} RgbasmRanked;
+
+// Sorts `routines` by value, largest first, and prints `function name
+// file:line value` for each, with `>=` in front of values that are not
+// exact.
+void rgbasm_report_routines(const RgbasmProgram *program,
+                            RgbasmRanked *routines, size_t count);
+
+#endif // RGBASM_TOOLS_REPORT_H_
@@ -0,0 +1,292 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "section_split.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <tree_sitter/tree-sitter-rgbasm-tokenizer.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+
+static bool token_is(const char *data, const RgbasmToken *token,
+                     const char *word) {
+  return token->length == strlen(word) &&
+         strncasecmp(data + token->offset, word, token->length) == 0;
+}
+
+// Change of the block nesting by a keyword starting a statement.
+static int nesting_delta(const char *data, const RgbasmToken *token) {
+  static const char *const openers[] = {
+      "MACRO", "IF", "REPT", "FOR", "UNION", "LOAD", "PUSHS",
+  };
+  static const char *const closers[] = {
+      "ENDM", "ENDC", "ENDR", "ENDU", "ENDL", "POPS",
+  };
+  for (size_t i = 0; i < sizeof(openers) / sizeof(openers[0]); i++) {
+    if (token_is(data, token, openers[i])) {
+      return 1;
+    }
+  }
+  for (size_t i = 0; i < sizeof(closers) / sizeof(closers[0]); i++) {
+    if (token_is(data, token, closers[i])) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Advances `point` from byte `from` to byte `to`.
+static TSPoint advance_point(const char *data, uint32_t from, uint32_t to,
+                             TSPoint point) {
+  uint32_t line_start = from - point.column;
+  const char *p = data + from;
+  const char *end = data + to;
+  while ((p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+    point.row += 1;
+    p += 1;
+    line_start = (uint32_t)(p - data);
+  }
+  point.column = to - line_start;
+  return point;
+}
+
+uint32_t rgbasm_section_ranges(const char *data, uint32_t length,
+                               uint32_t min_chunk_bytes, TSRange **ranges) {
+  uint32_t capacity = 16;
+  uint32_t count = 0;
+  TSRange *result = malloc(capacity * sizeof(TSRange));
+  result[0] = (TSRange){
+      .start_point = {0, 0},
+      .start_byte = 0,
+  };
+  count = 1;
+
+  RgbasmTokenizer tokenizer;
+  rgbasm_tokenizer_init(&tokenizer, data, length);
+  RgbasmToken token;
+  TSPoint point = {0, 0};
+  uint32_t point_byte = 0;
+  int depth = 0;
+  int fragments = 0;
+  bool statement_start = true;
+
+  while (rgbasm_tokenizer_next(&tokenizer, &token)) {
+    switch (token.token_class) {
+    case RGBASM_TOKEN_NEWLINE:
+      statement_start = true;
+      continue;
+    case RGBASM_TOKEN_COMMENT:
+    case RGBASM_TOKEN_LABEL:
+      continue;
+    case RGBASM_TOKEN_PUNCTUATION:
+      if (token.length == 2 && data[token.offset] == '[') {
+        fragments += 1;
+      } else if (token.length == 2 && data[token.offset] == ']') {
+        fragments -= fragments > 0 ? 1 : 0;
+      }
+      if (data[token.offset] == ':') {
+        continue; // label colons and `::` keep the statement start
+      }
+      break;
+    case RGBASM_TOKEN_KEYWORD:
+      if (!statement_start) {
+        break;
+      }
+      depth += nesting_delta(data, &token);
+      if (depth < 0) {
+        depth = 0;
+      }
+      if (depth == 0 && fragments == 0 && token_is(data, &token, "SECTION")) {
+        // cut at the beginning of the line
+        uint32_t line = token.offset;
+        while (line > 0 && data[line - 1] != '\n') {
+          line--;
+        }
+        TSRange *last = &result[count - 1];
+        if (line > last->start_byte &&
+            line - last->start_byte >= min_chunk_bytes) {
+          point = advance_point(data, point_byte, line, point);
+          point_byte = line;
+          last->end_byte = line;
+          last->end_point = point;
+          if (count == capacity) {
+            capacity *= 2;
+            result = realloc(result, capacity * sizeof(TSRange));
+          }
+          result[count++] = (TSRange){
+              .start_point = point,
+              .start_byte = line,
+          };
+        }
+      }
+      break;
+    default:
+      break;
+    }
+    statement_start = false;
+  }
+
+  TSRange *last = &result[count - 1];
+  last->end_byte = length;
+  last->end_point = advance_point(data, point_byte, length, point);
+  *ranges = result;
+  return count;
+}
+
+// ----- Parallel parsing -----
+
+typedef struct SplitJob {
+  const char *data;
+  uint32_t length;
+  RgbasmChunk *chunks;
+  uint32_t count;
+  atomic_uint next;
+} SplitJob;
+
+static void *parse_worker(void *payload) {
+  SplitJob *job = payload;
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_rgbasm());
+  for (;;) {
+    const unsigned index = atomic_fetch_add(&job->next, 1);
+    if (index >= job->count) {
+      break;
+    }
+    RgbasmChunk *chunk = &job->chunks[index];
+    ts_parser_set_included_ranges(parser, &chunk->range, 1);
+    chunk->tree = ts_parser_parse_string(parser, NULL, job->data, job->length);
+  }
+  ts_parser_delete(parser);
+  return NULL;
+}
+
+bool rgbasm_parse_split(const char *data, uint32_t length, unsigned threads,
+                        uint32_t min_chunk_bytes, RgbasmSplitParse *result) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  if (min_chunk_bytes == 0) {
+    // a few chunks per thread evens out differently sized sections
+    min_chunk_bytes = length / (threads * 4);
+  }
+
+  TSRange *ranges;
+  const uint32_t count =
+      rgbasm_section_ranges(data, length, min_chunk_bytes, &ranges);
+  SplitJob job = {
+      .data = data,
+      .length = length,
+      .chunks = calloc(count, sizeof(RgbasmChunk)),
+      .count = count,
+  };
+  atomic_init(&job.next, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    job.chunks[i].range = ranges[i];
+  }
+  free(ranges);
+
+  if (threads > count) {
+    threads = count;
+  }
+  pthread_t *workers = calloc(threads, sizeof(pthread_t));
+  unsigned started = 0;
+  for (unsigned i = 1; i < threads; i++) {
+    if (pthread_create(&workers[i], NULL, parse_worker, &job) != 0) {
+      break;
+    }
+    started = i;
+  }
+  parse_worker(&job); // the calling thread helps
+  for (unsigned i = 1; i <= started; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  free(workers);
+
+  result->chunks = job.chunks;
+  result->count = count;
+  for (uint32_t i = 0; i < count; i++) {
+    if (job.chunks[i].tree == NULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void rgbasm_split_parse_free(RgbasmSplitParse *result) {
+  for (uint32_t i = 0; i < result->count; i++) {
+    if (result->chunks[i].tree != NULL) {
+      ts_tree_delete(result->chunks[i].tree);
+    }
+  }
+  free(result->chunks);
+  result->chunks = NULL;
+  result->count = 0;
+}
+
+// ----- Outline -----
+
+typedef struct Outline {
+  RgbasmOutlineEntry *entries;
+  uint32_t count;
+  uint32_t capacity;
+} Outline;
+
+static void outline_push(Outline *outline, const char *kind, uint32_t chunk,
+                         TSNode node, TSNode name) {
+  if (ts_node_is_null(name)) {
+    return;
+  }
+  if (outline->count == outline->capacity) {
+    outline->capacity = outline->capacity ? outline->capacity * 2 : 64;
+    outline->entries = realloc(outline->entries, outline->capacity *
+                                                     sizeof(RgbasmOutlineEntry));
+  }
+  outline->entries[outline->count++] = (RgbasmOutlineEntry){
+      .kind = kind,
+      .chunk = chunk,
+      .node = node,
+      .name_start = ts_node_start_byte(name),
+      .name_end = ts_node_end_byte(name),
+  };
+}
+
+static TSNode field(TSNode node, const char *name) {
+  return ts_node_child_by_field_name(node, name, (uint32_t)strlen(name));
+}
+
+static void outline_walk(Outline *outline, uint32_t chunk, TSNode node) {
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(node, i);
+    const char *type = ts_node_type(child);
+    if (strcmp(type, "section_block") == 0) {
+      const TSNode directive = ts_node_named_child(child, 0);
+      outline_push(outline, "section", chunk, child, field(directive, "name"));
+      outline_walk(outline, chunk, child);
+    } else if (strcmp(type, "global_label_block") == 0) {
+      outline_push(outline, "label", chunk, child, field(child, "name"));
+      outline_walk(outline, chunk, child);
+    } else if (strcmp(type, "def_directive") == 0) {
+      outline_push(outline, "constant", chunk, child, field(child, "name"));
+    } else if (strcmp(type, "macro_definition") == 0) {
+      outline_push(outline, "macro", chunk, child, field(child, "name"));
+    } else if (strcmp(type, "directive") == 0 ||
+               strcmp(type, "export_directive") == 0 ||
+               strcmp(type, "load_block") == 0 ||
+               strcmp(type, "pushs_block") == 0) {
+      outline_walk(outline, chunk, child);
+    }
+  }
+}
+
+uint32_t rgbasm_split_outline(const RgbasmSplitParse *parse,
+                              RgbasmOutlineEntry **entries) {
+  Outline outline = {0};
+  for (uint32_t i = 0; i < parse->count; i++) {
+    outline_walk(&outline, i, ts_tree_root_node(parse->chunks[i].tree));
+  }
+  *entries = outline.entries;
+  return outline.count;
+}
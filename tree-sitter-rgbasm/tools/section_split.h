@@ -0,0 +1,52 @@
+#ifndef RGBASM_TOOLS_SECTION_SPLIT_H_
+#define RGBASM_TOOLS_SECTION_SPLIT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Parallel parsing of a single large file.
+//
+// A SECTION directive starts a fresh scanner state, so a file can be cut in
+// front of every SECTION line that is not nested in a block (MACRO, IF, REPT,
+// FOR, UNION, LOAD, PUSHS or a fragment literal). The chunks are parsed
+// concurrently, each restricted to its range of the whole document with
+// ts_parser_set_included_ranges, so node positions are those of the file.
+
+typedef struct RgbasmChunk {
+  TSRange range;
+  TSTree *tree;
+} RgbasmChunk;
+
+typedef struct RgbasmSplitParse {
+  RgbasmChunk *chunks;
+  uint32_t count;
+} RgbasmSplitParse;
+
+typedef struct RgbasmOutlineEntry {
+  const char *kind; // "section", "label", "constant" or "macro"
+  uint32_t chunk;
+  TSNode node;      // the block or directive node
+  uint32_t name_start;
+  uint32_t name_end;
+} RgbasmOutlineEntry;
+
+// Returns the ranges of the chunks obtained by cutting in front of every
+// top-level SECTION line, merging neighbours until each chunk has at least
+// `min_chunk_bytes` (except the last one). The caller frees `*ranges`.
+uint32_t rgbasm_section_ranges(const char *data, uint32_t length,
+                               uint32_t min_chunk_bytes, TSRange **ranges);
+
+// Parses the chunks on `threads` worker threads, each with its own parser.
+// `min_chunk_bytes` of 0 picks a size that gives every thread a few chunks.
+bool rgbasm_parse_split(const char *data, uint32_t length, unsigned threads,
+                        uint32_t min_chunk_bytes, RgbasmSplitParse *result);
+
+void rgbasm_split_parse_free(RgbasmSplitParse *result);
+
+// Collects sections, global labels, constants and macro definitions of all
+// chunks in document order. The caller frees `*entries`.
+uint32_t rgbasm_split_outline(const RgbasmSplitParse *parse,
+                              RgbasmOutlineEntry **entries);
+
+#endif // RGBASM_TOOLS_SECTION_SPLIT_H_
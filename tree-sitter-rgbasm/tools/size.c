@@ -0,0 +1,254 @@
+// Reports the byte size of every SECTION of a project and how full the ROM
+// and RAM banks they are placed in are. Files are measured in parallel, each
+// with the constants of the files it INCLUDEs.
+
+#include "batch.h"
+#include "json.h"
+#include "layout.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-v] [--json] path...\n"
+          "\n"
+          "Prints `bank bytes capacity percent` for every bank the sections\n"
+          "use; a bank is a section type, with its number where sections\n"
+          "give one. Sizes that depend on unknown values are printed as\n"
+          "lower bounds, e.g. `>=12`.\n"
+          "\n"
+          "  -I dir  resolve INCLUDE and INCBIN paths in dir, like rgbasm -I\n"
+          "  -v      also print `section bank name bytes file:line` for every\n"
+          "          section, LOAD and PUSHS\n"
+          "  --json  print the sections and banks as a JSON object\n",
+          argv0);
+}
+
+typedef struct SizeTask {
+  const char *const *paths;
+  RgbasmLayoutOptions options;
+  RgbasmFileLayout *layouts; // per path
+} SizeTask;
+
+static void measure(TSParser *parser, size_t index, const Source *source,
+                    TSTree *tree, void *context) {
+  SizeTask *task = context;
+  RgbasmConstants constants;
+  rgbasm_constants_init(&constants);
+  rgbasm_layout_file(parser, task->paths[index], source->data,
+                     ts_tree_root_node(tree), &task->options, &constants,
+                     &task->layouts[index]);
+  rgbasm_constants_free(&constants);
+}
+
+typedef struct Bank {
+  char key[24]; // e.g. ROMX[2]
+  uint64_t bytes;
+  uint32_t capacity;
+  bool exact;
+} Bank;
+
+// The largest UNION section of a name so far, they overlap.
+typedef struct Union {
+  size_t bank;
+  const char *name;
+  uint32_t bytes;
+} Union;
+
+typedef struct Report {
+  Bank *banks;
+  size_t bank_count;
+  Union *unions;
+  size_t union_count;
+} Report;
+
+static void bank_key(const RgbasmSectionSize *section, char *key,
+                     size_t size) {
+  const char *type = section->type[0] ? section->type : "?";
+  if (section->has_bank && rgbasm_section_type_banked(type)) {
+    snprintf(key, size, "%s[%d]", type, section->bank);
+  } else {
+    snprintf(key, size, "%s", type);
+  }
+}
+
+static void report_add(Report *report, const RgbasmSectionSize *section) {
+  char key[24];
+  bank_key(section, key, sizeof(key));
+  Bank *bank = NULL;
+  for (size_t i = 0; i < report->bank_count && bank == NULL; i++) {
+    if (strcmp(report->banks[i].key, key) == 0) {
+      bank = &report->banks[i];
+    }
+  }
+  if (bank == NULL) {
+    report->banks =
+        realloc(report->banks, (report->bank_count + 1) * sizeof(Bank));
+    bank = &report->banks[report->bank_count++];
+    *bank = (Bank){.capacity = rgbasm_section_capacity(section->type),
+                   .exact = true};
+    strcpy(bank->key, key);
+  }
+  uint32_t bytes = section->bytes;
+  if (section->is_union) {
+    Union *found = NULL;
+    for (size_t i = 0; i < report->union_count && found == NULL; i++) {
+      if (report->unions[i].bank == (size_t)(bank - report->banks) &&
+          strcmp(report->unions[i].name, section->name) == 0) {
+        found = &report->unions[i];
+      }
+    }
+    if (found == NULL) {
+      report->unions =
+          realloc(report->unions, (report->union_count + 1) * sizeof(Union));
+      found = &report->unions[report->union_count++];
+      *found = (Union){.bank = (size_t)(bank - report->banks),
+                       .name = section->name};
+    }
+    bytes = bytes > found->bytes ? bytes - found->bytes : 0;
+    found->bytes += bytes;
+  }
+  bank->bytes += bytes;
+  bank->exact = bank->exact && section->exact;
+}
+
+static int compare_banks(const void *a, const void *b) {
+  return strcmp(((const Bank *)a)->key, ((const Bank *)b)->key);
+}
+
+static void print_text(const char *const *paths, size_t count,
+                       const RgbasmFileLayout *layouts, const Report *report,
+                       bool verbose) {
+  if (verbose) {
+    for (size_t i = 0; i < count; i++) {
+      for (size_t j = 0; j < layouts[i].count; j++) {
+        const RgbasmSectionSize *section = &layouts[i].sections[j];
+        char key[24];
+        bank_key(section, key, sizeof(key));
+        static const char *const kinds[] = {"section", "load", "pushs"};
+        printf("%s\t%s\t%s\t%s%u\t%s:%u\n", kinds[section->kind], key,
+               section->name, section->exact ? "" : ">=", section->bytes,
+               paths[i], section->point.row + 1);
+      }
+    }
+  }
+  for (size_t i = 0; i < report->bank_count; i++) {
+    const Bank *bank = &report->banks[i];
+    printf("%s\t%s%llu", bank->key, bank->exact ? "" : ">=",
+           (unsigned long long)bank->bytes);
+    if (bank->capacity != 0) {
+      printf("\t%u\t%.1f%%", bank->capacity,
+             100.0 * (double)bank->bytes / bank->capacity);
+    }
+    printf("\n");
+  }
+}
+
+static void print_json(const char *const *paths, size_t count,
+                       const RgbasmFileLayout *layouts,
+                       const Report *report) {
+  JsonBuffer out = {0};
+  json_appendf(&out, "{\"sections\":[");
+  bool first = true;
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < layouts[i].count; j++) {
+      const RgbasmSectionSize *section = &layouts[i].sections[j];
+      char key[24];
+      bank_key(section, key, sizeof(key));
+      json_appendf(&out, "%s{\"name\":", first ? "" : ",");
+      json_append_string(&out, section->name, strlen(section->name));
+      json_appendf(&out, ",\"bank\":");
+      json_append_string(&out, key, strlen(key));
+      json_appendf(&out, ",\"bytes\":%u,\"exact\":%s,\"file\":",
+                   section->bytes, section->exact ? "true" : "false");
+      json_append_string(&out, paths[i], strlen(paths[i]));
+      json_appendf(&out, ",\"line\":%u}", section->point.row + 1);
+      first = false;
+    }
+  }
+  json_appendf(&out, "],\"banks\":[");
+  for (size_t i = 0; i < report->bank_count; i++) {
+    const Bank *bank = &report->banks[i];
+    json_appendf(&out, "%s{\"bank\":", i ? "," : "");
+    json_append_string(&out, bank->key, strlen(bank->key));
+    json_appendf(&out, ",\"bytes\":%llu,\"exact\":%s",
+                 (unsigned long long)bank->bytes,
+                 bank->exact ? "true" : "false");
+    if (bank->capacity != 0) {
+      json_appendf(&out, ",\"capacity\":%u", bank->capacity);
+    }
+    json_appendf(&out, "}");
+  }
+  json_appendf(&out, "]}\n");
+  fwrite(out.data, 1, out.length, stdout);
+  json_buffer_free(&out);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  bool verbose = false;
+  bool json = false;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  SizeTask task = {
+      .paths = (const char *const *)paths.items,
+      .options = {.include_dirs = include_dirs,
+                  .include_dir_count = include_dir_count},
+      .layouts = calloc(paths.count, sizeof(RgbasmFileLayout)),
+  };
+  const bool ok = rgbasm_batch_parse(task.paths, paths.count, threads, measure,
+                                     &task);
+
+  Report report = {0};
+  for (size_t i = 0; i < paths.count; i++) {
+    for (size_t j = 0; j < task.layouts[i].count; j++) {
+      // LOAD blocks take up their RAM as well as the ROM holding their code
+      report_add(&report, &task.layouts[i].sections[j]);
+    }
+  }
+  qsort(report.banks, report.bank_count, sizeof(Bank), compare_banks);
+  if (json) {
+    print_json(task.paths, paths.count, task.layouts, &report);
+  } else {
+    print_text(task.paths, paths.count, task.layouts, &report, verbose);
+  }
+
+  for (size_t i = 0; i < paths.count; i++) {
+    rgbasm_file_layout_free(&task.layouts[i]);
+  }
+  free(task.layouts);
+  free(report.banks);
+  free(report.unions);
+  path_list_free(&paths);
+  free(include_dirs);
+  return ok ? 0 : 1;
+}
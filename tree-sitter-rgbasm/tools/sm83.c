@@ -0,0 +1,205 @@
+#include "sm83.h"
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "expr.h"
+#include "sm83_table.h"
+
+#define OPERAND_MAX 16
+#define FORM_MAX 48
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+// The lowercase text of `node`, hl+ and hl- spelled hli and hld.
+static void lower_text(TSNode node, const char *source, char *out,
+                       size_t size) {
+  const uint32_t start = ts_node_start_byte(node);
+  uint32_t length = ts_node_end_byte(node) - start;
+  if (length >= size) {
+    length = (uint32_t)size - 1;
+  }
+  for (uint32_t i = 0; i < length; i++) {
+    out[i] = (char)tolower((unsigned char)source[start + i]);
+  }
+  out[length] = '\0';
+  if (strcmp(out, "hl+") == 0) {
+    strcpy(out, "hli");
+  } else if (strcmp(out, "hl-") == 0) {
+    strcpy(out, "hld");
+  }
+}
+
+static bool is_r8(const char *name) {
+  return name[0] != '\0' && name[1] == '\0' && strchr("abcdehl", name[0]);
+}
+
+static bool is_r16(const char *name) {
+  return strcmp(name, "bc") == 0 || strcmp(name, "de") == 0 ||
+         strcmp(name, "hl") == 0 || strcmp(name, "sp") == 0;
+}
+
+// Whether an address is `[$ff00 + c]` or `[c + $ff00]`, which rgbasm
+// assembles like `[c]`.
+static bool is_high_c(TSNode node, const char *source) {
+  char text[OPERAND_MAX * 2];
+  size_t length = 0;
+  const uint32_t end = ts_node_end_byte(node);
+  for (uint32_t i = ts_node_start_byte(node); i < end; i++) {
+    const unsigned char c = (unsigned char)source[i];
+    if (isspace(c) || c == '[' || c == ']') {
+      continue;
+    }
+    if (length + 1 == sizeof(text)) {
+      return false;
+    }
+    text[length++] = (char)tolower(c);
+  }
+  text[length] = '\0';
+  const char *plus = strchr(text, '+');
+  if (plus == NULL) {
+    return false;
+  }
+  const char *number = text;
+  size_t number_length = (size_t)(plus - text);
+  if (strcmp(plus + 1, "c") != 0) {
+    if (strncmp(text, "c+", 2) != 0) {
+      return false;
+    }
+    number = plus + 1;
+    number_length = strlen(number);
+  }
+  int32_t value;
+  return rgbasm_expr_number(number, number_length, &value) && value == 0xff00;
+}
+
+// An operand as written and by its class, see instructions.lua.
+static void operand(TSNode node, const char *source, char *exact,
+                    char *class) {
+  if (is_type(node, "register")) {
+    lower_text(node, source, exact, OPERAND_MAX);
+    strcpy(class, is_r8(exact) ? "r" : is_r16(exact) ? "rr" : exact);
+  } else if (is_type(node, "address")) {
+    const TSNode inner = ts_node_named_child(node, 0);
+    if (!ts_node_is_null(inner) && is_type(inner, "register")) {
+      char name[OPERAND_MAX - 2];
+      lower_text(inner, source, name, sizeof(name));
+      snprintf(exact, OPERAND_MAX, "[%s]", name);
+    } else if (is_high_c(node, source)) {
+      strcpy(exact, "[c]");
+    } else {
+      strcpy(exact, "[n]");
+    }
+    strcpy(class, exact);
+  } else if (is_type(node, "condition_code")) {
+    strcpy(exact, "cc");
+    strcpy(class, "cc");
+  } else {
+    const TSNode left = ts_node_child_by_field_name(node, "left", 4);
+    // ld hl, sp + e8
+    const char *form =
+        is_type(node, "binary_expression") && !ts_node_is_null(left) &&
+                is_type(left, "register")
+            ? "sp+n"
+            : "n";
+    strcpy(exact, form);
+    strcpy(class, form);
+  }
+}
+
+static bool is_alu(const char *mnemonic) {
+  static const char *const names[] = {"add", "adc", "sub", "sbc",
+                                      "and", "xor", "or",  "cp"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++) {
+    if (strcmp(mnemonic, names[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static int compare_form(const void *key, const void *entry) {
+  return strcmp(key, ((const RgbasmSm83Form *)entry)->form);
+}
+
+static const RgbasmSm83Form *find(const char *form) {
+  return bsearch(form, rgbasm_sm83_forms,
+                 sizeof(rgbasm_sm83_forms) / sizeof(*rgbasm_sm83_forms),
+                 sizeof(*rgbasm_sm83_forms), compare_form);
+}
+
+const RgbasmSm83Form *rgbasm_sm83_form(const char *form) {
+  return find(form);
+}
+
+const RgbasmSm83Form *rgbasm_sm83_lookup(TSNode instruction,
+                                         const char *source) {
+  if (is_type(instruction, "instruction")) {
+    instruction = ts_node_named_child(instruction, 0);
+    if (ts_node_is_null(instruction)) {
+      return NULL;
+    }
+  }
+  const TSNode name = ts_node_child_by_field_name(instruction, "mnemonic", 8);
+  if (ts_node_is_null(name)) {
+    return NULL;
+  }
+  char mnemonic[OPERAND_MAX];
+  lower_text(name, source, mnemonic, sizeof(mnemonic));
+
+  char exact[2][OPERAND_MAX];
+  char class[2][OPERAND_MAX];
+  unsigned count = 0;
+  const uint32_t children = ts_node_named_child_count(instruction);
+  for (uint32_t i = 0; i < children; i++) {
+    const TSNode child = ts_node_named_child(instruction, i);
+    if (is_type(child, "instruction_name")) {
+      continue;
+    }
+    const bool list = is_type(child, "operand_list");
+    const uint32_t operands = list ? ts_node_named_child_count(child) : 1;
+    for (uint32_t j = 0; j < operands; j++) {
+      if (count == 2) {
+        return NULL;
+      }
+      operand(list ? ts_node_named_child(child, j) : child, source,
+              exact[count], class[count]);
+      count++;
+    }
+  }
+  // push and pop take af where the other rr forms take sp
+  if (count == 1 && strcmp(exact[0], "sp") == 0 &&
+      (strcmp(mnemonic, "push") == 0 || strcmp(mnemonic, "pop") == 0)) {
+    return NULL;
+  }
+  if (count == 2 && is_alu(mnemonic) && strcmp(exact[0], "a") == 0) {
+    strcpy(exact[0], exact[1]);
+    strcpy(class[0], class[1]);
+    count = 1;
+  }
+
+  char form[FORM_MAX];
+  const RgbasmSm83Form *found = NULL;
+  if (count == 0) {
+    found = find(mnemonic);
+  } else if (count == 1) {
+    for (unsigned k = 0; k < 2 && found == NULL; k++) {
+      snprintf(form, sizeof(form), "%s %s", mnemonic,
+               k == 0 ? exact[0] : class[0]);
+      found = find(form);
+    }
+  } else {
+    // exact/exact, exact/class, class/exact, class/class
+    for (unsigned k = 0; k < 4 && found == NULL; k++) {
+      snprintf(form, sizeof(form), "%s %s,%s", mnemonic,
+               k < 2 ? exact[0] : class[0], k % 2 ? class[1] : exact[1]);
+      found = find(form);
+    }
+  }
+  return found;
+}
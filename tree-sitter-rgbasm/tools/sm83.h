@@ -0,0 +1,28 @@
+#ifndef RGBASM_TOOLS_SM83_H_
+#define RGBASM_TOOLS_SM83_H_
+
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// SM83 encodings of instruction nodes.
+//
+// Forms are keyed like lua/rgbds/instructions.lua keys them, the table is
+// generated by scripts/update-sm83.py.
+
+typedef struct RgbasmSm83Form {
+  const char *form; // e.g. "ld r,[hl]"
+  uint8_t bytes;
+  uint8_t cycles;       // M-cycles
+  uint8_t taken_cycles; // if a condition is true, else `cycles`
+  const char *flags;    // Z N H C: set by the result, 0, 1 or - if kept
+} RgbasmSm83Form;
+
+// The form of an `instruction` node, or of the instruction it wraps. NULL for
+// forms the CPU does not have and for instructions with missing parts.
+const RgbasmSm83Form *rgbasm_sm83_lookup(TSNode instruction,
+                                         const char *source);
+
+// The form keyed `form`, e.g. "xor r", NULL if the CPU does not have it.
+const RgbasmSm83Form *rgbasm_sm83_form(const char *form);
+
+#endif // RGBASM_TOOLS_SM83_H_
@@ -0,0 +1,117 @@
+// WARN: script-generated by scripts/update-sm83.py. Do not edit directly.
+// SM83 instruction forms as keyed by sm83.c, sorted for bsearch.
+
+static const RgbasmSm83Form rgbasm_sm83_forms[] = {
+  {"adc [hl]", 1, 2, 2, "Z0HC"},
+  {"adc n", 2, 2, 2, "Z0HC"},
+  {"adc r", 1, 1, 1, "Z0HC"},
+  {"add [hl]", 1, 2, 2, "Z0HC"},
+  {"add hl,rr", 1, 2, 2, "-0HC"},
+  {"add n", 2, 2, 2, "Z0HC"},
+  {"add r", 1, 1, 1, "Z0HC"},
+  {"add sp,n", 2, 4, 4, "00HC"},
+  {"and [hl]", 1, 2, 2, "Z010"},
+  {"and n", 2, 2, 2, "Z010"},
+  {"and r", 1, 1, 1, "Z010"},
+  {"bit n,[hl]", 2, 3, 3, "Z01-"},
+  {"bit n,r", 2, 2, 2, "Z01-"},
+  {"call cc,n", 3, 3, 6, "----"},
+  {"call n", 3, 6, 6, "----"},
+  {"ccf", 1, 1, 1, "-00C"},
+  {"cp [hl]", 1, 2, 2, "Z1HC"},
+  {"cp n", 2, 2, 2, "Z1HC"},
+  {"cp r", 1, 1, 1, "Z1HC"},
+  {"cpl", 1, 1, 1, "-11-"},
+  {"daa", 1, 1, 1, "Z-0C"},
+  {"dec [hl]", 1, 3, 3, "Z1H-"},
+  {"dec r", 1, 1, 1, "Z1H-"},
+  {"dec rr", 1, 2, 2, "----"},
+  {"di", 1, 1, 1, "----"},
+  {"ei", 1, 1, 1, "----"},
+  {"halt", 1, 1, 1, "----"},
+  {"inc [hl]", 1, 3, 3, "Z0H-"},
+  {"inc r", 1, 1, 1, "Z0H-"},
+  {"inc rr", 1, 2, 2, "----"},
+  {"jp cc,n", 3, 3, 4, "----"},
+  {"jp hl", 1, 1, 1, "----"},
+  {"jp n", 3, 4, 4, "----"},
+  {"jr cc,n", 2, 2, 3, "----"},
+  {"jr n", 2, 3, 3, "----"},
+  {"ld [bc],a", 1, 2, 2, "----"},
+  {"ld [c],a", 1, 2, 2, "----"},
+  {"ld [de],a", 1, 2, 2, "----"},
+  {"ld [hl],n", 2, 3, 3, "----"},
+  {"ld [hl],r", 1, 2, 2, "----"},
+  {"ld [hld],a", 1, 2, 2, "----"},
+  {"ld [hli],a", 1, 2, 2, "----"},
+  {"ld [n],a", 3, 4, 4, "----"},
+  {"ld [n],sp", 3, 5, 5, "----"},
+  {"ld a,[bc]", 1, 2, 2, "----"},
+  {"ld a,[c]", 1, 2, 2, "----"},
+  {"ld a,[de]", 1, 2, 2, "----"},
+  {"ld a,[hld]", 1, 2, 2, "----"},
+  {"ld a,[hli]", 1, 2, 2, "----"},
+  {"ld a,[n]", 3, 4, 4, "----"},
+  {"ld hl,sp+n", 2, 3, 3, "00HC"},
+  {"ld r,[hl]", 1, 2, 2, "----"},
+  {"ld r,n", 2, 2, 2, "----"},
+  {"ld r,r", 1, 1, 1, "----"},
+  {"ld rr,n", 3, 3, 3, "----"},
+  {"ld sp,hl", 1, 2, 2, "----"},
+  {"ldd [hl],a", 1, 2, 2, "----"},
+  {"ldd a,[hl]", 1, 2, 2, "----"},
+  {"ldh [c],a", 1, 2, 2, "----"},
+  {"ldh [n],a", 2, 3, 3, "----"},
+  {"ldh a,[c]", 1, 2, 2, "----"},
+  {"ldh a,[n]", 2, 3, 3, "----"},
+  {"ldi [hl],a", 1, 2, 2, "----"},
+  {"ldi a,[hl]", 1, 2, 2, "----"},
+  {"nop", 1, 1, 1, "----"},
+  {"or [hl]", 1, 2, 2, "Z000"},
+  {"or n", 2, 2, 2, "Z000"},
+  {"or r", 1, 1, 1, "Z000"},
+  {"pop af", 1, 3, 3, "ZNHC"},
+  {"pop rr", 1, 3, 3, "----"},
+  {"push af", 1, 4, 4, "----"},
+  {"push rr", 1, 4, 4, "----"},
+  {"res n,[hl]", 2, 4, 4, "----"},
+  {"res n,r", 2, 2, 2, "----"},
+  {"ret", 1, 4, 4, "----"},
+  {"ret cc", 1, 2, 5, "----"},
+  {"reti", 1, 4, 4, "----"},
+  {"rl [hl]", 2, 4, 4, "Z00C"},
+  {"rl r", 2, 2, 2, "Z00C"},
+  {"rla", 1, 1, 1, "000C"},
+  {"rlc [hl]", 2, 4, 4, "Z00C"},
+  {"rlc r", 2, 2, 2, "Z00C"},
+  {"rlca", 1, 1, 1, "000C"},
+  {"rr [hl]", 2, 4, 4, "Z00C"},
+  {"rr r", 2, 2, 2, "Z00C"},
+  {"rra", 1, 1, 1, "000C"},
+  {"rrc [hl]", 2, 4, 4, "Z00C"},
+  {"rrc r", 2, 2, 2, "Z00C"},
+  {"rrca", 1, 1, 1, "000C"},
+  {"rst n", 1, 4, 4, "----"},
+  {"sbc [hl]", 1, 2, 2, "Z1HC"},
+  {"sbc n", 2, 2, 2, "Z1HC"},
+  {"sbc r", 1, 1, 1, "Z1HC"},
+  {"scf", 1, 1, 1, "-001"},
+  {"set n,[hl]", 2, 4, 4, "----"},
+  {"set n,r", 2, 2, 2, "----"},
+  {"sla [hl]", 2, 4, 4, "Z00C"},
+  {"sla r", 2, 2, 2, "Z00C"},
+  {"sra [hl]", 2, 4, 4, "Z00C"},
+  {"sra r", 2, 2, 2, "Z00C"},
+  {"srl [hl]", 2, 4, 4, "Z00C"},
+  {"srl r", 2, 2, 2, "Z00C"},
+  {"stop", 2, 1, 1, "----"},
+  {"stop n", 2, 1, 1, "----"},
+  {"sub [hl]", 1, 2, 2, "Z1HC"},
+  {"sub n", 2, 2, 2, "Z1HC"},
+  {"sub r", 1, 1, 1, "Z1HC"},
+  {"swap [hl]", 2, 4, 4, "Z000"},
+  {"swap r", 2, 2, 2, "Z000"},
+  {"xor [hl]", 1, 2, 2, "Z000"},
+  {"xor n", 2, 2, 2, "Z000"},
+  {"xor r", 1, 1, 1, "Z000"},
+};
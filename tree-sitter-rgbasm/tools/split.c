@@ -0,0 +1,201 @@
+// Parses a single large file in parallel, split at top-level SECTION lines.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "section_split.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/tree-sitter-rgbasm.h>
+#include <unistd.h>
+
+typedef enum Mode {
+  MODE_OUTLINE,
+  MODE_RANGES,
+  MODE_BENCH,
+  MODE_CHECK,
+} Mode;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [--min-chunk bytes] "
+          "[--outline | --ranges | --bench | --check] file\n"
+          "\n"
+          "  --outline  print sections, labels, constants and macros "
+          "(default)\n"
+          "  --ranges   print the chunk ranges\n"
+          "  --bench    compare against a single threaded parse\n"
+          "  --check    compare the outline and the subtree of every entry\n"
+          "             with those of a single threaded parse, print the\n"
+          "             entries that differ and `chunks N entries M same`\n"
+          "             or `different`\n",
+          argv0);
+}
+
+static void print_entry(const char *path, const char *data,
+                        const RgbasmOutlineEntry *entry) {
+  const TSPoint point = ts_node_start_point(entry->node);
+  printf("%s:%u:%u: %s %.*s\n", path, point.row + 1, point.column + 1,
+         entry->kind, (int)(entry->name_end - entry->name_start),
+         data + entry->name_start);
+}
+
+// Whether two outline entries name the same thing with the same subtree.
+static bool same_entry(const RgbasmOutlineEntry *a,
+                       const RgbasmOutlineEntry *b) {
+  if (strcmp(a->kind, b->kind) != 0 || a->name_start != b->name_start ||
+      a->name_end != b->name_end ||
+      ts_node_start_byte(a->node) != ts_node_start_byte(b->node) ||
+      ts_node_end_byte(a->node) != ts_node_end_byte(b->node)) {
+    return false;
+  }
+  char *left = ts_node_string(a->node);
+  char *right = ts_node_string(b->node);
+  const bool same = strcmp(left, right) == 0;
+  free(left);
+  free(right);
+  return same;
+}
+
+// Compares the outline of `parse` with that of the file parsed as a single
+// chunk on this thread. Returns false if they differ.
+static bool check(const char *path, const Source *source,
+                  const RgbasmSplitParse *parse) {
+  RgbasmSplitParse whole;
+  if (!rgbasm_parse_split(source->data, source->length, 1, UINT32_MAX,
+                          &whole)) {
+    fprintf(stderr, "%s: parsing failed\n", path);
+    rgbasm_split_parse_free(&whole);
+    return false;
+  }
+  RgbasmOutlineEntry *split_entries;
+  RgbasmOutlineEntry *whole_entries;
+  const uint32_t split_count = rgbasm_split_outline(parse, &split_entries);
+  const uint32_t whole_count = rgbasm_split_outline(&whole, &whole_entries);
+  bool same = split_count == whole_count;
+  for (uint32_t i = 0; i < split_count || i < whole_count; i++) {
+    if (i < split_count && i < whole_count &&
+        same_entry(&split_entries[i], &whole_entries[i])) {
+      continue;
+    }
+    same = false;
+    if (i < split_count) {
+      printf("split\t");
+      print_entry(path, source->data, &split_entries[i]);
+    }
+    if (i < whole_count) {
+      printf("single\t");
+      print_entry(path, source->data, &whole_entries[i]);
+    }
+  }
+  printf("chunks\t%u\tentries\t%u\t%s\n", parse->count, split_count,
+         same ? "same" : "different");
+  free(split_entries);
+  free(whole_entries);
+  rgbasm_split_parse_free(&whole);
+  return same;
+}
+
+static double parse_whole(const Source *source) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, tree_sitter_rgbasm());
+  const double start = now_seconds();
+  TSTree *tree =
+      ts_parser_parse_string(parser, NULL, source->data, source->length);
+  const double elapsed = now_seconds() - start;
+  ts_tree_delete(tree);
+  ts_parser_delete(parser);
+  return elapsed;
+}
+
+int main(int argc, char **argv) {
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t min_chunk = 0;
+  Mode mode = MODE_OUTLINE;
+  const char *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--min-chunk") == 0 && i + 1 < argc) {
+      min_chunk = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--outline") == 0) {
+      mode = MODE_OUTLINE;
+    } else if (strcmp(argv[i], "--ranges") == 0) {
+      mode = MODE_RANGES;
+    } else if (strcmp(argv[i], "--bench") == 0) {
+      mode = MODE_BENCH;
+    } else if (strcmp(argv[i], "--check") == 0) {
+      mode = MODE_CHECK;
+    } else if (argv[i][0] == '-' || path != NULL) {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == NULL || threads < 1) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  Source source;
+  if (!source_read(path, &source)) {
+    fprintf(stderr, "%s: could not read file\n", path);
+    return 1;
+  }
+
+  const double start = now_seconds();
+  RgbasmSplitParse parse;
+  const bool ok = rgbasm_parse_split(source.data, source.length,
+                                     (unsigned)threads, min_chunk, &parse);
+  const double elapsed = now_seconds() - start;
+  if (!ok) {
+    fprintf(stderr, "%s: parsing failed\n", path);
+    rgbasm_split_parse_free(&parse);
+    source_free(&source);
+    return 1;
+  }
+
+  int status = 0;
+  switch (mode) {
+  case MODE_OUTLINE: {
+    RgbasmOutlineEntry *entries;
+    const uint32_t count = rgbasm_split_outline(&parse, &entries);
+    for (uint32_t i = 0; i < count; i++) {
+      print_entry(path, source.data, &entries[i]);
+    }
+    free(entries);
+    break;
+  }
+  case MODE_RANGES:
+    for (uint32_t i = 0; i < parse.count; i++) {
+      const TSRange *range = &parse.chunks[i].range;
+      const bool error = ts_node_has_error(ts_tree_root_node(parse.chunks[i].tree));
+      printf("%u-%u %u:%u-%u:%u%s\n", range->start_byte, range->end_byte,
+             range->start_point.row + 1, range->start_point.column + 1,
+             range->end_point.row + 1, range->end_point.column + 1,
+             error ? " (errors)" : "");
+    }
+    break;
+  case MODE_BENCH: {
+    const double whole = parse_whole(&source);
+    const double mib = (double)source.length / (1024.0 * 1024.0);
+    printf("chunks:      %u\n", parse.count);
+    printf("threads:     %ld\n", threads);
+    printf("single:      %.3f ms (%.2f MiB/s)\n", whole * 1e3, mib / whole);
+    printf("split:       %.3f ms (%.2f MiB/s)\n", elapsed * 1e3, mib / elapsed);
+    printf("speedup:     %.2fx\n", whole / elapsed);
+    break;
+  }
+  case MODE_CHECK:
+    status = check(path, &source, &parse) ? 0 : 1;
+    break;
+  }
+
+  rgbasm_split_parse_free(&parse);
+  source_free(&source);
+  return status;
+}
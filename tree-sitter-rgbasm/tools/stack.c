@@ -0,0 +1,287 @@
+// Reports the maximum stack depth of the entry point and the interrupt
+// handlers of a project. The stack of a Game Boy program is a few hundred
+// bytes of WRAM or HRAM and nothing notices when it overflows.
+//
+// The depth of a routine is the most it pushes below the stack pointer it
+// was entered with: push, pop, add sp and inc/dec sp along every path, plus
+// the return address and depth of every routine it calls. Routines are
+// computed once per program, from the control-flow graphs of tools/cfg.c.
+
+#include "cfg.h"
+#include "layout.h"
+#include "program.h"
+#include "report.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-j threads] [-I dir]... [-e label]... [-l bytes] [-v] "
+          "path...\n"
+          "\n"
+          "Prints `entry file:line bytes` for the code at $100, every\n"
+          "interrupt vector with code and every -e label; a handler counts\n"
+          "the return address the interrupt pushes. `total` is the entry\n"
+          "point with the deepest handler on top. Depths that are not exact\n"
+          "are lower bounds, e.g. `>=12`, followed by the first reason.\n"
+          "`ld sp, n` starts a new stack, the depth counts from there.\n"
+          "Macro invocations are not expanded.\n"
+          "\n"
+          "  -I dir    resolve INCLUDE and INCBIN paths in dir, like rgbasm\n"
+          "  -e label  also analyze the code starting at label\n"
+          "  -l bytes  the size of the stack: also print ok or over\n"
+          "  -v        also print `function name file:line bytes` for every\n"
+          "            routine the entries call, deepest first\n"
+          "\n"
+          "Exits with 1 if an entry is over the size given with -l.\n",
+          argv0);
+}
+
+typedef struct Depth {
+  int64_t bytes;
+  bool exact;
+  int32_t problem; // the instruction of the first reason it is not exact
+  const char *reason;
+} Depth;
+
+typedef struct Analysis {
+  const RgbasmProgram *program;
+  RgbasmRoutines routines; // those done are in `depths`
+  Depth *depths;           // per instruction, of the routine starting there
+} Analysis;
+
+static void problem(Depth *depth, int32_t instruction, const char *reason) {
+  if (depth->exact) {
+    depth->exact = false;
+    depth->problem = instruction;
+    depth->reason = reason;
+  }
+}
+
+#define UNREACHED INT64_MIN
+
+static Depth routine_depth(Analysis *analysis, int32_t entry) {
+  RgbasmCfg cfg;
+  switch (rgbasm_routines_begin(&analysis->routines, entry, &cfg)) {
+  case RGBASM_ROUTINE_DONE:
+    return analysis->depths[entry];
+  case RGBASM_ROUTINE_RUNNING:
+    return (Depth){.exact = false, .problem = entry, .reason = "recursion"};
+  case RGBASM_ROUTINE_UNSEEN:
+    break;
+  }
+  Depth result = {.exact = true, .problem = -1};
+  if (cfg.problem >= 0) {
+    problem(&result, cfg.problem, cfg.reason);
+  }
+
+  // the depth on entering every node, in reverse postorder: a node's
+  // predecessors along forward edges come first
+  int64_t *depth = malloc((cfg.node_count + 1) * sizeof(int64_t));
+  for (size_t v = 0; v < cfg.node_count; v++) {
+    depth[v] = UNREACHED;
+  }
+  depth[0] = 0;
+  for (size_t i = cfg.node_count; i-- > 0;) {
+    const uint32_t v = cfg.order[i];
+    if (depth[v] == UNREACHED) {
+      continue;
+    }
+    const RgbasmCfgNode *node = &cfg.nodes[v];
+    const RgbasmInstruction *self =
+        &analysis->program->instructions[node->instruction];
+    int64_t after = depth[v] + self->stack_delta;
+    if (self->stack_set) {
+      after = 0;
+    } else if (self->stack_unknown) {
+      problem(&result, node->instruction, "stack pointer set from a register");
+    }
+    const int64_t peak = after > depth[v] ? after : depth[v];
+    result.bytes = peak > result.bytes ? peak : result.bytes;
+
+    for (uint32_t j = 0; j < node->edge_count; j++) {
+      const RgbasmCfgEdge *edge = &cfg.edges[node->first_edge + j];
+      if (edge->callee >= 0) {
+        const Depth callee = routine_depth(analysis, edge->callee);
+        if (!callee.exact) {
+          problem(&result, callee.problem, callee.reason);
+        }
+        // the return address, then the callee below it
+        const int64_t call = depth[v] + 2 + callee.bytes;
+        result.bytes = call > result.bytes ? call : result.bytes;
+      } else if (self->flow == RGBASM_FLOW_CALL ||
+                 self->flow == RGBASM_FLOW_CALL_COND) {
+        const int64_t call = depth[v] + 2;
+        result.bytes = call > result.bytes ? call : result.bytes;
+      }
+      if (edge->to < 0) {
+        if (edge->instruction < 0 && after != 0 &&
+            (self->flow == RGBASM_FLOW_RETURN ||
+             self->flow == RGBASM_FLOW_RETURN_COND)) {
+          problem(&result, node->instruction,
+                  "return with a different stack depth than on entry");
+        }
+        continue;
+      }
+      if (edge->back) {
+        // unless the loop starts over with a new stack
+        if (after > depth[edge->to] &&
+            !analysis->program->instructions[edge->instruction].stack_set) {
+          problem(&result, node->instruction, "stack growing in a loop");
+        }
+      } else if (depth[edge->to] == UNREACHED) {
+        depth[edge->to] = after;
+      } else if (depth[edge->to] != after) {
+        problem(&result, cfg.nodes[edge->to].instruction,
+                "paths joining with different stack depths");
+        depth[edge->to] =
+            after > depth[edge->to] ? after : depth[edge->to];
+      }
+    }
+  }
+
+  free(depth);
+  analysis->depths[entry] = result;
+  rgbasm_routines_end(&analysis->routines, entry, &cfg);
+  return result;
+}
+
+// Returns true if `depth` is over a given limit.
+static bool print_entry(const RgbasmProgram *program, const char *name,
+                        int32_t entry, const Depth *depth, int64_t limit) {
+  const bool over = limit >= 0 && depth->bytes > limit;
+  printf("%s\t", name);
+  if (entry >= 0) {
+    rgbasm_report_location(program, entry);
+  }
+  printf("\t%s%lld", depth->exact ? "" : ">=", (long long)depth->bytes);
+  if (limit >= 0) {
+    printf("\t%s", over ? "over" : "ok");
+  }
+  rgbasm_report_reason(program, depth->exact, depth->reason, depth->problem);
+  printf("\n");
+  return over;
+}
+
+static void print_routines(const Analysis *analysis) {
+  const RgbasmProgram *program = analysis->program;
+  RgbasmRanked *ranked =
+      malloc((program->instruction_count + 1) * sizeof(RgbasmRanked));
+  size_t count = 0;
+  for (size_t i = 0; i < program->instruction_count; i++) {
+    if (analysis->routines.state[i] == RGBASM_ROUTINE_DONE) {
+      const Depth *depth = &analysis->depths[i];
+      ranked[count++] = (RgbasmRanked){(int32_t)i, depth->bytes, depth->exact};
+    }
+  }
+  rgbasm_report_routines(program, ranked, count);
+  free(ranked);
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = 0;
+  bool verbose = false;
+  int64_t limit = -1;
+  const char **include_dirs = calloc((size_t)argc, sizeof(char *));
+  size_t include_dir_count = 0;
+  const char **entries = calloc((size_t)argc, sizeof(char *));
+  size_t entry_count = 0;
+  PathList paths = {0};
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = (unsigned)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      include_dirs[include_dir_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      entries[entry_count++] = argv[++i];
+    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+      limit = strtoll(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      usage(argv[0]);
+      return 0;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const RgbasmLayoutOptions options = {
+      .include_dirs = include_dirs,
+      .include_dir_count = include_dir_count,
+  };
+  RgbasmProgram program;
+  bool ok = rgbasm_program_build(&program, (const char *const *)paths.items,
+                                 paths.count, threads, &options);
+  Analysis analysis = {
+      .program = &program,
+      .depths = calloc(program.instruction_count + 1, sizeof(Depth)),
+  };
+  rgbasm_routines_init(&analysis.routines, &program);
+
+  bool over = false;
+  const int32_t start = rgbasm_report_rom0_at(&program, 0x100);
+  Depth main_depth = {.exact = true, .problem = -1};
+  if (start >= 0) {
+    main_depth = routine_depth(&analysis, start);
+    over |= print_entry(&program, "start", start, &main_depth, limit);
+  }
+
+  Depth deepest = {.bytes = 0, .exact = true, .problem = -1};
+  for (size_t i = 0; i < RGBASM_VECTOR_COUNT; i++) {
+    const int32_t entry =
+        rgbasm_report_rom0_at(&program, rgbasm_vectors[i].address);
+    if (entry < 0) {
+      continue;
+    }
+    Depth depth = routine_depth(&analysis, entry);
+    depth.bytes += 2; // the return address the interrupt pushes
+    over |=
+        print_entry(&program, rgbasm_vectors[i].name, entry, &depth, limit);
+    if (depth.bytes > deepest.bytes || (depth.bytes == deepest.bytes &&
+                                        !depth.exact)) {
+      deepest = depth;
+    }
+  }
+  for (size_t i = 0; i < entry_count; i++) {
+    const int32_t label = rgbasm_program_label(&program, entries[i]);
+    const int32_t entry = label >= 0 ? program.labels[label].instruction : -1;
+    if (entry < 0) {
+      fprintf(stderr, "%s: no code at this label\n", entries[i]);
+      ok = false;
+      continue;
+    }
+    const Depth depth = routine_depth(&analysis, entry);
+    over |= print_entry(&program, entries[i], entry, &depth, limit);
+  }
+  if (start >= 0) {
+    Depth total = main_depth;
+    total.bytes += deepest.bytes;
+    if (!deepest.exact) {
+      problem(&total, deepest.problem, deepest.reason);
+    }
+    over |= print_entry(&program, "total", -1, &total, limit);
+  }
+  if (verbose) {
+    print_routines(&analysis);
+  }
+
+  free(analysis.depths);
+  rgbasm_routines_free(&analysis.routines);
+  rgbasm_program_free(&program);
+  path_list_free(&paths);
+  free(include_dirs);
+  free(entries);
+  return ok && !over ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+#include "symbols.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Walk {
+  RgbasmFileSymbols *out;
+  const char *source;
+  TSTreeCursor cursor;
+  uint32_t scope; // name of the enclosing global label
+  uint8_t flags;
+} Walk;
+
+void rgbasm_file_symbols_init(RgbasmFileSymbols *self) {
+  *self = (RgbasmFileSymbols){0};
+  rgbasm_file_symbols_add_string(self, "", 0);
+}
+
+void rgbasm_file_symbols_free(RgbasmFileSymbols *self) {
+  free(self->strings);
+  free(self->symbols);
+  free(self->references);
+  free(self->includes);
+  *self = (RgbasmFileSymbols){0};
+}
+
+// A copy of `count` items of `size` bytes, NULL for none.
+static void *copy_items(const void *items, size_t count, size_t size) {
+  if (count == 0) {
+    return NULL;
+  }
+  void *copy = malloc(count * size);
+  memcpy(copy, items, count * size);
+  return copy;
+}
+
+void rgbasm_file_symbols_copy(RgbasmFileSymbols *self,
+                              const RgbasmFileSymbols *from) {
+  *self = (RgbasmFileSymbols){
+      .strings = copy_items(from->strings, from->strings_length, 1),
+      .strings_length = from->strings_length,
+      .strings_capacity = from->strings_length,
+      .symbols = copy_items(from->symbols, from->symbol_count,
+                            sizeof(RgbasmSymbol)),
+      .symbol_count = from->symbol_count,
+      .symbol_capacity = from->symbol_count,
+      .references = copy_items(from->references, from->reference_count,
+                               sizeof(RgbasmReference)),
+      .reference_count = from->reference_count,
+      .reference_capacity = from->reference_count,
+      .includes = copy_items(from->includes, from->include_count,
+                             sizeof(RgbasmInclude)),
+      .include_count = from->include_count,
+      .include_capacity = from->include_count,
+  };
+}
+
+uint32_t rgbasm_file_symbols_add_string(RgbasmFileSymbols *self,
+                                        const char *data, uint32_t length) {
+  if (self->strings_length + length + 1 > self->strings_capacity) {
+    uint32_t capacity = self->strings_capacity ? self->strings_capacity : 256;
+    while (self->strings_length + length + 1 > capacity) {
+      capacity *= 2;
+    }
+    self->strings = realloc(self->strings, capacity);
+    self->strings_capacity = capacity;
+  }
+  const uint32_t offset = self->strings_length;
+  if (data != NULL) {
+    memcpy(self->strings + offset, data, length);
+  }
+  self->strings[offset + length] = '\0';
+  self->strings_length += length + 1;
+  return offset;
+}
+
+const char *rgbasm_symbol_kind_name(RgbasmSymbolKind kind) {
+  static const char *const names[RGBASM_SYMBOL_KIND_COUNT] = {
+      "label",  "local", "constant", "variable",
+      "string", "macro", "section",  "export",
+  };
+  return kind < RGBASM_SYMBOL_KIND_COUNT ? names[kind] : "unknown";
+}
+
+static bool is_type(TSNode node, const char *type) {
+  return strcmp(ts_node_type(node), type) == 0;
+}
+
+static TSNode field(TSNode node, const char *name) {
+  return ts_node_child_by_field_name(node, name, (uint32_t)strlen(name));
+}
+
+static uint32_t add_node_text(Walk *walk, TSNode node) {
+  const uint32_t start = ts_node_start_byte(node);
+  return rgbasm_file_symbols_add_string(walk->out, walk->source + start,
+                                        ts_node_end_byte(node) - start);
+}
+
+// The contents of a string or raw string literal.
+static uint32_t add_string_contents(Walk *walk, TSNode node) {
+  uint32_t start = ts_node_start_byte(node);
+  uint32_t end = ts_node_end_byte(node);
+  const char *source = walk->source;
+  if (start < end && source[start] == '#') {
+    start++;
+  }
+  uint32_t quotes = 0;
+  while (quotes < 3 && start + quotes < end && source[start + quotes] == '"') {
+    quotes++;
+  }
+  // `""` is an empty regular string, not an opening triple quote
+  if (quotes == 2) {
+    quotes = 1;
+  }
+  if (end - start >= 2 * quotes) {
+    start += quotes;
+    end -= quotes;
+  }
+  return rgbasm_file_symbols_add_string(walk->out, source + start, end - start);
+}
+
+// A local label with its parent, e.g. `Parent.local` for `.local`.
+static uint32_t add_local_name(Walk *walk, TSNode name) {
+  if (walk->scope == 0) {
+    return add_node_text(walk, name);
+  }
+  RgbasmFileSymbols *out = walk->out;
+  const uint32_t start = ts_node_start_byte(name);
+  const uint32_t length = ts_node_end_byte(name) - start;
+  const uint32_t scope_length = (uint32_t)strlen(out->strings + walk->scope);
+  const uint32_t offset =
+      rgbasm_file_symbols_add_string(out, NULL, scope_length + length);
+  memcpy(out->strings + offset, out->strings + walk->scope, scope_length);
+  memcpy(out->strings + offset + scope_length, walk->source + start, length);
+  return offset;
+}
+
+static void push(Walk *walk, RgbasmSymbolKind kind, uint32_t name,
+                 uint32_t scope, uint8_t flags, TSNode node) {
+  RgbasmFileSymbols *out = walk->out;
+  if (out->symbol_count == out->symbol_capacity) {
+    out->symbol_capacity = out->symbol_capacity ? out->symbol_capacity * 2 : 64;
+    out->symbols =
+        realloc(out->symbols, out->symbol_capacity * sizeof(RgbasmSymbol));
+  }
+  out->symbols[out->symbol_count++] = (RgbasmSymbol){
+      .name = name,
+      .scope = scope,
+      .kind = (uint8_t)kind,
+      .flags = flags | walk->flags,
+      .point = ts_node_start_point(node),
+      .start_byte = ts_node_start_byte(node),
+      .end_byte = ts_node_end_byte(node),
+  };
+}
+
+static void push_reference(Walk *walk, uint32_t name, uint8_t flags,
+                           TSNode node) {
+  RgbasmFileSymbols *out = walk->out;
+  if (out->reference_count == out->reference_capacity) {
+    out->reference_capacity =
+        out->reference_capacity ? out->reference_capacity * 2 : 256;
+    out->references = realloc(out->references,
+                              out->reference_capacity * sizeof(RgbasmReference));
+  }
+  out->references[out->reference_count++] = (RgbasmReference){
+      .name = name,
+      .flags = flags | (walk->flags & RGBASM_SYMBOL_IN_MACRO
+                            ? RGBASM_REFERENCE_IN_MACRO
+                            : 0),
+      .point = ts_node_start_point(node),
+      .start_byte = ts_node_start_byte(node),
+      .end_byte = ts_node_end_byte(node),
+  };
+}
+
+static void push_include(Walk *walk, TSNode node) {
+  TSNode path = {0};
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(node, i);
+    if (is_type(child, "argument_list")) {
+      path = ts_node_named_child(child, 0);
+      break;
+    }
+  }
+  if (ts_node_is_null(path) || !(is_type(path, "string_literal") ||
+                                 is_type(path, "raw_string_literal"))) {
+    return;
+  }
+  RgbasmFileSymbols *out = walk->out;
+  if (out->include_count == out->include_capacity) {
+    out->include_capacity =
+        out->include_capacity ? out->include_capacity * 2 : 8;
+    out->includes =
+        realloc(out->includes, out->include_capacity * sizeof(RgbasmInclude));
+  }
+  out->includes[out->include_count++] = (RgbasmInclude){
+      .name = add_string_contents(walk, path),
+      .point = ts_node_start_point(path),
+  };
+}
+
+static void visit(Walk *walk);
+
+static void visit_children(Walk *walk) {
+  if (!ts_tree_cursor_goto_first_child(&walk->cursor)) {
+    return;
+  }
+  do {
+    visit(walk);
+  } while (ts_tree_cursor_goto_next_sibling(&walk->cursor));
+  ts_tree_cursor_goto_parent(&walk->cursor);
+}
+
+static void visit_local_label(Walk *walk, TSNode node) {
+  const TSNode name = field(node, "name");
+  if (ts_node_is_null(name)) {
+    return;
+  }
+  if (is_type(name, "qualified_symbol")) {
+    // `Parent.local`, the parent is the text before the first dot
+    const uint32_t start = ts_node_start_byte(name);
+    const char *text = walk->source + start;
+    const char *dot = memchr(text, '.', ts_node_end_byte(name) - start);
+    const uint32_t scope =
+        dot ? rgbasm_file_symbols_add_string(walk->out, text,
+                                             (uint32_t)(dot - text))
+            : 0;
+    push(walk, RGBASM_SYMBOL_LOCAL, add_node_text(walk, name), scope, 0, name);
+  } else {
+    push(walk, RGBASM_SYMBOL_LOCAL, add_local_name(walk, name), walk->scope, 0,
+         name);
+  }
+}
+
+static void visit_def(Walk *walk, TSNode node) {
+  const TSNode name = field(node, "name");
+  if (ts_node_is_null(name)) {
+    return;
+  }
+  RgbasmSymbolKind kind = RGBASM_SYMBOL_VARIABLE;
+  const TSNode assign = field(node, "assign_type");
+  if (!ts_node_is_null(assign)) {
+    if (is_type(assign, "equ_keyword") || is_type(assign, "r_keyword")) {
+      kind = RGBASM_SYMBOL_CONSTANT;
+    } else if (is_type(assign, "equs_keyword")) {
+      kind = RGBASM_SYMBOL_STRING;
+    }
+  }
+  push(walk, kind, add_node_text(walk, name), 0, 0, name);
+}
+
+static void visit_export(Walk *walk, TSNode node) {
+  const uint32_t count = ts_node_named_child_count(node);
+  for (uint32_t i = 0; i < count; i++) {
+    const TSNode child = ts_node_named_child(node, i);
+    if (is_type(child, "def_directive")) {
+      const uint8_t flags = walk->flags;
+      walk->flags |= RGBASM_SYMBOL_EXPORTED;
+      visit_def(walk, child);
+      walk->flags = flags;
+    } else if (is_type(child, "argument_list")) {
+      const uint32_t argument_count = ts_node_named_child_count(child);
+      for (uint32_t j = 0; j < argument_count; j++) {
+        const TSNode name = ts_node_named_child(child, j);
+        if (is_type(name, "variable") || is_type(name, "qualified_symbol")) {
+          push(walk, RGBASM_SYMBOL_EXPORT, add_node_text(walk, name), 0, 0,
+               name);
+        } else if (is_type(name, "local_symbol")) {
+          push(walk, RGBASM_SYMBOL_EXPORT, add_local_name(walk, name),
+               walk->scope, 0, name);
+        }
+      }
+    }
+  }
+}
+
+static void visit(Walk *walk) {
+  const TSNode node = ts_tree_cursor_current_node(&walk->cursor);
+  if (!ts_node_is_named(node)) {
+    return;
+  }
+  // the name of a label, constant, macro or section is not a use of it
+  const char *field_name = ts_tree_cursor_current_field_name(&walk->cursor);
+  if (field_name != NULL && strcmp(field_name, "name") == 0) {
+    return;
+  }
+  const char *type = ts_node_type(node);
+
+  if (strcmp(type, "global_label_block") == 0) {
+    const TSNode name = field(node, "name");
+    if (ts_node_is_null(name)) {
+      visit_children(walk);
+      return;
+    }
+    const TSNode colon = ts_node_next_sibling(name);
+    const uint8_t flags = !ts_node_is_null(colon) && is_type(colon, "::")
+                              ? RGBASM_SYMBOL_EXPORTED
+                              : 0;
+    const uint32_t label = add_node_text(walk, name);
+    push(walk, RGBASM_SYMBOL_LABEL, label, 0, flags, name);
+    const uint32_t scope = walk->scope;
+    walk->scope = label;
+    visit_children(walk);
+    walk->scope = scope;
+  } else if (strcmp(type, "local_label_block") == 0) {
+    visit_local_label(walk, node);
+    visit_children(walk);
+  } else if (strcmp(type, "def_directive") == 0) {
+    visit_def(walk, node);
+    visit_children(walk);
+  } else if (strcmp(type, "export_directive") == 0) {
+    visit_export(walk, node);
+  } else if (strcmp(type, "macro_invocation") == 0) {
+    const TSNode name = ts_node_named_child(node, 0);
+    if (!ts_node_is_null(name) && is_type(name, "variable")) {
+      push_reference(walk, add_node_text(walk, name),
+                     RGBASM_REFERENCE_MACRO_CALL, name);
+    }
+    // the arguments, without the name again
+    if (ts_tree_cursor_goto_first_child(&walk->cursor)) {
+      while (ts_tree_cursor_goto_next_sibling(&walk->cursor)) {
+        visit(walk);
+      }
+      ts_tree_cursor_goto_parent(&walk->cursor);
+    }
+  } else if (strcmp(type, "variable") == 0 ||
+             strcmp(type, "qualified_symbol") == 0) {
+    push_reference(walk, add_node_text(walk, node), 0, node);
+  } else if (strcmp(type, "local_symbol") == 0) {
+    push_reference(walk, add_local_name(walk, node), 0, node);
+  } else if (strcmp(type, "include_directive") == 0) {
+    push_include(walk, node);
+  } else if (strcmp(type, "macro_definition") == 0) {
+    const TSNode name = field(node, "name");
+    if (!ts_node_is_null(name)) {
+      push(walk, RGBASM_SYMBOL_MACRO, add_node_text(walk, name), 0, 0, name);
+    }
+    const uint8_t flags = walk->flags;
+    walk->flags |= RGBASM_SYMBOL_IN_MACRO;
+    visit_children(walk);
+    walk->flags = flags;
+  } else if (strcmp(type, "section_block") == 0) {
+    const TSNode directive = ts_node_named_child(node, 0);
+    const TSNode name = field(directive, "name");
+    if (!ts_node_is_null(name) && (is_type(name, "string_literal") ||
+                                   is_type(name, "raw_string_literal"))) {
+      push(walk, RGBASM_SYMBOL_SECTION, add_string_contents(walk, name), 0, 0,
+           name);
+    }
+    // labels do not carry over into a new section
+    const uint32_t scope = walk->scope;
+    walk->scope = 0;
+    visit_children(walk);
+    walk->scope = scope;
+  } else {
+    // operands, arguments and expressions may use any symbol
+    visit_children(walk);
+  }
+}
+
+void rgbasm_extract_symbols(RgbasmFileSymbols *self, TSNode root,
+                            const char *source) {
+  Walk walk = {
+      .out = self,
+      .source = source,
+      .cursor = ts_tree_cursor_new(root),
+  };
+  visit(&walk);
+  ts_tree_cursor_delete(&walk.cursor);
+}
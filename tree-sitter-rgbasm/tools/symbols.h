@@ -0,0 +1,95 @@
+#ifndef RGBASM_TOOLS_SYMBOLS_H_
+#define RGBASM_TOOLS_SYMBOLS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// Definitions, references, exports and includes of one rgbasm file, extracted
+// from its syntax tree.
+
+typedef enum RgbasmSymbolKind {
+  RGBASM_SYMBOL_LABEL,    // Global: and Global::
+  RGBASM_SYMBOL_LOCAL,    // .local and Parent.local
+  RGBASM_SYMBOL_CONSTANT, // DEF name EQU / RB / RW / RL
+  RGBASM_SYMBOL_VARIABLE, // DEF name = ...
+  RGBASM_SYMBOL_STRING,   // DEF name EQUS ...
+  RGBASM_SYMBOL_MACRO,
+  RGBASM_SYMBOL_SECTION,
+  RGBASM_SYMBOL_EXPORT, // a name listed by EXPORT
+  RGBASM_SYMBOL_KIND_COUNT,
+} RgbasmSymbolKind;
+
+enum {
+  RGBASM_SYMBOL_EXPORTED = 1 << 0, // `::` or EXPORT DEF
+  RGBASM_SYMBOL_IN_MACRO = 1 << 1, // defined when the macro is expanded
+};
+
+// Names are offsets into the string pool of their RgbasmFileSymbols. Local
+// labels are stored qualified (`Parent.local`) when their parent label is
+// known; `scope` is the parent's name, or 0 for none.
+typedef struct RgbasmSymbol {
+  uint32_t name;
+  uint32_t scope;
+  uint8_t kind;
+  uint8_t flags;
+  uint16_t reserved;
+  TSPoint point;
+  uint32_t start_byte;
+  uint32_t end_byte;
+} RgbasmSymbol;
+
+enum {
+  RGBASM_REFERENCE_MACRO_CALL = 1 << 0, // the name of a macro invocation
+  RGBASM_REFERENCE_IN_MACRO = 1 << 1,   // in the body of a macro definition
+};
+
+// A use of a symbol outside of its definition. Local names are qualified like
+// the definitions when their parent label is known.
+typedef struct RgbasmReference {
+  uint32_t name;
+  uint8_t flags;
+  uint8_t reserved[3];
+  TSPoint point;
+  uint32_t start_byte;
+  uint32_t end_byte;
+} RgbasmReference;
+
+typedef struct RgbasmInclude {
+  uint32_t name; // as written
+  TSPoint point;
+} RgbasmInclude;
+
+typedef struct RgbasmFileSymbols {
+  char *strings; // starts with an empty string, every name is NUL terminated
+  uint32_t strings_length;
+  uint32_t strings_capacity;
+  RgbasmSymbol *symbols;
+  uint32_t symbol_count;
+  uint32_t symbol_capacity;
+  RgbasmReference *references;
+  uint32_t reference_count;
+  uint32_t reference_capacity;
+  RgbasmInclude *includes;
+  uint32_t include_count;
+  uint32_t include_capacity;
+} RgbasmFileSymbols;
+
+void rgbasm_file_symbols_init(RgbasmFileSymbols *self);
+void rgbasm_file_symbols_free(RgbasmFileSymbols *self);
+// Makes `self` an independent copy of `from`.
+void rgbasm_file_symbols_copy(RgbasmFileSymbols *self,
+                              const RgbasmFileSymbols *from);
+
+// Appends the definitions, references, exports and includes below `root`.
+void rgbasm_extract_symbols(RgbasmFileSymbols *self, TSNode root,
+                            const char *source);
+
+// Appends `length` bytes plus a NUL and returns the offset. With `data` NULL
+// the bytes are left for the caller to fill.
+uint32_t rgbasm_file_symbols_add_string(RgbasmFileSymbols *self,
+                                        const char *data, uint32_t length);
+
+const char *rgbasm_symbol_kind_name(RgbasmSymbolKind kind);
+
+#endif // RGBASM_TOOLS_SYMBOLS_H_
@@ -0,0 +1,76 @@
+// Dumps the tokens of the lexer-only tokenizer, or measures its throughput.
+
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tree_sitter/tree-sitter-rgbasm-tokenizer.h>
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--bench] file...\n"
+          "\n"
+          "Prints `offset length class` for every token, or with --bench the\n"
+          "tokenizer throughput over all files.\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  bool bench = false;
+  PathList paths = {0};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bench") == 0) {
+      bench = true;
+    } else if (argv[i][0] == '-') {
+      usage(argv[0]);
+      return 2;
+    } else {
+      path_list_collect(&paths, argv[i]);
+    }
+  }
+  if (paths.count == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  RgbasmToken tokens[4096];
+  uint64_t bytes = 0;
+  uint64_t count = 0;
+  const double start = now_seconds();
+  for (size_t i = 0; i < paths.count; i++) {
+    RgbasmMappedFile file;
+    if (!rgbasm_map_file(paths.items[i], &file)) {
+      fprintf(stderr, "%s: could not map file\n", paths.items[i]);
+      continue;
+    }
+    RgbasmTokenizer tokenizer;
+    rgbasm_tokenizer_init(&tokenizer, file.data, (uint32_t)file.length);
+    uint32_t filled;
+    while ((filled = rgbasm_tokenizer_fill(&tokenizer, tokens,
+                                           sizeof(tokens) / sizeof(tokens[0]))) > 0) {
+      count += filled;
+      if (bench) {
+        continue;
+      }
+      for (uint32_t t = 0; t < filled; t++) {
+        printf("%u %u %s\n", tokens[t].offset, tokens[t].length,
+               rgbasm_token_class_name(tokens[t].token_class));
+      }
+    }
+    bytes += file.length;
+    rgbasm_unmap_file(&file);
+  }
+  const double elapsed = now_seconds() - start;
+
+  if (bench) {
+    printf("files:       %zu\n", paths.count);
+    printf("bytes:       %llu\n", (unsigned long long)bytes);
+    printf("tokens:      %llu\n", (unsigned long long)count);
+    printf("time:        %.3f ms\n", elapsed * 1e3);
+    printf("throughput:  %.2f MiB/s\n",
+           (double)bytes / (1024.0 * 1024.0) / elapsed);
+  }
+  path_list_free(&paths);
+  return 0;
+}
@@ -0,0 +1,193 @@
+#define _XOPEN_SOURCE 700 // realpath
+
+#include "util.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+bool source_read(const char *path, Source *source) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  if (fseek(file, 0, SEEK_END) != 0) {
+    fclose(file);
+    return false;
+  }
+  const long size = ftell(file);
+  if (size < 0 || size > UINT32_MAX - 1) {
+    fclose(file);
+    return false;
+  }
+  rewind(file);
+  char *data = malloc((size_t)size + 1);
+  if (data == NULL || fread(data, 1, (size_t)size, file) != (size_t)size) {
+    free(data);
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+  data[size] = '\0';
+  source->path = strdup(path);
+  source->data = data;
+  source->length = (uint32_t)size;
+  return true;
+}
+
+void source_free(Source *source) {
+  free(source->path);
+  free(source->data);
+  source->path = NULL;
+  source->data = NULL;
+  source->length = 0;
+}
+
+bool is_rgbasm_path(const char *path) {
+  static const char *const extensions[] = {
+      ".asm", ".s", ".inc", ".rgbasm", ".rgbinc", ".gbz80",
+  };
+  const char *dot = strrchr(path, '.');
+  if (dot == NULL || strchr(dot, '/') != NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+    if (strcmp(dot, extensions[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+char *path_canonical(const char *path) {
+  char *resolved = realpath(path, NULL);
+  if (resolved != NULL) {
+    return resolved;
+  }
+  char *dir = strdup(path);
+  char *slash = strrchr(dir, '/');
+  const char *name = path;
+  const char *parent = ".";
+  if (slash != NULL) {
+    name = path + (slash - dir) + 1;
+    *slash = '\0';
+    parent = slash == dir ? "/" : dir;
+  }
+  char *parent_path = realpath(parent, NULL);
+  if (parent_path != NULL) {
+    const size_t length = strlen(parent_path) + strlen(name) + 2;
+    resolved = malloc(length);
+    snprintf(resolved, length, "%s/%s",
+             strcmp(parent_path, "/") == 0 ? "" : parent_path, name);
+    free(parent_path);
+  }
+  free(dir);
+  return resolved;
+}
+
+void path_list_push(PathList *list, const char *path) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->items = realloc(list->items, list->capacity * sizeof(char *));
+  }
+  list->items[list->count++] = strdup(path);
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void collect_directory(PathList *list, const char *dir) {
+  DIR *handle = opendir(dir);
+  if (handle == NULL) {
+    return;
+  }
+  const size_t first = list->count;
+  struct dirent *entry;
+  while ((entry = readdir(handle)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    const size_t len = strlen(dir) + strlen(entry->d_name) + 2;
+    char *child = malloc(len);
+    snprintf(child, len, "%s/%s", dir, entry->d_name);
+    struct stat info;
+    if (stat(child, &info) == 0) {
+      if (S_ISDIR(info.st_mode)) {
+        collect_directory(list, child);
+      } else if (S_ISREG(info.st_mode) && is_rgbasm_path(child)) {
+        path_list_push(list, child);
+      }
+    }
+    free(child);
+  }
+  closedir(handle);
+  // keep the order stable across file systems
+  qsort(list->items + first, list->count - first, sizeof(char *),
+        compare_paths);
+}
+
+void path_list_collect(PathList *list, const char *path) {
+  struct stat info;
+  if (stat(path, &info) != 0) {
+    return;
+  }
+  if (S_ISDIR(info.st_mode)) {
+    collect_directory(list, path);
+  } else {
+    path_list_push(list, path);
+  }
+}
+
+void path_list_free(PathList *list) {
+  for (size_t i = 0; i < list->count; i++) {
+    free(list->items[i]);
+  }
+  free(list->items);
+  list->items = NULL;
+  list->count = 0;
+  list->capacity = 0;
+}
+
+void span_list_push(SpanList *list, const char *data, uint32_t length) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 256;
+    list->items = realloc(list->items, list->capacity * sizeof(Span));
+  }
+  list->items[list->count++] = (Span){data, length};
+  list->bytes += length;
+}
+
+void span_list_collect_nodes(SpanList *list, const char *data, TSNode root,
+                             const char *type) {
+  TSTreeCursor cursor = ts_tree_cursor_new(root);
+  for (;;) {
+    const TSNode node = ts_tree_cursor_current_node(&cursor);
+    if (strcmp(ts_node_type(node), type) == 0) {
+      const uint32_t start = ts_node_start_byte(node);
+      span_list_push(list, data + start, ts_node_end_byte(node) - start);
+    } else if (ts_tree_cursor_goto_first_child(&cursor)) {
+      continue;
+    }
+    while (!ts_tree_cursor_goto_next_sibling(&cursor)) {
+      if (!ts_tree_cursor_goto_parent(&cursor)) {
+        ts_tree_cursor_delete(&cursor);
+        return;
+      }
+    }
+  }
+}
+
+void span_list_free(SpanList *list) {
+  free(list->items);
+  *list = (SpanList){0};
+}
+
+double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
@@ -0,0 +1,61 @@
+#ifndef RGBASM_TOOLS_UTIL_H_
+#define RGBASM_TOOLS_UTIL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tree_sitter/api.h>
+
+// A source file loaded into memory. `data` is NUL terminated.
+typedef struct Source {
+  char *path;
+  char *data;
+  uint32_t length;
+} Source;
+
+typedef struct PathList {
+  char **items;
+  size_t count;
+  size_t capacity;
+} PathList;
+
+// A slice of a source, e.g. the text of a node.
+typedef struct Span {
+  const char *data;
+  uint32_t length;
+} Span;
+
+typedef struct SpanList {
+  Span *items;
+  size_t count;
+  size_t capacity;
+  uint64_t bytes;
+} SpanList;
+
+bool source_read(const char *path, Source *source);
+void source_free(Source *source);
+
+// Returns true for the file extensions the Neovim plugin treats as rgbasm.
+bool is_rgbasm_path(const char *path);
+
+// Appends `path` if it is a file, or every rgbasm file below it if it is a
+// directory. Hidden directories are skipped.
+void path_list_collect(PathList *list, const char *path);
+void path_list_push(PathList *list, const char *path);
+
+// The absolute path without symlinks, `.` or `..`. A file that does not exist
+// (any more) is resolved through its directory. NULL if that fails too.
+char *path_canonical(const char *path);
+void path_list_free(PathList *list);
+
+void span_list_push(SpanList *list, const char *data, uint32_t length);
+// Appends the text of every node of the given type below `root`, e.g. the
+// `identifier` nodes injected with the rgbasm_identifier grammar.
+void span_list_collect_nodes(SpanList *list, const char *data, TSNode root,
+                             const char *type);
+void span_list_free(SpanList *list);
+
+// Monotonic clock in seconds.
+double now_seconds(void);
+
+#endif // RGBASM_TOOLS_UTIL_H_
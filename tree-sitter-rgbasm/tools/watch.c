@@ -0,0 +1,192 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "watch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct Watched {
+  int wd;
+  char *dir;
+} Watched;
+
+struct RgbasmWatch {
+  int fd;
+  Watched *items;
+  size_t count;
+  size_t capacity;
+};
+
+RgbasmWatch *rgbasm_watch_new(void) {
+  const int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  RgbasmWatch *self = calloc(1, sizeof(RgbasmWatch));
+  self->fd = fd;
+  return self;
+}
+
+void rgbasm_watch_delete(RgbasmWatch *self) {
+  close(self->fd);
+  for (size_t i = 0; i < self->count; i++) {
+    free(self->items[i].dir);
+  }
+  free(self->items);
+  free(self);
+}
+
+static const char *watched_dir(const RgbasmWatch *self, int wd) {
+  for (size_t i = 0; i < self->count; i++) {
+    if (self->items[i].wd == wd) {
+      return self->items[i].dir;
+    }
+  }
+  return NULL;
+}
+
+static char *join(const char *dir, const char *name) {
+  const size_t length = strlen(dir) + strlen(name) + 2;
+  char *path = malloc(length);
+  snprintf(path, length, "%s/%s", dir, name);
+  return path;
+}
+
+// Watches `dir` and, with `changed`, reports the files already in it: they
+// were created before the watch existed.
+static bool watch_dir(RgbasmWatch *self, const char *dir, bool recursive,
+                      PathList *changed) {
+  const int wd = inotify_add_watch(
+      self->fd, dir,
+      IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+          IN_ONLYDIR);
+  if (wd < 0) {
+    return false;
+  }
+  if (watched_dir(self, wd) == NULL) {
+    if (self->count == self->capacity) {
+      self->capacity = self->capacity ? self->capacity * 2 : 64;
+      self->items = realloc(self->items, self->capacity * sizeof(Watched));
+    }
+    self->items[self->count++] = (Watched){wd, strdup(dir)};
+  }
+  if (!recursive && changed == NULL) {
+    return true;
+  }
+  DIR *handle = opendir(dir);
+  if (handle == NULL) {
+    return true;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(handle)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    char *child = join(dir, entry->d_name);
+    struct stat info;
+    if (stat(child, &info) == 0) {
+      if (S_ISDIR(info.st_mode) && recursive) {
+        watch_dir(self, child, true, changed);
+      } else if (S_ISREG(info.st_mode) && changed != NULL) {
+        path_list_push(changed, child);
+      }
+    }
+    free(child);
+  }
+  closedir(handle);
+  return true;
+}
+
+bool rgbasm_watch_add(RgbasmWatch *self, const char *dir, bool recursive) {
+  return watch_dir(self, dir, recursive, NULL);
+}
+
+static void push_unique(PathList *list, const char *path) {
+  for (size_t i = 0; i < list->count; i++) {
+    if (strcmp(list->items[i], path) == 0) {
+      return;
+    }
+  }
+  path_list_push(list, path);
+}
+
+bool rgbasm_watch_next(RgbasmWatch *self, PathList *changed, int settle_ms) {
+  // aligned for the events in it
+  _Alignas(struct inotify_event) char buffer[65536];
+  int timeout = -1;
+  for (;;) {
+    struct pollfd poll_fd = {.fd = self->fd, .events = POLLIN};
+    const int ready = poll(&poll_fd, 1, timeout);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (ready == 0) {
+      return true;
+    }
+    const ssize_t length = read(self->fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return false;
+    }
+    for (char *next = buffer; next < buffer + length;) {
+      const struct inotify_event *event = (const struct inotify_event *)next;
+      next += sizeof(struct inotify_event) + event->len;
+      const char *dir = watched_dir(self, event->wd);
+      // hidden files are editor swap and backup files
+      if (dir == NULL || event->len == 0 || event->name[0] == '.') {
+        continue;
+      }
+      char *path = join(dir, event->name);
+      if (!(event->mask & IN_ISDIR)) {
+        push_unique(changed, path);
+      } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        PathList files = {0};
+        watch_dir(self, path, true, &files);
+        for (size_t i = 0; i < files.count; i++) {
+          push_unique(changed, files.items[i]);
+        }
+        path_list_free(&files);
+      }
+      free(path);
+    }
+    timeout = settle_ms;
+  }
+}
+
+#else
+
+RgbasmWatch *rgbasm_watch_new(void) {
+  return NULL;
+}
+
+void rgbasm_watch_delete(RgbasmWatch *self) {
+  (void)self;
+}
+
+bool rgbasm_watch_add(RgbasmWatch *self, const char *dir, bool recursive) {
+  (void)self;
+  (void)dir;
+  (void)recursive;
+  return false;
+}
+
+bool rgbasm_watch_next(RgbasmWatch *self, PathList *changed, int settle_ms) {
+  (void)self;
+  (void)changed;
+  (void)settle_ms;
+  return false;
+}
+
+#endif
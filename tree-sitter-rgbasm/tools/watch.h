@@ -0,0 +1,28 @@
+#ifndef RGBASM_TOOLS_WATCH_H_
+#define RGBASM_TOOLS_WATCH_H_
+
+#include "util.h"
+
+#include <stdbool.h>
+
+// Watches directories for changed, created, deleted and renamed files with
+// inotify. Not available on other systems, rgbasm_watch_new returns NULL
+// there.
+
+typedef struct RgbasmWatch RgbasmWatch;
+
+RgbasmWatch *rgbasm_watch_new(void);
+void rgbasm_watch_delete(RgbasmWatch *self);
+
+// Watches `dir` unless it is watched already, with `recursive` also its
+// subdirectories except hidden ones.
+bool rgbasm_watch_add(RgbasmWatch *self, const char *dir, bool recursive);
+
+// Blocks until a file in a watched directory changed, then collects changes
+// until none came for `settle_ms` milliseconds, so a save that writes and
+// renames is reported once. Appends the paths of the changed files, each once;
+// directories created meanwhile are watched and their files reported.
+// Returns false on an error.
+bool rgbasm_watch_next(RgbasmWatch *self, PathList *changed, int settle_ms);
+
+#endif // RGBASM_TOOLS_WATCH_H_